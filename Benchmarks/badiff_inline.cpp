@@ -0,0 +1,53 @@
+//
+//  badiff_inline.cpp
+//  fadbadxx Benchmarks
+//
+//  Gradient of a long sin/exp/pow/sqrt/div chain with heap adjoints,
+//  B<double>, and with one inline adjoint per node, B<double,1>.
+//
+
+#include "badiff.h"
+#include "bench.h"
+#include <cmath>
+#include <vector>
+
+using namespace fadbad;
+
+template <class V>
+V chain(const std::vector<V>& x)
+{
+	V s=0;
+	for(size_t i=0;i+1<x.size();++i)
+	{
+		V a=x[i]*x[i+1];
+		s+=sin(a)+exp(x[i]/3.0)-pow(x[i+1],2)+sqrt(x[i]*x[i]+1.0)/(2.0+cos(x[i]));
+	}
+	return s;
+}
+
+template <unsigned int N>
+double gradientTime(const int n, std::vector<double>& g)
+{
+	return bestOf(5,[&]()
+	{
+		std::vector<B<double,N> > x(n);
+		for(int i=0;i<n;++i) x[i]=0.01*i;
+		{
+			B<double,N> f=chain(x);
+			f.diff(0,1);
+		}
+		for(int i=0;i<n;++i) g[i]=x[i].d(0);
+	});
+}
+
+int main()
+{
+	const int n=200000;
+	std::vector<double> g0(n),g1(n);
+	const double t0=gradientTime<0>(n,g0), t1=gradientTime<1>(n,g1);
+	double err=0;
+	for(int i=0;i<n;++i) err=std::max(err,std::fabs(g0[i]-g1[i]));
+	std::printf("B<double>   %8.1f ms\n",t0*1e3);
+	std::printf("B<double,1> %8.1f ms  (%.2fx, max gradient difference %g)\n",t1*1e3,t0/t1,err);
+	return 0;
+}
@@ -0,0 +1,27 @@
+//
+//  bench.h
+//  fadbadxx Benchmarks
+//
+
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+// Best wall-clock time in seconds of reps calls of fn():
+template <class FN>
+double bestOf(const int reps, FN fn)
+{
+	double best=1e300;
+	for(int r=0;r<reps;++r)
+	{
+		const std::chrono::steady_clock::time_point t0=std::chrono::steady_clock::now();
+		fn();
+		best=std::min(best,std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count());
+	}
+	return best;
+}
+
+#endif
@@ -0,0 +1,132 @@
+//
+//  ddouble.cpp
+//  fadbadxx Benchmarks
+//
+//  DDouble against double and long double: elementary functions, T graph
+//  and Taylor program expansions to order 40, with the deviation of the
+//  double and DDouble results from long double. long double is the
+//  portable reference; where it is 80-bit x87 its 64-bit significand
+//  bounds the deviation that can be seen (about 1e-19), the 106-bit
+//  accuracy of DDouble is checked in Tests/fadbadxxTests/ddouble.cpp.
+//
+
+#include "ddouble.h"
+#include "tadiff.h"
+#include "tape.h"
+#include "taylorprogram.h"
+#include "bench.h"
+#include <cmath>
+#include <vector>
+
+using namespace fadbad;
+
+const int Calls=10000, Order=40;
+
+long double ld(const double a) { return a; }
+long double ld(const DDouble& a) { return (long double)a.hi+(long double)a.lo; }
+
+struct Fn
+{
+	template <class V> V operator()(const V* x) const
+	{
+		const V& X=x[0];
+		return exp(sin(X))*atan(X)/(1.0+X*X)+sqrt(1.0+X*X)*log(2.0+X)-X*X*X*cos(X);
+	}
+};
+
+// Time per call in ns of f over Calls arguments, and the largest relative
+// deviation of its results from long double:
+template <class U, class FN, class LFN>
+void function(const char* name, FN f, LFN lf)
+{
+	std::vector<U> a(Calls), r(Calls);
+	std::vector<long double> l(Calls);
+	for(int i=0;i<Calls;++i) { a[i]=U(0.1+2.0*i/Calls)/3.0; l[i]=lf(ld(a[i])); }
+	const double t=bestOf(20,[&]() { for(int i=0;i<Calls;++i) r[i]=f(a[i]); });
+	double e=0;
+	for(int i=0;i<Calls;++i) e=std::max(e,(double)(std::fabs(ld(r[i])-l[i])/std::fabs(l[i])));
+	std::printf("  %-6s %7.1f ns, max rel dev %.1e\n",name,t/Calls*1e9,e);
+}
+
+template <class U> void functions(const char* type)
+{
+	std::printf("%s:\n",type);
+	function<U>("add",[](const U& x) { return x+x/3.0; },[](long double x) { return x+x/3.0L; });
+	function<U>("mul",[](const U& x) { return x*x; },[](long double x) { return x*x; });
+	function<U>("div",[](const U& x) { return 1.0/x; },[](long double x) { return 1/x; });
+	function<U>("sqrt",[](const U& x) { return sqrt(x); },[](long double x) { return std::sqrt(x); });
+	function<U>("exp",[](const U& x) { return exp(x); },[](long double x) { return std::exp(x); });
+	function<U>("log",[](const U& x) { return log(x); },[](long double x) { return std::log(x); });
+	function<U>("sin",[](const U& x) { return sin(x); },[](long double x) { return std::sin(x); });
+	function<U>("atan",[](const U& x) { return atan(x); },[](long double x) { return std::atan(x); });
+}
+
+template <class U> struct Graph
+{
+	T<U,Order+1> x,y;
+	Graph()
+	{
+		x=U(0.3); x[1]=U(1.0);
+		y=Fn()(&x);
+	}
+	double time()
+	{
+		return bestOf(20,[&]() { y.reset(); y.eval(Order); });
+	}
+};
+
+template <class U> double maxDev(const U* c, const T<long double,Order+1>& ref)
+{
+	double e=0;
+	for(int k=0;k<=Order;++k)
+		e=std::max(e,(double)(std::fabs(ld(c[k])-ref[k])/std::fabs(ref[k])));
+	return e;
+}
+
+template <class U> double powTail()
+{
+	T<U,Order+1> x;
+	x=U(0.3); x[1]=U(1.0);
+	T<U,Order+1> y=pow(x,3);
+	y.eval(Order);
+	double m=0;
+	for(int k=4;k<=Order;++k) m=std::max(m,(double)std::fabs(ld(y[k])));
+	return m;
+}
+
+int main()
+{
+	functions<double>("double");
+	functions<DDouble>("DDouble");
+
+	Graph<double> gd;
+	Graph<DDouble> gdd;
+	Graph<long double> gl;
+	const double td=gd.time(), tdd=gdd.time(), tl=gl.time();
+	std::vector<double> cd(Order+1);
+	std::vector<DDouble> cdd(Order+1);
+	for(int k=0;k<=Order;++k) { cd[k]=gd.y[k]; cdd[k]=gdd.y[k]; }
+	std::printf("T graph K=%d: double %.1f us, DDouble %.1f us (%.1fx), long double %.1f us (%.1fx)\n",
+		Order,td*1e6,tdd*1e6,tdd/td,tl*1e6,tl/td);
+	std::printf("  max rel dev from long double: double %.1e, DDouble %.1e\n",
+		maxDev(&cd[0],gl.y),maxDev(&cdd[0],gl.y));
+
+	// pow(x,3) runs the power recurrence, whose rounding errors grow with
+	// the order; the exact coefficients above 3 are 0.
+	std::printf("pow(x,3) at 0.3, max |c_k| for k=4..%d: double %.1e, DDouble %.1e\n",
+		Order,powTail<double>(),powTail<DDouble>());
+
+	double x0=0.3;
+	Tape tape;
+	tape.record(Fn(),&x0,1);
+	TaylorProgram<double> pd(tape,Order);
+	TaylorProgram<DDouble> pdd(tape,Order);
+	std::vector<double> xd(Order+1,0.0), yd(Order+1);
+	std::vector<DDouble> xdd(Order+1), ydd(Order+1);
+	xd[0]=0.3; xd[1]=1; xdd[0]=0.3; xdd[1]=1.0;
+	const double sd=bestOf(50,[&]() { pd.evaluate(&xd[0],&yd[0]); });
+	const double sdd=bestOf(50,[&]() { pdd.evaluate(&xdd[0],&ydd[0]); });
+	std::printf("TaylorProgram K=%d: double %.1f us, DDouble %.1f us (%.1fx), DDouble max rel dev %.1e\n",
+		Order,sd*1e6,sdd*1e6,sdd/sd,maxDev(&ydd[0],gl.y));
+	return 0;
+}
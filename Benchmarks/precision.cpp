@@ -0,0 +1,184 @@
+//
+//  precision.cpp
+//  fadbadxx Benchmarks
+//
+//  Single and mixed precision against double: F and B on a 200 input
+//  model, float adjoints of a tape with 200k inputs, and Taylor programs
+//  to order 30 in double, float, double/float (MixedTaylorProgram) and
+//  Lanes, with their errors relative to double. Run with any argument to
+//  flush subnormals (FlushSubnormals) during the float runs.
+//
+
+#include "tadiff.h"
+#include "fadiff.h"
+#include "badiff.h"
+#include "tape.h"
+#include "taylorprogram.h"
+#include "simdlanes.h"
+#include "precision.h"
+#include "bench.h"
+#include <cmath>
+#include <vector>
+
+using namespace fadbad;
+
+const unsigned int Vars=200, Directions=32, TapeVars=200000, Order=30;
+
+template <class V> V model(const V* x, const unsigned int n)
+{
+	V s=0.0;
+	for(unsigned int i=0;i<n;++i)
+		s=s+sin(x[i])*exp(x[(i+1)%n]*0.1)/(1.0+sqr(x[(i+3)%n]))+sqrt(sqr(x[i])+1.0)*0.5;
+	return s;
+}
+
+struct Model
+{
+	template <class V> V operator()(const V* x) const { return model(x,TapeVars); }
+};
+
+struct Series
+{
+	template <class V> V operator()(const V* x) const
+	{
+		V s=0.0;
+		for(int i=0;i<50;++i) s=s+sin(x[0]*(0.1*i))*exp(x[1]*0.05)/(1.0+sqr(x[0]+0.01*i));
+		return s;
+	}
+};
+
+double relErr(const std::vector<double>& a, const std::vector<double>& ref)
+{
+	double err=0;
+	for(unsigned int k=0;k<ref.size();++k)
+		err=std::max(err,std::fabs(a[k]-ref[k])/std::max(1e-3,std::fabs(ref[k])));
+	return err;
+}
+
+template <class U> std::vector<double> forward(const char* name, const std::vector<double>* ref)
+{
+	std::vector< F<U,Directions> > x(Vars);
+	std::vector<double> d(Directions);
+	const double t=bestOf(20,[&]()
+	{
+		for(unsigned int i=0;i<Vars;++i)
+		{
+			x[i]=U(0.3+0.01*i);
+			if (i<Directions) x[i].diff(i);
+		}
+		F<U,Directions> y=model(&x[0],Vars);
+		for(unsigned int k=0;k<Directions;++k) d[k]=double(y.d(k));
+	});
+	std::printf("  F<%s,%u> %8.1f us",name,Directions,t*1e6);
+	if (ref) std::printf("  max rel err %.2g",relErr(d,*ref));
+	std::printf("\n");
+	return d;
+}
+
+template <class U> std::vector<double> reverse(const char* name, const std::vector<double>* ref)
+{
+	std::vector< B<U> > x(Vars);
+	std::vector<double> d(Vars);
+	const double t=bestOf(20,[&]()
+	{
+		for(unsigned int i=0;i<Vars;++i) x[i]=U(0.3+0.01*i);
+		B<U> y=model(&x[0],Vars);
+		y.diff(0,1);
+		for(unsigned int k=0;k<Vars;++k) d[k]=double(x[k].d(0));
+	});
+	std::printf("  B<%s> %8.1f us",name,t*1e6);
+	if (ref) std::printf("  max rel err %.2g",relErr(d,*ref));
+	std::printf("\n");
+	return d;
+}
+
+void tapeGradient()
+{
+	std::vector<double> x(TapeVars);
+	for(unsigned int i=0;i<TapeVars;++i) x[i]=0.3+1e-6*i;
+	Tape tape;
+	tape.record(Model(),&x[0],TapeVars);
+	std::vector<double> g(TapeVars);
+	std::vector<float> gf(TapeVars);
+	const double td=bestOf(10,[&]() { tape.gradient(&x[0],&g[0]); });
+	const double tf=bestOf(10,[&]() { tape.gradient(&x[0],&gf[0]); });
+	std::vector<double> gd(gf.begin(),gf.end());
+	std::printf("tape gradient, %u operations: double adjoints %.2f ms, float adjoints %.2f ms, max rel err %.2g\n",
+		tape.size(),td*1e3,tf*1e3,relErr(gd,g));
+}
+
+void taylor()
+{
+	const unsigned int n=Order+1, split=8;
+	double x0[2]={0.3,0.7};
+	Tape tape;
+	tape.record(Series(),x0,2);
+	// x0=0.3+t, x1=0.7+0.5t:
+	std::vector<double> x(2*n,0.0), yd(n), ym(n);
+	x[0]=0.3; x[1]=1; x[n]=0.7; x[n+1]=0.5;
+	std::vector<float> xf(x.begin(),x.end()), yf(n);
+	TaylorProgram<double> pd(tape,Order);
+	TaylorProgram<float> pf(tape,Order);
+	MixedTaylorProgram<double,float> pm(tape,Order,split);
+	const double td=bestOf(50,[&]() { pd.evaluate(&x[0],&yd[0]); });
+	const double tf=bestOf(50,[&]() { pf.evaluate(&xf[0],&yf[0]); });
+	const double tm=bestOf(50,[&]() { pm.evaluate(&x[0],&ym[0]); });
+	std::printf("Taylor program K=%u: double %.1f us, float %.1f us, mixed (split %u) %.1f us\n",
+		Order,td*1e6,tf*1e6,split,tm*1e6);
+	for(double h: {0.05,0.5})
+	{
+		double sd=0,sf=0,sm=0,hk=1;
+		for(unsigned int k=0;k<n;++k)
+		{
+			sd+=yd[k]*hk; sf+=yf[k]*hk; sm+=ym[k]*hk;
+			hk*=h;
+		}
+		std::printf("  series at h=%g, rel err vs double: float %.2g, mixed %.2g\n",
+			h,std::fabs(sf-sd)/std::fabs(sd),std::fabs(sm-sd)/std::fabs(sd));
+	}
+	// 8 and 16 expansions per pass:
+	typedef Lanes<double,8> LD;
+	typedef Lanes<float,8> LF;
+	typedef Lanes<float,16> LF16;
+	TaylorProgram<LD> ld(tape,Order);
+	TaylorProgram<LF> lf(tape,Order);
+	TaylorProgram<LF16> lf16(tape,Order);
+	std::vector<LD> xld(2*n), yld(n);
+	std::vector<LF> xlf(2*n), ylf(n);
+	std::vector<LF16> xl16(2*n), yl16(n);
+	for(unsigned int i=0;i<2*n;++i) { xld[i]=x[i]; xlf[i]=float(x[i]); xl16[i]=float(x[i]); }
+	const double a=bestOf(30,[&]() { ld.evaluate(&xld[0],&yld[0]); });
+	const double b=bestOf(30,[&]() { lf.evaluate(&xlf[0],&ylf[0]); });
+	const double c=bestOf(30,[&]() { lf16.evaluate(&xl16[0],&yl16[0]); });
+	MixedTaylorProgram<LD,LF> lm(tape,Order,split);
+	const double m=bestOf(30,[&]() { lm.evaluate(&xld[0],&yld[0]); });
+	std::printf("  per expansion: Lanes<double,8> %.2f us, Lanes<float,8> %.2f us, Lanes<float,16> %.2f us, mixed Lanes<double/float,8> %.2f us\n",
+		a/8*1e6,b/8*1e6,c/16*1e6,m/8*1e6);
+	// T graphs:
+	T<double> t[2];
+	T<float> u0=0.3f, u1=0.7f;
+	t[0]=0.3; t[1]=0.7;
+	t[0][1]=1; t[1][1]=0.5; u0[1]=1; u1[1]=0.5f;
+	T<double> rd=Series()(t);
+	T<float> rf=0.0f;
+	for(int i=0;i<50;++i) rf=rf+sin(u0*float(0.1*i))*exp(u1*0.05f)/(1.0f+sqr(u0+float(0.01*i)));
+	const double ga=bestOf(30,[&]() { rd.reset(); rd.eval(Order); });
+	const double gb=bestOf(30,[&]() { rf.reset(); rf.eval(Order); });
+	std::printf("T graph K=%u: T<double> %.1f us, T<float> %.1f us, c[K] rel err %.2g\n",
+		Order,ga*1e6,gb*1e6,std::fabs(rf[Order]-rd[Order])/std::fabs(rd[Order]));
+}
+
+int main(int argc, char**)
+{
+	FlushSubnormals* flush=argc>1?new FlushSubnormals:0;
+	std::printf("forward, %u inputs:\n",Vars);
+	const std::vector<double> fd=forward<double>("double",0);
+	forward<float>("float",&fd);
+	std::printf("reverse, %u inputs:\n",Vars);
+	const std::vector<double> bd=reverse<double>("double",0);
+	reverse<float>("float",&bd);
+	tapeGradient();
+	taylor();
+	delete flush;
+	return 0;
+}
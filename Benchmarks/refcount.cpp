@@ -0,0 +1,66 @@
+//
+//  refcount.cpp
+//  fadbadxx Benchmarks
+//
+//  Cost of building expressions on a shared preamble graph, in ns per
+//  node including allocation, from 1, 2 and 4 threads. This build uses
+//  plain reference counts; refcount_atomic.cpp builds the same program
+//  with FADBAD_ATOMIC_RC. The plain build is only timed on one thread:
+//  its counts race when threads share nodes.
+//
+
+#include <thread>
+#include "tadiff.h"
+#include "badiff.h"
+#include "bench.h"
+#include <vector>
+
+using namespace fadbad;
+
+const unsigned int P=64, Models=4000, Terms=200;
+
+template <class V>
+void run(const char* name)
+{
+	std::vector<V> pre(P);
+	for(unsigned int i=0;i<P;++i) pre[i]=V(0.01*i);
+	for(unsigned int i=1;i<P;++i) pre[i]=pre[i]*pre[i-1]+pre[i];
+#ifdef FADBAD_ATOMIC_RC
+	const unsigned int maxThreads=4;
+#else
+	const unsigned int maxThreads=1;
+#endif
+	for(unsigned int threads=1;threads<=maxThreads;threads*=2)
+	{
+		std::vector<double> sink(threads);
+		const double t=bestOf(3,[&]()
+		{
+			std::vector<std::thread> workers;
+			for(unsigned int w=0;w<threads;++w) workers.emplace_back([&,w]()
+			{
+				double acc=0;
+				for(unsigned int m=w;m<Models;m+=threads)
+				{
+					V s=pre[m%P];
+					for(unsigned int k=0;k<Terms;++k) s=s+pre[(m+k)%P]*pre[(m*7+k)%P];
+					acc+=s.val();
+				}
+				sink[w]=acc;
+			});
+			for(unsigned int w=0;w<threads;++w) workers[w].join();
+		});
+		std::printf("%s, %u thread%s: %6.1f ns/node\n",name,threads,threads>1?"s":"",t/(Models*Terms*2.0)*1e9);
+	}
+}
+
+int main()
+{
+#ifdef FADBAD_ATOMIC_RC
+	std::printf("atomic reference counts\n");
+#else
+	std::printf("plain reference counts\n");
+#endif
+	run< T<double> >("T");
+	run< B<double> >("B");
+	return 0;
+}
@@ -0,0 +1,9 @@
+//
+//  refcount_atomic.cpp
+//  fadbadxx Benchmarks
+//
+//  refcount.cpp with FADBAD_ATOMIC_RC.
+//
+
+#define FADBAD_ATOMIC_RC
+#include "refcount.cpp"
@@ -0,0 +1,76 @@
+//
+//  tape_minimize.cpp
+//  fadbadxx Benchmarks
+//
+//  L-BFGS and trust-region Newton-CG on recorded Rosenbrock and extended
+//  Powell objectives, gtol 1e-6. Pass the sizes to run as arguments
+//  (default 1000 100000).
+//
+
+#include "tape.h"
+#include "minimize.h"
+#include "bench.h"
+#include <cstdlib>
+#include <vector>
+
+using namespace fadbad;
+
+struct Rosenbrock
+{
+	unsigned int n;
+	template <class V> V operator()(const V* x) const
+	{
+		V s=0;
+		for(unsigned int i=0;i+1<n;i+=2) s+=100.0*sqr(x[i+1]-sqr(x[i]))+sqr(1.0-x[i]);
+		return s;
+	}
+	void start(double* x) const { for(unsigned int i=0;i+1<n;i+=2) { x[i]=-1.2; x[i+1]=1; } }
+};
+
+struct Powell
+{
+	unsigned int n;
+	template <class V> V operator()(const V* x) const
+	{
+		V s=0;
+		for(unsigned int i=0;i+3<n;i+=4)
+			s+=sqr(x[i]+10.0*x[i+1])+5.0*sqr(x[i+2]-x[i+3])+pow(x[i+1]-2.0*x[i+2],4)+10.0*pow(x[i]-x[i+3],4);
+		return s;
+	}
+	void start(double* x) const { for(unsigned int i=0;i+3<n;i+=4) { x[i]=3; x[i+1]=-1; x[i+2]=0; x[i+3]=1; } }
+};
+
+void report(const char* name, const MinimizeStats& s)
+{
+	std::printf("  %-14s it %5u  grads %5u  hv %6u  f %9.2e  |g| %8.1e  %8.3f s  %9.0f it/s%s\n",
+		name,s.iterations,s.gradients,s.hessVecs,s.f,s.gradNorm,s.seconds,s.iterationsPerSecond(),
+		s.converged?"":"  (not converged)");
+}
+
+template <class FUN>
+void run(const char* problem, const FUN& f)
+{
+	std::vector<double> x(f.n);
+	f.start(&x[0]);
+	Tape tape;
+	tape.record(f,&x[0],f.n);
+	std::printf("%s n=%u, %u tape operations\n",problem,f.n,tape.size());
+	LBFGS lbfgs(tape);
+	report("L-BFGS",lbfgs.minimize(&x[0],1e-6,5000));
+	f.start(&x[0]);
+	TrustRegionNewtonCG tr(tape);
+	report("TR Newton-CG",tr.minimize(&x[0],1e-6,5000));
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<unsigned int> sizes;
+	for(int i=1;i<argc;++i) sizes.push_back((unsigned int)std::atoi(argv[i]));
+	if (sizes.empty()) { sizes.push_back(1000); sizes.push_back(100000); }
+	for(unsigned int n: sizes)
+	{
+		run("Rosenbrock",Rosenbrock{n});
+		run("extended Powell",Powell{n});
+	}
+	return 0;
+}
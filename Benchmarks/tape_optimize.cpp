@@ -0,0 +1,61 @@
+//
+//  tape_optimize.cpp
+//  fadbadxx Benchmarks
+//
+//  Tape length, gradient replay time and pass time of optimize() on
+//  model code with neutral parameters, repeated subexpressions and an
+//  unused diagnostic. Pass n as the argument (default 200000).
+//
+
+#include "tapeopt.h"
+#include "bench.h"
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace fadbad;
+
+struct Model
+{
+	unsigned int n;
+	double gain, offset, unit;
+	template <class V> V operator()(const V* x) const
+	{
+		V f=0, diag=0;
+		for(unsigned int i=0;i+1<n;++i)
+		{
+			V a=x[i]*gain+offset; // gain 1, offset 0
+			V b=x[i+1]*unit*1000.0/1000.0; // unit 1
+			V d=(a-b)*(a-b);
+			V e=exp(-x[i]*x[i])*exp(-x[i]*x[i]);
+			diag+=sqrt(d+1.0)*log(1.0+e); // never used
+			V c=V(2.0)*V(0.5); // constants only
+			f+=c*d*2.0*0.5+pow(e,1)*V(3.0)-(-x[i])*0.1*10.0;
+		}
+		return f;
+	}
+};
+
+int main(int argc, char** argv)
+{
+	const unsigned int n=argc>1?(unsigned int)std::atoi(argv[1]):200000;
+	std::vector<double> x(n),g1(n),g2(n);
+	for(unsigned int i=0;i<n;++i) x[i]=0.3+0.001*(i%100);
+	const Model model={n,1.0,0.0,1.0};
+	Tape tape;
+	const double tRecord=bestOf(1,[&]() { tape.record(model,&x[0],n); });
+	Tape opt=tape;
+	TapeOptimizeStats s;
+	const double tOptimize=bestOf(1,[&]() { s=optimize(opt); });
+	std::printf("n=%u: %u -> %u operations (%.1f%%)\n",n,s.before,s.after,100.0*s.after/s.before);
+	std::printf("  dead %u  folded %u  identities %u  common %u  scalings %u\n",s.dead,s.folded,s.identities,s.common,s.scalings);
+	std::printf("  record %.1f ms, optimize %.1f ms\n",tRecord*1e3,tOptimize*1e3);
+	double f1=0, f2=0;
+	const double t1=bestOf(20,[&]() { f1=tape.gradient(&x[0],&g1[0]); });
+	const double t2=bestOf(20,[&]() { f2=opt.gradient(&x[0],&g2[0]); });
+	double err=0;
+	for(unsigned int i=0;i<n;++i) err=std::max(err,std::fabs(g1[i]-g2[i]));
+	std::printf("  gradient replay %.2f ms -> %.2f ms (%.2fx)\n",t1*1e3,t2*1e3,t1/t2);
+	std::printf("  f %.17g vs %.17g, max gradient difference %.2g\n",f1,f2,err);
+	return 0;
+}
@@ -0,0 +1,77 @@
+//
+//  tape_renumber.cpp
+//  fadbadxx Benchmarks
+//
+//  Far reads, replay times, Taylor program buffers and (where perf
+//  events are allowed) cache misses of an assembly-style tape, 400k
+//  terms scattered into 50k residuals, before and after tapeRenumber.
+//
+
+#include "tapeopt.h"
+#include "taylorprogram.h"
+#include "perfcount.h"
+#include "bench.h"
+#include <random>
+#include <vector>
+
+using namespace fadbad;
+
+const unsigned int Terms=400000, Rows=50000, Inputs=100000;
+
+struct Assembly
+{
+	template <class V> void operator()(const V* x, V* y) const
+	{
+		std::mt19937 gen(2);
+		std::uniform_int_distribution<unsigned int> ux(0,Inputs-1), ur(0,Rows-1);
+		std::vector<V> t(Terms);
+		std::vector<unsigned int> row(Terms);
+		for(unsigned int k=0;k<Terms;++k) t[k]=x[ux(gen)]*x[ux(gen)];
+		for(unsigned int k=0;k<Terms;++k) t[k]=sin(t[k]);
+		for(unsigned int k=0;k<Terms;++k) t[k]=t[k]*0.5+x[ux(gen)];
+		for(unsigned int k=0;k<Terms;++k) row[k]=ur(gen);
+		std::vector<V> r(Rows,V(0.0));
+		for(unsigned int k=0;k<Terms;++k) r[row[k]]=r[row[k]]+t[k];
+		V s=r[0]*r[0];
+		for(unsigned int i=1;i<Rows;++i) s=s+r[i]*r[i];
+		y[0]=s;
+	}
+};
+
+void run(const char* name, const Tape& tape, const double* x)
+{
+	std::vector<double> v(tape.size()),w(tape.size());
+	for(unsigned int j=0;j<Inputs;++j) v[tape.input(j)]=x[j];
+	const double tf=bestOf(20,[&]() { tape.forward(&v[0]); });
+	const double tr=bestOf(20,[&]()
+	{
+		std::fill(w.begin(),w.end(),0.0);
+		w[tape.output(0)]=1;
+		tape.reverse(&v[0],&w[0]);
+	});
+	CacheCounters counters;
+	counters.start();
+	tape.reverse(&v[0],&w[0]);
+	counters.stop();
+	TaylorProgram<double> program(tape,8);
+	std::vector<double> xs(Inputs*9,0.0),ys(9);
+	for(unsigned int j=0;j<Inputs;++j) { xs[j*9]=x[j]; xs[j*9+1]=1; }
+	const double tp=bestOf(5,[&]() { program.evaluate(&xs[0],&ys[0]); });
+	std::printf("%-11s far reads %8llu  forward %6.2f ms  reverse %6.2f ms  Taylor(8) %7.2f ms, %u buffers\n",
+		name,tapeFarReads(tape),tf*1e3,tr*1e3,tp*1e3,program.buffers());
+	if (counters.available())
+		std::printf("%-11s reverse sweep L1D misses %llu, LL misses %llu\n","",counters.l1Misses(),counters.llMisses());
+}
+
+int main()
+{
+	std::vector<double> x(Inputs);
+	for(unsigned int i=0;i<Inputs;++i) x[i]=0.1+1e-5*i;
+	Tape tape;
+	tape.record(Assembly(),&x[0],Inputs,1);
+	std::printf("%u operations\n",tape.size());
+	run("recorded",tape,&x[0]);
+	const bool kept=tapeRenumber(tape);
+	run(kept?"renumbered":"(rejected)",tape,&x[0]);
+	return 0;
+}
@@ -20,6 +20,9 @@ public class TaylorValue {
     /// The underlying bridge object to interact with the FADBAD library.
     fileprivate var taylorBridge: fadbad.bridge.TaylorBridge
     
+    /// The right-hand side bound to an ODE state variable, kept alive for as long as the variable.
+    fileprivate var rightHandSide: TaylorValue?
+    
     // MARK: - Initializers
     
     /// Creates a new Taylor series value with a constant value.
@@ -38,6 +41,26 @@ public class TaylorValue {
         taylorBridge = bridge
     }
     
+    /// Creates the state variable `x` of an initial value problem `x' = f(x)`, `x(0) = initialValue`.
+    ///
+    /// Record the right-hand side on the state variables and bind it with `bind(to:)`.
+    /// Evaluating a state variable then computes the coefficients of the solution,
+    /// with no loop over the orders on the caller's side.
+    ///
+    /// ```swift
+    /// let x = T(odeInitialValue: 0.0)
+    /// let y = T(odeInitialValue: 1.0)
+    /// x.bind(to: y)  // x' = y
+    /// y.bind(to: -x) // y' = -x
+    /// x.evaluate(to: 10)
+    /// // x[k] are the Taylor coefficients of sin(t)
+    /// ```
+    ///
+    /// - Parameter initialValue: The value of the state variable at the expansion point.
+    public init (odeInitialValue initialValue: Double) {
+        taylorBridge = fadbad.bridge.BuildODEVariable(initialValue)
+    }
+    
     // MARK: - Public functions
     
     /// Computes the coefficients of the Taylor series expansion up to the specified order.
@@ -56,6 +79,40 @@ public class TaylorValue {
         taylorBridge.eval(UInt32(i))
     }
     
+    /// Computes the coefficients one order at a time until the series is accurate enough at a given step.
+    ///
+    /// Evaluation stops at the first order `k >= 1` where the last two terms,
+    /// `|x[k-1]| * step^(k-1)` and `|x[k]| * step^k`, are both at most `tolerance`,
+    /// an estimate of the truncation error of the Taylor polynomial at `step`.
+    ///
+    /// ```swift
+    /// let x = T(0.0)
+    /// x[1] = 1
+    /// let f = exp(x)
+    /// let order = f.evaluate(step: 0.1, tolerance: 1e-12)
+    /// // order is 9: 0.1^8/8! and 0.1^9/9! are below 1e-12
+    /// ```
+    ///
+    /// - Parameters:
+    ///   - step: The distance from the expansion point at which the series is used.
+    ///   - tolerance: The largest acceptable truncation error.
+    ///   - maxOrder: The highest order to evaluate if the tolerance is not met.
+    /// - Returns: The order reached.
+    @discardableResult
+    public func evaluate(step: Double, tolerance: Double, maxOrder: UInt = 39) -> UInt {
+        return UInt(taylorBridge.evalToTolerance(step, tolerance, UInt32(maxOrder)))
+    }
+    
+    /// Binds an ODE state variable to the right-hand side of its differential equation.
+    ///
+    /// The receiver must have been created with `init(odeInitialValue:)`.
+    ///
+    /// - Parameter rhs: The recorded right-hand side `f(x)`.
+    public func bind(to rhs: TaylorValue) {
+        taylorBridge.bindRightHandSide(rhs.taylorBridge)
+        rightHandSide = rhs
+    }
+    
     /// Resets the Taylor series, clearing all computed coefficients while retaining the base value.
     ///
     /// This method is useful for reinitializing the series without creating a new instance.
@@ -47,6 +47,16 @@ unsigned int TaylorBridge::eval(const unsigned int& i)
     return m_taylorType.eval(i);
 }
 
+unsigned int TaylorBridge::evalToTolerance(const double& step, const double& tolerance, const unsigned int& maxOrder)
+{
+    return fadbad::evalToTolerance(m_taylorType, step, tolerance, maxOrder);
+}
+
+void TaylorBridge::bindRightHandSide(const TaylorBridge& rhs)
+{
+    fadbad::odeBind(m_taylorType, rhs.getTaylorType());
+}
+
 void TaylorBridge::reset()
 {
     m_taylorType.reset();
@@ -124,6 +134,11 @@ TaylorBridge BuildDivision(const double& lhs, const TaylorBridge& rhs)
     return TaylorBridge(result);
 }
 
+TaylorBridge BuildODEVariable(const double& initialValue)
+{
+    return fadbad::odeVariable(initialValue);
+}
+
 TaylorBridge BuildUnaryMinus(const TaylorBridge& value)
 {
     auto result = -(value.getTaylorType());
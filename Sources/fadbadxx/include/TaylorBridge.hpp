@@ -28,6 +28,9 @@ public:
     void setSubscriptValue(const int& index, const double& value);
     
     unsigned int eval(const unsigned int& i);
+    unsigned int evalToTolerance(const double& step, const double& tolerance, const unsigned int& maxOrder);
+    
+    void bindRightHandSide(const TaylorBridge& rhs);
     
     void reset();
     
@@ -51,6 +54,8 @@ TaylorBridge BuildDivision(const TaylorBridge& lhs, const TaylorBridge& rhs);
 TaylorBridge BuildDivision(const TaylorBridge& lhs, const double& rhs);
 TaylorBridge BuildDivision(const double& lhs, const TaylorBridge& rhs);
 
+TaylorBridge BuildODEVariable(const double& initialValue);
+
 TaylorBridge BuildUnaryMinus(const TaylorBridge& value);
 TaylorBridge BuildUnaryPlus(const TaylorBridge& value);
 
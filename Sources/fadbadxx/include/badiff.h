@@ -31,6 +31,7 @@
 #define _BADIFF_H
 
 #include "fadbad.h"
+#include "param.h"
 
 #include <vector>
 #include <stack>
@@ -38,8 +39,75 @@
 namespace fadbad
 {
 
+// Adjoints of a node. With N>0 the graph has exactly N dependents and
+// the adjoints are kept inline in the node, accumulated from zero without
+// allocation or size checks; N=1 is the scalar adjoint of a single
+// output such as a loss function. The RecycleBin is then empty and the
+// sizes passed to diff() and addValues() are only checked in debug
+// builds. With N=0 the number of dependents is chosen at diff() and the
+// adjoints live in recycled heap vectors.
+
+template <typename U, unsigned int N=0>
+class Derivatives // STACK-BASED
+{
+public:
+	struct RecycleBin {};
+private:
+	U m_values[N];
+	bool m_have;
+public:
+	Derivatives():m_have(false){ for(unsigned int i=0;i<N;++i) m_values[i]=Op<U>::myZero(); }
+	void recycle(RecycleBin&) { m_have=false; }
+	bool haveValues() const { return m_have; }
+	unsigned int count() const { return m_have?N:0; }
+	U& diff(RecycleBin&, const unsigned int i, const unsigned int)
+	{
+		USER_ASSERT(i<N,"Index "<<i<<" out of range [0,"<<N<<"]")
+		m_have=true;
+		return m_values[i]=Op<U>::myOne();
+	}
+	void add(RecycleBin&, const Derivatives<U,N>& d)
+	{
+		m_have=true;
+		for(unsigned int i=0;i<N;++i) Op<U>::myCadd(m_values[i],d.m_values[i]);
+	}
+	void sub(RecycleBin&, const Derivatives<U,N>& d)
+	{
+		m_have=true;
+		for(unsigned int i=0;i<N;++i) Op<U>::myCsub(m_values[i],d.m_values[i]);
+	}
+	template <typename V>
+	void add(RecycleBin&, const V& a, const Derivatives<U,N>& d)
+	{
+		m_have=true;
+		for(unsigned int i=0;i<N;++i) Op<U>::myCadd(m_values[i],a*d.m_values[i]);
+	}
+	template <typename V>
+	void sub(RecycleBin&, const V& a, const Derivatives<U,N>& d)
+	{
+		m_have=true;
+		for(unsigned int i=0;i<N;++i) Op<U>::myCsub(m_values[i],a*d.m_values[i]);
+	}
+	void addValues(RecycleBin&, const U* v, const unsigned int n)
+	{
+		USER_ASSERT(n==N,"Size mismatch "<<n<<"!="<<N)
+		m_have=true;
+		for(unsigned int i=0;i<N;++i) Op<U>::myCadd(m_values[i],v[i]);
+	}
+	U& operator[](const unsigned int i)
+	{
+		USER_ASSERT(i<N,"Index "<<i<<" out of bounds [0,"<<N<<"]")
+		return m_values[i];
+	}
+	const U& operator[](const unsigned int i) const
+	{
+		USER_ASSERT(i<N,"Index "<<i<<" out of bounds [0,"<<N<<"]")
+		return m_values[i];
+	}
+};
+
 template <typename U>
-class Derivatives
+class Derivatives<U,0> // HEAP-BASED
 {
 public:
 	class RecycleBin
@@ -85,6 +153,7 @@ public:
 	}
 	
 	bool haveValues() const { return m_values!=0; }
+	unsigned int count() const { return m_values!=0?size():0; }
 
 	U& diff(RecycleBin& bin, const unsigned int i, const unsigned int n)
 	{
@@ -97,7 +166,7 @@ public:
 		USER_ASSERT(m_values->size()==n,"Size mismatch "<<m_values->size()<<"!="<<n)
 		return (*m_values)[i]=Op<U>::myOne();
 	}
-	void add(RecycleBin& bin, const Derivatives<U>& d)
+	void add(RecycleBin& bin, const Derivatives<U,0>& d)
 	{
 		USER_ASSERT(d.size()>0,"Propagating node with no derivatives")
 		if (m_values==0)
@@ -111,7 +180,7 @@ public:
 			for(unsigned int i=0;i<m_values->size();++i) Op<U>::myCadd((*m_values)[i],(*d.m_values)[i]);
 		}
 	}
-	void sub(RecycleBin& bin, const Derivatives<U>& d)
+	void sub(RecycleBin& bin, const Derivatives<U,0>& d)
 	{
 		USER_ASSERT(d.size()>0,"Propagating node with no derivatives")
 		if (m_values==0)
@@ -126,7 +195,7 @@ public:
 		}
 	}
 	template <typename V>
-	void add(RecycleBin& bin, const V& a, const Derivatives<U>& d)
+	void add(RecycleBin& bin, const V& a, const Derivatives<U,0>& d)
 	{
 		USER_ASSERT(d.size()>0,"Propagating node with no derivatives")
 		if (m_values==0)
@@ -140,8 +209,22 @@ public:
 			for(unsigned int i=0;i<m_values->size();++i) Op<U>::myCadd((*m_values)[i],a*(*d.m_values)[i]);
 		}
 	}
+	// Adds n derivative values held in a plain array:
+	void addValues(RecycleBin& bin, const U* v, const unsigned int n)
+	{
+		if (m_values==0)
+		{
+			m_values=bin.popRecycle(n);
+			for(unsigned int i=0;i<n;++i) (*m_values)[i]=v[i];
+		}
+		else
+		{
+			USER_ASSERT(m_values->size()==n,"Size mismatch "<<m_values->size()<<"!="<<n)
+			for(unsigned int i=0;i<n;++i) Op<U>::myCadd((*m_values)[i],v[i]);
+		}
+	}
 	template <typename V>
-	void sub(RecycleBin& bin, const V& a, const Derivatives<U>& d)
+	void sub(RecycleBin& bin, const V& a, const Derivatives<U,0>& d)
 	{
 		USER_ASSERT(d.size()>0,"Propagating node with no derivatives")
 		if (m_values==0)
@@ -187,28 +270,28 @@ public:
 };
 
 
-template <typename U>
+template <typename U, unsigned int N=0>
 class BTypeNameHV // Heap Value
 {
 	U m_val;
-	mutable unsigned int m_rc;
+	mutable RefCount m_rc;
 	
 protected:
-	mutable Derivatives<U> m_derivatives;
+	mutable Derivatives<U,N> m_derivatives;
 	virtual ~BTypeNameHV(){}
 public:
-	BTypeNameHV():m_rc(0),m_derivatives(){}
-	template <typename V> explicit BTypeNameHV(const V& val):m_val(val),m_rc(0),m_derivatives(){}
+	BTypeNameHV():m_rc(),m_derivatives(){}
+	template <typename V> explicit BTypeNameHV(const V& val):m_val(val),m_rc(),m_derivatives(){}
 	const U& val() const { return m_val; }
 	U& val() { return m_val; }
-	void decRef(BTypeNameHV<U>*& pBTypeNameHV) 
+	void decRef(BTypeNameHV<U,N>*& pBTypeNameHV) 
 	{
 		INTERNAL_ASSERT(m_rc>0,"Resource counter negative");
 		if (--m_rc==0)
 		{
 			if (m_derivatives.haveValues())
 			{
-				typename Derivatives<U>::RecycleBin bin;
+				typename Derivatives<U,N>::RecycleBin bin;
 				propagate(bin);
 				m_derivatives.recycle(bin);
 				propagateChildren(bin);
@@ -217,7 +300,7 @@ public:
 		}
 		pBTypeNameHV=0;
 	}
-	void decRef(typename Derivatives<U>::RecycleBin& bin, BTypeNameHV<U>*& pBTypeNameHV) 
+	void decRef(typename Derivatives<U,N>::RecycleBin& bin, BTypeNameHV<U,N>*& pBTypeNameHV) 
 	{
 		INTERNAL_ASSERT(m_rc>0,"Resource counter negative");
 		if (--m_rc==0)
@@ -233,17 +316,19 @@ public:
 		pBTypeNameHV=0;
 	}
 	void incRef() const {++m_rc;}
+	unsigned int refCount() const {return m_rc;}
 
-	U& diff(typename Derivatives<U>::RecycleBin& bin, const unsigned int idx, const unsigned int size)
+	U& diff(typename Derivatives<U,N>::RecycleBin& bin, const unsigned int idx, const unsigned int size)
 	{
 		return m_derivatives.diff(bin,idx,size);
 	}
-	virtual void propagate(typename Derivatives<U>::RecycleBin&) {}
-	virtual void propagateChildren(typename Derivatives<U>::RecycleBin&) {}
-	void add(typename Derivatives<U>::RecycleBin& bin, const Derivatives<U>& d) { m_derivatives.add(bin,d); }
-	void sub(typename Derivatives<U>::RecycleBin& bin, const Derivatives<U>& d) { m_derivatives.sub(bin,d); }
-	void add(typename Derivatives<U>::RecycleBin& bin, const U& a, const Derivatives<U>& d) { m_derivatives.add(bin,a,d); }
-	void sub(typename Derivatives<U>::RecycleBin& bin, const U& a, const Derivatives<U>& d) { m_derivatives.sub(bin,a,d); }
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin&) {}
+	virtual void propagateChildren(typename Derivatives<U,N>::RecycleBin&) {}
+	void add(typename Derivatives<U,N>::RecycleBin& bin, const Derivatives<U,N>& d) { m_derivatives.add(bin,d); }
+	void sub(typename Derivatives<U,N>::RecycleBin& bin, const Derivatives<U,N>& d) { m_derivatives.sub(bin,d); }
+	void add(typename Derivatives<U,N>::RecycleBin& bin, const U& a, const Derivatives<U,N>& d) { m_derivatives.add(bin,a,d); }
+	void sub(typename Derivatives<U,N>::RecycleBin& bin, const U& a, const Derivatives<U,N>& d) { m_derivatives.sub(bin,a,d); }
+	void addValues(typename Derivatives<U,N>::RecycleBin& bin, const U* v, const unsigned int n) { m_derivatives.addValues(bin,v,n); }
 	U& deriv(const unsigned int i) 
 	{
 		USER_ASSERT(m_rc==1,"Still non-propagated dependencies ("<<m_rc-1<<"), the derivative might be wrong")
@@ -251,17 +336,17 @@ public:
 	}
 };
 
-template <typename U>
+template <typename U, unsigned int N=0>
 class BTypeName
 {
 	struct SV // Stack Value refers to reference-counted Heap Value:
 	{
-		mutable BTypeNameHV<U>* m_pBTypeNameHV;
-		SV(BTypeNameHV<U>* pBTypeNameHV):m_pBTypeNameHV(pBTypeNameHV){ m_pBTypeNameHV->incRef(); }
-		SV(const typename BTypeName<U>::SV& sv):m_pBTypeNameHV(sv.m_pBTypeNameHV){ m_pBTypeNameHV->incRef(); }
+		mutable BTypeNameHV<U,N>* m_pBTypeNameHV;
+		SV(BTypeNameHV<U,N>* pBTypeNameHV):m_pBTypeNameHV(pBTypeNameHV){ m_pBTypeNameHV->incRef(); }
+		SV(const typename BTypeName<U,N>::SV& sv):m_pBTypeNameHV(sv.m_pBTypeNameHV){ m_pBTypeNameHV->incRef(); }
 		~SV(){ m_pBTypeNameHV->decRef(m_pBTypeNameHV); }
-		BTypeNameHV<U>* getBTypeNameHV() const { return m_pBTypeNameHV; }
-		void setBTypeNameHV(BTypeNameHV<U>* pBTypeNameHV)
+		BTypeNameHV<U,N>* getBTypeNameHV() const { return m_pBTypeNameHV; }
+		void setBTypeNameHV(BTypeNameHV<U,N>* pBTypeNameHV)
 		{
 			if (m_pBTypeNameHV!=pBTypeNameHV) 
 			{
@@ -277,9 +362,9 @@ class BTypeName
 
 		U& diff(const unsigned int idx, const unsigned int size) 
 		{
-			typename Derivatives<U>::RecycleBin bin;
+			typename Derivatives<U,N>::RecycleBin bin;
 			U& res(m_pBTypeNameHV->diff(bin,idx,size));
-			BTypeNameHV<U>* pHV=new BTypeNameHV<U>(this->val());
+			BTypeNameHV<U,N>* pHV=new BTypeNameHV<U,N>(this->val());
 			m_pBTypeNameHV->decRef(bin,m_pBTypeNameHV);
 			m_pBTypeNameHV=pHV;
 			m_pBTypeNameHV->incRef();
@@ -288,68 +373,69 @@ class BTypeName
 	} m_sv;
 public:
 	typedef U UnderlyingType;
-	BTypeName():m_sv(new BTypeNameHV<U>()){}
-	BTypeName(BTypeNameHV<U>* pBTypeNameHV):m_sv(pBTypeNameHV){}
-	explicit BTypeName(const typename BTypeName<U>::SV& sv):m_sv(sv){}
-	template <typename V> /*explicit*/ BTypeName(const V& val):m_sv(new BTypeNameHV<U>(val)){}
-	BTypeName<U>& operator=(const BTypeName<U>& val) 
+	BTypeName():m_sv(new BTypeNameHV<U,N>()){}
+	BTypeName(BTypeNameHV<U,N>* pBTypeNameHV):m_sv(pBTypeNameHV){}
+	explicit BTypeName(const typename BTypeName<U,N>::SV& sv):m_sv(sv){}
+	template <typename V> /*explicit*/ BTypeName(const V& val):m_sv(new BTypeNameHV<U,N>(val)){}
+	BTypeName<U,N>& operator=(const BTypeName<U,N>& val) 
 	{
 		if (this==&val) return *this;
 		m_sv.setBTypeNameHV(val.m_sv.getBTypeNameHV());
 		return *this; 
 	}
-	template <typename V> BTypeName<U>& operator=(const V& val) { m_sv.setBTypeNameHV(new BTypeNameHV<U>(val)); return *this; }
-	BTypeNameHV<U>* getBTypeNameHV() const { return m_sv.getBTypeNameHV(); }
-	void setBTypeNameHV(const BTypeNameHV<U>* pBTypeNameHV) { m_sv.setBTypeNameHV(pBTypeNameHV); }
+	template <typename V> BTypeName<U,N>& operator=(const V& val) { m_sv.setBTypeNameHV(new BTypeNameHV<U,N>(val)); return *this; }
+	BTypeNameHV<U,N>* getBTypeNameHV() const { return m_sv.getBTypeNameHV(); }
+	void setBTypeNameHV(const BTypeNameHV<U,N>* pBTypeNameHV) { m_sv.setBTypeNameHV(pBTypeNameHV); }
 	const U& val() const { return m_sv.val(); }
 	U& x() { return m_sv.val(); }
 	const U& deriv(const unsigned int i) const { return m_sv.deriv(i); }
 	U& d(const unsigned int i) { return m_sv.deriv(i); }
 	U& diff(const unsigned int idx, const unsigned int size) { return m_sv.diff(idx,size); }
+	U& diff(const unsigned int idx) { USER_ASSERT(N>0,"Number of dependents not fixed") return m_sv.diff(idx,N); }
 	
-	BTypeName<U>& operator+=(const BTypeName<U>& val);
-	BTypeName<U>& operator-=(const BTypeName<U>& val);
-	BTypeName<U>& operator*=(const BTypeName<U>& val);
-	BTypeName<U>& operator/=(const BTypeName<U>& val);
-	template <typename V> BTypeName<U>& operator+=(const V& val);
-	template <typename V> BTypeName<U>& operator-=(const V& val);
-	template <typename V> BTypeName<U>& operator*=(const V& val);
-	template <typename V> BTypeName<U>& operator/=(const V& val);
+	BTypeName<U,N>& operator+=(const BTypeName<U,N>& val);
+	BTypeName<U,N>& operator-=(const BTypeName<U,N>& val);
+	BTypeName<U,N>& operator*=(const BTypeName<U,N>& val);
+	BTypeName<U,N>& operator/=(const BTypeName<U,N>& val);
+	template <typename V> BTypeName<U,N>& operator+=(const V& val);
+	template <typename V> BTypeName<U,N>& operator-=(const V& val);
+	template <typename V> BTypeName<U,N>& operator*=(const V& val);
+	template <typename V> BTypeName<U,N>& operator/=(const V& val);
 };
 
-template <typename U> bool operator==(const BTypeName<U>& val1, const BTypeName<U>& val2) { return Op<U>::myEq(val1.val(),val2.val()); }
-template <typename U> bool operator!=(const BTypeName<U>& val1, const BTypeName<U>& val2) { return Op<U>::myNe(val1.val(),val2.val()); }
-template <typename U> bool operator<(const BTypeName<U>& val1, const BTypeName<U>& val2) { return Op<U>::myLt(val1.val(),val2.val()); }
-template <typename U> bool operator<=(const BTypeName<U>& val1, const BTypeName<U>& val2) { return Op<U>::myLe(val1.val(),val2.val()); }
-template <typename U> bool operator>(const BTypeName<U>& val1, const BTypeName<U>& val2) { return Op<U>::myGt(val1.val(),val2.val()); }
-template <typename U> bool operator>=(const BTypeName<U>& val1, const BTypeName<U>& val2) { return Op<U>::myGe(val1.val(),val2.val()); }
-template <typename U, typename V> bool operator==(const BTypeName<U>& val1, const V& val2) { return Op<U>::myEq(val1.val(),val2); }
-template <typename U, typename V> bool operator==(const V& val1, const BTypeName<U>& val2) { return Op<U>::myEq(val1,val2.val()); }
-template <typename U, typename V> bool operator!=(const BTypeName<U>& val1, const V& val2) { return Op<U>::myNe(val1.val(),val2); }
-template <typename U, typename V> bool operator!=(const V& val1, const BTypeName<U>& val2) { return Op<U>::myNe(val1,val2.val()); }
-template <typename U, typename V> bool operator<(const BTypeName<U>& val1, const V& val2) { return Op<U>::myLt(val1.val(),val2); }
-template <typename U, typename V> bool operator<(const V& val1, const BTypeName<U>& val2) { return Op<U>::myLt(val1,val2.val()); }
-template <typename U, typename V> bool operator<=(const BTypeName<U>& val1, const V& val2) { return Op<U>::myLe(val1.val(),val2); }
-template <typename U, typename V> bool operator<=(const V& val1, const BTypeName<U>& val2) { return Op<U>::myLe(val1,val2.val()); }
-template <typename U, typename V> bool operator>(const BTypeName<U>& val1, const V& val2) { return Op<U>::myGt(val1.val(),val2); }
-template <typename U, typename V> bool operator>(const V& val1, const BTypeName<U>& val2) { return Op<U>::myGt(val1,val2.val()); }
-template <typename U, typename V> bool operator>=(const BTypeName<U>& val1, const V& val2) { return Op<U>::myGe(val1.val(),val2); }
-template <typename U, typename V> bool operator>=(const V& val1, const BTypeName<U>& val2) { return Op<U>::myGe(val1,val2.val()); }
+template <typename U, unsigned int N> bool operator==(const BTypeName<U,N>& val1, const BTypeName<U,N>& val2) { return Op<U>::myEq(val1.val(),val2.val()); }
+template <typename U, unsigned int N> bool operator!=(const BTypeName<U,N>& val1, const BTypeName<U,N>& val2) { return Op<U>::myNe(val1.val(),val2.val()); }
+template <typename U, unsigned int N> bool operator<(const BTypeName<U,N>& val1, const BTypeName<U,N>& val2) { return Op<U>::myLt(val1.val(),val2.val()); }
+template <typename U, unsigned int N> bool operator<=(const BTypeName<U,N>& val1, const BTypeName<U,N>& val2) { return Op<U>::myLe(val1.val(),val2.val()); }
+template <typename U, unsigned int N> bool operator>(const BTypeName<U,N>& val1, const BTypeName<U,N>& val2) { return Op<U>::myGt(val1.val(),val2.val()); }
+template <typename U, unsigned int N> bool operator>=(const BTypeName<U,N>& val1, const BTypeName<U,N>& val2) { return Op<U>::myGe(val1.val(),val2.val()); }
+template <typename U, unsigned int N, typename V> bool operator==(const BTypeName<U,N>& val1, const V& val2) { return Op<U>::myEq(val1.val(),val2); }
+template <typename U, unsigned int N, typename V> bool operator==(const V& val1, const BTypeName<U,N>& val2) { return Op<U>::myEq(val1,val2.val()); }
+template <typename U, unsigned int N, typename V> bool operator!=(const BTypeName<U,N>& val1, const V& val2) { return Op<U>::myNe(val1.val(),val2); }
+template <typename U, unsigned int N, typename V> bool operator!=(const V& val1, const BTypeName<U,N>& val2) { return Op<U>::myNe(val1,val2.val()); }
+template <typename U, unsigned int N, typename V> bool operator<(const BTypeName<U,N>& val1, const V& val2) { return Op<U>::myLt(val1.val(),val2); }
+template <typename U, unsigned int N, typename V> bool operator<(const V& val1, const BTypeName<U,N>& val2) { return Op<U>::myLt(val1,val2.val()); }
+template <typename U, unsigned int N, typename V> bool operator<=(const BTypeName<U,N>& val1, const V& val2) { return Op<U>::myLe(val1.val(),val2); }
+template <typename U, unsigned int N, typename V> bool operator<=(const V& val1, const BTypeName<U,N>& val2) { return Op<U>::myLe(val1,val2.val()); }
+template <typename U, unsigned int N, typename V> bool operator>(const BTypeName<U,N>& val1, const V& val2) { return Op<U>::myGt(val1.val(),val2); }
+template <typename U, unsigned int N, typename V> bool operator>(const V& val1, const BTypeName<U,N>& val2) { return Op<U>::myGt(val1,val2.val()); }
+template <typename U, unsigned int N, typename V> bool operator>=(const BTypeName<U,N>& val1, const V& val2) { return Op<U>::myGe(val1.val(),val2); }
+template <typename U, unsigned int N, typename V> bool operator>=(const V& val1, const BTypeName<U,N>& val2) { return Op<U>::myGe(val1,val2.val()); }
 
 // Binary operator base class:
 
-template <typename U>
-class BinBTypeNameHV : public BTypeNameHV<U>
+template <typename U, unsigned int N>
+class BinBTypeNameHV : public BTypeNameHV<U,N>
 {
-	BTypeNameHV<U>* m_pOp1;
-	BTypeNameHV<U>* m_pOp2;
+	BTypeNameHV<U,N>* m_pOp1;
+	BTypeNameHV<U,N>* m_pOp2;
 public:
-	BinBTypeNameHV(const U& val, BTypeNameHV<U>* pOp1, BTypeNameHV<U>* pOp2):BTypeNameHV<U>(val),m_pOp1(pOp1),m_pOp2(pOp2)
+	BinBTypeNameHV(const U& val, BTypeNameHV<U,N>* pOp1, BTypeNameHV<U,N>* pOp2):BTypeNameHV<U,N>(val),m_pOp1(pOp1),m_pOp2(pOp2)
 	{
 		m_pOp1->incRef();
 		m_pOp2->incRef();
 	}
-	virtual void propagateChildren(typename Derivatives<U>::RecycleBin& bin)
+	virtual void propagateChildren(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		m_pOp1->decRef(bin,m_pOp1);
 		m_pOp2->decRef(bin,m_pOp2);
@@ -359,22 +445,22 @@ public:
 		if (m_pOp1) m_pOp1->decRef(m_pOp1);
 		if (m_pOp2) m_pOp2->decRef(m_pOp2);
 	}
-	BTypeNameHV<U>* op1() { return m_pOp1; }
-	BTypeNameHV<U>* op2() { return m_pOp2; }
+	BTypeNameHV<U,N>* op1() { return m_pOp1; }
+	BTypeNameHV<U,N>* op2() { return m_pOp2; }
 };
 
 // Unary operator base class:
 
-template <typename U>
-class UnBTypeNameHV : public BTypeNameHV<U>
+template <typename U, unsigned int N>
+class UnBTypeNameHV : public BTypeNameHV<U,N>
 {
-	BTypeNameHV<U>* m_pOp;
+	BTypeNameHV<U,N>* m_pOp;
 public:
-	UnBTypeNameHV(const U& val, BTypeNameHV<U>* pOp):BTypeNameHV<U>(val),m_pOp(pOp)
+	UnBTypeNameHV(const U& val, BTypeNameHV<U,N>* pOp):BTypeNameHV<U,N>(val),m_pOp(pOp)
 	{
 		m_pOp->incRef();
 	}
-	virtual void propagateChildren(typename Derivatives<U>::RecycleBin& bin)
+	virtual void propagateChildren(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		m_pOp->decRef(bin,m_pOp);
 	}
@@ -382,422 +468,564 @@ public:
 	{
 		if (m_pOp) m_pOp->decRef(m_pOp);
 	}
-	BTypeNameHV<U>* op() { return m_pOp; }
+	BTypeNameHV<U,N>* op() { return m_pOp; }
 };
 
 // ADDITION:
 
-template <typename U>
-struct BTypeNameADD : public BinBTypeNameHV<U>
+template <typename U, unsigned int N>
+struct BTypeNameADD : public BinBTypeNameHV<U,N>
 {
-	BTypeNameADD(const U& val, BTypeNameHV<U>* pOp1, BTypeNameHV<U>* pOp2):BinBTypeNameHV<U>(val,pOp1,pOp2){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	BTypeNameADD(const U& val, BTypeNameHV<U,N>* pOp1, BTypeNameHV<U,N>* pOp2):BinBTypeNameHV<U,N>(val,pOp1,pOp2){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		this->op1()->add(bin,this->m_derivatives);
 		this->op2()->add(bin,this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameADD<U>&){} // not allowed
+	void operator=(const BTypeNameADD<U,N>&){} // not allowed
 };
-template <typename U, typename V>
-struct BTypeNameADD1 : public UnBTypeNameHV<U>
+template <typename U, unsigned int N, typename V>
+struct BTypeNameADD1 : public UnBTypeNameHV<U,N>
 {
-	const V m_a;
-	BTypeNameADD1(const U& val, const V& a, BTypeNameHV<U>* pOp2):UnBTypeNameHV<U>(val,pOp2),m_a(a){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	const typename ParamValue<V>::Type m_a;
+	BTypeNameADD1(const U& val, const V& a, BTypeNameHV<U,N>* pOp2):UnBTypeNameHV<U,N>(val,pOp2),m_a(a){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		this->op()->add(bin,this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameADD1<U,V>&){} // not allowed
+	void operator=(const BTypeNameADD1<U,N,V>&){} // not allowed
 };
-template <typename U, typename V>
-struct BTypeNameADD2 : public UnBTypeNameHV<U>
+template <typename U, unsigned int N, typename V>
+struct BTypeNameADD2 : public UnBTypeNameHV<U,N>
 {
-	const V m_b;
-	BTypeNameADD2(const U& val, BTypeNameHV<U>* pOp1, const V& b):UnBTypeNameHV<U>(val,pOp1),m_b(b){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	const typename ParamValue<V>::Type m_b;
+	BTypeNameADD2(const U& val, BTypeNameHV<U,N>* pOp1, const V& b):UnBTypeNameHV<U,N>(val,pOp1),m_b(b){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		this->op()->add(bin,this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameADD2<U,V>&){} // not allowed
+	void operator=(const BTypeNameADD2<U,N,V>&){} // not allowed
 };
-template <typename U>
-BTypeName<U> operator+(const BTypeName<U>& val1, const BTypeName<U>& val2)
+template <typename U, unsigned int N>
+BTypeName<U,N> operator+(const BTypeName<U,N>& val1, const BTypeName<U,N>& val2)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(new BTypeNameADD<U>(val1.val()+val2.val(),val1.getBTypeNameHV(),val2.getBTypeNameHV())));
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(new BTypeNameADD<U,N>(val1.val()+val2.val(),val1.getBTypeNameHV(),val2.getBTypeNameHV())));
 }
 /*
-template <typename U>
-BTypeName<U> operator+(const typename Op<U>::Underlying& a, const BTypeName<U>& val2)
+template <typename U, unsigned int N>
+BTypeName<U,N> operator+(const typename Op<U>::Underlying& a, const BTypeName<U,N>& val2)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameADD1<U,typename Op<U>::Underlying>(a+val2.val(), a, val2.getBTypeNameHV())
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameADD1<U,N,typename Op<U>::Underlying>(a+val2.val(), a, val2.getBTypeNameHV())
 	));
 }
-template <typename U>
-BTypeName<U> operator+(const BTypeName<U>& val1, const typename Op<U>::Underlying& b)
+template <typename U, unsigned int N>
+BTypeName<U,N> operator+(const BTypeName<U,N>& val1, const typename Op<U>::Underlying& b)
 {
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameADD2<U,typename Op<U>::Underlying>(val1.val()+b, val1.getBTypeNameHV(), b)
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameADD2<U,N,typename Op<U>::Underlying>(val1.val()+b, val1.getBTypeNameHV(), b)
 	));
 }
-template <typename U>
-BTypeName<U> operator+(const typename Op<U>::Base& a, const BTypeName<U>& val2)
+template <typename U, unsigned int N>
+BTypeName<U,N> operator+(const typename Op<U>::Base& a, const BTypeName<U,N>& val2)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameADD1<U,typename Op<U>::Base>(a+val2.val(), a, val2.getBTypeNameHV())
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameADD1<U,N,typename Op<U>::Base>(a+val2.val(), a, val2.getBTypeNameHV())
 	));
 }
-template <typename U>
-BTypeName<U> operator+(const BTypeName<U>& val1, const typename Op<U>::Base& b)
+template <typename U, unsigned int N>
+BTypeName<U,N> operator+(const BTypeName<U,N>& val1, const typename Op<U>::Base& b)
 {
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameADD2<U,typename Op<U>::Base>(val1.val()+b, val1.getBTypeNameHV(), b)
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameADD2<U,N,typename Op<U>::Base>(val1.val()+b, val1.getBTypeNameHV(), b)
 	));
 }
 */
-template <typename U, typename V>
-BTypeName<U> operator+(const V& a, const BTypeName<U>& val2)
+template <typename U, unsigned int N, typename V>
+BTypeName<U,N> operator+(const V& a, const BTypeName<U,N>& val2)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameADD1<U,V>(a+val2.val(), a, val2.getBTypeNameHV())
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameADD1<U,N,V>(a+val2.val(), a, val2.getBTypeNameHV())
 	));
 }
-template <typename U, typename V>
-BTypeName<U> operator+(const BTypeName<U>& val1, const V& b)
+template <typename U, unsigned int N, typename V>
+BTypeName<U,N> operator+(const BTypeName<U,N>& val1, const V& b)
 {
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameADD2<U,V>(val1.val()+b, val1.getBTypeNameHV(), b)
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameADD2<U,N,V>(val1.val()+b, val1.getBTypeNameHV(), b)
 	));
 }
 
 // SUBTRACTION:
 
-template <typename U>
-struct BTypeNameSUB : public BinBTypeNameHV<U>
+template <typename U, unsigned int N>
+struct BTypeNameSUB : public BinBTypeNameHV<U,N>
 {
-	BTypeNameSUB(const U& val, BTypeNameHV<U>* pOp1, BTypeNameHV<U>* pOp2):BinBTypeNameHV<U>(val,pOp1,pOp2){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	BTypeNameSUB(const U& val, BTypeNameHV<U,N>* pOp1, BTypeNameHV<U,N>* pOp2):BinBTypeNameHV<U,N>(val,pOp1,pOp2){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		this->op1()->add(bin,this->m_derivatives);
 		this->op2()->sub(bin,this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameSUB<U>&){} // not allowed
+	void operator=(const BTypeNameSUB<U,N>&){} // not allowed
 };
-template <typename U, typename V>
-struct BTypeNameSUB1 : public UnBTypeNameHV<U>
+template <typename U, unsigned int N, typename V>
+struct BTypeNameSUB1 : public UnBTypeNameHV<U,N>
 {
-	const V m_a;
-	BTypeNameSUB1(const U& val, const V& a, BTypeNameHV<U>* pOp2):UnBTypeNameHV<U>(val,pOp2),m_a(a){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	const typename ParamValue<V>::Type m_a;
+	BTypeNameSUB1(const U& val, const V& a, BTypeNameHV<U,N>* pOp2):UnBTypeNameHV<U,N>(val,pOp2),m_a(a){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		this->op()->sub(bin,this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameSUB1<U,V>&){} // not allowed
+	void operator=(const BTypeNameSUB1<U,N,V>&){} // not allowed
 };
-template <typename U, typename V>
-struct BTypeNameSUB2 : public UnBTypeNameHV<U>
+template <typename U, unsigned int N, typename V>
+struct BTypeNameSUB2 : public UnBTypeNameHV<U,N>
 {
-	const V m_b;
-	BTypeNameSUB2(const U& val, BTypeNameHV<U>* pOp1, const V& b):UnBTypeNameHV<U>(val,pOp1),m_b(b){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	const typename ParamValue<V>::Type m_b;
+	BTypeNameSUB2(const U& val, BTypeNameHV<U,N>* pOp1, const V& b):UnBTypeNameHV<U,N>(val,pOp1),m_b(b){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		this->op()->add(bin,this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameSUB2<U,V>&){} // not allowed
+	void operator=(const BTypeNameSUB2<U,N,V>&){} // not allowed
 };
-template <typename U>
-BTypeName<U> operator-(const BTypeName<U>& val1, const BTypeName<U>& val2)
+template <typename U, unsigned int N>
+BTypeName<U,N> operator-(const BTypeName<U,N>& val1, const BTypeName<U,N>& val2)
 {
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(new BTypeNameSUB<U>(val1.val()-val2.val(),val1.getBTypeNameHV(),val2.getBTypeNameHV())));
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(new BTypeNameSUB<U,N>(val1.val()-val2.val(),val1.getBTypeNameHV(),val2.getBTypeNameHV())));
 }
 /*
-template <typename U>
-BTypeName<U> operator-(const typename Op<U>::Underlying& a, const BTypeName<U>& val2)
+template <typename U, unsigned int N>
+BTypeName<U,N> operator-(const typename Op<U>::Underlying& a, const BTypeName<U,N>& val2)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameSUB1<U,typename Op<U>::Underlying>(a-val2.val(), a, val2.getBTypeNameHV())
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameSUB1<U,N,typename Op<U>::Underlying>(a-val2.val(), a, val2.getBTypeNameHV())
 	));
 }
-template <typename U>
-BTypeName<U> operator-(const BTypeName<U>& val1, const typename Op<U>::Underlying& b)
+template <typename U, unsigned int N>
+BTypeName<U,N> operator-(const BTypeName<U,N>& val1, const typename Op<U>::Underlying& b)
 {
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameSUB2<U,typename Op<U>::Underlying>(val1.val()-b, val1.getBTypeNameHV(), b)
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameSUB2<U,N,typename Op<U>::Underlying>(val1.val()-b, val1.getBTypeNameHV(), b)
 	));
 }
-template <typename U>
-BTypeName<U> operator-(const typename Op<U>::Base& a, const BTypeName<U>& val2)
+template <typename U, unsigned int N>
+BTypeName<U,N> operator-(const typename Op<U>::Base& a, const BTypeName<U,N>& val2)
 {
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameSUB1<U,typename Op<U>::Base>(a-val2.val(), a, val2.getBTypeNameHV())
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameSUB1<U,N,typename Op<U>::Base>(a-val2.val(), a, val2.getBTypeNameHV())
 	));
 }
-template <typename U>
-BTypeName<U> operator-(const BTypeName<U>& val1, const typename Op<U>::Base& b)
+template <typename U, unsigned int N>
+BTypeName<U,N> operator-(const BTypeName<U,N>& val1, const typename Op<U>::Base& b)
 {
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameSUB2<U,typename Op<U>::Base>(val1.val()-b, val1.getBTypeNameHV(), b)
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameSUB2<U,N,typename Op<U>::Base>(val1.val()-b, val1.getBTypeNameHV(), b)
 	));
 }
 */
-template <typename U, typename V>
-BTypeName<U> operator-(const V& a, const BTypeName<U>& val2)
+template <typename U, unsigned int N, typename V>
+BTypeName<U,N> operator-(const V& a, const BTypeName<U,N>& val2)
 {
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameSUB1<U,V>(a-val2.val(), a, val2.getBTypeNameHV())
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameSUB1<U,N,V>(a-val2.val(), a, val2.getBTypeNameHV())
 	));
 }
-template <typename U, typename V>
-BTypeName<U> operator-(const BTypeName<U>& val1, const V& b)
+template <typename U, unsigned int N, typename V>
+BTypeName<U,N> operator-(const BTypeName<U,N>& val1, const V& b)
 {
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameSUB2<U,V>(val1.val()-b, val1.getBTypeNameHV(), b)
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameSUB2<U,N,V>(val1.val()-b, val1.getBTypeNameHV(), b)
 	));
 }
 
 // MULTIPLICATION:
 
-template <typename U>
-struct BTypeNameMUL : public BinBTypeNameHV<U>
+template <typename U, unsigned int N>
+struct BTypeNameMUL : public BinBTypeNameHV<U,N>
 {
-	BTypeNameMUL(const U& val, BTypeNameHV<U>* pOp1, BTypeNameHV<U>* pOp2):BinBTypeNameHV<U>(val,pOp1,pOp2){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	BTypeNameMUL(const U& val, BTypeNameHV<U,N>* pOp1, BTypeNameHV<U,N>* pOp2):BinBTypeNameHV<U,N>(val,pOp1,pOp2){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		this->op1()->add(bin,this->op2()->val(),this->m_derivatives);
 		this->op2()->add(bin,this->op1()->val(),this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameMUL<U>&){} // not allowed
+	void operator=(const BTypeNameMUL<U,N>&){} // not allowed
 };
-template <typename U, typename V>
-struct BTypeNameMUL1 : public UnBTypeNameHV<U>
+template <typename U, unsigned int N, typename V>
+struct BTypeNameMUL1 : public UnBTypeNameHV<U,N>
 {
-	const V m_a;
-	BTypeNameMUL1(const U& val, const V& a, BTypeNameHV<U>* pOp2):UnBTypeNameHV<U>(val,pOp2),m_a(a){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	const typename ParamValue<V>::Type m_a;
+	BTypeNameMUL1(const U& val, const V& a, BTypeNameHV<U,N>* pOp2):UnBTypeNameHV<U,N>(val,pOp2),m_a(a){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		this->op()->add(bin,m_a,this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameMUL1<U,V>&){} // not allowed
+	void operator=(const BTypeNameMUL1<U,N,V>&){} // not allowed
 };
-template <typename U, typename V>
-struct BTypeNameMUL2 : public UnBTypeNameHV<U>
+template <typename U, unsigned int N, typename V>
+struct BTypeNameMUL2 : public UnBTypeNameHV<U,N>
 {
-	const V m_b;
-	BTypeNameMUL2(const U& val, BTypeNameHV<U>* pOp1, const V& b):UnBTypeNameHV<U>(val,pOp1),m_b(b){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	const typename ParamValue<V>::Type m_b;
+	BTypeNameMUL2(const U& val, BTypeNameHV<U,N>* pOp1, const V& b):UnBTypeNameHV<U,N>(val,pOp1),m_b(b){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		this->op()->add(bin,m_b,this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameMUL2<U,V>&){} // not allowed
+	void operator=(const BTypeNameMUL2<U,N,V>&){} // not allowed
 };
-template <typename U>
-BTypeName<U> operator*(const BTypeName<U>& val1, const BTypeName<U>& val2)
+template <typename U, unsigned int N>
+BTypeName<U,N> operator*(const BTypeName<U,N>& val1, const BTypeName<U,N>& val2)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(new BTypeNameMUL<U>(val1.val()*val2.val(),val1.getBTypeNameHV(),val2.getBTypeNameHV())));
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(new BTypeNameMUL<U,N>(val1.val()*val2.val(),val1.getBTypeNameHV(),val2.getBTypeNameHV())));
 }
 /*
-template <typename U>
-BTypeName<U> operator*(const typename Op<U>::Underlying& a, const BTypeName<U>& val2)
+template <typename U, unsigned int N>
+BTypeName<U,N> operator*(const typename Op<U>::Underlying& a, const BTypeName<U,N>& val2)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameMUL1<U,typename Op<U>::Underlying>(a*val2.val(), a, val2.getBTypeNameHV())
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameMUL1<U,N,typename Op<U>::Underlying>(a*val2.val(), a, val2.getBTypeNameHV())
 	));
 }
-template <typename U>
-BTypeName<U> operator*(const BTypeName<U>& val1, const typename Op<U>::Underlying& b)
+template <typename U, unsigned int N>
+BTypeName<U,N> operator*(const BTypeName<U,N>& val1, const typename Op<U>::Underlying& b)
 {
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameMUL2<U,typename Op<U>::Underlying>(val1.val()*b, val1.getBTypeNameHV(), b)
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameMUL2<U,N,typename Op<U>::Underlying>(val1.val()*b, val1.getBTypeNameHV(), b)
 	));
 }
-template <typename U>
-BTypeName<U> operator*(const typename Op<U>::Base& a, const BTypeName<U>& val2)
+template <typename U, unsigned int N>
+BTypeName<U,N> operator*(const typename Op<U>::Base& a, const BTypeName<U,N>& val2)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameMUL1<U,typename Op<U>::Base>(a*val2.val(), a, val2.getBTypeNameHV())
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameMUL1<U,N,typename Op<U>::Base>(a*val2.val(), a, val2.getBTypeNameHV())
 	));
 }
-template <typename U>
-BTypeName<U> operator*(const BTypeName<U>& val1, const typename Op<U>::Base& b)
+template <typename U, unsigned int N>
+BTypeName<U,N> operator*(const BTypeName<U,N>& val1, const typename Op<U>::Base& b)
 {
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameMUL2<U,typename Op<U>::Base>(val1.val()*b, val1.getBTypeNameHV(), b)
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameMUL2<U,N,typename Op<U>::Base>(val1.val()*b, val1.getBTypeNameHV(), b)
 	));
 }
 */
-template <typename U, typename V>
-BTypeName<U> operator*(const V& a, const BTypeName<U>& val2)
+template <typename U, unsigned int N, typename V>
+BTypeName<U,N> operator*(const V& a, const BTypeName<U,N>& val2)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameMUL1<U,V>(a*val2.val(), a, val2.getBTypeNameHV())
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameMUL1<U,N,V>(a*val2.val(), a, val2.getBTypeNameHV())
 	));
 }
-template <typename U, typename V>
-BTypeName<U> operator*(const BTypeName<U>& val1, const V& b)
+template <typename U, unsigned int N, typename V>
+BTypeName<U,N> operator*(const BTypeName<U,N>& val1, const V& b)
 {
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameMUL2<U,V>(val1.val()*b, val1.getBTypeNameHV(), b)
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameMUL2<U,N,V>(val1.val()*b, val1.getBTypeNameHV(), b)
 	));
 }
 
 // DIVISION:
 
-template <typename U>
-struct BTypeNameDIV : public BinBTypeNameHV<U>
+template <typename U, unsigned int N>
+struct BTypeNameDIV : public BinBTypeNameHV<U,N>
 {
-	BTypeNameDIV(const U& val, BTypeNameHV<U>* pOp1, BTypeNameHV<U>* pOp2):BinBTypeNameHV<U>(val,pOp1,pOp2){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	BTypeNameDIV(const U& val, BTypeNameHV<U,N>* pOp1, BTypeNameHV<U,N>* pOp2):BinBTypeNameHV<U,N>(val,pOp1,pOp2){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		U tmp=Op<U>::myInv(this->op2()->val());
 		this->op1()->add(bin,tmp,this->m_derivatives);
 		this->op2()->sub(bin,tmp*this->val(),this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameDIV<U>&){} // not allowed
+	void operator=(const BTypeNameDIV<U,N>&){} // not allowed
 };
-template <typename U, typename V>
-struct BTypeNameDIV1 : public UnBTypeNameHV<U>
+template <typename U, unsigned int N, typename V>
+struct BTypeNameDIV1 : public UnBTypeNameHV<U,N>
 {
-	const V m_a;
-	BTypeNameDIV1(const U& val, const V& a, BTypeNameHV<U>* pOp2):UnBTypeNameHV<U>(val,pOp2),m_a(a){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	const typename ParamValue<V>::Type m_a;
+	BTypeNameDIV1(const U& val, const V& a, BTypeNameHV<U,N>* pOp2):UnBTypeNameHV<U,N>(val,pOp2),m_a(a){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		this->op()->sub(bin,Op<U>::myInv(this->op()->val())*this->val(),this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameDIV1<U,V>&){} // not allowed
+	void operator=(const BTypeNameDIV1<U,N,V>&){} // not allowed
 };
-template <typename U, typename V>
-struct BTypeNameDIV2 : public UnBTypeNameHV<U>
+template <typename U, unsigned int N, typename V>
+struct BTypeNameDIV2 : public UnBTypeNameHV<U,N>
 {
-	const V m_b;
-	BTypeNameDIV2(const U& val, BTypeNameHV<U>* pOp1, const V& b):UnBTypeNameHV<U>(val,pOp1),m_b(b){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	const typename ParamValue<V>::Type m_b;
+	BTypeNameDIV2(const U& val, BTypeNameHV<U,N>* pOp1, const V& b):UnBTypeNameHV<U,N>(val,pOp1),m_b(b){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		this->op()->add(bin,Op<V>::myInv(m_b),this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameDIV2<U,V>&){} // not allowed
+	void operator=(const BTypeNameDIV2<U,N,V>&){} // not allowed
 };
-template <typename U>
-BTypeName<U> operator/(const BTypeName<U>& val1, const BTypeName<U>& val2)
+template <typename U, unsigned int N>
+BTypeName<U,N> operator/(const BTypeName<U,N>& val1, const BTypeName<U,N>& val2)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameDIV<U>(val1.val()/val2.val(),val1.getBTypeNameHV(),val2.getBTypeNameHV())
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameDIV<U,N>(val1.val()/val2.val(),val1.getBTypeNameHV(),val2.getBTypeNameHV())
 	));
 }
 /*
-template <typename U>
-BTypeName<U> operator/(const typename Op<U>::Underlying& a, const BTypeName<U>& val2)
+template <typename U, unsigned int N>
+BTypeName<U,N> operator/(const typename Op<U>::Underlying& a, const BTypeName<U,N>& val2)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameDIV1<U,typename Op<U>::Underlying>(a/val2.val(), a, val2.getBTypeNameHV())
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameDIV1<U,N,typename Op<U>::Underlying>(a/val2.val(), a, val2.getBTypeNameHV())
 	));
 }
-template <typename U>
-BTypeName<U> operator/(const BTypeName<U>& val1, const typename Op<U>::Underlying& b)
+template <typename U, unsigned int N>
+BTypeName<U,N> operator/(const BTypeName<U,N>& val1, const typename Op<U>::Underlying& b)
 {
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameDIV2<U,typename Op<U>::Underlying>(val1.val()/b, val1.getBTypeNameHV(), b)
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameDIV2<U,N,typename Op<U>::Underlying>(val1.val()/b, val1.getBTypeNameHV(), b)
 	));
 }
-template <typename U>
-BTypeName<U> operator/(const typename Op<U>::Base& a, const BTypeName<U>& val2)
+template <typename U, unsigned int N>
+BTypeName<U,N> operator/(const typename Op<U>::Base& a, const BTypeName<U,N>& val2)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameDIV1<U,typename Op<U>::Base>(a/val2.val(), a, val2.getBTypeNameHV())
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameDIV1<U,N,typename Op<U>::Base>(a/val2.val(), a, val2.getBTypeNameHV())
 	));
 }
-template <typename U>
-BTypeName<U> operator/(const BTypeName<U>& val1, const typename Op<U>::Base& b)
+template <typename U, unsigned int N>
+BTypeName<U,N> operator/(const BTypeName<U,N>& val1, const typename Op<U>::Base& b)
 {
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameDIV2<U,typename Op<U>::Base>(val1.val()/b, val1.getBTypeNameHV(), b)
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameDIV2<U,N,typename Op<U>::Base>(val1.val()/b, val1.getBTypeNameHV(), b)
 	));
 }
 */
-template <typename U, typename V>
-BTypeName<U> operator/(const V& a, const BTypeName<U>& val2)
+template <typename U, unsigned int N, typename V>
+BTypeName<U,N> operator/(const V& a, const BTypeName<U,N>& val2)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameDIV1<U,V>(a/val2.val(), a, val2.getBTypeNameHV())
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameDIV1<U,N,V>(a/val2.val(), a, val2.getBTypeNameHV())
 	));
 }
-template <typename U, typename V>
-BTypeName<U> operator/(const BTypeName<U>& val1, const V& b)
+template <typename U, unsigned int N, typename V>
+BTypeName<U,N> operator/(const BTypeName<U,N>& val1, const V& b)
 {
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNameDIV2<U,V>(val1.val()/b, val1.getBTypeNameHV(), b)
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNameDIV2<U,N,V>(val1.val()/b, val1.getBTypeNameHV(), b)
 	));
 }
 
 // COMPOUND ASSIGNMENTS:
 
-template <typename U> BTypeName<U>& BTypeName<U>::operator+=(const BTypeName<U>& val) { return (*this)=(*this)+val; }
-template <typename U> BTypeName<U>& BTypeName<U>::operator-=(const BTypeName<U>& val) { return (*this)=(*this)-val; }
-template <typename U> BTypeName<U>& BTypeName<U>::operator*=(const BTypeName<U>& val) { return (*this)=(*this)*val; }
-template <typename U> BTypeName<U>& BTypeName<U>::operator/=(const BTypeName<U>& val) { return (*this)=(*this)/val; }
-template <typename U> template <typename V> BTypeName<U>& BTypeName<U>::operator+=(const V& val) { return (*this)=(*this)+val; }
-template <typename U> template <typename V> BTypeName<U>& BTypeName<U>::operator-=(const V& val) { return (*this)=(*this)-val; }
-template <typename U> template <typename V> BTypeName<U>& BTypeName<U>::operator*=(const V& val) { return (*this)=(*this)*val; }
-template <typename U> template <typename V> BTypeName<U>& BTypeName<U>::operator/=(const V& val) { return (*this)=(*this)/val; }
+// (+= and -= on variables are defined with the n-ary sums below)
+template <typename U, unsigned int N> BTypeName<U,N>& BTypeName<U,N>::operator*=(const BTypeName<U,N>& val) { return (*this)=(*this)*val; }
+template <typename U, unsigned int N> BTypeName<U,N>& BTypeName<U,N>::operator/=(const BTypeName<U,N>& val) { return (*this)=(*this)/val; }
+template <typename U, unsigned int N> template <typename V> BTypeName<U,N>& BTypeName<U,N>::operator+=(const V& val) { return (*this)=(*this)+val; }
+template <typename U, unsigned int N> template <typename V> BTypeName<U,N>& BTypeName<U,N>::operator-=(const V& val) { return (*this)=(*this)-val; }
+template <typename U, unsigned int N> template <typename V> BTypeName<U,N>& BTypeName<U,N>::operator*=(const V& val) { return (*this)=(*this)*val; }
+template <typename U, unsigned int N> template <typename V> BTypeName<U,N>& BTypeName<U,N>::operator/=(const V& val) { return (*this)=(*this)/val; }
 
 // UNARY MINUS
 
-template <typename U>
-struct BTypeNameUMINUS : public UnBTypeNameHV<U>
+template <typename U, unsigned int N>
+struct BTypeNameUMINUS : public UnBTypeNameHV<U,N>
 {
-	BTypeNameUMINUS(const U& val, BTypeNameHV<U>* pOp):UnBTypeNameHV<U>(val,pOp){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	BTypeNameUMINUS(const U& val, BTypeNameHV<U,N>* pOp):UnBTypeNameHV<U,N>(val,pOp){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		this->op()->sub(bin,this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameUMINUS<U>&){} // not allowed
+	void operator=(const BTypeNameUMINUS<U,N>&){} // not allowed
 };
 
-template <typename U>
-BTypeName<U> operator-(const BTypeName<U>& val)
+template <typename U, unsigned int N>
+BTypeName<U,N> operator-(const BTypeName<U,N>& val)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(new BTypeNameUMINUS<U>(Op<U>::myNeg(val.val()),val.getBTypeNameHV())));
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(new BTypeNameUMINUS<U,N>(Op<U>::myNeg(val.val()),val.getBTypeNameHV())));
 }
 
 // UNARY PLUS
 
-template <typename U>
-struct BTypeNameUPLUS : public UnBTypeNameHV<U>
+template <typename U, unsigned int N>
+struct BTypeNameUPLUS : public UnBTypeNameHV<U,N>
 {
-	BTypeNameUPLUS(const U& val, BTypeNameHV<U>* pOp):UnBTypeNameHV<U>(val,pOp){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	BTypeNameUPLUS(const U& val, BTypeNameHV<U,N>* pOp):UnBTypeNameHV<U,N>(val,pOp){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		this->op()->add(bin,this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameUPLUS<U>&){} // not allowed
+	void operator=(const BTypeNameUPLUS<U,N>&){} // not allowed
 };
 
-template <typename U>
-BTypeName<U> operator+(const BTypeName<U>& val)
+template <typename U, unsigned int N>
+BTypeName<U,N> operator+(const BTypeName<U,N>& val)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(new BTypeNameUPLUS<U>(Op<U>::myPos(val.val()),val.getBTypeNameHV())));
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(new BTypeNameUPLUS<U,N>(Op<U>::myPos(val.val()),val.getBTypeNameHV())));
+}
+
+// N-ARY SUM:
+//
+// sum_j of terms with the operand pointers and the partial derivatives
+// of the sum with respect to them stored contiguously, so that a
+// reduction over n terms is one node and one propagation loop instead
+// of a chain of n MUL and n ADD nodes. sum() and dot() build it from
+// arrays, and += and -= on an unshared sum append to it in place; an
+// unshared product or scaled variable being added is taken apart into
+// its operands, so s+=x[i]*w[i] accumulates into a single node.
+
+template <typename U, unsigned int N>
+struct BTypeNameSUM : public BTypeNameHV<U,N>
+{
+	std::vector<BTypeNameHV<U,N>*> m_ops;
+	std::vector<U> m_w; // d(sum)/d(op)
+	BTypeNameSUM():BTypeNameHV<U,N>(Op<U>::myZero()){}
+	virtual ~BTypeNameSUM()
+	{
+		for(unsigned int j=0;j<m_ops.size();++j) if (m_ops[j]) m_ops[j]->decRef(m_ops[j]);
+	}
+	unsigned int terms() const { return (unsigned int)m_ops.size(); }
+	BTypeNameHV<U,N>* op(const unsigned int j) { return m_ops[j]; }
+	const U& weight(const unsigned int j) const { return m_w[j]; }
+	void reserve(const unsigned int n) { m_ops.reserve(n); m_w.reserve(n); }
+	// Adds the operand with partial derivative w, without touching the value:
+	void add(const U& w, BTypeNameHV<U,N>* pOp)
+	{
+		pOp->incRef();
+		m_ops.push_back(pOp);
+		m_w.push_back(w);
+	}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
+	{
+		for(unsigned int j=0;j<m_ops.size();++j) m_ops[j]->add(bin,m_w[j],this->m_derivatives);
+	}
+	virtual void propagateChildren(typename Derivatives<U,N>::RecycleBin& bin)
+	{
+		for(unsigned int j=0;j<m_ops.size();++j) m_ops[j]->decRef(bin,m_ops[j]);
+	}
+private:
+	void operator=(const BTypeNameSUM<U,N>&){} // not allowed
+};
+
+// Adds sign*x to an n-ary sum, using the operands of x instead when x is
+// an unshared product, scaled variable or sum:
+template <typename U, unsigned int N>
+void sumAppend(BTypeNameSUM<U,N>* pSum, BTypeNameHV<U,N>* pHV, const bool negate)
+{
+	typedef typename Op<U>::Base Base;
+	Op<U>::myCadd(pSum->val(),negate?Op<U>::myNeg(pHV->val()):pHV->val());
+	const U one(Op<U>::myOne()), sign(negate?Op<U>::myNeg(one):one);
+	if (pHV->refCount()==1)
+	{
+		if (BTypeNameSUM<U,N>* p=dynamic_cast<BTypeNameSUM<U,N>*>(pHV))
+		{
+			for(unsigned int j=0;j<p->terms();++j) pSum->add(sign*p->weight(j),p->op(j));
+			return;
+		}
+		if (BTypeNameMUL<U,N>* p=dynamic_cast<BTypeNameMUL<U,N>*>(pHV))
+		{
+			pSum->add(sign*p->op2()->val(),p->op1());
+			pSum->add(sign*p->op1()->val(),p->op2());
+			return;
+		}
+		if (BTypeNameMUL1<U,N,U>* p=dynamic_cast<BTypeNameMUL1<U,N,U>*>(pHV)) { pSum->add(sign*p->m_a,p->op()); return; }
+		if (BTypeNameMUL1<U,N,Base>* p=dynamic_cast<BTypeNameMUL1<U,N,Base>*>(pHV)) { pSum->add(sign*p->m_a,p->op()); return; }
+		if (BTypeNameMUL2<U,N,U>* p=dynamic_cast<BTypeNameMUL2<U,N,U>*>(pHV)) { pSum->add(sign*p->m_b,p->op()); return; }
+		if (BTypeNameMUL2<U,N,Base>* p=dynamic_cast<BTypeNameMUL2<U,N,Base>*>(pHV)) { pSum->add(sign*p->m_b,p->op()); return; }
+	}
+	pSum->add(sign,pHV);
+}
+
+// sum_j x[j]
+template <typename U, unsigned int N>
+BTypeName<U,N> sum(const BTypeName<U,N>* x, const unsigned int n)
+{
+	BTypeNameSUM<U,N>* pSum=new BTypeNameSUM<U,N>();
+	pSum->reserve(n);
+	const U one(Op<U>::myOne());
+	for(unsigned int j=0;j<n;++j)
+	{
+		Op<U>::myCadd(pSum->val(),x[j].val());
+		pSum->add(one,x[j].getBTypeNameHV());
+	}
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(pSum));
+}
+// sum_j w[j]*x[j] with constant weights
+template <typename U, unsigned int N, typename V>
+BTypeName<U,N> dot(const V* w, const BTypeName<U,N>* x, const unsigned int n)
+{
+	BTypeNameSUM<U,N>* pSum=new BTypeNameSUM<U,N>();
+	pSum->reserve(n);
+	for(unsigned int j=0;j<n;++j)
+	{
+		U wj(w[j]);
+		Op<U>::myCadd(pSum->val(),wj*x[j].val());
+		pSum->add(wj,x[j].getBTypeNameHV());
+	}
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(pSum));
+}
+// sum_j x[j]*y[j]
+template <typename U, unsigned int N>
+BTypeName<U,N> dot(const BTypeName<U,N>* x, const BTypeName<U,N>* y, const unsigned int n)
+{
+	BTypeNameSUM<U,N>* pSum=new BTypeNameSUM<U,N>();
+	pSum->reserve(2*n);
+	for(unsigned int j=0;j<n;++j)
+	{
+		Op<U>::myCadd(pSum->val(),x[j].val()*y[j].val());
+		pSum->add(y[j].val(),x[j].getBTypeNameHV());
+		pSum->add(x[j].val(),y[j].getBTypeNameHV());
+	}
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(pSum));
+}
+
+template <typename U, unsigned int N>
+bool sumExtend(BTypeName<U,N>& val1, const BTypeName<U,N>& val2, const bool negate)
+{
+	BTypeNameHV<U,N>* pHV=val1.getBTypeNameHV();
+	BTypeNameSUM<U,N>* pSum=dynamic_cast<BTypeNameSUM<U,N>*>(pHV);
+	if (pSum==0 || pHV->refCount()!=1 || pHV==val2.getBTypeNameHV()) return false;
+	sumAppend(pSum,val2.getBTypeNameHV(),negate);
+	return true;
+}
+template <typename U, unsigned int N> BTypeName<U,N>& BTypeName<U,N>::operator+=(const BTypeName<U,N>& val)
+{
+	if (sumExtend(*this,val,false)) return *this;
+	BTypeNameSUM<U,N>* pSum=new BTypeNameSUM<U,N>();
+	BTypeName<U,N> res(static_cast<BTypeNameHV<U,N>*>(pSum));
+	sumAppend(pSum,this->getBTypeNameHV(),false);
+	sumAppend(pSum,val.getBTypeNameHV(),false);
+	return (*this)=res;
+}
+template <typename U, unsigned int N> BTypeName<U,N>& BTypeName<U,N>::operator-=(const BTypeName<U,N>& val)
+{
+	if (sumExtend(*this,val,true)) return *this;
+	BTypeNameSUM<U,N>* pSum=new BTypeNameSUM<U,N>();
+	BTypeName<U,N> res(static_cast<BTypeNameHV<U,N>*>(pSum));
+	sumAppend(pSum,this->getBTypeNameHV(),false);
+	sumAppend(pSum,val.getBTypeNameHV(),true);
+	return (*this)=res;
 }
 
 // POWER
 
-template <typename U>
-struct BTypeNamePOW : public BinBTypeNameHV<U>
+template <typename U, unsigned int N>
+struct BTypeNamePOW : public BinBTypeNameHV<U,N>
 {
-	BTypeNamePOW(const U& val, BTypeNameHV<U>* pOp1, BTypeNameHV<U>* pOp2):BinBTypeNameHV<U>(val,pOp1,pOp2){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	BTypeNamePOW(const U& val, BTypeNameHV<U,N>* pOp1, BTypeNameHV<U,N>* pOp2):BinBTypeNameHV<U,N>(val,pOp1,pOp2){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		U tmp1(this->op2()->val() *  Op<U>::myPow(this->op1()->val(),this->op2()->val()-Op<U>::myOne()));
 		U tmp2(this->val() * Op<U>::myLog(this->op1()->val()));
@@ -805,286 +1033,286 @@ struct BTypeNamePOW : public BinBTypeNameHV<U>
 		this->op2()->add(bin,tmp2,this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNamePOW<U>&){} // not allowed
+	void operator=(const BTypeNamePOW<U,N>&){} // not allowed
 };
-template <typename U, typename V>
-struct BTypeNamePOW1 : public UnBTypeNameHV<U>
+template <typename U, unsigned int N, typename V>
+struct BTypeNamePOW1 : public UnBTypeNameHV<U,N>
 {
-	const V m_a;
-	BTypeNamePOW1(const U& val, const V& a, BTypeNameHV<U>* pOp2):UnBTypeNameHV<U>(val,pOp2),m_a(a){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	const typename ParamValue<V>::Type m_a;
+	BTypeNamePOW1(const U& val, const V& a, BTypeNameHV<U,N>* pOp2):UnBTypeNameHV<U,N>(val,pOp2),m_a(a){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		U tmp2(this->val() * Op<V>::myLog(m_a));
 		this->op()->add(bin,tmp2,this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNamePOW1<U,V>&){} // not allowed
+	void operator=(const BTypeNamePOW1<U,N,V>&){} // not allowed
 };
-template <typename U, typename V>
-struct BTypeNamePOW2 : public UnBTypeNameHV<U>
+template <typename U, unsigned int N, typename V>
+struct BTypeNamePOW2 : public UnBTypeNameHV<U,N>
 {
-	const V m_b;
-	BTypeNamePOW2(const U& val, BTypeNameHV<U>* pOp1, const V& b):UnBTypeNameHV<U>(val,pOp1),m_b(b){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	const typename ParamValue<V>::Type m_b;
+	BTypeNamePOW2(const U& val, BTypeNameHV<U,N>* pOp1, const V& b):UnBTypeNameHV<U,N>(val,pOp1),m_b(b){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		U tmp1(m_b *  Op<U>::myPow(this->op()->val(),m_b-Op<V>::myOne()));
 		this->op()->add(bin,tmp1,this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNamePOW2<U,V>&){} // not allowed
+	void operator=(const BTypeNamePOW2<U,N,V>&){} // not allowed
 };
-template <typename U>
-BTypeName<U> pow(const BTypeName<U>& val1, const BTypeName<U>& val2)
+template <typename U, unsigned int N>
+BTypeName<U,N> pow(const BTypeName<U,N>& val1, const BTypeName<U,N>& val2)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(new BTypeNamePOW<U>(Op<U>::myPow(val1.val(),val2.val()),val1.getBTypeNameHV(),val2.getBTypeNameHV())));
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(new BTypeNamePOW<U,N>(Op<U>::myPow(val1.val(),val2.val()),val1.getBTypeNameHV(),val2.getBTypeNameHV())));
 }
 /*
-template <typename U>
-BTypeName<U> pow(const typename Op<U>::Underlying& a, const BTypeName<U>& val2)
+template <typename U, unsigned int N>
+BTypeName<U,N> pow(const typename Op<U>::Underlying& a, const BTypeName<U,N>& val2)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNamePOW1<U,typename Op<U>::Underlying>(Op<U>::myPow(a,val2.val()), a, val2.getBTypeNameHV())
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNamePOW1<U,N,typename Op<U>::Underlying>(Op<U>::myPow(a,val2.val()), a, val2.getBTypeNameHV())
 	));
 }
-template <typename U>
-BTypeName<U> pow(const BTypeName<U>& val1, const typename Op<U>::Underlying& b)
+template <typename U, unsigned int N>
+BTypeName<U,N> pow(const BTypeName<U,N>& val1, const typename Op<U>::Underlying& b)
 {
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNamePOW2<U,typename Op<U>::Underlying>(Op<U>::myPow(val1.val(),b), val1.getBTypeNameHV(), b)
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNamePOW2<U,N,typename Op<U>::Underlying>(Op<U>::myPow(val1.val(),b), val1.getBTypeNameHV(), b)
 	));
 }
-template <typename U>
-BTypeName<U> pow(const typename Op<U>::Base& a, const BTypeName<U>& val2)
+template <typename U, unsigned int N>
+BTypeName<U,N> pow(const typename Op<U>::Base& a, const BTypeName<U,N>& val2)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNamePOW1<U,typename Op<U>::Base>(Op<U>::myPow(a,val2.val()), a, val2.getBTypeNameHV())
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNamePOW1<U,N,typename Op<U>::Base>(Op<U>::myPow(a,val2.val()), a, val2.getBTypeNameHV())
 	));
 }
-template <typename U>
-BTypeName<U> pow(const BTypeName<U>& val1, const typename Op<U>::Base& b)
+template <typename U, unsigned int N>
+BTypeName<U,N> pow(const BTypeName<U,N>& val1, const typename Op<U>::Base& b)
 {
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNamePOW2<U,typename Op<U>::Base>(Op<U>::myPow(val1.val(),b), val1.getBTypeNameHV(), b)
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNamePOW2<U,N,typename Op<U>::Base>(Op<U>::myPow(val1.val(),b), val1.getBTypeNameHV(), b)
 	));
 }
 */
-template <typename U, typename V>
-BTypeName<U> pow(const V& a, const BTypeName<U>& val2)
+template <typename U, unsigned int N, typename V>
+BTypeName<U,N> pow(const V& a, const BTypeName<U,N>& val2)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNamePOW1<U,V>(Op<U>::myPow(a,val2.val()), a, val2.getBTypeNameHV())
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNamePOW1<U,N,V>(Op<U>::myPow(a,val2.val()), a, val2.getBTypeNameHV())
 	));
 }
-template <typename U, typename V>
-BTypeName<U> pow(const BTypeName<U>& val1, const V& b)
+template <typename U, unsigned int N, typename V>
+BTypeName<U,N> pow(const BTypeName<U,N>& val1, const V& b)
 {
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(
-		new BTypeNamePOW2<U,V>(Op<U>::myPow(val1.val(),b), val1.getBTypeNameHV(), b)
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(
+		new BTypeNamePOW2<U,N,V>(Op<U>::myPow(val1.val(),b), val1.getBTypeNameHV(), b)
 	));
 }
 
 // SQR
 
-template <typename U>
-struct BTypeNameSQR : public UnBTypeNameHV<U>
+template <typename U, unsigned int N>
+struct BTypeNameSQR : public UnBTypeNameHV<U,N>
 {
-	BTypeNameSQR(const U& val, BTypeNameHV<U>* pOp):UnBTypeNameHV<U>(val,pOp){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	BTypeNameSQR(const U& val, BTypeNameHV<U,N>* pOp):UnBTypeNameHV<U,N>(val,pOp){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		U tmp(Op<U>::myTwo() * this->op()->val());
 		this->op()->add(bin,tmp,this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameSQR<U>&){} // not allowed
+	void operator=(const BTypeNameSQR<U,N>&){} // not allowed
 };
-template <typename U>
-BTypeName<U> sqr(const BTypeName<U>& val)
+template <typename U, unsigned int N>
+BTypeName<U,N> sqr(const BTypeName<U,N>& val)
 {
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(new BTypeNameSQR<U>(Op<U>::mySqr(val.val()), val.getBTypeNameHV())));
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(new BTypeNameSQR<U,N>(Op<U>::mySqr(val.val()), val.getBTypeNameHV())));
 }
 
 // SQRT
 
-template <typename U>
-struct BTypeNameSQRT : public UnBTypeNameHV<U>
+template <typename U, unsigned int N>
+struct BTypeNameSQRT : public UnBTypeNameHV<U,N>
 {
-	BTypeNameSQRT(const U& val, BTypeNameHV<U>* pOp):UnBTypeNameHV<U>(val,pOp){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	BTypeNameSQRT(const U& val, BTypeNameHV<U,N>* pOp):UnBTypeNameHV<U,N>(val,pOp){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		U tmp(Op<U>::myInv(this->val()*Op<U>::myTwo()));
 		this->op()->add(bin,tmp,this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameSQRT<U>&){} // not allowed
+	void operator=(const BTypeNameSQRT<U,N>&){} // not allowed
 };
-template <typename U>
-BTypeName<U> sqrt(const BTypeName<U>& val)
+template <typename U, unsigned int N>
+BTypeName<U,N> sqrt(const BTypeName<U,N>& val)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(new BTypeNameSQRT<U>(Op<U>::mySqrt(val.val()), val.getBTypeNameHV())));
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(new BTypeNameSQRT<U,N>(Op<U>::mySqrt(val.val()), val.getBTypeNameHV())));
 }
 
 // EXP
 
-template <typename U>
-struct BTypeNameEXP : public UnBTypeNameHV<U>
+template <typename U, unsigned int N>
+struct BTypeNameEXP : public UnBTypeNameHV<U,N>
 {
-	BTypeNameEXP(const U& val, BTypeNameHV<U>* pOp):UnBTypeNameHV<U>(val,pOp){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	BTypeNameEXP(const U& val, BTypeNameHV<U,N>* pOp):UnBTypeNameHV<U,N>(val,pOp){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		this->op()->add(bin,this->val(),this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameEXP<U>&){} // not allowed
+	void operator=(const BTypeNameEXP<U,N>&){} // not allowed
 };
-template <typename U>
-BTypeName<U> exp(const BTypeName<U>& val)
+template <typename U, unsigned int N>
+BTypeName<U,N> exp(const BTypeName<U,N>& val)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(new BTypeNameEXP<U>(Op<U>::myExp(val.val()), val.getBTypeNameHV())));
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(new BTypeNameEXP<U,N>(Op<U>::myExp(val.val()), val.getBTypeNameHV())));
 }
 
 // LOG
 
-template <typename U>
-struct BTypeNameLOG : public UnBTypeNameHV<U>
+template <typename U, unsigned int N>
+struct BTypeNameLOG : public UnBTypeNameHV<U,N>
 {
-	BTypeNameLOG(const U& val, BTypeNameHV<U>* pOp):UnBTypeNameHV<U>(val,pOp){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	BTypeNameLOG(const U& val, BTypeNameHV<U,N>* pOp):UnBTypeNameHV<U,N>(val,pOp){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		this->op()->add(bin,Op<U>::myInv(this->op()->val()),this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameLOG<U>&){} // not allowed
+	void operator=(const BTypeNameLOG<U,N>&){} // not allowed
 };
-template <typename U>
-BTypeName<U> log(const BTypeName<U>& val)
+template <typename U, unsigned int N>
+BTypeName<U,N> log(const BTypeName<U,N>& val)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(new BTypeNameLOG<U>(Op<U>::myLog(val.val()), val.getBTypeNameHV())));
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(new BTypeNameLOG<U,N>(Op<U>::myLog(val.val()), val.getBTypeNameHV())));
 }
 
 // SIN
 
-template <typename U>
-struct BTypeNameSIN : public UnBTypeNameHV<U>
+template <typename U, unsigned int N>
+struct BTypeNameSIN : public UnBTypeNameHV<U,N>
 {
-	BTypeNameSIN(const U& val, BTypeNameHV<U>* pOp):UnBTypeNameHV<U>(val,pOp){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	BTypeNameSIN(const U& val, BTypeNameHV<U,N>* pOp):UnBTypeNameHV<U,N>(val,pOp){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		U tmp(Op<U>::myCos(this->op()->val()));
 		this->op()->add(bin,tmp,this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameSIN<U>&){} // not allowed
+	void operator=(const BTypeNameSIN<U,N>&){} // not allowed
 };
-template <typename U>
-BTypeName<U> sin(const BTypeName<U>& val)
+template <typename U, unsigned int N>
+BTypeName<U,N> sin(const BTypeName<U,N>& val)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(new BTypeNameSIN<U>(Op<U>::mySin(val.val()), val.getBTypeNameHV())));
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(new BTypeNameSIN<U,N>(Op<U>::mySin(val.val()), val.getBTypeNameHV())));
 }
 
 // COS
 
-template <typename U>
-struct BTypeNameCOS : public UnBTypeNameHV<U>
+template <typename U, unsigned int N>
+struct BTypeNameCOS : public UnBTypeNameHV<U,N>
 {
-	BTypeNameCOS(const U& val, BTypeNameHV<U>* pOp):UnBTypeNameHV<U>(val,pOp){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	BTypeNameCOS(const U& val, BTypeNameHV<U,N>* pOp):UnBTypeNameHV<U,N>(val,pOp){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		U tmp(Op<U>::mySin(this->op()->val()));
 		this->op()->sub(bin,tmp,this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameCOS<U>&){} // not allowed
+	void operator=(const BTypeNameCOS<U,N>&){} // not allowed
 };
-template <typename U>
-BTypeName<U> cos(const BTypeName<U>& val)
+template <typename U, unsigned int N>
+BTypeName<U,N> cos(const BTypeName<U,N>& val)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(new BTypeNameCOS<U>(Op<U>::myCos(val.val()), val.getBTypeNameHV())));
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(new BTypeNameCOS<U,N>(Op<U>::myCos(val.val()), val.getBTypeNameHV())));
 }
 
 // TAN
 
-template <typename U>
-struct BTypeNameTAN : public UnBTypeNameHV<U>
+template <typename U, unsigned int N>
+struct BTypeNameTAN : public UnBTypeNameHV<U,N>
 {
-	BTypeNameTAN(const U& val, BTypeNameHV<U>* pOp):UnBTypeNameHV<U>(val,pOp){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	BTypeNameTAN(const U& val, BTypeNameHV<U,N>* pOp):UnBTypeNameHV<U,N>(val,pOp){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		U tmp(Op<U>::mySqr(this->val())+Op<U>::myOne());
 		this->op()->add(bin,tmp,this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameTAN<U>&){} // not allowed
+	void operator=(const BTypeNameTAN<U,N>&){} // not allowed
 };
-template <typename U>
-BTypeName<U> tan(const BTypeName<U>& val)
+template <typename U, unsigned int N>
+BTypeName<U,N> tan(const BTypeName<U,N>& val)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(new BTypeNameTAN<U>(Op<U>::myTan(val.val()), val.getBTypeNameHV())));
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(new BTypeNameTAN<U,N>(Op<U>::myTan(val.val()), val.getBTypeNameHV())));
 }
 
 // ASIN
 
-template <typename U>
-struct BTypeNameASIN : public UnBTypeNameHV<U>
+template <typename U, unsigned int N>
+struct BTypeNameASIN : public UnBTypeNameHV<U,N>
 {
-	BTypeNameASIN(const U& val, BTypeNameHV<U>* pOp):UnBTypeNameHV<U>(val,pOp){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	BTypeNameASIN(const U& val, BTypeNameHV<U,N>* pOp):UnBTypeNameHV<U,N>(val,pOp){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		U tmp(Op<U>::myInv(Op<U>::mySqrt(Op<U>::myOne()-Op<U>::mySqr(this->op()->val()))));
 		this->op()->add(bin,tmp,this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameASIN<U>&){} // not allowed
+	void operator=(const BTypeNameASIN<U,N>&){} // not allowed
 };
-template <typename U>
-BTypeName<U> asin(const BTypeName<U>& val)
+template <typename U, unsigned int N>
+BTypeName<U,N> asin(const BTypeName<U,N>& val)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(new BTypeNameASIN<U>(Op<U>::myAsin(val.val()), val.getBTypeNameHV())));
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(new BTypeNameASIN<U,N>(Op<U>::myAsin(val.val()), val.getBTypeNameHV())));
 }
 
 // ACOS
 
-template <typename U>
-struct BTypeNameACOS : public UnBTypeNameHV<U>
+template <typename U, unsigned int N>
+struct BTypeNameACOS : public UnBTypeNameHV<U,N>
 {
-	BTypeNameACOS(const U& val, BTypeNameHV<U>* pOp):UnBTypeNameHV<U>(val,pOp){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	BTypeNameACOS(const U& val, BTypeNameHV<U,N>* pOp):UnBTypeNameHV<U,N>(val,pOp){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		U tmp(Op<U>::myInv(Op<U>::mySqrt(Op<U>::myOne()-Op<U>::mySqr(this->op()->val()))));
 		this->op()->sub(bin,tmp,this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameACOS<U>&){} // not allowed
+	void operator=(const BTypeNameACOS<U,N>&){} // not allowed
 };
-template <typename U>
-BTypeName<U> acos(const BTypeName<U>& val)
+template <typename U, unsigned int N>
+BTypeName<U,N> acos(const BTypeName<U,N>& val)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(new BTypeNameACOS<U>(Op<U>::myAcos(val.val()), val.getBTypeNameHV())));
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(new BTypeNameACOS<U,N>(Op<U>::myAcos(val.val()), val.getBTypeNameHV())));
 }
 
 // ATAN
 
-template <typename U>
-struct BTypeNameATAN : public UnBTypeNameHV<U>
+template <typename U, unsigned int N>
+struct BTypeNameATAN : public UnBTypeNameHV<U,N>
 {
-	BTypeNameATAN(const U& val, BTypeNameHV<U>* pOp):UnBTypeNameHV<U>(val,pOp){}
-	virtual void propagate(typename Derivatives<U>::RecycleBin& bin)
+	BTypeNameATAN(const U& val, BTypeNameHV<U,N>* pOp):UnBTypeNameHV<U,N>(val,pOp){}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin& bin)
 	{
 		U tmp(Op<U>::myInv(Op<U>::mySqr(this->op()->val())+Op<U>::myOne()));
 		this->op()->add(bin,tmp,this->m_derivatives);
 	}
 private:
-	void operator=(const BTypeNameATAN<U>&){} // not allowed
+	void operator=(const BTypeNameATAN<U,N>&){} // not allowed
 };
-template <typename U>
-BTypeName<U> atan(const BTypeName<U>& val)
+template <typename U, unsigned int N>
+BTypeName<U,N> atan(const BTypeName<U,N>& val)
 { 
-	return BTypeName<U>(static_cast<BTypeNameHV<U>*>(new BTypeNameATAN<U>(Op<U>::myAtan(val.val()), val.getBTypeNameHV())));
+	return BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(new BTypeNameATAN<U,N>(Op<U>::myAtan(val.val()), val.getBTypeNameHV())));
 }
 
-template <typename U> struct Op< BTypeName<U> >
+template <typename U, unsigned int N> struct Op< BTypeName<U,N> >
 {
-	typedef BTypeName<U> T;
-	typedef BTypeName<U> Underlying;
+	typedef BTypeName<U,N> T;
+	typedef BTypeName<U,N> Underlying;
 	typedef typename Op<U>::Base Base;
 	static Base myInteger(const int i) { return Base(i); }
 	static Base myZero() { return myInteger(0); }
@@ -0,0 +1,326 @@
+//
+//  ddouble.h
+//  FADBADSwift
+//
+
+#ifndef _DDOUBLE_H
+#define _DDOUBLE_H
+
+#include "fadbad.h"
+
+namespace fadbad
+{
+
+// Double-double numbers: an unevaluated sum hi+lo of two doubles with
+// |lo| <= ulp(hi)/2, giving about 106 bits (32 decimal digits) of
+// significand with the exponent range of double. Arithmetic is built on
+// the error-free transformations twoSum and twoProd (the latter through
+// fma), so it runs on the double hardware; T< DDouble > computes high
+// order Taylor coefficients at a small multiple of the T<double> cost.
+//
+// The kernels rely on IEEE double rounding: do not compile them with
+// -ffast-math. Enable the hardware fma (-mfma, -march) where the target
+// does not imply it, or every twoProd is a library call.
+
+struct DDouble
+{
+	double hi;
+	double lo;
+	DDouble():hi(0),lo(0){}
+	DDouble(const double d):hi(d),lo(0){}
+	DDouble(const double h, const double l):hi(h),lo(l){}
+
+	DDouble& operator+=(const DDouble& a);
+	DDouble& operator-=(const DDouble& a);
+	DDouble& operator*=(const DDouble& a);
+	DDouble& operator/=(const DDouble& a);
+	DDouble& operator+=(const double a);
+	DDouble& operator-=(const double a);
+	DDouble& operator*=(const double a);
+	DDouble& operator/=(const double a);
+};
+
+// Error-free transformations: s+e is exactly a+b (a*b for twoProd).
+
+INLINE1 DDouble quickTwoSum(const double a, const double b) // requires |a| >= |b|
+{
+	const double s=a+b;
+	return DDouble(s,b-(s-a));
+}
+INLINE2 DDouble twoSum(const double a, const double b)
+{
+	const double s=a+b;
+	const double bb=s-a;
+	return DDouble(s,(a-(s-bb))+(b-bb));
+}
+INLINE2 DDouble twoProd(const double a, const double b)
+{
+	const double p=a*b;
+	return DDouble(p,::fma(a,b,-p));
+}
+
+INLINE2 DDouble operator+(const DDouble& a, const DDouble& b)
+{
+	DDouble s=twoSum(a.hi,b.hi);
+	const DDouble t=twoSum(a.lo,b.lo);
+	s.lo+=t.hi;
+	s=quickTwoSum(s.hi,s.lo);
+	s.lo+=t.lo;
+	return quickTwoSum(s.hi,s.lo);
+}
+INLINE2 DDouble operator+(const DDouble& a, const double b)
+{
+	DDouble s=twoSum(a.hi,b);
+	s.lo+=a.lo;
+	return quickTwoSum(s.hi,s.lo);
+}
+INLINE1 DDouble operator+(const double a, const DDouble& b) { return b+a; }
+INLINE1 DDouble operator-(const DDouble& a) { return DDouble(-a.hi,-a.lo); }
+INLINE1 DDouble operator+(const DDouble& a) { return a; }
+INLINE1 DDouble operator-(const DDouble& a, const DDouble& b) { return a+(-b); }
+INLINE1 DDouble operator-(const DDouble& a, const double b) { return a+(-b); }
+INLINE1 DDouble operator-(const double a, const DDouble& b) { return (-b)+a; }
+
+INLINE2 DDouble operator*(const DDouble& a, const DDouble& b)
+{
+	DDouble p=twoProd(a.hi,b.hi);
+	p.lo+=a.hi*b.lo+a.lo*b.hi;
+	return quickTwoSum(p.hi,p.lo);
+}
+INLINE2 DDouble operator*(const DDouble& a, const double b)
+{
+	DDouble p=twoProd(a.hi,b);
+	p.lo+=a.lo*b;
+	return quickTwoSum(p.hi,p.lo);
+}
+INLINE1 DDouble operator*(const double a, const DDouble& b) { return b*a; }
+
+INLINE2 DDouble operator/(const DDouble& a, const double b)
+{
+	const double q1=a.hi/b;
+	const DDouble p=twoProd(q1,b);
+	DDouble s=twoSum(a.hi,-p.hi);
+	s.lo+=a.lo-p.lo;
+	return quickTwoSum(q1,(s.hi+s.lo)/b);
+}
+INLINE2 DDouble operator/(const DDouble& a, const DDouble& b)
+{
+	const double q1=a.hi/b.hi;
+	DDouble r=a-b*q1;
+	const double q2=r.hi/b.hi;
+	r-=b*q2;
+	const double q3=r.hi/b.hi;
+	return quickTwoSum(q1,q2)+q3;
+}
+INLINE1 DDouble operator/(const double a, const DDouble& b) { return DDouble(a)/b; }
+
+INLINE1 DDouble& DDouble::operator+=(const DDouble& a) { return *this=*this+a; }
+INLINE1 DDouble& DDouble::operator-=(const DDouble& a) { return *this=*this-a; }
+INLINE1 DDouble& DDouble::operator*=(const DDouble& a) { return *this=*this*a; }
+INLINE1 DDouble& DDouble::operator/=(const DDouble& a) { return *this=*this/a; }
+INLINE1 DDouble& DDouble::operator+=(const double a) { return *this=*this+a; }
+INLINE1 DDouble& DDouble::operator-=(const double a) { return *this=*this-a; }
+INLINE1 DDouble& DDouble::operator*=(const double a) { return *this=*this*a; }
+INLINE1 DDouble& DDouble::operator/=(const double a) { return *this=*this/a; }
+
+INLINE1 bool operator==(const DDouble& a, const DDouble& b) { return a.hi==b.hi && a.lo==b.lo; }
+INLINE1 bool operator!=(const DDouble& a, const DDouble& b) { return !(a==b); }
+INLINE1 bool operator<(const DDouble& a, const DDouble& b) { return a.hi<b.hi || (a.hi==b.hi && a.lo<b.lo); }
+INLINE1 bool operator>(const DDouble& a, const DDouble& b) { return b<a; }
+INLINE1 bool operator<=(const DDouble& a, const DDouble& b) { return !(b<a); }
+INLINE1 bool operator>=(const DDouble& a, const DDouble& b) { return !(a<b); }
+
+// Constants, rounded to 106 bits.
+
+INLINE1 DDouble ddPI() { return DDouble(3.141592653589793116e+00,1.224646799147353207e-16); }
+INLINE1 DDouble ddPI2() { return DDouble(1.570796326794896558e+00,6.123233995736766036e-17); }
+INLINE1 DDouble ddLN2() { return DDouble(6.931471805599452862e-01,2.319046813846299558e-17); }
+INLINE1 double ddEPS() { return 4.93038065763132e-32; } // 2^-104
+
+// Elementary functions. exp reduces by ln2 and by 2^9 before summing its
+// series; sin and cos reduce by pi/2 and sum theirs on [-pi/4,pi/4]; log
+// (away from 1) and the inverse trigonometric functions take one Newton
+// step from the double result, which doubles its number of correct digits.
+
+INLINE1 DDouble fabs(const DDouble& a) { return a.hi<0?-a:a; }
+INLINE2 DDouble sqr(const DDouble& a)
+{
+	DDouble p=twoProd(a.hi,a.hi);
+	p.lo+=2*a.hi*a.lo+a.lo*a.lo;
+	return quickTwoSum(p.hi,p.lo);
+}
+INLINE2 DDouble sqrt(const DDouble& a)
+{
+	if (a.hi<=0) return DDouble(::sqrt(a.hi));
+	const double x=1/::sqrt(a.hi);
+	const double ax=a.hi*x;
+	return twoSum(ax,(a-sqr(DDouble(ax))).hi*(x*0.5));
+}
+INLINE2 DDouble exp(const DDouble& a)
+{
+	if (a.hi>709.79) return DDouble(::exp(a.hi));
+	if (a.hi<-745.14) return DDouble(0);
+	const double m=::floor(a.hi/ddLN2().hi+0.5);
+	const DDouble r=(a-ddLN2()*m)*(1.0/512);
+	DDouble s(r),t(r);
+	for(int k=2;::fabs(t.hi)>ddEPS()*::fabs(s.hi);++k)
+	{
+		t=t*r/k;
+		s+=t;
+	}
+	for(int i=0;i<9;++i) s=s*2.0+sqr(s); // exp(2r)-1 from exp(r)-1
+	s+=1.0;
+	return DDouble(::ldexp(s.hi,(int)m),::ldexp(s.lo,(int)m));
+}
+INLINE2 DDouble log(const DDouble& a)
+{
+	if (a.hi<=0) return DDouble(::log(a.hi));
+	if (::fabs(a.hi-1)<0.125) // 2 atanh((a-1)/(a+1)), keeps the relative accuracy near 1
+	{
+		const DDouble u=(a-1.0)/(a+1.0);
+		const DDouble u2=sqr(u);
+		DDouble s(u),t(u),term(u);
+		for(int k=3;::fabs(term.hi)>ddEPS()*::fabs(s.hi);k+=2)
+		{
+			t*=u2;
+			term=t/double(k);
+			s+=term;
+		}
+		return s*2.0;
+	}
+	const DDouble x(::log(a.hi));
+	return x+(a*exp(-x)-1.0);
+}
+
+// a-j*pi/2, with pi/2 split over three doubles so that the reduced
+// argument keeps its relative accuracy near the zeros of sin and cos.
+INLINE2 DDouble reducePI2(const DDouble& a, const double j)
+{
+	DDouble r=a-twoProd(1.570796326794896558e+00,j);
+	r-=twoProd(6.123233995736766036e-17,j);
+	return r+1.4973849048591698e-33*j;
+}
+// sin and cos of the reduced argument r, |r| <= pi/4.
+INLINE2 DDouble sinReduced(const DDouble& r)
+{
+	const DDouble r2=sqr(r);
+	DDouble s(r),t(r);
+	for(int k=3;::fabs(t.hi)>ddEPS()*::fabs(s.hi);k+=2)
+	{
+		t=-t*r2/double(k*(k-1));
+		s+=t;
+	}
+	return s;
+}
+INLINE2 DDouble cosReduced(const DDouble& r)
+{
+	const DDouble r2=sqr(r);
+	DDouble s(1.0),t(1.0);
+	for(int k=2;::fabs(t.hi)>ddEPS();k+=2)
+	{
+		t=-t*r2/double(k*(k-1));
+		s+=t;
+	}
+	return s;
+}
+INLINE2 DDouble sin(const DDouble& a)
+{
+	const double j=::nearbyint(a.hi/ddPI2().hi);
+	const DDouble r=reducePI2(a,j);
+	switch(((long long)j%4+4)%4)
+	{
+	case 0: return sinReduced(r);
+	case 1: return cosReduced(r);
+	case 2: return -sinReduced(r);
+	default: return -cosReduced(r);
+	}
+}
+INLINE2 DDouble cos(const DDouble& a)
+{
+	const double j=::nearbyint(a.hi/ddPI2().hi);
+	const DDouble r=reducePI2(a,j);
+	switch(((long long)j%4+4)%4)
+	{
+	case 0: return cosReduced(r);
+	case 1: return -sinReduced(r);
+	case 2: return -cosReduced(r);
+	default: return sinReduced(r);
+	}
+}
+INLINE1 DDouble tan(const DDouble& a) { return sin(a)/cos(a); }
+INLINE2 DDouble atan(const DDouble& a)
+{
+	const DDouble z(::atan(a.hi));
+	const DDouble c=cos(z);
+	return z+(a*c-sin(z))*c;
+}
+INLINE2 DDouble asin(const DDouble& a)
+{
+	if (::fabs(a.hi)>=1) return DDouble(::asin(a.hi));
+	const DDouble z(::asin(a.hi));
+	return z+(a-sin(z))/cos(z);
+}
+INLINE2 DDouble acos(const DDouble& a)
+{
+	if (::fabs(a.hi)>=1) return DDouble(::acos(a.hi));
+	const DDouble z(::acos(a.hi));
+	return z-(a-cos(z))/sin(z);
+}
+INLINE2 DDouble pow(const DDouble& a, const DDouble& b)
+{
+	if (b.lo==0 && b.hi==::floor(b.hi) && ::fabs(b.hi)<2147483648.0)
+	{
+		long long n=(long long)b.hi;
+		const bool invert=n<0;
+		if (invert) n=-n;
+		DDouble p(1.0),x(a);
+		for(;n>0;n>>=1)
+		{
+			if (n&1) p*=x;
+			if (n>1) x=sqr(x);
+		}
+		return invert?1.0/p:p;
+	}
+	return exp(b*log(a));
+}
+
+template <> struct Op<DDouble>
+{
+	typedef DDouble V;
+	typedef DDouble Underlying;
+	typedef DDouble Base;
+	static Base myInteger(const int i) { return Base(i); }
+	static Base myZero() { return myInteger(0); }
+	static Base myOne() { return myInteger(1);}
+	static Base myTwo() { return myInteger(2); }
+	static Base myPI() { return ddPI(); }
+	static V myPos(const V& x) { return +x; }
+	static V myNeg(const V& x) { return -x; }
+	template <typename Y> static V& myCadd(V& x, const Y& y) { return x+=y; }
+	template <typename Y> static V& myCsub(V& x, const Y& y) { return x-=y; }
+	template <typename Y> static V& myCmul(V& x, const Y& y) { return x*=y; }
+	template <typename Y> static V& myCdiv(V& x, const Y& y) { return x/=y; }
+	static V myInv(const V& x) { return 1.0/x; }
+	static V mySqr(const V& x) { return fadbad::sqr(x); }
+	template <typename X, typename Y>
+	static V myPow(const X& x, const Y& y) { return fadbad::pow(V(x),V(y)); }
+	static V mySqrt(const V& x) { return fadbad::sqrt(x); }
+	static V myLog(const V& x) { return fadbad::log(x); }
+	static V myExp(const V& x) { return fadbad::exp(x); }
+	static V mySin(const V& x) { return fadbad::sin(x); }
+	static V myCos(const V& x) { return fadbad::cos(x); }
+	static V myTan(const V& x) { return fadbad::tan(x); }
+	static V myAsin(const V& x) { return fadbad::asin(x); }
+	static V myAcos(const V& x) { return fadbad::acos(x); }
+	static V myAtan(const V& x) { return fadbad::atan(x); }
+	static bool myEq(const V& x, const V& y) { return x==y; }
+	static bool myNe(const V& x, const V& y) { return x!=y; }
+	static bool myLt(const V& x, const V& y) { return x<y; }
+	static bool myLe(const V& x, const V& y) { return x<=y; }
+	static bool myGt(const V& x, const V& y) { return x>y; }
+	static bool myGe(const V& x, const V& y) { return x>=y; }
+};
+
+} // namespace fadbad
+
+#endif
@@ -32,6 +32,10 @@
 
 #include <math.h>
 
+#ifdef FADBAD_ATOMIC_RC
+#include <atomic>
+#endif
+
 namespace fadbad
 {
 	// NOTE:
@@ -73,6 +77,47 @@ namespace fadbad
 		static bool myGt(const T& x, const T& y) { return x>y; }
 		static bool myGe(const T& x, const T& y) { return x>=y; }
 	};
+
+	// Reference count of a graph node of T or B. Define FADBAD_ATOMIC_RC
+	// to make it atomic, so that several threads can build expressions
+	// on shared nodes (a common set of parameters, a preamble graph) and
+	// drop them: increments are relaxed, decrements acquire-release so
+	// that the thread deleting a node sees every other thread's last use
+	// of it.
+	//
+	// With the option, threads working each on their own variables may at
+	// once: build and drop expressions on shared nodes, copy Params, and
+	// take the shortcuts that change a node in place when its count is 1
+	// (the T linear combinations and multiply-adds, the B sums, += on
+	// either). A count of 1 means the only reference is the calling
+	// thread's own variable or temporary, which no other thread can reach
+	// without a race on that variable; the count is read with acquire, so
+	// the uses of threads that dropped their references come before the
+	// change. Not safe: eval(), update() or diff() on graphs sharing nodes,
+	// which write coefficients, visit marks and adjoints in the nodes, and
+	// Param::set() while other threads read the parameter.
+	class RefCount
+	{
+#ifdef FADBAD_ATOMIC_RC
+		std::atomic<unsigned int> m_n;
+	public:
+		RefCount():m_n(0){}
+		RefCount(const RefCount&):m_n(0){} // a copied node has no references
+		void operator++() { m_n.fetch_add(1,std::memory_order_relaxed); }
+		unsigned int operator--() { return m_n.fetch_sub(1,std::memory_order_acq_rel)-1; }
+		operator unsigned int() const { return m_n.load(std::memory_order_acquire); }
+#else
+		unsigned int m_n;
+	public:
+		RefCount():m_n(0){}
+		RefCount(const RefCount&):m_n(0){} // a copied node has no references
+		void operator++() { ++m_n; }
+		unsigned int operator--() { return --m_n; }
+		operator unsigned int() const { return m_n; }
+#endif
+	private:
+		void operator=(const RefCount&); // not allowed
+	};
 } //namespace fadbad
 
 // Name for backward AD type:
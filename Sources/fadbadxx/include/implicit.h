@@ -0,0 +1,171 @@
+//
+//  implicit.h
+//  FADBADSwift
+//
+
+#ifndef _IMPLICIT_H
+#define _IMPLICIT_H
+
+#include <vector>
+#include <cmath>
+
+#include "matad.h"
+
+namespace fadbad
+{
+
+// Implicitly defined functions x(p) with res(x,p)=0.
+//
+// implicitSolve runs a solver on plain doubles and then differentiates
+// the solution by the implicit function theorem, dx/dp = -Jx^-1*Jp with
+// Jx=dres/dx and Jp=dres/dp at the solution, so the iterations are
+// never recorded: in reverse mode the solve is one node with nx outputs
+// whatever the number of iterations.
+//
+// res(x,p,r) computes the nx residuals r from the nx unknowns x and the
+// np parameters p and must be a template over the scalar type, since it
+// is evaluated on double, on F<double> (for Jx, and Jp*dp in forward
+// mode) and on B<double> (for Jp^T*lambda in reverse mode). The values
+// of x on entry are the initial guess.
+
+// Jx at (x,p), row-major nx x nx, by forward mode in nx directions.
+template <class RES>
+void implicitJacobian(RES& res, const double* x, const unsigned int nx, const double* p, const unsigned int np, double* J)
+{
+	std::vector< FTypeName<double> > fx(nx), fp(p,p+np), fr(nx);
+	for(unsigned int i=0;i<nx;++i)
+	{
+		fx[i]=x[i];
+		fx[i].diff(i,nx);
+	}
+	res(&fx[0],&fp[0],&fr[0]);
+	for(unsigned int i=0;i<nx;++i)
+		for(unsigned int j=0;j<nx;++j) J[i*nx+j]=fr[i].deriv(j);
+}
+
+// Default solver: Newton's method with the Jacobian from forward mode,
+// stopping when the max-norm of the update drops below tol.
+template <class RES>
+struct ImplicitNewton
+{
+	RES& m_res;
+	const unsigned int m_nx, m_np;
+	const double m_tol;
+	const unsigned int m_maxIter;
+	ImplicitNewton(RES& res, const unsigned int nx, const unsigned int np, const double tol=1e-12, const unsigned int maxIter=50):
+		m_res(res),m_nx(nx),m_np(np),m_tol(tol),m_maxIter(maxIter){}
+	bool operator()(double* x, const double* p) const
+	{
+		const unsigned int n=m_nx;
+		std::vector<double> J(n*n), r(n);
+		std::vector<unsigned int> piv(n);
+		for(unsigned int it=0;it<m_maxIter;++it)
+		{
+			m_res(x,p,&r[0]);
+			implicitJacobian(m_res,x,n,p,m_np,&J[0]);
+			if (!matLU(n,&J[0],n,&piv[0])) return false;
+			matLUSolve(n,&J[0],n,&piv[0],false,1,&r[0],1);
+			double step=0;
+			for(unsigned int i=0;i<n;++i)
+			{
+				x[i]-=r[i];
+				step=std::max(step,std::fabs(r[i]));
+			}
+			if (step<=m_tol*(1+step)) return true;
+		}
+		return false;
+	}
+};
+
+// Forward mode: dx = -Jx^-1*(Jp*dp) for all directions of p at once.
+template <class RES, class SOLVER, unsigned int N>
+bool implicitSolve(RES res, SOLVER solver, const FTypeName<double,N>* p, const unsigned int np,
+	FTypeName<double,N>* x, const unsigned int nx)
+{
+	std::vector<double> xv(nx), pv(np), J(nx*nx);
+	std::vector<unsigned int> piv(nx);
+	matValues(x,nx,&xv[0]);
+	matValues(p,np,&pv[0]);
+	if (!solver(&xv[0],&pv[0])) return false;
+	implicitJacobian(res,&xv[0],nx,&pv[0],np,&J[0]);
+	if (!matLU(nx,&J[0],nx,&piv[0])) return false;
+	const FTypeName<double,N>* pDep=matDepend(p,np);
+	if (pDep==0) { matStore(x,nx,&xv[0],0,(const double*)0,FTypeName<double,N>()); return true; }
+	const FTypeName<double,N> proto(*pDep);
+	const unsigned int nd=proto.size();
+	// res at the solution with constant x carries Jp*dp:
+	std::vector< FTypeName<double,N> > fx(xv.begin(),xv.end()), fr(nx);
+	res(&fx[0],p,&fr[0]);
+	std::vector<double> R(nx*nd), dx(nd*nx);
+	for(unsigned int i=0;i<nx;++i)
+		for(unsigned int d=0;d<nd;++d) R[i*nd+d]=fr[i].depend()?-fr[i][d]:0.0;
+	matLUSolve(nx,&J[0],nx,&piv[0],false,nd,&R[0],nd);
+	for(unsigned int i=0;i<nx;++i)
+		for(unsigned int d=0;d<nd;++d) dx[d*nx+i]=R[i*nd+d];
+	matStore(x,nx,&xv[0],nd,&dx[0],proto);
+	return true;
+}
+
+// Reverse mode: lambda = Jx^-T*xbar, pbar -= Jp^T*lambda, the latter by
+// one reverse sweep through res.
+template <class RES, unsigned int N>
+class BTypeNameIMPLICIT : public BTypeNameMATOP<double,N>
+{
+	RES m_res;
+	const unsigned int m_nx, m_np;
+	std::vector<double> m_x, m_p, m_lu;
+	std::vector<unsigned int> m_piv;
+	virtual void adjoint(const double* xBar, double* pBar) const
+	{
+		typedef BTypeName<double,1> BD; // a single sweep with a scalar adjoint
+		std::vector<double> lambda(xBar,xBar+m_nx);
+		matLUSolve(m_nx,&m_lu[0],m_nx,&m_piv[0],true,1,&lambda[0],1);
+		std::vector<BD> p(m_p.begin(),m_p.end());
+		BD s;
+		{
+			std::vector<BD> x(m_x.begin(),m_x.end()), r(m_nx);
+			RES res(m_res);
+			res(&x[0],&p[0],&r[0]);
+			s=dot(&lambda[0],&r[0],m_nx);
+		} // the residual graph must be gone before propagating
+		s.diff(0,1);
+		for(unsigned int j=0;j<m_np;++j) pBar[j]-=p[j].d(0);
+	}
+public:
+	BTypeNameIMPLICIT(const RES& res, const BTypeName<double,N>* p, const unsigned int np, const unsigned int nx):
+		BTypeNameMATOP<double,N>(nx),m_res(res),m_nx(nx),m_np(np),m_x(nx),m_p(np),m_lu(nx*nx),m_piv(nx)
+	{
+		for(unsigned int j=0;j<np;++j) this->input(p[j]);
+		matValues(p,np,&m_p[0]);
+	}
+	double* x() { return &m_x[0]; }
+	const double* p() const { return &m_p[0]; }
+	bool factor()
+	{
+		implicitJacobian(m_res,&m_x[0],m_nx,&m_p[0],m_np,&m_lu[0]);
+		return matLU(m_nx,&m_lu[0],m_nx,&m_piv[0]);
+	}
+	const double* solution() const { return &m_x[0]; }
+};
+
+template <class RES, class SOLVER, unsigned int N>
+bool implicitSolve(RES res, SOLVER solver, const BTypeName<double,N>* p, const unsigned int np,
+	BTypeName<double,N>* x, const unsigned int nx)
+{
+	BTypeNameIMPLICIT<RES,N>* pOp=new BTypeNameIMPLICIT<RES,N>(res,p,np,nx);
+	matValues(x,nx,pOp->x());
+	if (!solver(pOp->x(),pOp->p())) { delete pOp; return false; }
+	return matSolveOutputs(pOp,x);
+}
+
+// Both modes with the default Newton solver:
+template <class RES, typename X>
+bool implicitSolve(RES res, const X* p, const unsigned int np, X* x, const unsigned int nx,
+	const double tol=1e-12, const unsigned int maxIter=50)
+{
+	return implicitSolve(res,ImplicitNewton<RES>(res,nx,np,tol,maxIter),p,np,x,nx);
+}
+
+} // namespace fadbad
+
+#endif
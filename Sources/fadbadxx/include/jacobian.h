@@ -0,0 +1,292 @@
+//
+//  jacobian.h
+//  FADBADSwift
+//
+
+#ifndef _JACOBIAN_H
+#define _JACOBIAN_H
+
+#include <vector>
+#include <queue>
+#include <algorithm>
+
+#include "tape.h"
+
+namespace fadbad
+{
+
+// Jacobians of a recorded function by the cheapest of three schemes.
+//
+// The function is recorded once on a Tape. Its linearized graph has
+// one edge per operand of every operation, weighted by the local
+// partial derivative (Tape::partials). Forward mode costs one sweep over
+// the edges per input, reverse mode one per output. Vertex elimination
+// removes the intermediate vertices one at a time, in Markowitz order
+// (fewest predecessors times successors first), each removal adding
+// the products of the incoming and outgoing edge weights to the edges
+// that bypass the vertex; the Jacobian is left on the edges from the
+// inputs to the outputs. For chains with narrow bottlenecks this beats
+// both pure modes by large factors.
+//
+// The elimination is worked out once on the structure, when the engine
+// is built, and kept as a program of multiply-adds over edge weights, so
+// the cost of every scheme is known in multiply-adds before any is run.
+// jacobian() linearizes at x and runs the cheapest scheme.
+
+enum JacobianMode
+{
+	JacobianFORWARD, JacobianREVERSE, JacobianELIMINATION
+};
+
+class JacobianEngine
+{
+	// w[dst]+=w[a]*w[b] over the edge weights:
+	struct MulAdd
+	{
+		unsigned int dst, a, b;
+	};
+	struct Edge
+	{
+		unsigned int vertex, slot;
+	};
+	Tape m_tape;
+	unsigned int m_n, m_m, m_edges;
+	double m_cost[3];
+	JacobianMode m_mode;
+	std::vector<MulAdd> m_program;
+	std::vector<unsigned int> m_entry; // weight slot of J[k*n+j], or NoEntry
+	std::vector<double> m_v, m_w, m_t;
+	static constexpr unsigned int Lanes=8; // directions per forward or reverse sweep
+	static constexpr unsigned int NoEntry=~0u;
+
+	unsigned int one() const { return 2*m_tape.size(); } // weight slot holding 1
+
+	static unsigned int find(const std::vector<Edge>& edges, const unsigned int vertex)
+	{
+		for(unsigned int k=0;k<edges.size();++k) if (edges[k].vertex==vertex) return k;
+		return NoEntry;
+	}
+	static void remove(std::vector<unsigned int>& vertices, const unsigned int vertex)
+	{
+		std::vector<unsigned int>::iterator it=std::find(vertices.begin(),vertices.end(),vertex);
+		if (it!=vertices.end()) { *it=vertices.back(); vertices.pop_back(); }
+	}
+	// Markowitz elimination on the structure, giving up once it costs
+	// more than limit multiply-adds.
+	void plan(const double limit)
+	{
+		const unsigned int size=m_tape.size(), nv=size+m_m;
+		std::vector< std::vector<Edge> > preds(nv);
+		std::vector< std::vector<unsigned int> > succs(nv);
+		std::vector<unsigned int> column(size,NoEntry);
+		for(unsigned int j=0;j<m_n;++j) column[m_tape.input(j)]=j;
+		m_program.clear();
+		for(unsigned int i=0;i<size;++i)
+		{
+			const TapeOp& op=m_tape.op(i);
+			if (op.code==TapeINPUT || op.code==TapeCONST) continue;
+			Edge a={op.a,2*i};
+			preds[i].push_back(a);
+			succs[op.a].push_back(i);
+			if (tapeIsBinary(op.code) && op.b!=op.a)
+			{
+				Edge b={op.b,2*i+1};
+				preds[i].push_back(b);
+				succs[op.b].push_back(i);
+			}
+			else if (tapeIsBinary(op.code))
+			{
+				// one edge for x op x, weighted by both partials:
+				MulAdd sum={2*i,2*i+1,one()};
+				m_program.push_back(sum);
+			}
+		}
+		for(unsigned int k=0;k<m_m;++k)
+		{
+			Edge e={m_tape.output(k),one()};
+			preds[size+k].push_back(e);
+			succs[m_tape.output(k)].push_back(size+k);
+		}
+		unsigned int slots=one()+1;
+		typedef std::pair<double,unsigned int> Entry;
+		std::priority_queue< Entry,std::vector<Entry>,std::greater<Entry> > queue;
+		std::vector<bool> eliminated(nv,false);
+		for(unsigned int i=0;i<size;++i)
+			if (column[i]==NoEntry) queue.push(Entry(double(preds[i].size())*succs[i].size(),i));
+		while(!queue.empty())
+		{
+			const Entry top=queue.top();
+			queue.pop();
+			const unsigned int v=top.second;
+			if (eliminated[v] || top.first!=double(preds[v].size())*succs[v].size()) continue;
+			for(unsigned int q=0;q<succs[v].size();++q)
+			{
+				const unsigned int s=succs[v][q];
+				const unsigned int kb=find(preds[s],v);
+				const unsigned int b=preds[s][kb].slot;
+				preds[s][kb]=preds[s].back();
+				preds[s].pop_back();
+				for(unsigned int r=0;r<preds[v].size();++r)
+				{
+					const Edge& pa=preds[v][r];
+					unsigned int k=find(preds[s],pa.vertex);
+					if (k==NoEntry)
+					{
+						Edge e={pa.vertex,slots++};
+						preds[s].push_back(e);
+						succs[pa.vertex].push_back(s);
+						k=(unsigned int)preds[s].size()-1;
+					}
+					MulAdd op={preds[s][k].slot,pa.slot,b};
+					m_program.push_back(op);
+				}
+				if (s<size) queue.push(Entry(double(preds[s].size())*succs[s].size(),s));
+			}
+			for(unsigned int r=0;r<preds[v].size();++r)
+			{
+				const unsigned int p=preds[v][r].vertex;
+				remove(succs[p],v);
+				if (column[p]==NoEntry) queue.push(Entry(double(preds[p].size())*succs[p].size(),p));
+			}
+			preds[v].clear();
+			succs[v].clear();
+			eliminated[v]=true;
+			if (m_program.size()>limit) { m_program.clear(); m_cost[JacobianELIMINATION]=HUGE_VAL; return; }
+		}
+		m_cost[JacobianELIMINATION]=double(m_program.size());
+		m_entry.assign(m_m*m_n,NoEntry);
+		for(unsigned int k=0;k<m_m;++k)
+			for(unsigned int r=0;r<preds[size+k].size();++r)
+				m_entry[k*m_n+column[preds[size+k][r].vertex]]=preds[size+k][r].slot;
+		m_w.assign(slots,0.0);
+	}
+	void linearize(const double* x, double* y)
+	{
+		for(unsigned int j=0;j<m_n;++j) m_v[m_tape.input(j)]=x[j];
+		m_tape.forward(&m_v[0]);
+		for(unsigned int k=0;k<m_m;++k) y[k]=m_v[m_tape.output(k)];
+		m_tape.partials(&m_v[0],&m_w[0]);
+		m_w[one()]=1;
+	}
+	// Tangents of Lanes inputs at a time over the partials:
+	void forward(double* J)
+	{
+		const unsigned int size=m_tape.size();
+		const double* d=&m_w[0];
+		double* t=&m_t[0];
+		for(unsigned int j0=0;j0<m_n;j0+=Lanes)
+		{
+			std::fill(m_t.begin(),m_t.end(),0.0);
+			for(unsigned int l=0;l<Lanes && j0+l<m_n;++l) t[m_tape.input(j0+l)*Lanes+l]=1;
+			for(unsigned int i=0;i<size;++i)
+			{
+				const TapeOp& op=m_tape.op(i);
+				if (op.code==TapeINPUT || op.code==TapeCONST) continue;
+				double* ti=t+i*Lanes;
+				const double* ta=t+op.a*Lanes;
+				const double da=d[2*i];
+				if (tapeIsBinary(op.code))
+				{
+					const double* tb=t+op.b*Lanes;
+					const double db=d[2*i+1];
+					for(unsigned int l=0;l<Lanes;++l) ti[l]=da*ta[l]+db*tb[l];
+				}
+				else for(unsigned int l=0;l<Lanes;++l) ti[l]=da*ta[l];
+			}
+			for(unsigned int k=0;k<m_m;++k)
+			{
+				const double* tk=t+m_tape.output(k)*Lanes;
+				for(unsigned int l=0;l<Lanes && j0+l<m_n;++l) J[k*m_n+j0+l]=tk[l];
+			}
+		}
+	}
+	// Adjoints of Lanes outputs at a time over the partials:
+	void reverse(double* J)
+	{
+		const unsigned int size=m_tape.size();
+		const double* d=&m_w[0];
+		double* t=&m_t[0];
+		for(unsigned int k0=0;k0<m_m;k0+=Lanes)
+		{
+			std::fill(m_t.begin(),m_t.end(),0.0);
+			for(unsigned int l=0;l<Lanes && k0+l<m_m;++l) t[m_tape.output(k0+l)*Lanes+l]+=1;
+			for(unsigned int i=size;i-->0;)
+			{
+				const TapeOp& op=m_tape.op(i);
+				if (op.code==TapeINPUT || op.code==TapeCONST) continue;
+				const double* ti=t+i*Lanes;
+				double* ta=t+op.a*Lanes;
+				const double da=d[2*i];
+				for(unsigned int l=0;l<Lanes;++l) ta[l]+=da*ti[l];
+				if (tapeIsBinary(op.code))
+				{
+					double* tb=t+op.b*Lanes;
+					const double db=d[2*i+1];
+					for(unsigned int l=0;l<Lanes;++l) tb[l]+=db*ti[l];
+				}
+			}
+			for(unsigned int j=0;j<m_n;++j)
+			{
+				const double* tj=t+m_tape.input(j)*Lanes;
+				for(unsigned int l=0;l<Lanes && k0+l<m_m;++l) J[(k0+l)*m_n+j]=tj[l];
+			}
+		}
+	}
+	void eliminate(double* J)
+	{
+		double* w=&m_w[0];
+		const unsigned int nProgram=(unsigned int)m_program.size();
+		const MulAdd* program=nProgram==0?0:&m_program[0];
+		std::fill(m_w.begin()+one()+1,m_w.end(),0.0);
+		for(unsigned int q=0;q<nProgram;++q) w[program[q].dst]+=w[program[q].a]*w[program[q].b];
+		for(unsigned int e=0;e<m_m*m_n;++e) J[e]=m_entry[e]==NoEntry?0.0:w[m_entry[e]];
+	}
+public:
+	// Records f(x,y) with n inputs and m outputs (see Tape::record) and
+	// plans the elimination.
+	template <class FUN>
+	JacobianEngine(FUN f, const double* x, const unsigned int n, const unsigned int m):m_n(n),m_m(m),m_edges(0)
+	{
+		m_tape.record(f,x,n,m);
+		for(unsigned int i=0;i<m_tape.size();++i)
+		{
+			const unsigned int code=m_tape.op(i).code;
+			if (code!=TapeINPUT && code!=TapeCONST) m_edges+=tapeIsBinary(code)?2:1;
+		}
+		m_cost[JacobianFORWARD]=double(m_edges)*(((n+Lanes-1)/Lanes)*Lanes);
+		m_cost[JacobianREVERSE]=double(m_edges)*(((m+Lanes-1)/Lanes)*Lanes);
+		m_w.assign(one()+1,0.0);
+		plan(std::min(m_cost[JacobianFORWARD],m_cost[JacobianREVERSE]));
+		m_mode=JacobianFORWARD;
+		for(unsigned int k=1;k<3;++k) if (m_cost[k]<m_cost[m_mode]) m_mode=JacobianMode(k);
+		m_v.assign(m_tape.size(),0.0);
+		if (m_mode!=JacobianELIMINATION) m_t.assign(m_tape.size()*Lanes,0.0);
+	}
+	const Tape& tape() const { return m_tape; }
+	unsigned int edges() const { return m_edges; }
+	// Estimated multiply-adds, HUGE_VAL for an elimination that was
+	// abandoned as more expensive than the pure modes:
+	double cost(const JacobianMode mode) const { return m_cost[mode]; }
+	JacobianMode mode() const { return m_mode; }
+	void setMode(const JacobianMode mode)
+	{
+		if (mode==JacobianELIMINATION && m_cost[mode]==HUGE_VAL) plan(HUGE_VAL);
+		if (mode!=JacobianELIMINATION) m_t.assign(m_tape.size()*Lanes,0.0);
+		m_mode=mode;
+	}
+	// Outputs y and Jacobian J (m x n, row-major) at x.
+	void jacobian(const double* x, double* y, double* J)
+	{
+		linearize(x,y);
+		switch(m_mode)
+		{
+		case JacobianFORWARD: forward(J); break;
+		case JacobianREVERSE: reverse(J); break;
+		case JacobianELIMINATION: eliminate(J); break;
+		}
+	}
+};
+
+} // namespace fadbad
+
+#endif
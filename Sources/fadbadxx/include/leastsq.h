@@ -0,0 +1,399 @@
+//
+//  leastsq.h
+//  FADBADSwift
+//
+
+#ifndef _LEASTSQ_H
+#define _LEASTSQ_H
+
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+#include "fadiff.h"
+#include "matad.h"
+#include "tape.h"
+
+namespace fadbad
+{
+
+// Nonlinear least squares, min 0.5*|r(p)|^2 over np parameters p with
+// m residuals r, by Levenberg-Marquardt.
+//
+// res(p,r) must be a template over the scalar type. Jacobians are taken
+// in forward mode on F<double,NB>, NB columns per pass over the
+// residuals. With a sparsity pattern the columns are first colored so
+// that no two columns of a color share a row, and one direction then
+// carries a whole color: the number of passes is the number of colors
+// divided by NB, however many parameters there are. The pattern is given
+// to the constructor or to setSparsity; without one the Jacobian is
+// dense, and the dense pattern is built by the first fit.
+//
+// The Jacobian values are kept in the storage of the pattern, and the
+// step solves either the normal equations (J^T*J + lambda*D)*dp = -J^T*r
+// by Cholesky, accumulated row by row from the pattern, or, for a dense
+// Jacobian with useQR set, the damped problem through a Householder QR
+// of J in place. Every buffer is allocated before the first iteration,
+// so the iterations do not allocate. Row pointers are size_t, as the
+// number of nonzeros may exceed the range of unsigned int.
+
+struct LeastSquaresStats
+{
+	unsigned int iterations;
+	unsigned int jacobians; // Jacobian evaluations
+	unsigned int residuals; // residual evaluations on double
+	unsigned int passes; // residual passes per Jacobian
+	double cost; // 0.5*|r|^2
+	double gradNorm; // max-norm of J^T*r
+	double lambda;
+	double seconds;
+	bool converged;
+	LeastSquaresStats():iterations(0),jacobians(0),residuals(0),passes(0),cost(0),gradNorm(0),lambda(0),seconds(0),converged(false){}
+};
+
+// Sparsity pattern of the Jacobian of res at p, as rows of column
+// indices (CSR), found by propagating index sets through a recording.
+template <class RES>
+void jacobianPattern(RES res, const double* p, const unsigned int np, const unsigned int m,
+	std::vector<size_t>& rowPtr, std::vector<unsigned int>& cols)
+{
+	Tape tape;
+	tape.record(res,p,np,m);
+	std::vector< std::vector<unsigned int> > sets(tape.size());
+	for(unsigned int j=0;j<np;++j) sets[tape.input(j)].push_back(j);
+	for(unsigned int i=0;i<tape.size();++i)
+	{
+		const TapeOp& op=tape.op(i);
+		if (op.code==TapeINPUT || op.code==TapeCONST) continue;
+		if (tapeIsBinary(op.code))
+		{
+			const std::vector<unsigned int>& a=sets[op.a];
+			const std::vector<unsigned int>& b=sets[op.b];
+			sets[i].resize(a.size()+b.size());
+			sets[i].erase(std::set_union(a.begin(),a.end(),b.begin(),b.end(),sets[i].begin()),sets[i].end());
+		}
+		else sets[i]=sets[op.a];
+	}
+	rowPtr.assign(1,0);
+	cols.clear();
+	for(unsigned int k=0;k<m;++k)
+	{
+		const std::vector<unsigned int>& s=sets[tape.output(k)];
+		cols.insert(cols.end(),s.begin(),s.end());
+		rowPtr.push_back(cols.size());
+	}
+}
+
+template <class RES, unsigned int NB=16>
+class LevenbergMarquardt
+{
+	RES m_res;
+	const unsigned int m_m, m_np;
+	// pattern (CSR), column colors and Jacobian values in pattern order:
+	std::vector<size_t> m_rowPtr;
+	std::vector<unsigned int> m_cols, m_color;
+	unsigned int m_colors;
+	std::vector<double> m_J;
+	// work buffers:
+	std::vector< FTypeName<double,NB> > m_fp, m_fr;
+	std::vector<double> m_r, m_rt, m_pt, m_g, m_A, m_L, m_dp, m_diag, m_tau, m_qtr;
+
+	void color()
+	{
+		// greedy distance-2 coloring over the column intersection graph:
+		std::vector<size_t> colPtr(m_np+1,0);
+		std::vector<unsigned int> colRows(m_cols.size());
+		for(size_t k=0;k<m_cols.size();++k) ++colPtr[m_cols[k]+1];
+		for(unsigned int j=0;j<m_np;++j) colPtr[j+1]+=colPtr[j];
+		std::vector<size_t> fill(colPtr.begin(),colPtr.end()-1);
+		for(unsigned int i=0;i<m_m;++i)
+			for(size_t k=m_rowPtr[i];k<m_rowPtr[i+1];++k) colRows[fill[m_cols[k]]++]=i;
+		std::vector<unsigned int> forbidden(m_np+1,~0u);
+		m_color.assign(m_np,0);
+		m_colors=0;
+		for(unsigned int j=0;j<m_np;++j)
+		{
+			for(size_t k=colPtr[j];k<colPtr[j+1];++k)
+			{
+				const unsigned int i=colRows[k];
+				for(size_t q=m_rowPtr[i];q<m_rowPtr[i+1];++q)
+					if (m_cols[q]<j) forbidden[m_color[m_cols[q]]]=j;
+			}
+			unsigned int c=0;
+			while(forbidden[c]==j) ++c;
+			m_color[j]=c;
+			m_colors=std::max(m_colors,c+1);
+		}
+	}
+	// Every column in every row, one color per column:
+	void densePattern()
+	{
+		m_rowPtr.resize(m_m+1);
+		m_cols.resize((size_t)m_m*m_np);
+		for(unsigned int i=0;i<=m_m;++i) m_rowPtr[i]=(size_t)i*m_np;
+		for(unsigned int i=0;i<m_m;++i) for(unsigned int j=0;j<m_np;++j) m_cols[(size_t)i*m_np+j]=j;
+		m_color.resize(m_np);
+		for(unsigned int j=0;j<m_np;++j) m_color[j]=j;
+		m_colors=m_np;
+	}
+	void allocate()
+	{
+		m_J.assign(m_cols.size(),0.0);
+		m_fp.resize(m_np);
+		m_fr.resize(m_m);
+		m_r.assign(m_m,0.0);
+		m_rt.assign(m_m,0.0);
+		m_pt.assign(m_np,0.0);
+		m_g.assign(m_np,0.0);
+		m_A.assign((size_t)m_np*m_np,0.0);
+		m_L.assign(std::max((size_t)m_np*m_np,(size_t)2*m_np),0.0);
+		m_dp.assign(m_np,0.0);
+		m_diag.assign(m_np,0.0);
+		if (useQR && dense())
+		{
+			m_tau.assign(m_np,0.0);
+			m_qtr.assign(m_m,0.0);
+			m_A.assign((size_t)2*m_np*m_np,0.0);
+		}
+	}
+	bool dense() const { return m_cols.size()==(size_t)m_m*m_np && m_m>=m_np; }
+	// J and r at p, one pass per group of NB colors:
+	void jacobian(const double* p, LeastSquaresStats& stats)
+	{
+		for(unsigned int c0=0;c0<m_colors;c0+=NB)
+		{
+			for(unsigned int j=0;j<m_np;++j)
+			{
+				m_fp[j]=p[j];
+				if (m_color[j]>=c0 && m_color[j]<c0+NB) m_fp[j].diff(m_color[j]-c0);
+			}
+			m_res(&m_fp[0],&m_fr[0]);
+			for(unsigned int i=0;i<m_m;++i)
+			{
+				const FTypeName<double,NB>& ri=m_fr[i];
+				m_r[i]=ri.val();
+				for(size_t k=m_rowPtr[i];k<m_rowPtr[i+1];++k)
+				{
+					const unsigned int c=m_color[m_cols[k]];
+					if (c>=c0 && c<c0+NB) m_J[k]=ri.deriv(c-c0);
+				}
+			}
+		}
+		++stats.jacobians;
+		stats.passes=(m_colors+NB-1)/NB;
+	}
+	double cost(const double* r) const
+	{
+		double s=0;
+		for(unsigned int i=0;i<m_m;++i) s+=r[i]*r[i];
+		return 0.5*s;
+	}
+	// g=J^T*r and A=J^T*J (upper triangle), row by row:
+	void normalEquations()
+	{
+		std::fill(m_g.begin(),m_g.end(),0.0);
+		std::fill(m_A.begin(),m_A.end(),0.0);
+		for(unsigned int i=0;i<m_m;++i)
+		{
+			const size_t k0=m_rowPtr[i], k1=m_rowPtr[i+1];
+			for(size_t k=k0;k<k1;++k)
+			{
+				const unsigned int a=m_cols[k];
+				const double jk=m_J[k];
+				m_g[a]+=jk*m_r[i];
+				double* row=&m_A[(size_t)a*m_np];
+				for(size_t q=k;q<k1;++q) row[m_cols[q]]+=jk*m_J[q];
+			}
+		}
+		const size_t n=m_np;
+		for(unsigned int a=0;a<m_np;++a)
+		{
+			for(unsigned int b=0;b<a;++b) m_A[a*n+b]=m_A[b*n+a];
+			m_diag[a]=std::max(m_A[a*n+a],1e-300);
+		}
+	}
+	// dp from (A+lambda*diag(A))*dp=-g; false if not positive definite.
+	bool solveNormal(const double lambda)
+	{
+		const size_t n=m_np;
+		std::copy(m_A.begin(),m_A.begin()+n*n,m_L.begin());
+		for(unsigned int a=0;a<m_np;++a) m_L[a*n+a]+=lambda*m_diag[a];
+		if (!matCholesky(m_np,&m_L[0],m_np)) return false;
+		for(unsigned int a=0;a<m_np;++a) m_dp[a]=-m_g[a];
+		matCholSolve(m_np,&m_L[0],m_np,1,&m_dp[0],1);
+		return true;
+	}
+	// Householder QR of the dense J (m x np, row-major) in place, with
+	// Q^T*r in m_qtr and the column norms of J as scaling D.
+	void factorQR()
+	{
+		const unsigned int m=m_m;
+		const size_t n=m_np;
+		double* J=&m_J[0];
+		std::copy(m_r.begin(),m_r.end(),m_qtr.begin());
+		std::fill(m_g.begin(),m_g.end(),0.0);
+		for(unsigned int j=0;j<n;++j)
+		{
+			double s=0;
+			for(unsigned int i=0;i<m;++i) { s+=J[i*n+j]*J[i*n+j]; m_g[j]+=J[i*n+j]*m_r[i]; }
+			m_diag[j]=std::max(s,1e-300);
+		}
+		for(unsigned int k=0;k<n && k<m;++k)
+		{
+			double norm=0;
+			for(unsigned int i=k;i<m;++i) norm+=J[i*n+k]*J[i*n+k];
+			norm=std::sqrt(norm);
+			if (norm==0) { m_tau[k]=0; continue; }
+			const double alpha=J[k*n+k]>0?-norm:norm;
+			const double v0=J[k*n+k]-alpha;
+			// v=(1, J[k+1..m-1,k]/v0), H=I-tau*v*v^T
+			for(unsigned int i=k+1;i<m;++i) J[i*n+k]/=v0;
+			m_tau[k]=-v0/alpha;
+			J[k*n+k]=alpha;
+			for(unsigned int c=k+1;c<n;++c)
+			{
+				double s=J[k*n+c];
+				for(unsigned int i=k+1;i<m;++i) s+=J[i*n+k]*J[i*n+c];
+				s*=m_tau[k];
+				J[k*n+c]-=s;
+				for(unsigned int i=k+1;i<m;++i) J[i*n+c]-=s*J[i*n+k];
+			}
+			double s=m_qtr[k];
+			for(unsigned int i=k+1;i<m;++i) s+=J[i*n+k]*m_qtr[i];
+			s*=m_tau[k];
+			m_qtr[k]-=s;
+			for(unsigned int i=k+1;i<m;++i) m_qtr[i]-=s*J[i*n+k];
+		}
+	}
+	// dp minimizing |R*dp+Q^T*r|^2+lambda*|D*dp|^2, from the QR of the
+	// stacked 2np x np matrix [R; sqrt(lambda*D)].
+	bool solveQR(const double lambda)
+	{
+		const size_t n=m_np;
+		double* S=&m_A[0];
+		std::vector<double>& rhs=m_L; // first 2n entries
+		std::fill(m_A.begin(),m_A.end(),0.0);
+		for(unsigned int i=0;i<n;++i)
+		{
+			for(unsigned int c=i;c<n;++c) S[i*n+c]=m_J[i*n+c];
+			S[(n+i)*n+i]=std::sqrt(lambda*m_diag[i]);
+			rhs[i]=-m_qtr[i];
+			rhs[n+i]=0;
+		}
+		for(unsigned int k=0;k<n;++k)
+		{
+			// only rows k and n..n+k are nonzero below the diagonal in column k
+			double norm=S[k*n+k]*S[k*n+k];
+			for(unsigned int i=n;i<=n+k;++i) norm+=S[i*n+k]*S[i*n+k];
+			norm=std::sqrt(norm);
+			if (norm==0) return false;
+			const double alpha=S[k*n+k]>0?-norm:norm;
+			const double v0=S[k*n+k]-alpha;
+			const double tau=-v0/alpha;
+			for(unsigned int i=n;i<=n+k;++i) S[i*n+k]/=v0;
+			S[k*n+k]=alpha;
+			for(unsigned int c=k+1;c<n;++c)
+			{
+				double s=S[k*n+c];
+				for(unsigned int i=n;i<=n+k;++i) s+=S[i*n+k]*S[i*n+c];
+				s*=tau;
+				S[k*n+c]-=s;
+				for(unsigned int i=n;i<=n+k;++i) S[i*n+c]-=s*S[i*n+k];
+			}
+			double s=rhs[k];
+			for(unsigned int i=n;i<=n+k;++i) s+=S[i*n+k]*rhs[i];
+			s*=tau;
+			rhs[k]-=s;
+			for(unsigned int i=n;i<=n+k;++i) rhs[i]-=s*S[i*n+k];
+		}
+		for(unsigned int i=0;i<n;++i) m_dp[i]=rhs[i];
+		matTrsm(false,false,false,n,S,n,1,&m_dp[0],1);
+		return true;
+	}
+public:
+	bool useQR; // dense Jacobians only; set before the first fit
+	double lambda0, lambdaUp, lambdaDown, maxLambda;
+
+	LevenbergMarquardt(RES res, const unsigned int m, const unsigned int np):
+		m_res(res),m_m(m),m_np(np),m_colors(np),
+		useQR(false),lambda0(1e-3),lambdaUp(10),lambdaDown(0.1),maxLambda(1e16)
+	{
+	}
+	LevenbergMarquardt(RES res, const unsigned int m, const unsigned int np, const size_t* rowPtr, const unsigned int* cols):
+		m_res(res),m_m(m),m_np(np),m_colors(np),
+		useQR(false),lambda0(1e-3),lambdaUp(10),lambdaDown(0.1),maxLambda(1e16)
+	{
+		setSparsity(rowPtr,cols);
+	}
+	// Jacobian pattern as m rows of sorted column indices (CSR), e.g.
+	// from jacobianPattern.
+	void setSparsity(const size_t* rowPtr, const unsigned int* cols)
+	{
+		m_rowPtr.assign(rowPtr,rowPtr+m_m+1);
+		m_cols.assign(cols,cols+rowPtr[m_m]);
+		color();
+	}
+	unsigned int colors() const { return m_colors; }
+	const double* residuals() const { return &m_r[0]; }
+
+	LeastSquaresStats fit(double* p, const double gtol=1e-10, const double xtol=1e-12, const unsigned int maxIter=100)
+	{
+		if (m_rowPtr.empty()) densePattern();
+		if (m_J.size()!=m_cols.size() || m_fr.size()!=m_m || (useQR && dense() && m_tau.size()!=m_np)) allocate();
+		const bool qr=useQR && dense();
+		LeastSquaresStats stats;
+		std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+		double lambda=lambda0;
+		jacobian(p,stats);
+		double c=cost(&m_r[0]);
+		while(stats.iterations<maxIter)
+		{
+			if (qr) factorQR();
+			else normalEquations();
+			stats.gradNorm=0;
+			for(unsigned int a=0;a<m_np;++a) stats.gradNorm=std::max(stats.gradNorm,std::fabs(m_g[a]));
+			if (stats.gradNorm<=gtol) { stats.converged=true; break; }
+			bool accepted=false, small=false;
+			while(lambda<=maxLambda)
+			{
+				if (qr?solveQR(lambda):solveNormal(lambda))
+				{
+					double dpNorm=0, pNorm=0;
+					for(unsigned int a=0;a<m_np;++a)
+					{
+						m_pt[a]=p[a]+m_dp[a];
+						dpNorm=std::max(dpNorm,std::fabs(m_dp[a]));
+						pNorm=std::max(pNorm,std::fabs(p[a]));
+					}
+					small=dpNorm<=xtol*(pNorm+xtol);
+					m_res(&m_pt[0],&m_rt[0]);
+					++stats.residuals;
+					const double ct=cost(&m_rt[0]);
+					if (ct<c)
+					{
+						for(unsigned int a=0;a<m_np;++a) p[a]=m_pt[a];
+						c=ct;
+						lambda=std::max(lambda*lambdaDown,1e-300);
+						accepted=true;
+						break;
+					}
+					if (small) break;
+				}
+				lambda*=lambdaUp;
+			}
+			++stats.iterations;
+			if (!accepted) { stats.converged=small; break; }
+			jacobian(p,stats);
+			if (small) { stats.converged=true; break; }
+		}
+		stats.cost=cost(&m_r[0]);
+		stats.lambda=lambda;
+		stats.seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+		return stats;
+	}
+};
+
+} // namespace fadbad
+
+#endif
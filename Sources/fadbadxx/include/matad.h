@@ -0,0 +1,769 @@
+//
+//  matad.h
+//  FADBADSwift
+//
+
+#ifndef _MATAD_H
+#define _MATAD_H
+
+#include <vector>
+#include <algorithm>
+
+#include "fadiff.h"
+#include "badiff.h"
+
+// Edge length of the square tiles used by the blocked kernels:
+#ifndef MatBlockSize
+#define MatBlockSize 64
+#endif
+
+namespace fadbad
+{
+
+// Dense kernels on row-major arrays; ld* is the row stride of a matrix.
+// They work on plain values and are shared by the forward and reverse
+// mode operations below.
+
+template <typename S>
+S matAbs(const S& x) { return x<Op<S>::myZero()?Op<S>::myNeg(x):x; }
+
+// C = alpha*op(A)*op(B) + beta*C with C m x n and op(A) m x k, where op
+// transposes when tA (tB) is set. Tiles of op(A) and panels of op(B) are
+// packed into contiguous buffers so that the inner loop runs over
+// consecutive elements for every combination of transposes.
+template <typename S>
+void matGemm(const bool tA, const bool tB, const unsigned int m, const unsigned int n, const unsigned int k,
+	const S& alpha, const S* A, const unsigned int lda, const S* B, const unsigned int ldb,
+	const S& beta, S* C, const unsigned int ldc)
+{
+	for(unsigned int i=0;i<m;++i)
+	{
+		S* c=C+i*ldc;
+		if (beta==Op<S>::myZero()) for(unsigned int j=0;j<n;++j) c[j]=Op<S>::myZero();
+		else if (!(beta==Op<S>::myOne())) for(unsigned int j=0;j<n;++j) c[j]=beta*c[j];
+	}
+	if (m==0 || n==0 || k==0) return;
+	const unsigned int bs=MatBlockSize;
+	std::vector<S> pa(bs*bs), pb(bs*n);
+	for(unsigned int p0=0;p0<k;p0+=bs)
+	{
+		const unsigned int kb=std::min(bs,k-p0);
+		for(unsigned int p=0;p<kb;++p)
+			for(unsigned int j=0;j<n;++j) pb[p*n+j]=tB?B[j*ldb+p0+p]:B[(p0+p)*ldb+j];
+		for(unsigned int i0=0;i0<m;i0+=bs)
+		{
+			const unsigned int mb=std::min(bs,m-i0);
+			for(unsigned int i=0;i<mb;++i)
+				for(unsigned int p=0;p<kb;++p) pa[i*kb+p]=alpha*(tA?A[(p0+p)*lda+i0+i]:A[(i0+i)*lda+p0+p]);
+			for(unsigned int j0=0;j0<n;j0+=bs)
+			{
+				const unsigned int nb=std::min(bs,n-j0);
+				for(unsigned int i=0;i<mb;++i)
+				{
+					S* c=C+(i0+i)*ldc+j0;
+					for(unsigned int p=0;p<kb;++p)
+					{
+						const S a=pa[i*kb+p];
+						const S* b=&pb[p*n+j0];
+						for(unsigned int j=0;j<nb;++j) Op<S>::myCadd(c[j],a*b[j]);
+					}
+				}
+			}
+		}
+	}
+}
+
+// Solves op(T)*X = B in place of B (n x nrhs) for a triangular T, lower
+// or upper, with an implicit unit diagonal when unit is set.
+template <typename S>
+void matTrsm(const bool lower, const bool trans, const bool unit, const unsigned int n,
+	const S* T, const unsigned int ldt, const unsigned int nrhs, S* B, const unsigned int ldb)
+{
+	if (lower!=trans) // forward substitution
+	{
+		for(unsigned int i=0;i<n;++i)
+		{
+			S* bi=B+i*ldb;
+			if (!trans)
+			{
+				for(unsigned int k=0;k<i;++k)
+				{
+					const S t=T[i*ldt+k];
+					const S* bk=B+k*ldb;
+					for(unsigned int j=0;j<nrhs;++j) Op<S>::myCsub(bi[j],t*bk[j]);
+				}
+			}
+			if (!unit) for(unsigned int j=0;j<nrhs;++j) Op<S>::myCdiv(bi[j],T[i*ldt+i]);
+			if (trans) // row i of an upper T scatters into the rows below
+			{
+				for(unsigned int k=i+1;k<n;++k)
+				{
+					const S t=T[i*ldt+k];
+					S* bk=B+k*ldb;
+					for(unsigned int j=0;j<nrhs;++j) Op<S>::myCsub(bk[j],t*bi[j]);
+				}
+			}
+		}
+	}
+	else // backward substitution
+	{
+		for(unsigned int i=n;i-->0;)
+		{
+			S* bi=B+i*ldb;
+			if (!trans)
+			{
+				for(unsigned int k=i+1;k<n;++k)
+				{
+					const S t=T[i*ldt+k];
+					const S* bk=B+k*ldb;
+					for(unsigned int j=0;j<nrhs;++j) Op<S>::myCsub(bi[j],t*bk[j]);
+				}
+			}
+			if (!unit) for(unsigned int j=0;j<nrhs;++j) Op<S>::myCdiv(bi[j],T[i*ldt+i]);
+			if (trans) // row i of a lower T scatters into the rows above
+			{
+				for(unsigned int k=0;k<i;++k)
+				{
+					const S t=T[i*ldt+k];
+					S* bk=B+k*ldb;
+					for(unsigned int j=0;j<nrhs;++j) Op<S>::myCsub(bk[j],t*bi[j]);
+				}
+			}
+		}
+	}
+}
+
+// Cholesky factor A=L*L^T in place of the lower triangle of A, by blocks:
+// each diagonal tile is factored, the panel below it solved, and the
+// trailing matrix updated through matGemm. The strict upper triangle is
+// used as workspace. Returns false if A is not positive definite.
+template <typename S>
+bool matCholesky(const unsigned int n, S* A, const unsigned int lda)
+{
+	const unsigned int bs=MatBlockSize;
+	for(unsigned int k0=0;k0<n;k0+=bs)
+	{
+		const unsigned int k1=std::min(n,k0+bs);
+		for(unsigned int j=k0;j<k1;++j)
+		{
+			S s=A[j*lda+j];
+			for(unsigned int p=k0;p<j;++p) Op<S>::myCsub(s,A[j*lda+p]*A[j*lda+p]);
+			if (!(Op<S>::myZero()<s)) return false;
+			A[j*lda+j]=Op<S>::mySqrt(s);
+			for(unsigned int i=j+1;i<k1;++i)
+			{
+				S t=A[i*lda+j];
+				for(unsigned int p=k0;p<j;++p) Op<S>::myCsub(t,A[i*lda+p]*A[j*lda+p]);
+				A[i*lda+j]=t/A[j*lda+j];
+			}
+		}
+		for(unsigned int i=k1;i<n;++i)
+		{
+			for(unsigned int j=k0;j<k1;++j)
+			{
+				S t=A[i*lda+j];
+				for(unsigned int p=k0;p<j;++p) Op<S>::myCsub(t,A[i*lda+p]*A[j*lda+p]);
+				A[i*lda+j]=t/A[j*lda+j];
+			}
+		}
+		if (k1<n) matGemm(false,true,n-k1,n-k1,k1-k0,Op<S>::myNeg(Op<S>::myOne()),
+			A+k1*lda+k0,lda,A+k1*lda+k0,lda,Op<S>::myOne(),A+k1*lda+k1,lda);
+	}
+	return true;
+}
+
+// LU factorization P*A=L*U with partial pivoting, in place: U on and
+// above the diagonal, the unit lower L below it. Row i was swapped with
+// row piv[i] at step i. Returns false on an exactly singular A.
+template <typename S>
+bool matLU(const unsigned int n, S* A, const unsigned int lda, unsigned int* piv)
+{
+	for(unsigned int k=0;k<n;++k)
+	{
+		unsigned int p=k;
+		for(unsigned int i=k+1;i<n;++i) if (matAbs(A[p*lda+k])<matAbs(A[i*lda+k])) p=i;
+		piv[k]=p;
+		if (A[p*lda+k]==Op<S>::myZero()) return false;
+		if (p!=k) std::swap_ranges(A+k*lda,A+k*lda+n,A+p*lda);
+		const S* ak=A+k*lda;
+		for(unsigned int i=k+1;i<n;++i)
+		{
+			S* ai=A+i*lda;
+			const S l=ai[k]/ak[k];
+			ai[k]=l;
+			for(unsigned int j=k+1;j<n;++j) Op<S>::myCsub(ai[j],l*ak[j]);
+		}
+	}
+	return true;
+}
+
+// Solves A*X=B (or A^T*X=B when trans) in place of B, with A factored
+// by matLU.
+template <typename S>
+void matLUSolve(const unsigned int n, const S* LU, const unsigned int ldlu, const unsigned int* piv,
+	const bool trans, const unsigned int nrhs, S* B, const unsigned int ldb)
+{
+	if (!trans)
+	{
+		for(unsigned int i=0;i<n;++i) if (piv[i]!=i) std::swap_ranges(B+i*ldb,B+i*ldb+nrhs,B+piv[i]*ldb);
+		matTrsm(true,false,true,n,LU,ldlu,nrhs,B,ldb);
+		matTrsm(false,false,false,n,LU,ldlu,nrhs,B,ldb);
+	}
+	else
+	{
+		matTrsm(false,true,false,n,LU,ldlu,nrhs,B,ldb);
+		matTrsm(true,true,true,n,LU,ldlu,nrhs,B,ldb);
+		for(unsigned int i=n;i-->0;) if (piv[i]!=i) std::swap_ranges(B+i*ldb,B+i*ldb+nrhs,B+piv[i]*ldb);
+	}
+}
+
+// Solves A*X=B in place of B, with A factored by matCholesky.
+template <typename S>
+void matCholSolve(const unsigned int n, const S* L, const unsigned int ldl, const unsigned int nrhs, S* B, const unsigned int ldb)
+{
+	matTrsm(true,false,false,n,L,ldl,nrhs,B,ldb);
+	matTrsm(true,true,false,n,L,ldl,nrhs,B,ldb);
+}
+
+// log|det A| from the diagonal of a factor.
+template <typename S>
+S matLogDiag(const unsigned int n, const S* LU, const unsigned int ld)
+{
+	S s=Op<S>::myZero();
+	for(unsigned int i=0;i<n;++i) Op<S>::myCadd(s,Op<S>::myLog(matAbs(LU[i*ld+i])));
+	return s;
+}
+
+// MATRIX OPERATIONS
+//
+// matmul, triSolve, luSolve, cholSolve and logdet take and return dense
+// row-major arrays of F or B variables. Each call works on the values
+// with the kernels above and differentiates the matrix operation as a
+// whole by its closed-form rule:
+//
+//   C=A*B:           dC = dA*B + A*dB,        Abar += Cbar*B^T, Bbar += A^T*Cbar
+//   X=A^-1*B:        dX = A^-1*(dB - dA*X),   G=A^-T*Xbar, Bbar += G, Abar -= G*X^T
+//   y=log|det A|:    dy = tr(A^-1*dA),        Abar += ybar*A^-T
+//
+// so a product of n x n matrices costs one gemm per direction instead of
+// O(n^3) recorded scalar operations. triSolve and cholSolve read only the
+// triangle they use: the lower (or upper) triangle of T, and the lower
+// triangle of the symmetric A. Outputs may alias inputs. The solves
+// return false, leaving the outputs untouched, if the factorization fails;
+// logdet of an exactly singular A is -inf and carries no derivatives.
+
+// Forward mode:
+
+// First dependent entry of x, 0 if there is none.
+template <typename T, unsigned int N>
+const FTypeName<T,N>* matDepend(const FTypeName<T,N>* x, const unsigned int n)
+{
+	for(unsigned int i=0;i<n;++i) if (x[i].depend()) return &x[i];
+	return 0;
+}
+template <typename T, unsigned int N>
+void matValues(const FTypeName<T,N>* x, const unsigned int n, T* v)
+{
+	for(unsigned int i=0;i<n;++i) v[i]=x[i].val();
+}
+// Derivatives of x, direction-major: dx[d*n+i] is direction d of x[i].
+template <typename T, unsigned int N>
+void matDerivs(const FTypeName<T,N>* x, const unsigned int n, const unsigned int nd, T* dx)
+{
+	for(unsigned int i=0;i<n;++i)
+		for(unsigned int d=0;d<nd;++d) dx[d*n+i]=x[i].depend()?x[i][d]:Op<T>::myZero();
+}
+template <typename T, unsigned int N>
+void matStore(FTypeName<T,N>* x, const unsigned int n, const T* v, const unsigned int nd, const T* dx, const FTypeName<T,N>& proto)
+{
+	for(unsigned int i=0;i<n;++i)
+	{
+		x[i]=v[i];
+		if (nd==0) continue;
+		x[i].setDepend(proto);
+		for(unsigned int d=0;d<nd;++d) x[i][d]=dx[d*n+i];
+	}
+}
+// Gathers the directions of the n x n matrix A, keeping the part of
+// its entries the operation reads: all (part 0), the lower triangle
+// (part 1), the upper triangle (part 2) or the lower triangle of a
+// symmetric matrix (part 3).
+template <typename T, unsigned int N>
+void matSquareDerivs(const FTypeName<T,N>* A, const unsigned int n, const unsigned int nd, const int part, T* dA)
+{
+	matDerivs(A,n*n,nd,dA);
+	for(unsigned int d=0;d<nd;++d)
+	{
+		T* da=dA+d*n*n;
+		for(unsigned int i=0;i<n;++i)
+			for(unsigned int j=0;j<n;++j)
+			{
+				if ((part==1 || part==3) && j>i) da[i*n+j]=part==3?da[j*n+i]:Op<T>::myZero();
+				else if (part==2 && j<i) da[i*n+j]=Op<T>::myZero();
+			}
+	}
+}
+
+// dX = A^-1*(dB - dA*X) for all directions at once. solve(R,ldr,nrhs)
+// applies A^-1 in place.
+template <typename T, unsigned int N, class SOLVE>
+void matSolveDerivs(const FTypeName<T,N>* B, const unsigned int n, const unsigned int nrhs, const unsigned int nd,
+	const T* dA, const T* X, SOLVE solve, T* dX)
+{
+	std::vector<T> dAX(nd*n*nrhs), dB(nd*n*nrhs), R(n*nd*nrhs);
+	matGemm(false,false,nd*n,nrhs,n,Op<T>::myOne(),dA,n,X,nrhs,Op<T>::myZero(),&dAX[0],nrhs);
+	matDerivs(B,n*nrhs,nd,&dB[0]);
+	// right-hand sides side by side, R[i][d*nrhs+j]:
+	for(unsigned int d=0;d<nd;++d)
+		for(unsigned int i=0;i<n;++i)
+			for(unsigned int j=0;j<nrhs;++j) R[i*nd*nrhs+d*nrhs+j]=dB[(d*n+i)*nrhs+j]-dAX[(d*n+i)*nrhs+j];
+	solve(&R[0],nd*nrhs,nd*nrhs);
+	for(unsigned int d=0;d<nd;++d)
+		for(unsigned int i=0;i<n;++i)
+			for(unsigned int j=0;j<nrhs;++j) dX[(d*n+i)*nrhs+j]=R[i*nd*nrhs+d*nrhs+j];
+}
+template <typename T>
+struct MatLUSolver
+{
+	unsigned int n; const T* LU; const unsigned int* piv; bool trans;
+	void operator()(T* R, const unsigned int ldr, const unsigned int nrhs) const { matLUSolve(n,LU,n,piv,trans,nrhs,R,ldr); }
+};
+template <typename T>
+struct MatCholSolver
+{
+	unsigned int n; const T* L;
+	void operator()(T* R, const unsigned int ldr, const unsigned int nrhs) const { matCholSolve(n,L,n,nrhs,R,ldr); }
+};
+template <typename T>
+struct MatTriSolver
+{
+	unsigned int n; const T* Tm; bool lower; bool trans;
+	void operator()(T* R, const unsigned int ldr, const unsigned int nrhs) const { matTrsm(lower,trans,false,n,Tm,n,nrhs,R,ldr); }
+};
+
+// C = A*B with A m x k and B k x n.
+template <typename T, unsigned int N>
+void matmul(const FTypeName<T,N>* A, const FTypeName<T,N>* B, FTypeName<T,N>* C,
+	const unsigned int m, const unsigned int k, const unsigned int n)
+{
+	std::vector<T> a(m*k), b(k*n), c(m*n);
+	matValues(A,m*k,&a[0]);
+	matValues(B,k*n,&b[0]);
+	matGemm(false,false,m,n,k,Op<T>::myOne(),&a[0],k,&b[0],n,Op<T>::myZero(),&c[0],n);
+	const FTypeName<T,N>* pDep=matDepend(A,m*k);
+	if (pDep==0) pDep=matDepend(B,k*n);
+	if (pDep==0) { matStore(C,m*n,&c[0],0,(const T*)0,FTypeName<T,N>()); return; }
+	const FTypeName<T,N> proto(*pDep);
+	const unsigned int nd=proto.size();
+	std::vector<T> dA(nd*m*k), dB(nd*k*n), dBr(k*nd*n), dC(nd*m*n), AdB(m*nd*n);
+	matDerivs(A,m*k,nd,&dA[0]);
+	matDerivs(B,k*n,nd,&dB[0]);
+	// dA*B for all directions as one (nd*m) x k product:
+	matGemm(false,false,nd*m,n,k,Op<T>::myOne(),&dA[0],k,&b[0],n,Op<T>::myZero(),&dC[0],n);
+	// A*dB as one product with the directions of dB side by side:
+	for(unsigned int d=0;d<nd;++d)
+		for(unsigned int p=0;p<k;++p)
+			for(unsigned int j=0;j<n;++j) dBr[p*nd*n+d*n+j]=dB[(d*k+p)*n+j];
+	matGemm(false,false,m,nd*n,k,Op<T>::myOne(),&a[0],k,&dBr[0],nd*n,Op<T>::myZero(),&AdB[0],nd*n);
+	for(unsigned int d=0;d<nd;++d)
+		for(unsigned int i=0;i<m;++i)
+			for(unsigned int j=0;j<n;++j) Op<T>::myCadd(dC[(d*m+i)*n+j],AdB[i*nd*n+d*n+j]);
+	matStore(C,m*n,&c[0],nd,&dC[0],proto);
+}
+
+// Shared tail of the forward mode solves: X=A^-1*B given the factor.
+template <typename T, unsigned int N, class SOLVE>
+void matSolveStore(const FTypeName<T,N>* A, const FTypeName<T,N>* B, FTypeName<T,N>* X,
+	const unsigned int n, const unsigned int nrhs, const int part, SOLVE solve)
+{
+	std::vector<T> x(n*nrhs);
+	matValues(B,n*nrhs,&x[0]);
+	solve(&x[0],nrhs,nrhs);
+	const FTypeName<T,N>* pDep=matDepend(A,n*n);
+	if (pDep==0) pDep=matDepend(B,n*nrhs);
+	if (pDep==0) { matStore(X,n*nrhs,&x[0],0,(const T*)0,FTypeName<T,N>()); return; }
+	const FTypeName<T,N> proto(*pDep);
+	const unsigned int nd=proto.size();
+	std::vector<T> dA(nd*n*n), dX(nd*n*nrhs);
+	matSquareDerivs(A,n,nd,part,&dA[0]);
+	matSolveDerivs(B,n,nrhs,nd,&dA[0],&x[0],solve,&dX[0]);
+	matStore(X,n*nrhs,&x[0],nd,&dX[0],proto);
+}
+
+// X = T^-1*B with T n x n lower (or upper) triangular and B n x nrhs.
+template <typename T, unsigned int N>
+bool triSolve(const FTypeName<T,N>* Tm, const bool lower, const FTypeName<T,N>* B, FTypeName<T,N>* X,
+	const unsigned int n, const unsigned int nrhs)
+{
+	std::vector<T> t(n*n);
+	matValues(Tm,n*n,&t[0]);
+	for(unsigned int i=0;i<n;++i) if (t[i*n+i]==Op<T>::myZero()) return false;
+	MatTriSolver<T> solve={n,&t[0],lower,false};
+	matSolveStore(Tm,B,X,n,nrhs,lower?1:2,solve);
+	return true;
+}
+
+// X = A^-1*B with A n x n, by LU factorization with partial pivoting.
+template <typename T, unsigned int N>
+bool luSolve(const FTypeName<T,N>* A, const FTypeName<T,N>* B, FTypeName<T,N>* X,
+	const unsigned int n, const unsigned int nrhs)
+{
+	std::vector<T> lu(n*n);
+	std::vector<unsigned int> piv(n);
+	matValues(A,n*n,&lu[0]);
+	if (!matLU(n,&lu[0],n,&piv[0])) return false;
+	MatLUSolver<T> solve={n,&lu[0],&piv[0],false};
+	matSolveStore(A,B,X,n,nrhs,0,solve);
+	return true;
+}
+
+// X = A^-1*B with A n x n symmetric positive definite, by Cholesky.
+template <typename T, unsigned int N>
+bool cholSolve(const FTypeName<T,N>* A, const FTypeName<T,N>* B, FTypeName<T,N>* X,
+	const unsigned int n, const unsigned int nrhs)
+{
+	std::vector<T> l(n*n);
+	matValues(A,n*n,&l[0]);
+	if (!matCholesky(n,&l[0],n)) return false;
+	MatCholSolver<T> solve={n,&l[0]};
+	matSolveStore(A,B,X,n,nrhs,3,solve);
+	return true;
+}
+
+// log|det A| with A n x n, by LU factorization.
+template <typename T, unsigned int N>
+FTypeName<T,N> logdet(const FTypeName<T,N>* A, const unsigned int n)
+{
+	std::vector<T> lu(n*n);
+	std::vector<unsigned int> piv(n);
+	matValues(A,n*n,&lu[0]);
+	if (!matLU(n,&lu[0],n,&piv[0])) return FTypeName<T,N>(Op<T>::myLog(Op<T>::myZero()));
+	FTypeName<T,N> y(matLogDiag(n,&lu[0],n));
+	const FTypeName<T,N>* pDep=matDepend(A,n*n);
+	if (pDep==0) return y;
+	const unsigned int nd=pDep->size();
+	y.setDepend(*pDep);
+	// G = A^-T; dy = sum_ij G_ij*dA_ij
+	std::vector<T> g(n*n,Op<T>::myZero()), dA(nd*n*n);
+	for(unsigned int i=0;i<n;++i) g[i*n+i]=Op<T>::myOne();
+	matLUSolve(n,&lu[0],n,&piv[0],true,n,&g[0],n);
+	matDerivs(A,n*n,nd,&dA[0]);
+	for(unsigned int d=0;d<nd;++d)
+	{
+		T s=Op<T>::myZero();
+		for(unsigned int i=0;i<n*n;++i) Op<T>::myCadd(s,g[i]*dA[d*n*n+i]);
+		y[d]=s;
+	}
+	return y;
+}
+
+// Reverse mode:
+//
+// The outputs of a matrix operation are BTypeNameMATOUT nodes sharing one
+// reference-counted BTypeNameMATOP, which holds the input nodes and the
+// values and factors saved for the adjoint. An output that propagates
+// deposits its derivatives in the operation; the release of the last
+// output applies the adjoint rule once and propagates to the inputs.
+
+template <typename U, unsigned int N>
+class BTypeNameMATOP
+{
+	std::vector<BTypeNameHV<U,N>*> m_ins;
+	std::vector<U> m_bar; // output adjoints, direction-major
+	const unsigned int m_nout;
+	unsigned int m_nd;
+	unsigned int m_rc;
+	BTypeNameMATOP(const BTypeNameMATOP<U,N>&); // not allowed
+	void operator=(const BTypeNameMATOP<U,N>&); // not allowed
+protected:
+	// inBar += J^T*outBar for a single direction:
+	virtual void adjoint(const U* outBar, U* inBar) const=0;
+public:
+	BTypeNameMATOP(const unsigned int nout):m_nout(nout),m_nd(0),m_rc(0){}
+	virtual ~BTypeNameMATOP()
+	{
+		for(unsigned int j=0;j<m_ins.size();++j) if (m_ins[j]) m_ins[j]->decRef(m_ins[j]);
+	}
+	void input(const BTypeName<U,N>& x)
+	{
+		BTypeNameHV<U,N>* pHV=x.getBTypeNameHV();
+		pHV->incRef();
+		m_ins.push_back(pHV);
+	}
+	unsigned int inputs() const { return (unsigned int)m_ins.size(); }
+	unsigned int outputs() const { return m_nout; }
+	void incRef() { ++m_rc; }
+	void collect(const unsigned int i, const Derivatives<U,N>& d)
+	{
+		if (m_nd==0)
+		{
+			m_nd=d.count();
+			m_bar.assign(m_nd*m_nout,Op<U>::myZero());
+		}
+		for(unsigned int k=0;k<m_nd;++k) Op<U>::myCadd(m_bar[k*m_nout+i],d[k]);
+	}
+	void release(typename Derivatives<U,N>::RecycleBin& bin)
+	{
+		if (--m_rc>0) return;
+		const unsigned int nin=inputs();
+		if (m_nd>0)
+		{
+			std::vector<U> inBar(m_nd*nin,Op<U>::myZero()), v(m_nd);
+			for(unsigned int k=0;k<m_nd;++k) adjoint(&m_bar[k*m_nout],&inBar[k*nin]);
+			for(unsigned int j=0;j<nin;++j)
+			{
+				for(unsigned int k=0;k<m_nd;++k) v[k]=inBar[k*nin+j];
+				m_ins[j]->addValues(bin,&v[0],m_nd);
+			}
+		}
+		for(unsigned int j=0;j<nin;++j) m_ins[j]->decRef(bin,m_ins[j]);
+		delete this;
+	}
+};
+
+template <typename U, unsigned int N>
+struct BTypeNameMATOUT : public BTypeNameHV<U,N>
+{
+	BTypeNameMATOP<U,N>* m_pOp;
+	const unsigned int m_i;
+	BTypeNameMATOUT(const U& val, BTypeNameMATOP<U,N>* pOp, const unsigned int i):BTypeNameHV<U,N>(val),m_pOp(pOp),m_i(i)
+	{
+		m_pOp->incRef();
+	}
+	virtual ~BTypeNameMATOUT()
+	{
+		if (m_pOp) { typename Derivatives<U,N>::RecycleBin bin; m_pOp->release(bin); }
+	}
+	virtual void propagate(typename Derivatives<U,N>::RecycleBin&)
+	{
+		m_pOp->collect(m_i,this->m_derivatives);
+	}
+	virtual void propagateChildren(typename Derivatives<U,N>::RecycleBin& bin)
+	{
+		m_pOp->release(bin);
+		m_pOp=0;
+	}
+private:
+	void operator=(const BTypeNameMATOUT<U,N>&){} // not allowed
+};
+
+template <typename U, unsigned int N>
+void matValues(const BTypeName<U,N>* x, const unsigned int n, U* v)
+{
+	for(unsigned int i=0;i<n;++i) v[i]=x[i].val();
+}
+template <typename U, unsigned int N>
+void matOutputs(BTypeNameMATOP<U,N>* pOp, const U* v, BTypeName<U,N>* x)
+{
+	for(unsigned int i=0;i<pOp->outputs();++i) x[i]=BTypeName<U,N>(static_cast<BTypeNameHV<U,N>*>(new BTypeNameMATOUT<U,N>(v[i],pOp,i)));
+}
+
+template <typename U, unsigned int N>
+class BTypeNameMATMUL : public BTypeNameMATOP<U,N>
+{
+	const unsigned int m_m, m_k, m_n;
+	std::vector<U> m_a, m_b;
+	virtual void adjoint(const U* cBar, U* inBar) const
+	{
+		const U one(Op<U>::myOne());
+		matGemm(false,true,m_m,m_k,m_n,one,cBar,m_n,&m_b[0],m_n,one,inBar,m_k);
+		matGemm(true,false,m_k,m_n,m_m,one,&m_a[0],m_k,cBar,m_n,one,inBar+m_m*m_k,m_n);
+	}
+public:
+	BTypeNameMATMUL(const BTypeName<U,N>* A, const BTypeName<U,N>* Bm, const unsigned int m, const unsigned int k, const unsigned int n):
+		BTypeNameMATOP<U,N>(m*n),m_m(m),m_k(k),m_n(n),m_a(m*k),m_b(k*n)
+	{
+		for(unsigned int i=0;i<m*k;++i) this->input(A[i]);
+		for(unsigned int i=0;i<k*n;++i) this->input(Bm[i]);
+		matValues(A,m*k,&m_a[0]);
+		matValues(Bm,k*n,&m_b[0]);
+	}
+	void eval(U* c) const
+	{
+		matGemm(false,false,m_m,m_n,m_k,Op<U>::myOne(),&m_a[0],m_k,&m_b[0],m_n,Op<U>::myZero(),c,m_n);
+	}
+};
+
+// Common part of the solves X=A^-1*B. The inputs are the entries of A
+// the factorization reads, in row order, followed by B. part selects
+// them as in matSquareDerivs.
+template <typename U, unsigned int N>
+class BTypeNameMATSOLVE : public BTypeNameMATOP<U,N>
+{
+protected:
+	const unsigned int m_n, m_nrhs;
+	const int m_part;
+	std::vector<U> m_f; // factor
+	std::vector<U> m_x; // solution
+	bool reads(const unsigned int i, const unsigned int j) const
+	{
+		return m_part==0 || (m_part==2?j>=i:j<=i);
+	}
+	// G = A^-T*R in place:
+	virtual void solveTransposed(U* R) const=0;
+	virtual void adjoint(const U* xBar, U* inBar) const
+	{
+		const unsigned int n=m_n, nrhs=m_nrhs;
+		std::vector<U> g(xBar,xBar+n*nrhs), aBar(n*n);
+		solveTransposed(&g[0]);
+		matGemm(false,true,n,n,nrhs,Op<U>::myNeg(Op<U>::myOne()),&g[0],nrhs,&m_x[0],nrhs,Op<U>::myZero(),&aBar[0],n);
+		unsigned int j=0;
+		for(unsigned int r=0;r<n;++r)
+			for(unsigned int c=0;c<n;++c)
+			{
+				if (!reads(r,c)) continue;
+				Op<U>::myCadd(inBar[j],aBar[r*n+c]);
+				// the symmetric A has its upper triangle mirrored from the lower:
+				if (m_part==3 && c<r) Op<U>::myCadd(inBar[j],aBar[c*n+r]);
+				++j;
+			}
+		for(unsigned int i=0;i<n*nrhs;++i) Op<U>::myCadd(inBar[j+i],g[i]);
+	}
+public:
+	BTypeNameMATSOLVE(const BTypeName<U,N>* A, const BTypeName<U,N>* Bm, const unsigned int n, const unsigned int nrhs, const int part):
+		BTypeNameMATOP<U,N>(n*nrhs),m_n(n),m_nrhs(nrhs),m_part(part),m_f(n*n),m_x(n*nrhs)
+	{
+		for(unsigned int r=0;r<n;++r)
+			for(unsigned int c=0;c<n;++c) if (reads(r,c)) this->input(A[r*n+c]);
+		for(unsigned int i=0;i<n*nrhs;++i) this->input(Bm[i]);
+		matValues(A,n*n,&m_f[0]);
+		matValues(Bm,n*nrhs,&m_x[0]);
+	}
+	const U* solution() const { return &m_x[0]; }
+};
+
+template <typename U, unsigned int N>
+class BTypeNameTRISOLVE : public BTypeNameMATSOLVE<U,N>
+{
+	virtual void solveTransposed(U* R) const
+	{
+		matTrsm(this->m_part==1,true,false,this->m_n,&this->m_f[0],this->m_n,this->m_nrhs,R,this->m_nrhs);
+	}
+public:
+	BTypeNameTRISOLVE(const BTypeName<U,N>* Tm, const bool lower, const BTypeName<U,N>* Bm, const unsigned int n, const unsigned int nrhs):
+		BTypeNameMATSOLVE<U,N>(Tm,Bm,n,nrhs,lower?1:2){}
+	bool factor()
+	{
+		for(unsigned int i=0;i<this->m_n;++i) if (this->m_f[i*this->m_n+i]==Op<U>::myZero()) return false;
+		matTrsm(this->m_part==1,false,false,this->m_n,&this->m_f[0],this->m_n,this->m_nrhs,&this->m_x[0],this->m_nrhs);
+		return true;
+	}
+};
+
+template <typename U, unsigned int N>
+class BTypeNameLUSOLVE : public BTypeNameMATSOLVE<U,N>
+{
+	std::vector<unsigned int> m_piv;
+	virtual void solveTransposed(U* R) const
+	{
+		matLUSolve(this->m_n,&this->m_f[0],this->m_n,&m_piv[0],true,this->m_nrhs,R,this->m_nrhs);
+	}
+public:
+	BTypeNameLUSOLVE(const BTypeName<U,N>* A, const BTypeName<U,N>* Bm, const unsigned int n, const unsigned int nrhs):
+		BTypeNameMATSOLVE<U,N>(A,Bm,n,nrhs,0),m_piv(n){}
+	bool factor()
+	{
+		if (!matLU(this->m_n,&this->m_f[0],this->m_n,&m_piv[0])) return false;
+		matLUSolve(this->m_n,&this->m_f[0],this->m_n,&m_piv[0],false,this->m_nrhs,&this->m_x[0],this->m_nrhs);
+		return true;
+	}
+};
+
+template <typename U, unsigned int N>
+class BTypeNameCHOLSOLVE : public BTypeNameMATSOLVE<U,N>
+{
+	virtual void solveTransposed(U* R) const
+	{
+		matCholSolve(this->m_n,&this->m_f[0],this->m_n,this->m_nrhs,R,this->m_nrhs);
+	}
+public:
+	BTypeNameCHOLSOLVE(const BTypeName<U,N>* A, const BTypeName<U,N>* Bm, const unsigned int n, const unsigned int nrhs):
+		BTypeNameMATSOLVE<U,N>(A,Bm,n,nrhs,3){}
+	bool factor()
+	{
+		if (!matCholesky(this->m_n,&this->m_f[0],this->m_n)) return false;
+		matCholSolve(this->m_n,&this->m_f[0],this->m_n,this->m_nrhs,&this->m_x[0],this->m_nrhs);
+		return true;
+	}
+};
+
+template <typename U, unsigned int N>
+class BTypeNameLOGDET : public BTypeNameMATOP<U,N>
+{
+	const unsigned int m_n;
+	std::vector<U> m_lu;
+	std::vector<unsigned int> m_piv;
+	bool m_singular;
+	virtual void adjoint(const U* yBar, U* inBar) const
+	{
+		// Abar += ybar*A^-T
+		if (m_singular) return;
+		const unsigned int n=m_n;
+		std::vector<U> g(n*n,Op<U>::myZero());
+		for(unsigned int i=0;i<n;++i) g[i*n+i]=Op<U>::myOne();
+		matLUSolve(n,&m_lu[0],n,&m_piv[0],true,n,&g[0],n);
+		for(unsigned int i=0;i<n*n;++i) Op<U>::myCadd(inBar[i],yBar[0]*g[i]);
+	}
+public:
+	BTypeNameLOGDET(const BTypeName<U,N>* A, const unsigned int n):BTypeNameMATOP<U,N>(1),m_n(n),m_lu(n*n),m_piv(n)
+	{
+		for(unsigned int i=0;i<n*n;++i) this->input(A[i]);
+		matValues(A,n*n,&m_lu[0]);
+		m_singular=!matLU(n,&m_lu[0],n,&m_piv[0]);
+	}
+	U value() const { return m_singular?Op<U>::myLog(Op<U>::myZero()):matLogDiag(m_n,&m_lu[0],m_n); }
+};
+
+template <typename U, unsigned int N>
+void matmul(const BTypeName<U,N>* A, const BTypeName<U,N>* Bm, BTypeName<U,N>* C,
+	const unsigned int m, const unsigned int k, const unsigned int n)
+{
+	BTypeNameMATMUL<U,N>* pOp=new BTypeNameMATMUL<U,N>(A,Bm,m,k,n);
+	std::vector<U> c(m*n);
+	pOp->eval(&c[0]);
+	if (m*n==0) { delete pOp; return; }
+	matOutputs<U,N>(pOp,&c[0],C);
+}
+
+template <typename U, unsigned int N, class SOLVE>
+bool matSolveOutputs(SOLVE* pOp, BTypeName<U,N>* X)
+{
+	if (!pOp->factor() || pOp->outputs()==0) { delete pOp; return false; }
+	matOutputs<U,N>(pOp,pOp->solution(),X);
+	return true;
+}
+
+template <typename U, unsigned int N>
+bool triSolve(const BTypeName<U,N>* Tm, const bool lower, const BTypeName<U,N>* Bm, BTypeName<U,N>* X,
+	const unsigned int n, const unsigned int nrhs)
+{
+	return matSolveOutputs(new BTypeNameTRISOLVE<U,N>(Tm,lower,Bm,n,nrhs),X);
+}
+
+template <typename U, unsigned int N>
+bool luSolve(const BTypeName<U,N>* A, const BTypeName<U,N>* Bm, BTypeName<U,N>* X,
+	const unsigned int n, const unsigned int nrhs)
+{
+	return matSolveOutputs(new BTypeNameLUSOLVE<U,N>(A,Bm,n,nrhs),X);
+}
+
+template <typename U, unsigned int N>
+bool cholSolve(const BTypeName<U,N>* A, const BTypeName<U,N>* Bm, BTypeName<U,N>* X,
+	const unsigned int n, const unsigned int nrhs)
+{
+	return matSolveOutputs(new BTypeNameCHOLSOLVE<U,N>(A,Bm,n,nrhs),X);
+}
+
+template <typename U, unsigned int N>
+BTypeName<U,N> logdet(const BTypeName<U,N>* A, const unsigned int n)
+{
+	BTypeNameLOGDET<U,N>* pOp=new BTypeNameLOGDET<U,N>(A,n);
+	BTypeName<U,N> y;
+	const U v(pOp->value());
+	matOutputs<U,N>(pOp,&v,&y);
+	return y;
+}
+
+} // namespace fadbad
+
+#endif
@@ -0,0 +1,248 @@
+//
+//  minimize.h
+//  FADBADSwift
+//
+
+#ifndef _MINIMIZE_H
+#define _MINIMIZE_H
+
+#include <vector>
+#include <chrono>
+#include <cmath>
+
+#include "tape.h"
+
+namespace fadbad
+{
+
+// Unconstrained minimization drivers on a recorded objective.
+//
+// The objective is recorded once on a Tape (Tape::record) and every
+// iteration replays it; all optimizer state lives in buffers allocated
+// when the driver is constructed, so iterations do not allocate.
+
+struct MinimizeStats
+{
+	unsigned int iterations;
+	unsigned int gradients; // objective and gradient replays
+	unsigned int hessVecs; // Hessian-vector product replays
+	double f;
+	double gradNorm; // max-norm of the final gradient
+	double seconds;
+	bool converged;
+	MinimizeStats():iterations(0),gradients(0),hessVecs(0),f(0),gradNorm(0),seconds(0),converged(false){}
+	double iterationsPerSecond() const { return seconds>0?iterations/seconds:0; }
+};
+
+inline double minimizeDot(const double* a, const double* b, const unsigned int n)
+{
+	double s=0;
+	for(unsigned int i=0;i<n;++i) s+=a[i]*b[i];
+	return s;
+}
+inline double minimizeNormInf(const double* a, const unsigned int n)
+{
+	double s=0;
+	for(unsigned int i=0;i<n;++i) s=std::max(s,std::fabs(a[i]));
+	return s;
+}
+
+// Limited-memory BFGS with m correction pairs and a weak Wolfe line
+// search by bracketing and bisection. Stops when the max-norm of the
+// gradient drops below gtol.
+class LBFGS
+{
+	Tape& m_tape;
+	const unsigned int m_n, m_m;
+	std::vector<double> m_s, m_y; // m correction pairs, circular
+	std::vector<double> m_rho, m_alpha;
+	std::vector<double> m_g, m_d, m_xt, m_gt;
+public:
+	double c1, c2; // sufficient decrease and curvature constants
+	unsigned int maxLineSearch;
+	LBFGS(Tape& tape, const unsigned int m=7):m_tape(tape),m_n(tape.inputs()),m_m(m),
+		m_s(m*m_n),m_y(m*m_n),m_rho(m),m_alpha(m),m_g(m_n),m_d(m_n),m_xt(m_n),m_gt(m_n),
+		c1(1e-4),c2(0.9),maxLineSearch(40){}
+
+	MinimizeStats minimize(double* x, const double gtol=1e-6, const unsigned int maxIter=1000)
+	{
+		const unsigned int n=m_n;
+		MinimizeStats stats;
+		std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+		double f=m_tape.gradient(x,&m_g[0]);
+		++stats.gradients;
+		unsigned int stored=0, next=0;
+		while(stats.iterations<maxIter)
+		{
+			stats.gradNorm=minimizeNormInf(&m_g[0],n);
+			if (stats.gradNorm<=gtol) { stats.converged=true; break; }
+			// d = -H*g by the two-loop recursion:
+			for(unsigned int i=0;i<n;++i) m_d[i]=-m_g[i];
+			for(unsigned int k=0;k<stored;++k)
+			{
+				const unsigned int j=(next+m_m-1-k)%m_m;
+				m_alpha[j]=m_rho[j]*minimizeDot(&m_s[j*n],&m_d[0],n);
+				const double* y=&m_y[j*n];
+				for(unsigned int i=0;i<n;++i) m_d[i]-=m_alpha[j]*y[i];
+			}
+			if (stored>0)
+			{
+				const unsigned int j=(next+m_m-1)%m_m;
+				const double gamma=minimizeDot(&m_s[j*n],&m_y[j*n],n)/minimizeDot(&m_y[j*n],&m_y[j*n],n);
+				for(unsigned int i=0;i<n;++i) m_d[i]*=gamma;
+			}
+			for(unsigned int k=stored;k-->0;)
+			{
+				const unsigned int j=(next+m_m-1-k)%m_m;
+				const double beta=m_rho[j]*minimizeDot(&m_y[j*n],&m_d[0],n);
+				const double* s=&m_s[j*n];
+				for(unsigned int i=0;i<n;++i) m_d[i]+=(m_alpha[j]-beta)*s[i];
+			}
+			double slope=minimizeDot(&m_g[0],&m_d[0],n);
+			if (slope>=0)
+			{
+				// not a descent direction: restart from steepest descent
+				for(unsigned int i=0;i<n;++i) m_d[i]=-m_g[i];
+				slope=minimizeDot(&m_g[0],&m_d[0],n);
+				stored=0;
+			}
+			double alpha=stored==0?std::min(1.0,1.0/minimizeNormInf(&m_g[0],n)):1.0;
+			double lo=0, hi=HUGE_VAL, ft=f;
+			unsigned int ls=0;
+			for(;ls<maxLineSearch;++ls)
+			{
+				for(unsigned int i=0;i<n;++i) m_xt[i]=x[i]+alpha*m_d[i];
+				ft=m_tape.gradient(&m_xt[0],&m_gt[0]);
+				++stats.gradients;
+				if (!(ft<=f+c1*alpha*slope)) hi=alpha;
+				else if (minimizeDot(&m_gt[0],&m_d[0],n)<c2*slope) lo=alpha;
+				else break;
+				alpha=hi<HUGE_VAL?(lo+hi)/2:2*alpha;
+			}
+			if (ls==maxLineSearch) break;
+			// new correction pair:
+			double* s=&m_s[next*n];
+			double* y=&m_y[next*n];
+			for(unsigned int i=0;i<n;++i)
+			{
+				s[i]=m_xt[i]-x[i];
+				y[i]=m_gt[i]-m_g[i];
+				x[i]=m_xt[i];
+				m_g[i]=m_gt[i];
+			}
+			f=ft;
+			const double sy=minimizeDot(s,y,n);
+			if (sy>0)
+			{
+				m_rho[next]=1/sy;
+				next=(next+1)%m_m;
+				if (stored<m_m) ++stored;
+			}
+			++stats.iterations;
+		}
+		stats.f=f;
+		stats.gradNorm=minimizeNormInf(&m_g[0],n);
+		stats.seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+		return stats;
+	}
+};
+
+// Trust-region Newton method with the Steihaug-Toint truncated conjugate
+// gradient solver for the subproblem, using Hessian-vector products from
+// the tape. The inner solve stops at the boundary, on negative
+// curvature, or at a relative residual of min(0.5,sqrt(|g|)).
+class TrustRegionNewtonCG
+{
+	Tape& m_tape;
+	const unsigned int m_n;
+	std::vector<double> m_g, m_p, m_r, m_d, m_hd, m_hp, m_xt, m_gt, m_tmp;
+	// tau>=0 with |p+tau*d|=radius:
+	double toBoundary(const double radius) const
+	{
+		const unsigned int n=m_n;
+		const double dd=minimizeDot(&m_d[0],&m_d[0],n);
+		const double pd=minimizeDot(&m_p[0],&m_d[0],n);
+		const double pp=minimizeDot(&m_p[0],&m_p[0],n);
+		return (-pd+std::sqrt(pd*pd+dd*(radius*radius-pp)))/dd;
+	}
+public:
+	double radius0, maxRadius;
+	double eta; // minimum ratio of actual to predicted reduction for a step
+	unsigned int maxCG;
+	TrustRegionNewtonCG(Tape& tape):m_tape(tape),m_n(tape.inputs()),
+		m_g(m_n),m_p(m_n),m_r(m_n),m_d(m_n),m_hd(m_n),m_hp(m_n),m_xt(m_n),m_gt(m_n),m_tmp(m_n),
+		radius0(1),maxRadius(1e10),eta(0.1),maxCG(200)
+	{
+		m_tape.prepareHessVec();
+	}
+
+	MinimizeStats minimize(double* x, const double gtol=1e-6, const unsigned int maxIter=1000)
+	{
+		const unsigned int n=m_n;
+		MinimizeStats stats;
+		std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+		double f=m_tape.gradient(x,&m_g[0]);
+		++stats.gradients;
+		double radius=radius0;
+		while(stats.iterations<maxIter)
+		{
+			stats.gradNorm=minimizeNormInf(&m_g[0],n);
+			if (stats.gradNorm<=gtol) { stats.converged=true; break; }
+			// Steihaug-Toint CG on H*p=-g inside the trust region:
+			for(unsigned int i=0;i<n;++i) { m_p[i]=0; m_hp[i]=0; m_r[i]=m_g[i]; m_d[i]=-m_g[i]; }
+			double rr=minimizeDot(&m_r[0],&m_r[0],n);
+			const double tol=std::min(0.5,std::sqrt(std::sqrt(rr)))*std::sqrt(rr);
+			for(unsigned int k=0;k<maxCG;++k)
+			{
+				m_tape.hessVec(x,&m_d[0],&m_tmp[0],&m_hd[0]);
+				++stats.hessVecs;
+				const double dhd=minimizeDot(&m_d[0],&m_hd[0],n);
+				double step=dhd>0?rr/dhd:0;
+				bool boundary=dhd<=0;
+				if (!boundary)
+				{
+					double pp=0;
+					for(unsigned int i=0;i<n;++i) { const double pi=m_p[i]+step*m_d[i]; pp+=pi*pi; }
+					boundary=pp>=radius*radius;
+				}
+				if (boundary) step=toBoundary(radius);
+				for(unsigned int i=0;i<n;++i)
+				{
+					m_p[i]+=step*m_d[i];
+					m_hp[i]+=step*m_hd[i];
+					m_r[i]+=step*m_hd[i];
+				}
+				if (boundary) break;
+				const double rrNew=minimizeDot(&m_r[0],&m_r[0],n);
+				if (std::sqrt(rrNew)<=tol) break;
+				const double beta=rrNew/rr;
+				rr=rrNew;
+				for(unsigned int i=0;i<n;++i) m_d[i]=-m_r[i]+beta*m_d[i];
+			}
+			// Ratio of actual to predicted reduction:
+			const double predicted=-(minimizeDot(&m_g[0],&m_p[0],n)+0.5*minimizeDot(&m_p[0],&m_hp[0],n));
+			for(unsigned int i=0;i<n;++i) m_xt[i]=x[i]+m_p[i];
+			const double ft=m_tape.gradient(&m_xt[0],&m_gt[0]);
+			++stats.gradients;
+			const double rho=predicted>0?(f-ft)/predicted:-1;
+			const double pNorm=std::sqrt(minimizeDot(&m_p[0],&m_p[0],n));
+			if (rho<0.25) radius=0.25*pNorm;
+			else if (rho>0.75 && pNorm>=0.99*radius) radius=std::min(2*radius,maxRadius);
+			if (rho>eta)
+			{
+				for(unsigned int i=0;i<n;++i) { x[i]=m_xt[i]; m_g[i]=m_gt[i]; }
+				f=ft;
+			}
+			++stats.iterations;
+			if (radius<1e-15*(1+minimizeNormInf(x,n))) break;
+		}
+		stats.f=f;
+		stats.gradNorm=minimizeNormInf(&m_g[0],n);
+		stats.seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+		return stats;
+	}
+};
+
+} // namespace fadbad
+
+#endif
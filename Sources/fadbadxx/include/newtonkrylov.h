@@ -0,0 +1,184 @@
+//
+//  newtonkrylov.h
+//  FADBADSwift
+//
+
+#ifndef _NEWTONKRYLOV_H
+#define _NEWTONKRYLOV_H
+
+#include <vector>
+#include <chrono>
+#include <cmath>
+
+#include "tape.h"
+
+namespace fadbad
+{
+
+// Matrix-free Newton-Krylov solver for square systems F(x)=0.
+//
+// F is recorded once on a Tape with n inputs and n outputs
+// (Tape::record(f,x,n,n)). The Jacobian is never formed: each Newton
+// step solves J*dx=-F inexactly by restarted GMRES, whose products J*v
+// are forward sweeps of the tape on F<double,1> (Tape::jvp), about the
+// cost of one evaluation of F. The forcing term follows Eisenstat and
+// Walker (choice 2), and steps are backtracked on |F|. All Krylov and
+// line search buffers are allocated by the constructor.
+
+struct NewtonKrylovStats
+{
+	unsigned int iterations; // Newton steps
+	unsigned int krylov; // GMRES iterations over all steps
+	unsigned int jvps; // Jacobian-vector products
+	unsigned int residuals; // evaluations of F alone
+	double residualNorm; // |F| at the final x
+	double seconds;
+	bool converged;
+	NewtonKrylovStats():iterations(0),krylov(0),jvps(0),residuals(0),residualNorm(0),seconds(0),converged(false){}
+};
+
+class NewtonGMRES
+{
+	Tape& m_tape;
+	const unsigned int m_n, m_m;
+	std::vector<double> m_V; // m+1 Krylov basis vectors
+	std::vector<double> m_H; // (m+1) x m Hessenberg, row-major
+	std::vector<double> m_cs, m_sn, m_s, m_y;
+	std::vector<double> m_f, m_ft, m_dx, m_xt, m_tmp;
+
+	static double dot(const double* a, const double* b, const unsigned int n)
+	{
+		double s=0;
+		for(unsigned int i=0;i<n;++i) s+=a[i]*b[i];
+		return s;
+	}
+	void jv(const double* x, const double* v, double* w, NewtonKrylovStats& stats)
+	{
+		m_tape.jvp(x,v,&m_tmp[0],w);
+		++stats.jvps;
+	}
+	// dx with |J*dx+f|<=eta*|f| by GMRES(m) from dx=0.
+	void gmres(const double* x, const double eta, NewtonKrylovStats& stats)
+	{
+		const unsigned int n=m_n, m=m_m;
+		const double fNorm=std::sqrt(dot(&m_f[0],&m_f[0],n));
+		const double tol=eta*fNorm;
+		std::fill(m_dx.begin(),m_dx.end(),0.0);
+		double beta=fNorm; // residual -f-J*dx of dx=0
+		for(unsigned int i=0;i<n;++i) m_V[i]=-m_f[i];
+		for(unsigned int cycle=0;cycle<maxRestarts && beta>tol && beta>0;++cycle)
+		{
+			for(unsigned int i=0;i<n;++i) m_V[i]/=beta;
+			std::fill(m_s.begin(),m_s.end(),0.0);
+			m_s[0]=beta;
+			unsigned int k=0;
+			while(k<m)
+			{
+				double* w=&m_V[(k+1)*n];
+				jv(x,&m_V[k*n],w,stats);
+				++stats.krylov;
+				// modified Gram-Schmidt:
+				for(unsigned int j=0;j<=k;++j)
+				{
+					const double h=dot(w,&m_V[j*n],n);
+					m_H[j*m+k]=h;
+					const double* vj=&m_V[j*n];
+					for(unsigned int i=0;i<n;++i) w[i]-=h*vj[i];
+				}
+				const double h=std::sqrt(dot(w,w,n));
+				m_H[(k+1)*m+k]=h;
+				if (h>0) for(unsigned int i=0;i<n;++i) w[i]/=h;
+				// previous rotations, then a new one zeroing H(k+1,k):
+				for(unsigned int j=0;j<k;++j)
+				{
+					const double a=m_H[j*m+k], b=m_H[(j+1)*m+k];
+					m_H[j*m+k]=m_cs[j]*a+m_sn[j]*b;
+					m_H[(j+1)*m+k]=-m_sn[j]*a+m_cs[j]*b;
+				}
+				const double a=m_H[k*m+k], b=m_H[(k+1)*m+k];
+				const double r=std::sqrt(a*a+b*b);
+				m_cs[k]=r>0?a/r:1;
+				m_sn[k]=r>0?b/r:0;
+				m_H[k*m+k]=r;
+				m_H[(k+1)*m+k]=0;
+				m_s[k+1]=-m_sn[k]*m_s[k];
+				m_s[k]*=m_cs[k];
+				++k;
+				if (std::fabs(m_s[k])<=tol || h==0) break;
+			}
+			// dx+=V*y with H*y=s, upper triangular k x k:
+			for(unsigned int j=k;j-->0;)
+			{
+				double t=m_s[j];
+				for(unsigned int q=j+1;q<k;++q) t-=m_H[j*m+q]*m_y[q];
+				m_y[j]=m_H[j*m+j]!=0?t/m_H[j*m+j]:0;
+			}
+			for(unsigned int j=0;j<k;++j)
+			{
+				const double* vj=&m_V[j*n];
+				for(unsigned int i=0;i<n;++i) m_dx[i]+=m_y[j]*vj[i];
+			}
+			beta=std::fabs(m_s[k]);
+			if (beta<=tol || cycle+1==maxRestarts) break;
+			// true residual for the restart:
+			jv(x,&m_dx[0],&m_V[0],stats);
+			for(unsigned int i=0;i<n;++i) m_V[i]=-m_f[i]-m_V[i];
+			beta=std::sqrt(dot(&m_V[0],&m_V[0],n));
+		}
+	}
+public:
+	double etaMax; // largest forcing term
+	unsigned int maxRestarts; // GMRES cycles per Newton step
+	unsigned int maxBacktrack;
+	NewtonGMRES(Tape& tape, const unsigned int restart=30):m_tape(tape),m_n(tape.inputs()),m_m(restart),
+		m_V((restart+1)*m_n),m_H((restart+1)*restart),m_cs(restart),m_sn(restart),m_s(restart+1),m_y(restart),
+		m_f(m_n),m_ft(m_n),m_dx(m_n),m_xt(m_n),m_tmp(m_n),
+		etaMax(0.9),maxRestarts(10),maxBacktrack(20)
+	{
+		m_tape.prepareJvp();
+	}
+
+	// Newton steps until |F(x)|<=ftol.
+	NewtonKrylovStats solve(double* x, const double ftol=1e-10, const unsigned int maxIter=100)
+	{
+		const unsigned int n=m_n;
+		NewtonKrylovStats stats;
+		std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+		m_tape.evaluate(x,&m_f[0]);
+		++stats.residuals;
+		double fNorm=std::sqrt(dot(&m_f[0],&m_f[0],n));
+		double eta=etaMax, fNormOld=fNorm;
+		while(stats.iterations<maxIter)
+		{
+			if (fNorm<=ftol) { stats.converged=true; break; }
+			gmres(x,eta,stats);
+			// backtrack on |F| with the Armijo condition for |F|:
+			double t=1, ftNorm=fNorm;
+			unsigned int bt=0;
+			for(;bt<maxBacktrack;++bt)
+			{
+				for(unsigned int i=0;i<n;++i) m_xt[i]=x[i]+t*m_dx[i];
+				m_tape.evaluate(&m_xt[0],&m_ft[0]);
+				++stats.residuals;
+				ftNorm=std::sqrt(dot(&m_ft[0],&m_ft[0],n));
+				if (ftNorm<=(1-1e-4*t*(1-eta))*fNorm) break;
+				t*=0.5;
+			}
+			++stats.iterations;
+			if (bt==maxBacktrack) break;
+			for(unsigned int i=0;i<n;++i) { x[i]=m_xt[i]; m_f[i]=m_ft[i]; }
+			fNormOld=fNorm;
+			fNorm=ftNorm;
+			// Eisenstat-Walker choice 2, safeguarded:
+			const double etaNew=0.9*(fNorm/fNormOld)*(fNorm/fNormOld);
+			eta=std::min(etaMax,std::max(etaNew,0.9*eta*eta>0.1?0.9*eta*eta:0.0));
+		}
+		stats.residualNorm=fNorm;
+		stats.seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+		return stats;
+	}
+};
+
+} // namespace fadbad
+
+#endif
@@ -0,0 +1,124 @@
+//
+//  param.h
+//  FADBADSwift
+//
+
+#ifndef _PARAM_H
+#define _PARAM_H
+
+#include "fadbad.h"
+
+namespace fadbad
+{
+
+// Process-wide counters, atomic when graphs may be built from several
+// threads (FADBAD_ATOMIC_RC, see RefCount).
+#ifdef FADBAD_ATOMIC_RC
+typedef std::atomic<unsigned long> ParamCounter;
+#else
+typedef unsigned long ParamCounter;
+#endif
+
+// Clock advanced by every parameter update.
+inline ParamCounter& paramClock()
+{
+	static ParamCounter clock(0);
+	return clock;
+}
+// Number of the current T::update() pass, which visits every node once.
+inline ParamCounter& paramPass()
+{
+	static ParamCounter pass(0);
+	return pass;
+}
+
+// Mutable model parameter.
+//
+// A Param is a reference-counted handle to a shared value slot. Passed
+// wherever the operators accept a constant V (x+p, p*x, x/p, pow(x,p), ...)
+// it is stored in the node by handle, so the recorded graph reads the slot
+// instead of a baked-in copy. set() changes the value for every node that
+// refers to the slot and stamps it with the parameter clock; update() on a
+// T graph then invalidates only the nodes downstream of changed slots
+// before the next eval(). B graphs are single-use and keep the value the
+// slot had when they were recorded (see ParamValue), so a set() between
+// recording and diff() does not reach them.
+template <typename U>
+class Param
+{
+	struct Slot
+	{
+		U m_val;
+		unsigned long m_stamp;
+		RefCount m_rc;
+		Slot(const U& val):m_val(val),m_stamp(paramClock()),m_rc(){ ++m_rc; }
+	};
+	Slot* m_pSlot;
+public:
+	typedef U UnderlyingType;
+	Param(const U& val):m_pSlot(new Slot(val)){}
+	Param(const Param<U>& p):m_pSlot(p.m_pSlot){ ++m_pSlot->m_rc; }
+	~Param(){ if (--m_pSlot->m_rc==0) delete m_pSlot; }
+	Param<U>& operator=(const Param<U>& p)
+	{
+		++p.m_pSlot->m_rc;
+		if (--m_pSlot->m_rc==0) delete m_pSlot;
+		m_pSlot=p.m_pSlot;
+		return *this;
+	}
+	const U& val() const { return m_pSlot->m_val; }
+	operator const U&() const { return m_pSlot->m_val; }
+	void set(const U& val)
+	{
+		m_pSlot->m_val=val;
+		m_pSlot->m_stamp=++paramClock();
+	}
+	// Clock value at the last change of the slot:
+	unsigned long stamp() const { return m_pSlot->m_stamp; }
+};
+
+// Type in which a reverse node stores a constant operand of type V: the
+// value itself for a Param, so that the recorded values and the adjoints
+// propagated by diff() agree.
+template <typename V> struct ParamValue { typedef V Type; };
+template <typename U> struct ParamValue< Param<U> > { typedef U Type; };
+
+// Stamp of a constant operand; plain constants never change.
+template <typename V> unsigned long paramStamp(const V&) { return 0; }
+template <typename U> unsigned long paramStamp(const Param<U>& p) { return p.stamp(); }
+
+template <typename U> U operator+(const Param<U>& a, const U& b) { return a.val()+b; }
+template <typename U> U operator+(const U& a, const Param<U>& b) { return a+b.val(); }
+template <typename U> U operator-(const Param<U>& a, const U& b) { return a.val()-b; }
+template <typename U> U operator-(const U& a, const Param<U>& b) { return a-b.val(); }
+template <typename U> U operator*(const Param<U>& a, const U& b) { return a.val()*b; }
+template <typename U> U operator*(const U& a, const Param<U>& b) { return a*b.val(); }
+template <typename U> U operator/(const Param<U>& a, const U& b) { return a.val()/b; }
+template <typename U> U operator/(const U& a, const Param<U>& b) { return a/b.val(); }
+
+template <typename U> struct Op< Param<U> >
+{
+	typedef Param<U> V;
+	typedef typename Op<U>::Base Base;
+	static Base myInteger(const int i) { return Base(i); }
+	static Base myZero() { return myInteger(0); }
+	static Base myOne() { return myInteger(1);}
+	static Base myTwo() { return myInteger(2); }
+	static U myPos(const V& x) { return Op<U>::myPos(x.val()); }
+	static U myNeg(const V& x) { return Op<U>::myNeg(x.val()); }
+	static U myInv(const V& x) { return Op<U>::myInv(x.val()); }
+	static U mySqr(const V& x) { return Op<U>::mySqr(x.val()); }
+	static U mySqrt(const V& x) { return Op<U>::mySqrt(x.val()); }
+	static U myLog(const V& x) { return Op<U>::myLog(x.val()); }
+	static U myExp(const V& x) { return Op<U>::myExp(x.val()); }
+	static U mySin(const V& x) { return Op<U>::mySin(x.val()); }
+	static U myCos(const V& x) { return Op<U>::myCos(x.val()); }
+	static U myTan(const V& x) { return Op<U>::myTan(x.val()); }
+	static U myAsin(const V& x) { return Op<U>::myAsin(x.val()); }
+	static U myAcos(const V& x) { return Op<U>::myAcos(x.val()); }
+	static U myAtan(const V& x) { return Op<U>::myAtan(x.val()); }
+};
+
+} // namespace fadbad
+
+#endif
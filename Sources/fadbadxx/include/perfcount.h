@@ -0,0 +1,97 @@
+//
+//  perfcount.h
+//  FADBADSwift
+//
+
+#ifndef _PERFCOUNT_H
+#define _PERFCOUNT_H
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+namespace fadbad
+{
+
+// Hardware cache miss counters of the calling thread, for measuring the
+// effect of slot renumbering on replays. On Linux they are read through
+// perf_event_open: L1 data cache read misses and last level cache read
+// misses (the generic perf events do not name the L2 cache; on most
+// hosts with two cache levels per core the last level is L3). Elsewhere,
+// or when the kernel refuses the events (perf_event_paranoid, seccomp),
+// available() is false and the counts stay 0.
+//
+//	CacheCounters counters;
+//	counters.start();
+//	tape.gradient(x,g);
+//	counters.stop();
+//	// counters.l1Misses(), counters.llMisses()
+
+class CacheCounters
+{
+	enum { L1, LL, Counters };
+	int m_fd[Counters];
+	unsigned long long m_count[Counters];
+	CacheCounters(const CacheCounters&); // not allowed
+	void operator=(const CacheCounters&); // not allowed
+#ifdef __linux__
+	static int open(const unsigned long long config)
+	{
+		struct perf_event_attr attr;
+		std::memset(&attr,0,sizeof(attr));
+		attr.size=sizeof(attr);
+		attr.type=PERF_TYPE_HW_CACHE;
+		attr.config=config;
+		attr.disabled=1;
+		attr.exclude_kernel=1;
+		attr.exclude_hv=1;
+		return (int)syscall(__NR_perf_event_open,&attr,0,-1,-1,0);
+	}
+#endif
+public:
+	CacheCounters()
+	{
+		for(int i=0;i<Counters;++i) { m_fd[i]=-1; m_count[i]=0; }
+#ifdef __linux__
+		const unsigned long long readMiss=(PERF_COUNT_HW_CACHE_OP_READ<<8)|(PERF_COUNT_HW_CACHE_RESULT_MISS<<16);
+		m_fd[L1]=open(PERF_COUNT_HW_CACHE_L1D|readMiss);
+		m_fd[LL]=open(PERF_COUNT_HW_CACHE_LL|readMiss);
+#endif
+	}
+	~CacheCounters()
+	{
+#ifdef __linux__
+		for(int i=0;i<Counters;++i) if (m_fd[i]>=0) close(m_fd[i]);
+#endif
+	}
+	bool available() const { return m_fd[L1]>=0 || m_fd[LL]>=0; }
+	void start()
+	{
+#ifdef __linux__
+		for(int i=0;i<Counters;++i)
+			if (m_fd[i]>=0) { ioctl(m_fd[i],PERF_EVENT_IOC_RESET,0); ioctl(m_fd[i],PERF_EVENT_IOC_ENABLE,0); }
+#endif
+	}
+	void stop()
+	{
+#ifdef __linux__
+		for(int i=0;i<Counters;++i)
+		{
+			m_count[i]=0;
+			if (m_fd[i]<0) continue;
+			ioctl(m_fd[i],PERF_EVENT_IOC_DISABLE,0);
+			if (read(m_fd[i],&m_count[i],sizeof(m_count[i]))!=sizeof(m_count[i])) m_count[i]=0;
+		}
+#endif
+	}
+	unsigned long long l1Misses() const { return m_count[L1]; }
+	unsigned long long llMisses() const { return m_count[LL]; }
+};
+
+} // namespace fadbad
+
+#endif
@@ -0,0 +1,64 @@
+//
+//  precision.h
+//  FADBADSwift
+//
+
+#ifndef _PRECISION_H
+#define _PRECISION_H
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+namespace fadbad
+{
+
+// Single and mixed precision.
+//
+// T<float>, F<float,N>, B<float>, TaylorProgram<float> and their
+// Lanes<float,W> forms are supported configurations: constants written
+// as double literals are rounded to float where they meet a float value.
+// Mixed configurations:
+//
+// - float adjoints over double values: Tape::reverse on a float adjoint
+//   array, or Tape::gradient(x,float* g);
+// - double low orders with float high orders: MixedTaylorProgram<double,
+//   float>, or MixedTaylorProgram<Lanes<double,W>,Lanes<float,W> > where
+//   the float lanes pay off (taylorprogram.h).
+//
+// High order Taylor coefficients shrink like r^-k for a convergence
+// radius r and reach the float subnormal range (below 1e-38) at moderate
+// orders, where every operation on them is many times slower. Run float
+// expansions with subnormals flushed to zero, by a FlushSubnormals object
+// on the evaluating thread; the flushed values are far below what float
+// coefficients can resolve anyway.
+
+class FlushSubnormals
+{
+#if defined(__SSE__) || defined(_M_X64)
+	unsigned int m_csr;
+public:
+	FlushSubnormals():m_csr(_mm_getcsr()){ _mm_setcsr(m_csr|0x8040); } // FTZ and DAZ
+	~FlushSubnormals(){ _mm_setcsr(m_csr); }
+#elif defined(__aarch64__)
+	unsigned long m_fpcr;
+public:
+	FlushSubnormals()
+	{
+		__asm__ __volatile__("mrs %0, fpcr" : "=r"(m_fpcr));
+		const unsigned long fz=m_fpcr|(1ul<<24);
+		__asm__ __volatile__("msr fpcr, %0" : : "r"(fz));
+	}
+	~FlushSubnormals(){ __asm__ __volatile__("msr fpcr, %0" : : "r"(m_fpcr)); }
+#else
+public:
+	FlushSubnormals(){}
+#endif
+private:
+	FlushSubnormals(const FlushSubnormals&); // not allowed
+	void operator=(const FlushSubnormals&); // not allowed
+};
+
+} // namespace fadbad
+
+#endif
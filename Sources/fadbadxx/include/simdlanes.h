@@ -0,0 +1,179 @@
+//
+//  simdlanes.h
+//  FADBADSwift
+//
+
+#ifndef _SIMDLANES_H
+#define _SIMDLANES_H
+
+#include <type_traits>
+
+#include "fadbad.h"
+
+namespace fadbad
+{
+
+// A fixed-width pack of W values that behaves like a single scalar. All
+// operations are element-wise loops over a contiguous array, which the
+// compiler turns into SIMD instructions. Instantiating T< Lanes<double,W> >
+// evaluates W Taylor expansions through one recorded graph.
+
+template <typename U, int W>
+struct Lanes
+{
+	U v[W];
+	Lanes(){ for(int i=0;i<W;++i) v[i]=Op<U>::myZero(); }
+	template <typename S, typename=typename std::enable_if<std::is_arithmetic<S>::value>::type>
+	Lanes(const S& s){ for(int i=0;i<W;++i) v[i]=s; }
+	// Lane-wise conversion from another precision (MixedTaylorProgram):
+	template <typename S>
+	explicit Lanes(const Lanes<S,W>& a){ for(int i=0;i<W;++i) v[i]=U(a.v[i]); }
+	U& operator[](const int i){ return v[i]; }
+	const U& operator[](const int i) const { return v[i]; }
+
+	Lanes<U,W>& operator+=(const Lanes<U,W>& a){ for(int i=0;i<W;++i) v[i]+=a.v[i]; return *this; }
+	Lanes<U,W>& operator-=(const Lanes<U,W>& a){ for(int i=0;i<W;++i) v[i]-=a.v[i]; return *this; }
+	Lanes<U,W>& operator*=(const Lanes<U,W>& a){ for(int i=0;i<W;++i) v[i]*=a.v[i]; return *this; }
+	Lanes<U,W>& operator/=(const Lanes<U,W>& a){ for(int i=0;i<W;++i) v[i]/=a.v[i]; return *this; }
+};
+
+// Lane access for scalars and packs, used by drivers that need per-lane
+// control decisions (step sizes, masks) on top of the packed arithmetic.
+
+template <typename U>
+struct LaneTraits
+{
+	typedef U Scalar;
+	static const int width=1;
+	static Scalar& lane(U& x, const int){ return x; }
+	static const Scalar& lane(const U& x, const int){ return x; }
+};
+
+template <typename U, int W>
+struct LaneTraits< Lanes<U,W> >
+{
+	typedef U Scalar;
+	static const int width=W;
+	static Scalar& lane(Lanes<U,W>& x, const int i){ return x.v[i]; }
+	static const Scalar& lane(const Lanes<U,W>& x, const int i){ return x.v[i]; }
+};
+
+template <typename U, int W> INLINE1 const U& laneOf(const Lanes<U,W>& x, const int i){ return x.v[i]; }
+template <typename S> INLINE1 const S& laneOf(const S& x, const int){ return x; }
+
+#define LANES_BINARY_OPERATOR(OP)\
+template <typename U, int W>\
+INLINE2 Lanes<U,W> operator OP(const Lanes<U,W>& a, const Lanes<U,W>& b)\
+{\
+	Lanes<U,W> c;\
+	for(int i=0;i<W;++i) c.v[i]=a.v[i] OP b.v[i];\
+	return c;\
+}\
+template <typename U, int W, typename S, typename=typename std::enable_if<std::is_arithmetic<S>::value>::type>\
+INLINE2 Lanes<U,W> operator OP(const Lanes<U,W>& a, const S& b)\
+{\
+	Lanes<U,W> c;\
+	for(int i=0;i<W;++i) c.v[i]=a.v[i] OP b;\
+	return c;\
+}\
+template <typename U, int W, typename S, typename=typename std::enable_if<std::is_arithmetic<S>::value>::type>\
+INLINE2 Lanes<U,W> operator OP(const S& a, const Lanes<U,W>& b)\
+{\
+	Lanes<U,W> c;\
+	for(int i=0;i<W;++i) c.v[i]=a OP b.v[i];\
+	return c;\
+}
+
+LANES_BINARY_OPERATOR(+)
+LANES_BINARY_OPERATOR(-)
+LANES_BINARY_OPERATOR(*)
+LANES_BINARY_OPERATOR(/)
+
+#undef LANES_BINARY_OPERATOR
+
+template <typename U, int W>
+INLINE2 Lanes<U,W> operator-(const Lanes<U,W>& a)
+{
+	Lanes<U,W> c;
+	for(int i=0;i<W;++i) c.v[i]=-a.v[i];
+	return c;
+}
+template <typename U, int W>
+INLINE1 Lanes<U,W> operator+(const Lanes<U,W>& a) { return a; }
+
+// Comparisons hold when they hold in every lane.
+
+#define LANES_COMPARISON(OP)\
+template <typename U, int W>\
+INLINE2 bool operator OP(const Lanes<U,W>& a, const Lanes<U,W>& b)\
+{\
+	for(int i=0;i<W;++i) if (!(a.v[i] OP b.v[i])) return false;\
+	return true;\
+}
+
+LANES_COMPARISON(==)
+LANES_COMPARISON(<)
+LANES_COMPARISON(<=)
+LANES_COMPARISON(>)
+LANES_COMPARISON(>=)
+
+#undef LANES_COMPARISON
+
+template <typename U, int W>
+INLINE1 bool operator!=(const Lanes<U,W>& a, const Lanes<U,W>& b) { return !(a==b); }
+
+#define LANES_FUNCTION(NAME)\
+	static V NAME(const V& x)\
+	{\
+		V y;\
+		for(int i=0;i<W;++i) y.v[i]=Op<U>::NAME(x.v[i]);\
+		return y;\
+	}
+
+template <typename U, int W> struct Op< Lanes<U,W> >
+{
+	typedef Lanes<U,W> V;
+	typedef Lanes<U,W> Underlying;
+	typedef typename Op<U>::Base Base;
+	static Base myInteger(const int i) { return Base(i); }
+	static Base myZero() { return myInteger(0); }
+	static Base myOne() { return myInteger(1);}
+	static Base myTwo() { return myInteger(2); }
+	static Base myPI() { return Op<Base>::myPI(); }
+	static V myPos(const V& x) { return +x; }
+	static V myNeg(const V& x) { return -x; }
+	template <typename Y> static V& myCadd(V& x, const Y& y) { return x+=y; }
+	template <typename Y> static V& myCsub(V& x, const Y& y) { return x-=y; }
+	template <typename Y> static V& myCmul(V& x, const Y& y) { return x*=y; }
+	template <typename Y> static V& myCdiv(V& x, const Y& y) { return x/=y; }
+	static V myInv(const V& x) { return myOne()/x; }
+	LANES_FUNCTION(mySqr)
+	template <typename X, typename Y>
+	static V myPow(const X& x, const Y& y)
+	{
+		V z;
+		for(int i=0;i<W;++i) z.v[i]=Op<U>::myPow(laneOf(x,i),laneOf(y,i));
+		return z;
+	}
+	LANES_FUNCTION(mySqrt)
+	LANES_FUNCTION(myLog)
+	LANES_FUNCTION(myExp)
+	LANES_FUNCTION(mySin)
+	LANES_FUNCTION(myCos)
+	LANES_FUNCTION(myTan)
+	LANES_FUNCTION(myAsin)
+	LANES_FUNCTION(myAcos)
+	LANES_FUNCTION(myAtan)
+	static bool myEq(const V& x, const V& y) { return x==y; }
+	static bool myNe(const V& x, const V& y) { return x!=y; }
+	static bool myLt(const V& x, const V& y) { return x<y; }
+	static bool myLe(const V& x, const V& y) { return x<=y; }
+	static bool myGt(const V& x, const V& y) { return x>y; }
+	static bool myGe(const V& x, const V& y) { return x>=y; }
+};
+
+#undef LANES_FUNCTION
+
+} // namespace fadbad
+
+#endif
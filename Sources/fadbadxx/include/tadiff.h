@@ -31,12 +31,14 @@
 #define _TADIFF_H
 
 #include <algorithm>
+#include <vector>
 
 #ifndef MaxLength
 #define MaxLength 40
 #endif
 
 #include "fadbad.h"
+#include "param.h"
 
 namespace fadbad
 {
@@ -68,21 +70,37 @@ template <typename U, int N>
 class TTypeNameHV // Heap Value
 {
 	TValues<U,N> m_val;
-	mutable unsigned int m_rc;
+	mutable RefCount m_rc;
+	unsigned long m_stamp; // parameter clock the values were computed at
+	unsigned long m_pass; // last update() pass that reached the node
 protected:
 	virtual ~TTypeNameHV(){}
+	// Drops the values if they predate parameter stamp s:
+	unsigned long restamp(const unsigned long s){ if (s>m_stamp) { m_stamp=s; m_val.reset(); } return m_stamp; }
+	unsigned long stamp() const { return m_stamp; }
 public:
-	TTypeNameHV():m_rc(0){}
-	template <typename V> explicit TTypeNameHV(const V& val):m_val(val),m_rc(0){}
+	TTypeNameHV():m_rc(),m_stamp(paramClock()),m_pass(0){}
+	template <typename V> explicit TTypeNameHV(const V& val):m_val(val),m_rc(),m_stamp(paramClock()),m_pass(0){}
 	const U& val(const unsigned int i) const { return m_val[i]; }
 	U& val(const unsigned int i) { return m_val[i]; }
 	unsigned int length() const { return m_val.length(); }
 	unsigned int& length() { return m_val.length(); }
 	void decRef(TTypeNameHV<U,N>*& pTTypeNameHV) const { if (--m_rc==0) { delete this; pTTypeNameHV=0;} }
 	void incRef() const {++m_rc;}
+	unsigned int refCount() const {return m_rc;}
 
 	virtual void reset(){m_val.reset();}
 	virtual unsigned int eval(const unsigned int k){return k+1;}
+	// Invalidates values that depend on changed parameters and returns
+	// the newest parameter stamp they depend on. A pass reaches every node
+	// once; later visits in the same pass return the stamp already set.
+	unsigned long update(const unsigned long pass)
+	{
+		if (m_pass==pass) return m_stamp;
+		m_pass=pass;
+		return updateOperands(pass);
+	}
+	virtual unsigned long updateOperands(const unsigned long){return 0;}
 };
 
 template <typename U, int N=MaxLength>
@@ -113,6 +131,7 @@ private:
 
 		void reset(){m_pTTypeNameHV->reset();}
 		unsigned int eval(const unsigned int i){return m_pTTypeNameHV->eval(i);}
+		void update(){m_pTTypeNameHV->update(++paramPass());}
 	} m_sv;
 public:
 	typedef U UnderlyingType;
@@ -141,6 +160,8 @@ public:
 	
 	TTypeName<U,N>& operator+=(const TTypeName<U,N>& val);
 	TTypeName<U,N>& operator-=(const TTypeName<U,N>& val);
+	TTypeName<U,N>& operator+=(TTypeName<U,N>&& val);
+	TTypeName<U,N>& operator-=(TTypeName<U,N>&& val);
 	TTypeName<U,N>& operator*=(const TTypeName<U,N>& val);
 	TTypeName<U,N>& operator/=(const TTypeName<U,N>& val);
 	template <typename V> TTypeName<U,N>& operator+=(const V& val);
@@ -150,8 +171,36 @@ public:
 
 	void reset(){m_sv.reset();}
 	unsigned int eval(const unsigned int i){return m_sv.eval(i);}
+	// Like reset(), but only for the nodes that depend on a Param changed
+	// since they were computed:
+	void update(){m_sv.update();}
 };
 
+// Deferred construction.
+//
+// Builders normally compute the order 0 coefficient of a new node at once
+// when the operands have one. While a TTypeNameDeferred object is alive on
+// the current thread they record structure only, and all coefficients,
+// including order 0, are computed by the first eval(). This saves the
+// elementary function calls when a graph is recorded once and then
+// re-seeded and evaluated many times.
+
+inline bool& tDeferred()
+{
+	static thread_local bool deferred=false;
+	return deferred;
+}
+class TTypeNameDeferred
+{
+	bool m_prev;
+	TTypeNameDeferred(const TTypeNameDeferred&); // not allowed
+	void operator=(const TTypeNameDeferred&); // not allowed
+public:
+	TTypeNameDeferred():m_prev(tDeferred()){ tDeferred()=true; }
+	~TTypeNameDeferred(){ tDeferred()=m_prev; }
+};
+template <typename U, int N> bool eagerValue(const TTypeName<U,N>& val) { return val.length()>0 && !tDeferred(); }
+
 template <typename U, int N> bool operator==(const TTypeName<U,N>& val1, const TTypeName<U,N>& val2) { return Op<U>::myEq(val1.val(),val2.val()); }
 template <typename U, int N> bool operator!=(const TTypeName<U,N>& val1, const TTypeName<U,N>& val2) { return Op<U>::myNe(val1.val(),val2.val()); }
 template <typename U, int N> bool operator<(const TTypeName<U,N>& val1, const TTypeName<U,N>& val2) { return Op<U>::myLt(val1.val(),val2.val()); }
@@ -199,6 +248,7 @@ public:
 	const U& op1Val(const unsigned int k) {return this->op1()->val(k);}
 	const U& op2Val(const unsigned int k) {return this->op2()->val(k);}
 	void reset(){op1()->reset();op2()->reset();TTypeNameHV<U,N>::reset();}
+	unsigned long updateOperands(const unsigned long pass){unsigned long s1=op1()->update(pass),s2=op2()->update(pass);return this->restamp(std::max(s1,s2));}
 };
 
 // Unary operator base class:
@@ -225,6 +275,7 @@ public:
 	unsigned int opEval(const unsigned int k){return this->op()->eval(k);}
 	const U& opVal(const unsigned int k) {return this->op()->val(k);}
 	void reset(){op()->reset();TTypeNameHV<U,N>::reset();}
+	unsigned long updateOperands(const unsigned long pass){return this->restamp(op()->update(pass));}
 };
 
 // ADDITION:
@@ -256,6 +307,7 @@ struct TTypeNameADD1 : public UnTTypeNameHV<U,N>
 		for(unsigned int i=this->length();i<l;++i) this->val(i)=this->opVal(i);
 		return this->length()=l;
 	}
+	unsigned long updateOperands(const unsigned long pass){return this->restamp(std::max(this->op()->update(pass),paramStamp(m_a)));}
 private:
 	void operator=(const TTypeNameADD1<U,N,V>&){} // not allowed
 };
@@ -272,13 +324,14 @@ struct TTypeNameADD2 : public UnTTypeNameHV<U,N>
 		for(unsigned int i=this->length();i<l;++i) this->val(i)=this->opVal(i);
 		return this->length()=l;
 	}
+	unsigned long updateOperands(const unsigned long pass){return this->restamp(std::max(this->op()->update(pass),paramStamp(m_b)));}
 private:
 	void operator=(const TTypeNameADD2<U,N,V>&){} // not allowed
 };
 template <typename U, int N>
 TTypeName<U,N> operator+(const TTypeName<U,N>& val1, const TTypeName<U,N>& val2)
 {
-	TTypeNameHV<U,N>* pHV=val1.length()>0 && val2.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val1) && eagerValue(val2) ?
 		new TTypeNameADD<U,N>(val1.val()+val2.val(),val1.getTTypeNameHV(),val2.getTTypeNameHV()):
 		new TTypeNameADD<U,N>(val1.getTTypeNameHV(),val2.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -287,7 +340,7 @@ TTypeName<U,N> operator+(const TTypeName<U,N>& val1, const TTypeName<U,N>& val2)
 template <typename U, int N>
 TTypeName<U,N> operator+(const typename Op<U>::Underlying& a, const TTypeName<U,N>& val2)
 {
-	TTypeNameHV<U,N>* pHV=val2.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val2) ?
 		new TTypeNameADD1<U,N,typename Op<U>::Underlying>(a+val2.val(), a, val2.getTTypeNameHV()):
 		new TTypeNameADD1<U,N,typename Op<U>::Underlying>(a, val2.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -295,7 +348,7 @@ TTypeName<U,N> operator+(const typename Op<U>::Underlying& a, const TTypeName<U,
 template <typename U, int N>
 TTypeName<U,N> operator+(const TTypeName<U,N>& val1, const typename Op<U>::Underlying& b)
 {
-	TTypeNameHV<U,N>* pHV=val1.length()>0?
+	TTypeNameHV<U,N>* pHV=eagerValue(val1)?
 		new TTypeNameADD2<U,N,typename Op<U>::Underlying>(val1.val()+b, val1.getTTypeNameHV(), b):
 		new TTypeNameADD2<U,N,typename Op<U>::Underlying>(val1.getTTypeNameHV(), b);
 	return TTypeName<U,N>(pHV);
@@ -303,7 +356,7 @@ TTypeName<U,N> operator+(const TTypeName<U,N>& val1, const typename Op<U>::Under
 template <typename U, int N>
 TTypeName<U,N> operator+(const typename Op<U>::Base& a, const TTypeName<U,N>& val2)
 {
-	TTypeNameHV<U,N>* pHV=val2.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val2) ?
 		new TTypeNameADD1<U,N,typename Op<U>::Base>(a+val2.val(), a, val2.getTTypeNameHV()):
 		new TTypeNameADD1<U,N,typename Op<U>::Base>(a, val2.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -311,7 +364,7 @@ TTypeName<U,N> operator+(const typename Op<U>::Base& a, const TTypeName<U,N>& va
 template <typename U, int N>
 TTypeName<U,N> operator+(const TTypeName<U,N>& val1, const typename Op<U>::Base& b)
 {
-	TTypeNameHV<U,N>* pHV=val1.length()>0?
+	TTypeNameHV<U,N>* pHV=eagerValue(val1)?
 		new TTypeNameADD2<U,N,typename Op<U>::Base>(val1.val()+b, val1.getTTypeNameHV(), b):
 		new TTypeNameADD2<U,N,typename Op<U>::Base>(val1.getTTypeNameHV(), b);
 	return TTypeName<U,N>(pHV);
@@ -320,7 +373,7 @@ TTypeName<U,N> operator+(const TTypeName<U,N>& val1, const typename Op<U>::Base&
 template <typename U, int N, typename V>
 TTypeName<U,N> operator+(const V& a, const TTypeName<U,N>& val2)
 {
-	TTypeNameHV<U,N>* pHV=val2.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val2) ?
 		new TTypeNameADD1<U,N,V>(a+val2.val(), a, val2.getTTypeNameHV()):
 		new TTypeNameADD1<U,N,V>(a, val2.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -328,7 +381,7 @@ TTypeName<U,N> operator+(const V& a, const TTypeName<U,N>& val2)
 template <typename U, int N, typename V>
 TTypeName<U,N> operator+(const TTypeName<U,N>& val1, const V& b)
 {
-	TTypeNameHV<U,N>* pHV=val1.length()>0?
+	TTypeNameHV<U,N>* pHV=eagerValue(val1)?
 		new TTypeNameADD2<U,N,V>(val1.val()+b, val1.getTTypeNameHV(), b):
 		new TTypeNameADD2<U,N,V>(val1.getTTypeNameHV(), b);
 	return TTypeName<U,N>(pHV);
@@ -363,6 +416,7 @@ struct TTypeNameSUB1 : public UnTTypeNameHV<U,N>
 		for(unsigned int i=this->length();i<l;++i) this->val(i)=Op<U>::myNeg(this->opVal(i));
 		return this->length()=l;
 	}
+	unsigned long updateOperands(const unsigned long pass){return this->restamp(std::max(this->op()->update(pass),paramStamp(m_a)));}
 private:
 	void operator=(const TTypeNameSUB1<U,N,V>&){} // not allowed
 };
@@ -379,13 +433,14 @@ struct TTypeNameSUB2 : public UnTTypeNameHV<U,N>
 		for(unsigned int i=this->length();i<l;++i) this->val(i)=this->opVal(i);
 		return this->length()=l;
 	}
+	unsigned long updateOperands(const unsigned long pass){return this->restamp(std::max(this->op()->update(pass),paramStamp(m_b)));}
 private:
 	void operator=(const TTypeNameSUB2<U,N,V>&){} // not allowed
 };
 template <typename U, int N>
 TTypeName<U,N> operator-(const TTypeName<U,N>& val1, const TTypeName<U,N>& val2)
 { 
-	TTypeNameHV<U,N>* pHV=val1.length()>0 && val2.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val1) && eagerValue(val2) ?
 		new TTypeNameSUB<U,N>(val1.val()-val2.val(),val1.getTTypeNameHV(),val2.getTTypeNameHV()):
 		new TTypeNameSUB<U,N>(val1.getTTypeNameHV(),val2.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -394,7 +449,7 @@ TTypeName<U,N> operator-(const TTypeName<U,N>& val1, const TTypeName<U,N>& val2)
 template <typename U, int N>
 TTypeName<U,N> operator-(const typename Op<U>::Underlying& a, const TTypeName<U,N>& val2)
 {
-	TTypeNameHV<U,N>* pHV=val2.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val2) ?
 		new TTypeNameSUB1<U,N,typename Op<U>::Underlying>(a-val2.val(), a, val2.getTTypeNameHV()):
 		new TTypeNameSUB1<U,N,typename Op<U>::Underlying>(a, val2.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -402,7 +457,7 @@ TTypeName<U,N> operator-(const typename Op<U>::Underlying& a, const TTypeName<U,
 template <typename U, int N>
 TTypeName<U,N> operator-(const TTypeName<U,N>& val1, const typename Op<U>::Underlying& b)
 {
-	TTypeNameHV<U,N>* pHV=val1.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val1) ?
 		new TTypeNameSUB2<U,N,typename Op<U>::Underlying>(val1.val()-b, val1.getTTypeNameHV(), b):
 		new TTypeNameSUB2<U,N,typename Op<U>::Underlying>(val1.getTTypeNameHV(), b);
 	return TTypeName<U,N>(pHV);
@@ -410,7 +465,7 @@ TTypeName<U,N> operator-(const TTypeName<U,N>& val1, const typename Op<U>::Under
 template <typename U, int N>
 TTypeName<U,N> operator-(const typename Op<U>::Base& a, const TTypeName<U,N>& val2)
 {
-	TTypeNameHV<U,N>* pHV=val2.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val2) ?
 		new TTypeNameSUB1<U,N,typename Op<U>::Base>(a-val2.val(), a, val2.getTTypeNameHV()):
 		new TTypeNameSUB1<U,N,typename Op<U>::Base>(a, val2.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -418,7 +473,7 @@ TTypeName<U,N> operator-(const typename Op<U>::Base& a, const TTypeName<U,N>& va
 template <typename U, int N>
 TTypeName<U,N> operator-(const TTypeName<U,N>& val1, const typename Op<U>::Base& b)
 {
-	TTypeNameHV<U,N>* pHV=val1.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val1) ?
 		new TTypeNameSUB2<U,N,typename Op<U>::Base>(val1.val()-b, val1.getTTypeNameHV(), b):
 		new TTypeNameSUB2<U,N,typename Op<U>::Base>(val1.getTTypeNameHV(), b);
 	return TTypeName<U,N>(pHV);
@@ -427,7 +482,7 @@ TTypeName<U,N> operator-(const TTypeName<U,N>& val1, const typename Op<U>::Base&
 template <typename U, int N, typename V>
 TTypeName<U,N> operator-(const V& a, const TTypeName<U,N>& val2)
 {
-	TTypeNameHV<U,N>* pHV=val2.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val2) ?
 		new TTypeNameSUB1<U,N,V>(a-val2.val(), a, val2.getTTypeNameHV()):
 		new TTypeNameSUB1<U,N,V>(a, val2.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -435,7 +490,7 @@ TTypeName<U,N> operator-(const V& a, const TTypeName<U,N>& val2)
 template <typename U, int N, typename V>
 TTypeName<U,N> operator-(const TTypeName<U,N>& val1, const V& b)
 {
-	TTypeNameHV<U,N>* pHV=val1.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val1) ?
 		new TTypeNameSUB2<U,N,V>(val1.val()-b, val1.getTTypeNameHV(), b):
 		new TTypeNameSUB2<U,N,V>(val1.getTTypeNameHV(), b);
 	return TTypeName<U,N>(pHV);
@@ -474,6 +529,7 @@ struct TTypeNameMUL1 : public UnTTypeNameHV<U,N>
 		for(unsigned int i=this->length();i<l;++i) this->val(i)=m_a*this->opVal(i);
 		return this->length()=l;
 	}
+	unsigned long updateOperands(const unsigned long pass){return this->restamp(std::max(this->op()->update(pass),paramStamp(m_a)));}
 private:
 	void operator=(const TTypeNameMUL1<U,N,V>&){} // not allowed
 };
@@ -489,13 +545,14 @@ struct TTypeNameMUL2 : public UnTTypeNameHV<U,N>
 		for(unsigned int i=this->length();i<l;++i) this->val(i)=this->opVal(i)*m_b;
 		return this->length()=l;
 	}
+	unsigned long updateOperands(const unsigned long pass){return this->restamp(std::max(this->op()->update(pass),paramStamp(m_b)));}
 private:
 	void operator=(const TTypeNameMUL2<U,N,V>&){} // not allowed
 };
 template <typename U, int N>
 TTypeName<U,N> operator*(const TTypeName<U,N>& val1, const TTypeName<U,N>& val2)
 {
-	TTypeNameHV<U,N>* pHV=val1.length()>0 && val2.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val1) && eagerValue(val2) ?
 		new TTypeNameMUL<U,N>(val1.val()*val2.val(),val1.getTTypeNameHV(),val2.getTTypeNameHV()):
 		new TTypeNameMUL<U,N>(val1.getTTypeNameHV(),val2.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -504,7 +561,7 @@ TTypeName<U,N> operator*(const TTypeName<U,N>& val1, const TTypeName<U,N>& val2)
 template <typename U, int N>
 TTypeName<U,N> operator*(const typename Op<U>::Underlying& a, const TTypeName<U,N>& val2)
 {
-	TTypeNameHV<U,N>* pHV=val2.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val2) ?
 		new TTypeNameMUL1<U,N,typename Op<U>::Underlying>(a*val2.val(), a, val2.getTTypeNameHV()):
 		new TTypeNameMUL1<U,N,typename Op<U>::Underlying>(a, val2.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -512,7 +569,7 @@ TTypeName<U,N> operator*(const typename Op<U>::Underlying& a, const TTypeName<U,
 template <typename U, int N>
 TTypeName<U,N> operator*(const TTypeName<U,N>& val1, const typename Op<U>::Underlying& b)
 {
-	TTypeNameHV<U,N>* pHV=val1.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val1) ?
 		new TTypeNameMUL2<U,N,typename Op<U>::Underlying>(val1.val()*b, val1.getTTypeNameHV(), b):
 		new TTypeNameMUL2<U,N,typename Op<U>::Underlying>(val1.getTTypeNameHV(), b);
 	return TTypeName<U,N>(pHV);
@@ -520,7 +577,7 @@ TTypeName<U,N> operator*(const TTypeName<U,N>& val1, const typename Op<U>::Under
 template <typename U, int N>
 TTypeName<U,N> operator*(const typename Op<U>::Base& a, const TTypeName<U,N>& val2)
 {
-	TTypeNameHV<U,N>* pHV=val2.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val2) ?
 		new TTypeNameMUL1<U,N,typename Op<U>::Base>(a*val2.val(), a, val2.getTTypeNameHV()):
 		new TTypeNameMUL1<U,N,typename Op<U>::Base>(a, val2.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -528,7 +585,7 @@ TTypeName<U,N> operator*(const typename Op<U>::Base& a, const TTypeName<U,N>& va
 template <typename U, int N>
 TTypeName<U,N> operator*(const TTypeName<U,N>& val1, const typename Op<U>::Base& b)
 {
-	TTypeNameHV<U,N>* pHV=val1.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val1) ?
 		new TTypeNameMUL2<U,N,typename Op<U>::Base>(val1.val()*b, val1.getTTypeNameHV(), b):
 		new TTypeNameMUL2<U,N,typename Op<U>::Base>(val1.getTTypeNameHV(), b);
 	return TTypeName<U,N>(pHV);
@@ -537,7 +594,7 @@ TTypeName<U,N> operator*(const TTypeName<U,N>& val1, const typename Op<U>::Base&
 template <typename U, int N, typename V>
 TTypeName<U,N> operator*(const V& a, const TTypeName<U,N>& val2)
 {
-	TTypeNameHV<U,N>* pHV=val2.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val2) ?
 		new TTypeNameMUL1<U,N,V>(a*val2.val(), a, val2.getTTypeNameHV()):
 		new TTypeNameMUL1<U,N,V>(a, val2.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -545,7 +602,7 @@ TTypeName<U,N> operator*(const V& a, const TTypeName<U,N>& val2)
 template <typename U, int N, typename V>
 TTypeName<U,N> operator*(const TTypeName<U,N>& val1, const V& b)
 {
-	TTypeNameHV<U,N>* pHV=val1.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val1) ?
 		new TTypeNameMUL2<U,N,V>(val1.val()*b, val1.getTTypeNameHV(), b):
 		new TTypeNameMUL2<U,N,V>(val1.getTTypeNameHV(), b);
 	return TTypeName<U,N>(pHV);
@@ -590,6 +647,7 @@ struct TTypeNameDIV1 : public UnTTypeNameHV<U,N>
 		}
 		return this->length()=l;
 	}
+	unsigned long updateOperands(const unsigned long pass){return this->restamp(std::max(this->op()->update(pass),paramStamp(m_a)));}
 private:
 	void operator=(const TTypeNameDIV1<U,N,V>&){} // not allowed
 };
@@ -605,13 +663,14 @@ struct TTypeNameDIV2 : public UnTTypeNameHV<U,N>
 		for(unsigned int i=this->length();i<l;++i) this->val(i)=this->opVal(i)/m_b;
 		return this->length()=l;
 	}
+	unsigned long updateOperands(const unsigned long pass){return this->restamp(std::max(this->op()->update(pass),paramStamp(m_b)));}
 private:
 	void operator=(const TTypeNameDIV2<U,N,V>&){} // not allowed
 };
 template <typename U, int N>
 TTypeName<U,N> operator/(const TTypeName<U,N>& val1, const TTypeName<U,N>& val2)
 {
-	TTypeNameHV<U,N>* pHV=val1.length()>0 && val2.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val1) && eagerValue(val2) ?
 		new TTypeNameDIV<U,N>(val1.val()/val2.val(),val1.getTTypeNameHV(),val2.getTTypeNameHV()):
 		new TTypeNameDIV<U,N>(val1.getTTypeNameHV(),val2.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -620,7 +679,7 @@ TTypeName<U,N> operator/(const TTypeName<U,N>& val1, const TTypeName<U,N>& val2)
 template <typename U, int N>
 TTypeName<U,N> operator/(const typename Op<U>::Underlying& a, const TTypeName<U,N>& val2)
 {
-	TTypeNameHV<U,N>* pHV=val2.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val2) ?
 		new TTypeNameDIV1<U,N,typename Op<U>::Underlying>(a/val2.val(), a, val2.getTTypeNameHV()):
 		new TTypeNameDIV1<U,N,typename Op<U>::Underlying>(a, val2.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -628,7 +687,7 @@ TTypeName<U,N> operator/(const typename Op<U>::Underlying& a, const TTypeName<U,
 template <typename U, int N>
 TTypeName<U,N> operator/(const TTypeName<U,N>& val1, const typename Op<U>::Underlying& b)
 {
-	TTypeNameHV<U,N>* pHV=val1.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val1) ?
 		new TTypeNameDIV2<U,N,typename Op<U>::Underlying>(val1.val()/b, val1.getTTypeNameHV(), b):
 		new TTypeNameDIV2<U,N,typename Op<U>::Underlying>(val1.getTTypeNameHV(), b);
 	return TTypeName<U,N>(pHV);
@@ -636,7 +695,7 @@ TTypeName<U,N> operator/(const TTypeName<U,N>& val1, const typename Op<U>::Under
 template <typename U, int N>
 TTypeName<U,N> operator/(const typename Op<U>::Base& a, const TTypeName<U,N>& val2)
 {
-	TTypeNameHV<U,N>* pHV=val2.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val2) ?
 		new TTypeNameDIV1<U,N,typename Op<U>::Base>(a/val2.val(), a, val2.getTTypeNameHV()):
 		new TTypeNameDIV1<U,N,typename Op<U>::Base>(a, val2.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -644,7 +703,7 @@ TTypeName<U,N> operator/(const typename Op<U>::Base& a, const TTypeName<U,N>& va
 template <typename U, int N>
 TTypeName<U,N> operator/(const TTypeName<U,N>& val1, const typename Op<U>::Base& b)
 {
-	TTypeNameHV<U,N>* pHV=val1.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val1) ?
 		new TTypeNameDIV2<U,N,typename Op<U>::Base>(val1.val()/b, val1.getTTypeNameHV(), b):
 		new TTypeNameDIV2<U,N,typename Op<U>::Base>(val1.getTTypeNameHV(), b);
 	return TTypeName<U,N>(pHV);
@@ -653,7 +712,7 @@ TTypeName<U,N> operator/(const TTypeName<U,N>& val1, const typename Op<U>::Base&
 template <typename U, int N, typename V>
 TTypeName<U,N> operator/(const V& a, const TTypeName<U,N>& val2)
 {
-	TTypeNameHV<U,N>* pHV=val2.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val2) ?
 		new TTypeNameDIV1<U,N,V>(a/val2.val(), a, val2.getTTypeNameHV()):
 		new TTypeNameDIV1<U,N,V>(a, val2.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -661,7 +720,7 @@ TTypeName<U,N> operator/(const V& a, const TTypeName<U,N>& val2)
 template <typename U, int N, typename V>
 TTypeName<U,N> operator/(const TTypeName<U,N>& val1, const V& b)
 {
-	TTypeNameHV<U,N>* pHV=val1.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val1) ?
 		new TTypeNameDIV2<U,N,V>(val1.val()/b, val1.getTTypeNameHV(), b):
 		new TTypeNameDIV2<U,N,V>(val1.getTTypeNameHV(), b);
 	return TTypeName<U,N>(pHV);
@@ -669,8 +728,7 @@ TTypeName<U,N> operator/(const TTypeName<U,N>& val1, const V& b)
 
 // COMPOUND ASSIGNMENTS:
 
-template <typename U, int N> TTypeName<U,N>& TTypeName<U,N>::operator+=(const TTypeName<U,N>& val) { return (*this)=(*this)+val; }
-template <typename U, int N> TTypeName<U,N>& TTypeName<U,N>::operator-=(const TTypeName<U,N>& val) { return (*this)=(*this)-val; } 
+// (+= and -= on series are defined with the linear combinations below)
 template <typename U, int N> TTypeName<U,N>& TTypeName<U,N>::operator*=(const TTypeName<U,N>& val) { return (*this)=(*this)*val; }
 template <typename U, int N> TTypeName<U,N>& TTypeName<U,N>::operator/=(const TTypeName<U,N>& val) { return (*this)=(*this)/val; }
 template <typename U, int N> template <typename V> TTypeName<U,N>& TTypeName<U,N>::operator+=(const V& val) { return (*this)=(*this)+val; }
@@ -698,7 +756,7 @@ private:
 template <typename U, int N>
 TTypeName<U,N> operator-(const TTypeName<U,N>& val)
 {
-	TTypeNameHV<U,N>* pHV=val.length()>0 ? 
+	TTypeNameHV<U,N>* pHV=eagerValue(val) ? 
 		new TTypeNameUMINUS<U,N>(Op<U>::myNeg(val.val()),val.getTTypeNameHV()) : 
 		new TTypeNameUMINUS<U,N>(val.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -724,12 +782,280 @@ private:
 template <typename U, int N>
 TTypeName<U,N> operator+(const TTypeName<U,N>& val)
 {
-	TTypeNameHV<U,N>* pHV=val.length()>0 ? 
+	TTypeNameHV<U,N>* pHV=eagerValue(val) ? 
 		new TTypeNameUPLUS<U,N>(+val.val(),val.getTTypeNameHV()) : 
 		new TTypeNameUPLUS<U,N>(val.getTTypeNameHV());	
 	return TTypeName<U,N>(pHV);
 }
 
+// LINEAR COMBINATION:
+//
+// sum_j w[j]*x[j] in a single node, with the weights stored next to the
+// operand pointers, instead of chains of MUL1 and ADD nodes. + and - build
+// it when an operand is an expiring temporary (an rvalue held by nobody
+// else) that is a scaled series or another linear combination, whose
+// terms are then merged; a temporary product becomes a multiply-add.
+// += and -= extend an unshared combination in place, so a0*x0+...+an*xn
+// and accumulation loops like s+=w[i]*x[i] build one node with n terms.
+// Named operands are never merged: they stay in the graph, so they are
+// evaluated with the result and a product shared by several sums is
+// convolved once.
+
+template <typename U, int N>
+struct TTypeNameLINCOMB : public TTypeNameHV<U,N>
+{
+	std::vector<TTypeNameHV<U,N>*> m_ops;
+	std::vector<U> m_w;
+	TTypeNameLINCOMB():TTypeNameHV<U,N>()
+	{
+		// The empty sum:
+		if (!tDeferred()) { this->val(0)=Op<U>::myZero(); this->length()=1; }
+	}
+	virtual ~TTypeNameLINCOMB()
+	{
+		for(unsigned int j=0;j<m_ops.size();++j) m_ops[j]->decRef(m_ops[j]);
+	}
+	unsigned int terms() const { return (unsigned int)m_ops.size(); }
+	TTypeNameHV<U,N>* op(const unsigned int j) { return m_ops[j]; }
+	const U& weight(const unsigned int j) const { return m_w[j]; }
+	void add(const U& w, TTypeNameHV<U,N>* pOp)
+	{
+		pOp->incRef();
+		m_ops.push_back(pOp);
+		m_w.push_back(w);
+		// Keep order 0 if it can be updated, drop the higher orders:
+		if (this->length()>0 && pOp->length()>0 && !tDeferred())
+		{
+			Op<U>::myCadd(this->val(0),w*pOp->val(0));
+			this->length()=1;
+		}
+		else this->length()=0;
+	}
+	unsigned int eval(const unsigned int k)
+	{
+		unsigned int l=k+1;
+		for(unsigned int j=0;j<m_ops.size();++j) l=std::min(l,m_ops[j]->eval(k));
+		for(unsigned int i=this->length();i<l;++i)
+		{
+			U sum=Op<U>::myZero();
+			for(unsigned int j=0;j<m_ops.size();++j) Op<U>::myCadd(sum,m_w[j]*m_ops[j]->val(i));
+			this->val(i)=sum;
+		}
+		return this->length()=l;
+	}
+	void reset()
+	{
+		for(unsigned int j=0;j<m_ops.size();++j) m_ops[j]->reset();
+		TTypeNameHV<U,N>::reset();
+	}
+	unsigned long updateOperands(const unsigned long pass)
+	{
+		unsigned long s=0;
+		for(unsigned int j=0;j<m_ops.size();++j) s=std::max(s,m_ops[j]->update(pass));
+		return this->restamp(s);
+	}
+private:
+	void operator=(const TTypeNameLINCOMB<U,N>&){} // not allowed
+};
+
+// MULTIPLY-ADD: a*b+c in a single node.
+
+template <typename U, int N>
+struct TTypeNameFMA : public TTypeNameHV<U,N>
+{
+	TTypeNameHV<U,N>* m_pA;
+	TTypeNameHV<U,N>* m_pB;
+	TTypeNameHV<U,N>* m_pC;
+	TTypeNameFMA(TTypeNameHV<U,N>* pA, TTypeNameHV<U,N>* pB, TTypeNameHV<U,N>* pC):TTypeNameHV<U,N>(),m_pA(pA),m_pB(pB),m_pC(pC)
+	{
+		m_pA->incRef();m_pB->incRef();m_pC->incRef();
+		if (!tDeferred() && m_pA->length()>0 && m_pB->length()>0 && m_pC->length()>0)
+		{
+			this->val(0)=m_pA->val(0)*m_pB->val(0)+m_pC->val(0);
+			this->length()=1;
+		}
+	}
+	virtual ~TTypeNameFMA()
+	{
+		m_pA->decRef(m_pA);m_pB->decRef(m_pB);m_pC->decRef(m_pC);
+	}
+	TTypeNameHV<U,N>* opA() { return m_pA; }
+	TTypeNameHV<U,N>* opB() { return m_pB; }
+	TTypeNameHV<U,N>* opC() { return m_pC; }
+	unsigned int eval(const unsigned int k)
+	{
+		unsigned int l=std::min(std::min(m_pA->eval(k),m_pB->eval(k)),m_pC->eval(k));
+		for(unsigned int i=this->length();i<l;++i)
+		{
+			this->val(i)=m_pC->val(i);
+			for(unsigned int j=0;j<=i;++j) Op<U>::myCadd(this->val(i),m_pA->val(j)*m_pB->val(i-j));
+		}
+		return this->length()=l;
+	}
+	void reset(){m_pA->reset();m_pB->reset();m_pC->reset();TTypeNameHV<U,N>::reset();}
+	unsigned long updateOperands(const unsigned long pass)
+	{
+		unsigned long sA=m_pA->update(pass),sB=m_pB->update(pass),sC=m_pC->update(pass);
+		return this->restamp(std::max(std::max(sA,sB),sC));
+	}
+private:
+	void operator=(const TTypeNameFMA<U,N>&){} // not allowed
+};
+
+// Appends w*x to a linear combination, taking over the terms of x instead
+// when x is an expiring (take) and unshared scaled series, negation or
+// linear combination:
+template <typename U, int N>
+void lincombAppend(TTypeNameLINCOMB<U,N>* pLC, TTypeNameHV<U,N>* pHV, const U& w, const bool take)
+{
+	typedef typename Op<U>::Base Base;
+	if (take && pHV->refCount()==1)
+	{
+		if (TTypeNameLINCOMB<U,N>* p=dynamic_cast<TTypeNameLINCOMB<U,N>*>(pHV))
+		{
+			for(unsigned int j=0;j<p->terms();++j) pLC->add(w*p->weight(j),p->op(j));
+			return;
+		}
+		if (TTypeNameMUL1<U,N,U>* p=dynamic_cast<TTypeNameMUL1<U,N,U>*>(pHV)) { pLC->add(w*p->m_a,p->op()); return; }
+		if (TTypeNameMUL1<U,N,Base>* p=dynamic_cast<TTypeNameMUL1<U,N,Base>*>(pHV)) { pLC->add(w*p->m_a,p->op()); return; }
+		if (TTypeNameMUL2<U,N,U>* p=dynamic_cast<TTypeNameMUL2<U,N,U>*>(pHV)) { pLC->add(w*p->m_b,p->op()); return; }
+		if (TTypeNameMUL2<U,N,Base>* p=dynamic_cast<TTypeNameMUL2<U,N,Base>*>(pHV)) { pLC->add(w*p->m_b,p->op()); return; }
+		if (TTypeNameUMINUS<U,N>* p=dynamic_cast<TTypeNameUMINUS<U,N>*>(pHV)) { pLC->add(Op<U>::myNeg(w),p->op()); return; }
+	}
+	pLC->add(w,pHV);
+}
+template <typename U, int N>
+bool lincombTerm(TTypeNameHV<U,N>* pHV, const bool take)
+{
+	typedef typename Op<U>::Base Base;
+	return take && pHV->refCount()==1 && (dynamic_cast<TTypeNameLINCOMB<U,N>*>(pHV) ||
+		dynamic_cast<TTypeNameMUL1<U,N,U>*>(pHV) || dynamic_cast<TTypeNameMUL1<U,N,Base>*>(pHV) ||
+		dynamic_cast<TTypeNameMUL2<U,N,U>*>(pHV) || dynamic_cast<TTypeNameMUL2<U,N,Base>*>(pHV));
+}
+// val1+sign*val2 as a linear combination or multiply-add node merging the
+// expiring operands (take1, take2), or as a plain sum if nothing merges:
+template <typename U, int N>
+TTypeName<U,N> fuseSum(const TTypeName<U,N>& val1, const TTypeName<U,N>& val2, const bool negate, const bool take1, const bool take2)
+{
+	TTypeNameHV<U,N>* pOp1=val1.getTTypeNameHV();
+	TTypeNameHV<U,N>* pOp2=val2.getTTypeNameHV();
+	if (pOp1!=pOp2)
+	{
+		TTypeNameHV<U,N>* pHV=0;
+		TTypeNameMUL<U,N>* pMul;
+		if (negate) {}
+		else if (take2 && pOp2->refCount()==1 && (pMul=dynamic_cast<TTypeNameMUL<U,N>*>(pOp2)))
+			pHV=new TTypeNameFMA<U,N>(pMul->op1(),pMul->op2(),pOp1);
+		else if (take1 && pOp1->refCount()==1 && (pMul=dynamic_cast<TTypeNameMUL<U,N>*>(pOp1)))
+			pHV=new TTypeNameFMA<U,N>(pMul->op1(),pMul->op2(),pOp2);
+		if (pHV==0 && (lincombTerm(pOp1,take1) || lincombTerm(pOp2,take2)))
+		{
+			TTypeNameLINCOMB<U,N>* pLC=new TTypeNameLINCOMB<U,N>();
+			const U one(Op<U>::myOne());
+			lincombAppend(pLC,pOp1,one,take1);
+			lincombAppend(pLC,pOp2,negate?Op<U>::myNeg(one):one,take2);
+			pHV=pLC;
+		}
+		if (pHV) return TTypeName<U,N>(pHV);
+	}
+	return negate?val1-val2:val1+val2;
+}
+
+// sum_j w[j]*x[j] as one node:
+template <typename U, int N>
+TTypeName<U,N> lincomb(const U* w, const TTypeName<U,N>* x, const unsigned int n)
+{
+	TTypeNameLINCOMB<U,N>* pLC=new TTypeNameLINCOMB<U,N>();
+	for(unsigned int j=0;j<n;++j) pLC->add(w[j],x[j].getTTypeNameHV());
+	TTypeNameHV<U,N>* pHV=pLC;
+	return TTypeName<U,N>(pHV);
+}
+template <typename U, int N>
+TTypeName<U,N> fma(const TTypeName<U,N>& a, const TTypeName<U,N>& b, const TTypeName<U,N>& c)
+{
+	TTypeNameHV<U,N>* pHV=new TTypeNameFMA<U,N>(a.getTTypeNameHV(),b.getTTypeNameHV(),c.getTTypeNameHV());
+	return TTypeName<U,N>(pHV);
+}
+
+// Extends an unshared linear combination in place, merging val2 if it
+// is expiring (take2):
+template <typename U, int N>
+bool lincombExtend(const TTypeName<U,N>& val1, const TTypeName<U,N>& val2, const bool negate, const bool take2)
+{
+	TTypeNameHV<U,N>* pHV=val1.getTTypeNameHV();
+	if (pHV->refCount()!=1 || pHV==val2.getTTypeNameHV()) return false;
+	TTypeNameLINCOMB<U,N>* pLC=dynamic_cast<TTypeNameLINCOMB<U,N>*>(pHV);
+	if (pLC==0) return false;
+	const U one(Op<U>::myOne());
+	lincombAppend(pLC,val2.getTTypeNameHV(),negate?Op<U>::myNeg(one):one,take2);
+	return true;
+}
+// Hands the graph of an expiring temporary over to the result, so the
+// combination stays unshared along a chain like a*x+b*y+c*z; the
+// temporary is left with a fresh empty node of its own.
+template <typename U, int N>
+TTypeName<U,N> lincombTakeOver(TTypeName<U,N>& val)
+{
+	TTypeName<U,N> res(val.getTTypeNameHV());
+	val=TTypeName<U,N>();
+	return res;
+}
+template <typename U, int N>
+TTypeName<U,N> operator+(TTypeName<U,N>&& val1, const TTypeName<U,N>& val2)
+{
+	if (lincombExtend(val1,val2,false,false)) return lincombTakeOver(val1);
+	return fuseSum(val1,val2,false,true,false);
+}
+template <typename U, int N>
+TTypeName<U,N> operator+(const TTypeName<U,N>& val1, TTypeName<U,N>&& val2)
+{
+	if (lincombExtend(val2,val1,false,false)) return lincombTakeOver(val2);
+	return fuseSum(val1,val2,false,false,true);
+}
+template <typename U, int N>
+TTypeName<U,N> operator+(TTypeName<U,N>&& val1, TTypeName<U,N>&& val2)
+{
+	if (lincombExtend(val1,val2,false,true)) return lincombTakeOver(val1);
+	return fuseSum(val1,val2,false,true,true);
+}
+template <typename U, int N>
+TTypeName<U,N> operator-(TTypeName<U,N>&& val1, const TTypeName<U,N>& val2)
+{
+	if (lincombExtend(val1,val2,true,false)) return lincombTakeOver(val1);
+	return fuseSum(val1,val2,true,true,false);
+}
+template <typename U, int N>
+TTypeName<U,N> operator-(const TTypeName<U,N>& val1, TTypeName<U,N>&& val2)
+{
+	return fuseSum(val1,val2,true,false,true);
+}
+template <typename U, int N>
+TTypeName<U,N> operator-(TTypeName<U,N>&& val1, TTypeName<U,N>&& val2)
+{
+	if (lincombExtend(val1,val2,true,true)) return lincombTakeOver(val1);
+	return fuseSum(val1,val2,true,true,true);
+}
+template <typename U, int N> TTypeName<U,N>& TTypeName<U,N>::operator+=(const TTypeName<U,N>& val)
+{
+	if (lincombExtend(*this,val,false,false)) return *this;
+	return (*this)=(*this)+val;
+}
+template <typename U, int N> TTypeName<U,N>& TTypeName<U,N>::operator-=(const TTypeName<U,N>& val)
+{
+	if (lincombExtend(*this,val,true,false)) return *this;
+	return (*this)=(*this)-val;
+}
+template <typename U, int N> TTypeName<U,N>& TTypeName<U,N>::operator+=(TTypeName<U,N>&& val)
+{
+	if (lincombExtend(*this,val,false,true)) return *this;
+	return (*this)=fuseSum(*this,val,false,false,true);
+}
+template <typename U, int N> TTypeName<U,N>& TTypeName<U,N>::operator-=(TTypeName<U,N>&& val)
+{
+	if (lincombExtend(*this,val,true,true)) return *this;
+	return (*this)=fuseSum(*this,val,true,false,true);
+}
+
 // POWER
 
 template <typename U, int N>
@@ -778,7 +1104,7 @@ template <typename U, int N>
 TTypeName<U,N> pow(const TTypeName<U,N>& val1, const TTypeName<U,N>& val2)
 {
 	TTypeName<U,N> tmp(exp(val2*log(val1)));
-	TTypeNameHV<U,N>* pHV=val1.length()>0 && val2.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val1) && eagerValue(val2) ?
 		new TTypeNamePOW<U,N>(Op<U>::myPow(val1.val(),val2.val()),tmp.getTTypeNameHV()) :
 		new TTypeNamePOW<U,N>(tmp.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -788,7 +1114,7 @@ template <typename U, int N>
 TTypeName<U,N> pow(const typename Op<U>::Underlying& a, const TTypeName<U,N>& val2)
 {
 	TTypeName<U,N> tmp(exp(val2*Op<U>::myLog(a)));
-	TTypeNameHV<U,N>* pHV=val2.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val2) ?
 		new TTypeNamePOW1<U,N,typename Op<U>::Underlying>(Op<U>::myPow(a,val2.val()), tmp.getTTypeNameHV()) :
 		new TTypeNamePOW1<U,N,typename Op<U>::Underlying>(tmp.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -797,7 +1123,7 @@ template <typename U, int N>
 TTypeName<U,N> pow(const TTypeName<U,N>& val1, const typename Op<U>::Underlying& b)
 {
 	TTypeName<U,N> tmp(exp(b*log(val1)));
-	TTypeNameHV<U,N>* pHV=val1.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val1) ?
 		new TTypeNamePOW2<U,N,typename Op<U>::Underlying>(Op<U>::myPow(val1.val(),b), tmp.getTTypeNameHV()) :
 		new TTypeNamePOW2<U,N,typename Op<U>::Underlying>(tmp.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -806,7 +1132,7 @@ template <typename U, int N>
 TTypeName<U,N> pow(const typename Op<U>::Base& a, const TTypeName<U,N>& val2)
 {
 	TTypeName<U,N> tmp(exp(val2*Op<typename Op<U>::Base>::myLog(a)));
-	TTypeNameHV<U,N>* pHV=val2.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val2) ?
 		new TTypeNamePOW1<U,N,typename Op<U>::Base>(Op<U>::myPow(a,val2.val()), tmp.getTTypeNameHV()) :
 		new TTypeNamePOW1<U,N,typename Op<U>::Base>(tmp.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -815,7 +1141,7 @@ template <typename U, int N>
 TTypeName<U,N> pow(const TTypeName<U,N>& val1, const typename Op<U>::Base& b)
 {
 	TTypeName<U,N> tmp(exp(b*log(val1)));
-	TTypeNameHV<U,N>* pHV=val1.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val1) ?
 		new TTypeNamePOW2<U,N,typename Op<U>::Base>(Op<U>::myPow(val1.val(),b), tmp.getTTypeNameHV()) :
 		new TTypeNamePOW2<U,N,typename Op<U>::Base>(tmp.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -825,7 +1151,7 @@ template <typename U, int N, typename V>
 TTypeName<U,N> pow(const V& a, const TTypeName<U,N>& val2)
 {
 	TTypeName<U,N> tmp(exp(val2*Op<V>::myLog(a)));
-	TTypeNameHV<U,N>* pHV=val2.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val2) ?
 		new TTypeNamePOW1<U,N,V>(Op<U>::myPow(a,val2.val()), tmp.getTTypeNameHV()) :
 		new TTypeNamePOW1<U,N,V>(tmp.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -834,12 +1160,40 @@ template <typename U, int N, typename V>
 TTypeName<U,N> pow(const TTypeName<U,N>& val1, const V& b)
 {
 	TTypeName<U,N> tmp(exp(b*log(val1)));
-	TTypeNameHV<U,N>* pHV=val1.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val1) ?
 		new TTypeNamePOW2<U,N,V>(Op<U>::myPow(val1.val(),b), tmp.getTTypeNameHV()) :
 		new TTypeNamePOW2<U,N,V>(tmp.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
 }
 
+// log of a parameter slot, as a constant series that follows set():
+template <typename U, int N>
+struct TTypeNameLOGPARAM : public TTypeNameHV<U,N>
+{
+	const Param<U> m_a;
+	TTypeNameLOGPARAM(const Param<U>& a):TTypeNameHV<U,N>(),m_a(a){}
+	unsigned int eval(const unsigned int k)
+	{
+		if (0==this->length()) { this->val(0)=Op<U>::myLog(m_a.val()); this->length()=1; }
+		return k+1;
+	}
+	unsigned long updateOperands(const unsigned long){return this->restamp(paramStamp(m_a));}
+private:
+	void operator=(const TTypeNameLOGPARAM<U,N>&){} // not allowed
+};
+// A parameter base is read through log(a) on every update, where the
+// generic version above would fold log(a) into a constant.
+template <typename U, int N>
+TTypeName<U,N> pow(const Param<U>& a, const TTypeName<U,N>& val2)
+{
+	TTypeName<U,N> loga(static_cast<TTypeNameHV<U,N>*>(new TTypeNameLOGPARAM<U,N>(a)));
+	TTypeName<U,N> tmp(exp(val2*loga));
+	TTypeNameHV<U,N>* pHV=eagerValue(val2) ?
+		new TTypeNamePOW<U,N>(Op<U>::myPow(a.val(),val2.val()),tmp.getTTypeNameHV()) :
+		new TTypeNamePOW<U,N>(tmp.getTTypeNameHV());
+	return TTypeName<U,N>(pHV);
+}
+
 // SQR
 
 template <typename U, int N>
@@ -867,7 +1221,7 @@ private:
 template <typename U, int N>
 TTypeName<U,N> sqr(const TTypeName<U,N>& val)
 { 
-	TTypeNameHV<U,N>* pHV=val.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val) ?
 		new TTypeNameSQR<U,N>(Op<U>::mySqr(val.val()), val.getTTypeNameHV()) :
 		new TTypeNameSQR<U,N>(val.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -901,7 +1255,7 @@ private:
 template <typename U, int N>
 TTypeName<U,N> sqrt(const TTypeName<U,N>& val)
 {
-	TTypeNameHV<U,N>* pHV=val.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val) ?
 		new TTypeNameSQRT<U,N>(Op<U>::mySqrt(val.val()), val.getTTypeNameHV()):
 		new TTypeNameSQRT<U,N>(val.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -933,7 +1287,7 @@ private:
 template <typename U, int N>
 TTypeName<U,N> exp(const TTypeName<U,N>& val)
 {
-	TTypeNameHV<U,N>* pHV=val.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val) ?
 		new TTypeNameEXP<U,N>(Op<U>::myExp(val.val()), val.getTTypeNameHV()):
 		new TTypeNameEXP<U,N>(val.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -966,7 +1320,7 @@ private:
 template <typename U, int N>
 TTypeName<U,N> log(const TTypeName<U,N>& val)
 {
-	TTypeNameHV<U,N>* pHV=val.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val) ?
 		new TTypeNameLOG<U,N>(Op<U>::myLog(val.val()), val.getTTypeNameHV()):
 		new TTypeNameLOG<U,N>(val.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -1008,7 +1362,7 @@ private:
 template <typename U, int N>
 TTypeName<U,N> sin(const TTypeName<U,N>& val)
 {
-	TTypeNameHV<U,N>* pHV=val.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val) ?
 		new TTypeNameSIN<U,N>(Op<U>::mySin(val.val()), val.getTTypeNameHV()):
 		new TTypeNameSIN<U,N>(val.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -1050,7 +1404,7 @@ private:
 template <typename U, int N>
 TTypeName<U,N> cos(const TTypeName<U,N>& val)
 {
-	TTypeNameHV<U,N>* pHV=val.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val) ?
 		new TTypeNameCOS<U,N>(Op<U>::myCos(val.val()), val.getTTypeNameHV()):
 		new TTypeNameCOS<U,N>(val.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -1083,7 +1437,7 @@ template <typename U, int N>
 TTypeName<U,N> tan(const TTypeName<U,N>& val)
 { 
 	TTypeName<U,N> tmp(sqr(cos(val)));
-	TTypeNameHV<U,N>* pHV=val.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val) ?
 		new TTypeNameTAN<U,N>(Op<U>::myTan(val.val()), val.getTTypeNameHV(), tmp.getTTypeNameHV()):
 		new TTypeNameTAN<U,N>(val.getTTypeNameHV(), tmp.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -1116,7 +1470,7 @@ template <typename U, int N>
 TTypeName<U,N> asin(const TTypeName<U,N>& val)
 {
 	TTypeName<U,N> tmp(sqrt(Op<U>::myOne()-sqr(val)));
-	TTypeNameHV<U,N>* pHV=val.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val) ?
 		new TTypeNameASIN<U,N>(Op<U>::myAsin(val.val()), val.getTTypeNameHV(), tmp.getTTypeNameHV()):
 		new TTypeNameASIN<U,N>(val.getTTypeNameHV(), tmp.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -1149,7 +1503,7 @@ template <typename U, int N>
 TTypeName<U,N> acos(const TTypeName<U,N>& val)
 {
 	TTypeName<U,N> tmp(sqrt(Op<U>::myOne()-sqr(val)));
-	TTypeNameHV<U,N>* pHV=val.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val) ?
 		new TTypeNameACOS<U,N>(Op<U>::myAcos(val.val()), val.getTTypeNameHV(), tmp.getTTypeNameHV()):
 		new TTypeNameACOS<U,N>(val.getTTypeNameHV(), tmp.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -1182,7 +1536,7 @@ template <typename U, int N>
 TTypeName<U,N> atan(const TTypeName<U,N>& val)
 { 
 	TTypeName<U,N> tmp(Op<U>::myOne()+sqr(val));
-	TTypeNameHV<U,N>* pHV=val.length()>0 ?
+	TTypeNameHV<U,N>* pHV=eagerValue(val) ?
 		new TTypeNameATAN<U,N>(Op<U>::myAtan(val.val()), val.getTTypeNameHV(), tmp.getTTypeNameHV()):
 		new TTypeNameATAN<U,N>(val.getTTypeNameHV(), tmp.getTTypeNameHV());
 	return TTypeName<U,N>(pHV);
@@ -1227,7 +1581,7 @@ TTypeName<U,N> diff(const TTypeName<U,N>& val, const int b)
 // diff(TaylorOp,i).
 // THIS FUNCTION EVALUATES THE 0.ORDER COEFFICIENT
 	TTypeNameHV<U,N>* pHV=0;
-	if (val.length()>b)
+	if (!tDeferred() && val.length()>b)
 	{
 		unsigned int fact=1;
 		for(unsigned int j=b;j>1;--j){ fact*=j; }
@@ -1240,6 +1594,107 @@ TTypeName<U,N> diff(const TTypeName<U,N>& val, const int b)
 	return TTypeName<U,N>(pHV);
 }
 
+// ODE state variable: x with x'=f(x), x(0) given.
+//
+// The node is bound to the recorded right-hand side f, which in turn
+// refers back to the node, and eval(k) runs the IVP recurrence
+//   f.eval(i); x[i+1]=f[i]/(i+1)
+// itself. Evaluating any output of the system to order k thereby
+// computes all state and field coefficients to that order. The binding
+// is not reference counted (it would form a cycle), so f must be kept
+// alive for as long as the node is evaluated. reset() keeps the initial
+// value and also resets f, as does update() when a Param used in f has
+// changed.
+
+template <typename U, int N>
+struct TTypeNameODE : public TTypeNameHV<U,N>
+{
+	TTypeNameHV<U,N>* m_pF; // not owned
+	bool m_resetting;
+	template <typename V> explicit TTypeNameODE(const V& x0):TTypeNameHV<U,N>(x0),m_pF(0),m_resetting(false){}
+	void bind(TTypeNameHV<U,N>* pF){ m_pF=pF; }
+	TTypeNameHV<U,N>* rhs() { return m_pF; }
+	unsigned int eval(const unsigned int k)
+	{
+		USER_ASSERT(m_pF!=0,"ODE variable has no right-hand side")
+		USER_ASSERT(k<N,"Order "<<k<<" out of bounds [0,"<<N-1<<"]")
+		for(unsigned int i=this->length();i<=k;i=this->length())
+		{
+			// f.eval may re-enter this node, which is then valid to order i-1:
+			m_pF->eval(i-1);
+			this->val(i)=m_pF->val(i-1)/Op<U>::myInteger(i);
+			this->length()=i+1;
+		}
+		return this->length();
+	}
+	void reset()
+	{
+		if (m_resetting) return;
+		m_resetting=true;
+		this->length()=1;
+		if (m_pF) m_pF->reset();
+		m_resetting=false;
+	}
+	unsigned long updateOperands(const unsigned long pass)
+	{
+		if (m_pF==0) return 0;
+		unsigned long s=m_pF->update(pass); // the pass mark stops f at this node
+		// All higher coefficients of the loop depend on the change:
+		if (s>this->stamp()) { this->restamp(s); reset(); }
+		return this->stamp();
+	}
+private:
+	void operator=(const TTypeNameODE<U,N>&){} // not allowed
+};
+template <typename U, int N=MaxLength>
+TTypeName<U,N> odeVariable(const U& x0)
+{
+	TTypeNameHV<U,N>* pHV=new TTypeNameODE<U,N>(x0);
+	return TTypeName<U,N>(pHV);
+}
+// Binds the state variable x (created by odeVariable) to its right-hand side.
+template <typename U, int N>
+void odeBind(TTypeName<U,N>& x, const TTypeName<U,N>& f)
+{
+	TTypeNameODE<U,N>* pODE=dynamic_cast<TTypeNameODE<U,N>*>(x.getTTypeNameHV());
+	USER_ASSERT(pODE!=0,"Not an ODE variable")
+	pODE->bind(f.getTTypeNameHV());
+}
+
+// Evaluates the count outputs one order at a time, all of them to order
+// k before any to k+1, and stops at the first k>=1 where the truncation
+// error of the Taylor polynomials at step h, estimated by the last two
+// terms max(|c[k-1]|*h^(k-1),|c[k]|*h^k) over all outputs, is at most
+// tol. Returns the order reached, maxOrder if the estimate never got
+// below tol. Two terms are used so that series with every other
+// coefficient zero (sin, cos) do not stop early.
+template <typename U, int N>
+unsigned int evalToTolerance(TTypeName<U,N>* outputs, const unsigned int count, const U& h, const U& tol, const unsigned int maxOrder=N-1)
+{
+	USER_ASSERT(maxOrder<N,"Order "<<maxOrder<<" out of bounds [0,"<<N-1<<"]")
+	const U zero=Op<U>::myZero();
+	U hk=Op<U>::myOne(), last=zero;
+	for(unsigned int k=0;k<=maxOrder;++k)
+	{
+		U term=zero;
+		for(unsigned int j=0;j<count;++j)
+		{
+			outputs[j].eval(k);
+			U t=outputs[j][k]*hk;
+			if (Op<U>::myLt(t,zero)) t=Op<U>::myNeg(t);
+			if (Op<U>::myGt(t,term)) term=t;
+		}
+		if (k>0 && Op<U>::myLe(term,tol) && Op<U>::myLe(last,tol)) return k;
+		last=term;
+		hk=hk*h;
+	}
+	return maxOrder;
+}
+template <typename U, int N>
+unsigned int evalToTolerance(TTypeName<U,N>& output, const U& h, const U& tol, const unsigned int maxOrder=N-1)
+{
+	return evalToTolerance(&output,1,h,tol,maxOrder);
+}
 
 template <typename U, int N> struct Op< TTypeName<U,N> >
 {
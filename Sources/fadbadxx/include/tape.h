@@ -0,0 +1,500 @@
+//
+//  tape.h
+//  FADBADSwift
+//
+
+#ifndef _TAPE_H
+#define _TAPE_H
+
+#include <vector>
+#include <algorithm>
+
+#include "fadiff.h"
+
+namespace fadbad
+{
+
+// Linear operation tape.
+//
+// A computation written as a template over the scalar type is recorded
+// once on TapeVar into a flat array of operations; each operation writes
+// one value slot, numbered by its position, and reads earlier slots.
+// Replays then run forward and reverse sweeps over that array with no
+// graph nodes, reference counts or allocation: gradients on double,
+// Jacobian-vector products and Hessian-vector products (forward over
+// reverse) on F<double,1>. The sweeps are templates over the scalar
+// type, so any type with an Op specialization can be pushed through a
+// recording.
+//
+// Control flow is fixed at recording time: branches on values take the
+// direction they took for the recording point.
+
+enum TapeCode
+{
+	TapeINPUT, TapeCONST,
+	TapeADD, TapeSUB, TapeMUL, TapeDIV, TapeNEG,
+	TapeADDC, TapeCSUB, TapeMULC, TapeDIVC, TapeCDIV, // with a constant c
+	TapeSQR, TapePOWC, TapePOW, TapeSQRT, TapeEXP, TapeLOG,
+	TapeSIN, TapeCOS, TapeTAN, TapeASIN, TapeACOS, TapeATAN,
+	TapeCodes
+};
+
+// Operation writing slot i: code, first operand a, and either the
+// second operand or the index of the constant in b.
+struct TapeOp
+{
+	unsigned int code;
+	unsigned int a, b;
+};
+
+inline bool tapeHasConstant(const unsigned int code)
+{
+	return code==TapeCONST || (code>=TapeADDC && code<=TapeCDIV) || code==TapePOWC;
+}
+inline bool tapeIsBinary(const unsigned int code)
+{
+	return (code>=TapeADD && code<=TapeDIV) || code==TapePOW;
+}
+
+class Tape;
+
+// Tape being recorded on by this thread:
+inline Tape*& tapeRecording()
+{
+	static thread_local Tape* pTape=0;
+	return pTape;
+}
+
+class Tape
+{
+	std::vector<TapeOp> m_ops;
+	std::vector<double> m_consts;
+	std::vector<unsigned int> m_inputs, m_outputs;
+	// sweep buffers, sized once per recording:
+	std::vector<double> m_v, m_w;
+	std::vector<float> m_wf;
+	std::vector< FTypeName<double,1> > m_tv, m_tw;
+public:
+	unsigned int size() const { return (unsigned int)m_ops.size(); }
+	unsigned int inputs() const { return (unsigned int)m_inputs.size(); }
+	unsigned int outputs() const { return (unsigned int)m_outputs.size(); }
+	const TapeOp& op(const unsigned int i) const { return m_ops[i]; }
+	double constant(const unsigned int k) const { return m_consts[k]; }
+	unsigned int input(const unsigned int j) const { return m_inputs[j]; }
+	unsigned int output(const unsigned int j) const { return m_outputs[j]; }
+
+	// Recording:
+	void clear()
+	{
+		m_ops.clear();
+		m_consts.clear();
+		m_inputs.clear();
+		m_outputs.clear();
+	}
+	unsigned int push(const unsigned int code, const unsigned int a, const unsigned int b)
+	{
+		TapeOp op={code,a,b};
+		m_ops.push_back(op);
+		return size()-1;
+	}
+	unsigned int pushConstant(const unsigned int code, const unsigned int a, const double c)
+	{
+		m_consts.push_back(c);
+		return push(code,a,(unsigned int)m_consts.size()-1);
+	}
+	unsigned int addInput()
+	{
+		m_inputs.push_back(push(TapeINPUT,0,0));
+		return m_inputs.back();
+	}
+	void addOutput(const unsigned int slot) { m_outputs.push_back(slot); }
+	// Sizes the sweep buffers; record does this, code building a tape
+	// with push must call it before replaying.
+	void prepare()
+	{
+		m_v.assign(size(),0.0);
+		m_w.assign(size(),0.0);
+		m_wf.clear();
+		m_tv.clear();
+		m_tw.clear();
+	}
+	// Sizes the F<double,1> buffers of jvp, and of hessVec, ahead of the
+	// first product; the drivers call these from their constructors.
+	void prepareJvp() { if (m_tv.size()!=size()) m_tv.resize(size()); }
+	void prepareHessVec() { prepareJvp(); if (m_tw.size()!=size()) m_tw.resize(size()); }
+
+	// Records y=f(x) for a scalar objective f(const V* x).
+	template <class FUN> void record(FUN f, const double* x, const unsigned int n);
+	// Records f(x,y) writing m outputs.
+	template <class FUN> void record(FUN f, const double* x, const unsigned int n, const unsigned int m);
+
+	// Value of operation op (other than TapeINPUT) on slot values v:
+	template <class S> static S apply(const TapeOp& op, const S* v, const double* c);
+	// Replay, on slot arrays v (values) and w (adjoints) of size(). The
+	// adjoints may be of a narrower type W than the values (float
+	// adjoints over double values): the local partials are computed on
+	// S and rounded once when added to w.
+	template <class S> void forward(S* v) const;
+	template <class S, class W> void reverse(const S* v, W* w) const;
+	// Local partial derivatives at slot values v: d[2*i] of slot i by
+	// operand a and d[2*i+1] by operand b.
+	void partials(const double* v, double* d) const;
+
+	// Outputs at x.
+	void evaluate(const double* x, double* y)
+	{
+		for(unsigned int j=0;j<inputs();++j) m_v[m_inputs[j]]=x[j];
+		forward(&m_v[0]);
+		for(unsigned int j=0;j<outputs();++j) y[j]=m_v[m_outputs[j]];
+	}
+	double value(const double* x)
+	{
+		for(unsigned int j=0;j<inputs();++j) m_v[m_inputs[j]]=x[j];
+		forward(&m_v[0]);
+		return m_v[m_outputs[0]];
+	}
+	// Value of the first output at x and its gradient g.
+	double gradient(const double* x, double* g)
+	{
+		for(unsigned int j=0;j<inputs();++j) m_v[m_inputs[j]]=x[j];
+		forward(&m_v[0]);
+		std::fill(m_w.begin(),m_w.end(),0.0);
+		m_w[m_outputs[0]]=1.0;
+		reverse(&m_v[0],&m_w[0]);
+		for(unsigned int j=0;j<inputs();++j) g[j]=m_w[m_inputs[j]];
+		return m_v[m_outputs[0]];
+	}
+	// The same with float adjoints over double values: half the memory
+	// traffic of the reverse sweep, g to about float precision.
+	double gradient(const double* x, float* g)
+	{
+		for(unsigned int j=0;j<inputs();++j) m_v[m_inputs[j]]=x[j];
+		forward(&m_v[0]);
+		m_wf.assign(size(),0.0f);
+		m_wf[m_outputs[0]]=1.0f;
+		reverse(&m_v[0],&m_wf[0]);
+		for(unsigned int j=0;j<inputs();++j) g[j]=m_wf[m_inputs[j]];
+		return m_v[m_outputs[0]];
+	}
+	// Outputs y at x and the Jacobian-vector product jv=J*dir, by one
+	// forward sweep in direction dir.
+	void jvp(const double* x, const double* dir, double* y, double* jv)
+	{
+		prepareJvp();
+		for(unsigned int j=0;j<inputs();++j)
+		{
+			FTypeName<double,1>& xj=m_tv[m_inputs[j]];
+			xj=x[j];
+			xj.diff(0)=dir[j];
+		}
+		forward(&m_tv[0]);
+		for(unsigned int j=0;j<outputs();++j)
+		{
+			const FTypeName<double,1>& yj=m_tv[m_outputs[j]];
+			y[j]=yj.val();
+			jv[j]=yj.deriv(0);
+		}
+	}
+	// Gradient g and Hessian-vector product hv=H*dir of the first output,
+	// by a reverse sweep over a forward sweep in direction dir.
+	double hessVec(const double* x, const double* dir, double* g, double* hv)
+	{
+		prepareHessVec();
+		for(unsigned int j=0;j<inputs();++j)
+		{
+			FTypeName<double,1>& xj=m_tv[m_inputs[j]];
+			xj=x[j];
+			xj.diff(0)=dir[j];
+		}
+		forward(&m_tv[0]);
+		for(unsigned int i=0;i<size();++i) m_tw[i]=0.0;
+		m_tw[m_outputs[0]]=1.0;
+		reverse(&m_tv[0],&m_tw[0]);
+		for(unsigned int j=0;j<inputs();++j)
+		{
+			const FTypeName<double,1>& wj=m_tw[m_inputs[j]];
+			g[j]=wj.val();
+			hv[j]=wj.deriv(0);
+		}
+		return m_tv[m_outputs[0]].val();
+	}
+};
+
+// Recording variable: the slot holding its value on the tape being
+// recorded, and the value itself so that the recorded code can branch.
+// Plain constants get a slot only when an operation needs one.
+class TapeVar
+{
+	mutable unsigned int m_slot;
+	double m_val;
+public:
+	static const unsigned int NoSlot=~0u;
+	TapeVar():m_slot(NoSlot),m_val(0){}
+	TapeVar(const double val):m_slot(NoSlot),m_val(val){}
+	TapeVar(const unsigned int slot, const double val):m_slot(slot),m_val(val){}
+	const double& val() const { return m_val; }
+	unsigned int slot() const
+	{
+		if (m_slot==NoSlot) m_slot=tapeRecording()->pushConstant(TapeCONST,0,m_val);
+		return m_slot;
+	}
+	TapeVar& operator+=(const TapeVar& b);
+	TapeVar& operator-=(const TapeVar& b);
+	TapeVar& operator*=(const TapeVar& b);
+	TapeVar& operator/=(const TapeVar& b);
+};
+
+inline TapeVar tapeUnary(const unsigned int code, const TapeVar& a, const double val)
+{
+	return TapeVar(tapeRecording()->push(code,a.slot(),0),val);
+}
+inline TapeVar tapeBinary(const unsigned int code, const TapeVar& a, const TapeVar& b, const double val)
+{
+	return TapeVar(tapeRecording()->push(code,a.slot(),b.slot()),val);
+}
+inline TapeVar tapeConstant(const unsigned int code, const TapeVar& a, const double c, const double val)
+{
+	return TapeVar(tapeRecording()->pushConstant(code,a.slot(),c),val);
+}
+
+inline TapeVar operator+(const TapeVar& a, const TapeVar& b) { return tapeBinary(TapeADD,a,b,a.val()+b.val()); }
+inline TapeVar operator-(const TapeVar& a, const TapeVar& b) { return tapeBinary(TapeSUB,a,b,a.val()-b.val()); }
+inline TapeVar operator*(const TapeVar& a, const TapeVar& b) { return tapeBinary(TapeMUL,a,b,a.val()*b.val()); }
+inline TapeVar operator/(const TapeVar& a, const TapeVar& b) { return tapeBinary(TapeDIV,a,b,a.val()/b.val()); }
+inline TapeVar operator+(const TapeVar& a, const double c) { return tapeConstant(TapeADDC,a,c,a.val()+c); }
+inline TapeVar operator+(const double c, const TapeVar& b) { return tapeConstant(TapeADDC,b,c,c+b.val()); }
+inline TapeVar operator-(const TapeVar& a, const double c) { return tapeConstant(TapeADDC,a,-c,a.val()-c); }
+inline TapeVar operator-(const double c, const TapeVar& b) { return tapeConstant(TapeCSUB,b,c,c-b.val()); }
+inline TapeVar operator*(const TapeVar& a, const double c) { return tapeConstant(TapeMULC,a,c,a.val()*c); }
+inline TapeVar operator*(const double c, const TapeVar& b) { return tapeConstant(TapeMULC,b,c,c*b.val()); }
+inline TapeVar operator/(const TapeVar& a, const double c) { return tapeConstant(TapeDIVC,a,c,a.val()/c); }
+inline TapeVar operator/(const double c, const TapeVar& b) { return tapeConstant(TapeCDIV,b,c,c/b.val()); }
+inline TapeVar operator-(const TapeVar& a) { return tapeUnary(TapeNEG,a,-a.val()); }
+inline TapeVar operator+(const TapeVar& a) { return a; }
+
+inline TapeVar& TapeVar::operator+=(const TapeVar& b) { return (*this)=(*this)+b; }
+inline TapeVar& TapeVar::operator-=(const TapeVar& b) { return (*this)=(*this)-b; }
+inline TapeVar& TapeVar::operator*=(const TapeVar& b) { return (*this)=(*this)*b; }
+inline TapeVar& TapeVar::operator/=(const TapeVar& b) { return (*this)=(*this)/b; }
+
+inline TapeVar sqr(const TapeVar& a) { return tapeUnary(TapeSQR,a,a.val()*a.val()); }
+inline TapeVar pow(const TapeVar& a, const double c) { return tapeConstant(TapePOWC,a,c,::pow(a.val(),c)); }
+inline TapeVar pow(const TapeVar& a, const int c) { return pow(a,double(c)); }
+inline TapeVar pow(const TapeVar& a, const TapeVar& b) { return tapeBinary(TapePOW,a,b,::pow(a.val(),b.val())); }
+inline TapeVar pow(const double c, const TapeVar& b) { return pow(TapeVar(c),b); }
+inline TapeVar sqrt(const TapeVar& a) { return tapeUnary(TapeSQRT,a,::sqrt(a.val())); }
+inline TapeVar exp(const TapeVar& a) { return tapeUnary(TapeEXP,a,::exp(a.val())); }
+inline TapeVar log(const TapeVar& a) { return tapeUnary(TapeLOG,a,::log(a.val())); }
+inline TapeVar sin(const TapeVar& a) { return tapeUnary(TapeSIN,a,::sin(a.val())); }
+inline TapeVar cos(const TapeVar& a) { return tapeUnary(TapeCOS,a,::cos(a.val())); }
+inline TapeVar tan(const TapeVar& a) { return tapeUnary(TapeTAN,a,::tan(a.val())); }
+inline TapeVar asin(const TapeVar& a) { return tapeUnary(TapeASIN,a,::asin(a.val())); }
+inline TapeVar acos(const TapeVar& a) { return tapeUnary(TapeACOS,a,::acos(a.val())); }
+inline TapeVar atan(const TapeVar& a) { return tapeUnary(TapeATAN,a,::atan(a.val())); }
+
+inline bool operator==(const TapeVar& a, const TapeVar& b) { return a.val()==b.val(); }
+inline bool operator!=(const TapeVar& a, const TapeVar& b) { return a.val()!=b.val(); }
+inline bool operator<(const TapeVar& a, const TapeVar& b) { return a.val()<b.val(); }
+inline bool operator<=(const TapeVar& a, const TapeVar& b) { return a.val()<=b.val(); }
+inline bool operator>(const TapeVar& a, const TapeVar& b) { return a.val()>b.val(); }
+inline bool operator>=(const TapeVar& a, const TapeVar& b) { return a.val()>=b.val(); }
+
+template <> struct Op<TapeVar>
+{
+	typedef TapeVar T;
+	typedef double Base;
+	static Base myInteger(const int i) { return Base(i); }
+	static Base myZero() { return myInteger(0); }
+	static Base myOne() { return myInteger(1);}
+	static Base myTwo() { return myInteger(2); }
+	static Base myPI() { return Op<Base>::myPI(); }
+	static T myPos(const T& x) { return +x; }
+	static T myNeg(const T& x) { return -x; }
+	template <typename V> static T& myCadd(T& x, const V& y) { return x+=y; }
+	template <typename V> static T& myCsub(T& x, const V& y) { return x-=y; }
+	template <typename V> static T& myCmul(T& x, const V& y) { return x*=y; }
+	template <typename V> static T& myCdiv(T& x, const V& y) { return x/=y; }
+	static T myInv(const T& x) { return myOne()/x; }
+	static T mySqr(const T& x) { return fadbad::sqr(x); }
+	template <typename X, typename Y>
+	static T myPow(const X& x, const Y& y) { return fadbad::pow(x,y); }
+	static T mySqrt(const T& x) { return fadbad::sqrt(x); }
+	static T myLog(const T& x) { return fadbad::log(x); }
+	static T myExp(const T& x) { return fadbad::exp(x); }
+	static T mySin(const T& x) { return fadbad::sin(x); }
+	static T myCos(const T& x) { return fadbad::cos(x); }
+	static T myTan(const T& x) { return fadbad::tan(x); }
+	static T myAsin(const T& x) { return fadbad::asin(x); }
+	static T myAcos(const T& x) { return fadbad::acos(x); }
+	static T myAtan(const T& x) { return fadbad::atan(x); }
+	static bool myEq(const T& x, const T& y) { return x==y; }
+	static bool myNe(const T& x, const T& y) { return x!=y; }
+	static bool myLt(const T& x, const T& y) { return x<y; }
+	static bool myLe(const T& x, const T& y) { return x<=y; }
+	static bool myGt(const T& x, const T& y) { return x>y; }
+	static bool myGe(const T& x, const T& y) { return x>=y; }
+};
+
+template <class FUN>
+void Tape::record(FUN f, const double* x, const unsigned int n)
+{
+	clear();
+	Tape* pPrev=tapeRecording();
+	tapeRecording()=this;
+	{
+		std::vector<TapeVar> xv;
+		xv.reserve(n);
+		for(unsigned int j=0;j<n;++j) xv.push_back(TapeVar(addInput(),x[j]));
+		TapeVar y=f(&xv[0]);
+		addOutput(y.slot());
+	}
+	tapeRecording()=pPrev;
+	prepare();
+}
+template <class FUN>
+void Tape::record(FUN f, const double* x, const unsigned int n, const unsigned int m)
+{
+	clear();
+	Tape* pPrev=tapeRecording();
+	tapeRecording()=this;
+	{
+		std::vector<TapeVar> xv, yv(m);
+		xv.reserve(n);
+		for(unsigned int j=0;j<n;++j) xv.push_back(TapeVar(addInput(),x[j]));
+		f(&xv[0],&yv[0]);
+		for(unsigned int i=0;i<m;++i) addOutput(yv[i].slot());
+	}
+	tapeRecording()=pPrev;
+	prepare();
+}
+
+template <class S>
+S Tape::apply(const TapeOp& op, const S* v, const double* c)
+{
+	switch(op.code)
+	{
+	case TapeCONST: return S(c[op.b]);
+	case TapeADD: return v[op.a]+v[op.b];
+	case TapeSUB: return v[op.a]-v[op.b];
+	case TapeMUL: return v[op.a]*v[op.b];
+	case TapeDIV: return v[op.a]/v[op.b];
+	case TapeNEG: return Op<S>::myNeg(v[op.a]);
+	case TapeADDC: return v[op.a]+c[op.b];
+	case TapeCSUB: return c[op.b]-v[op.a];
+	case TapeMULC: return v[op.a]*c[op.b];
+	case TapeDIVC: return v[op.a]/c[op.b];
+	case TapeCDIV: return c[op.b]/v[op.a];
+	case TapeSQR: return Op<S>::mySqr(v[op.a]);
+	case TapePOWC: return Op<S>::myPow(v[op.a],c[op.b]);
+	case TapePOW: return Op<S>::myPow(v[op.a],v[op.b]);
+	case TapeSQRT: return Op<S>::mySqrt(v[op.a]);
+	case TapeEXP: return Op<S>::myExp(v[op.a]);
+	case TapeLOG: return Op<S>::myLog(v[op.a]);
+	case TapeSIN: return Op<S>::mySin(v[op.a]);
+	case TapeCOS: return Op<S>::myCos(v[op.a]);
+	case TapeTAN: return Op<S>::myTan(v[op.a]);
+	case TapeASIN: return Op<S>::myAsin(v[op.a]);
+	case TapeACOS: return Op<S>::myAcos(v[op.a]);
+	case TapeATAN: return Op<S>::myAtan(v[op.a]);
+	}
+	return v[op.a];
+}
+
+template <class S>
+void Tape::forward(S* v) const
+{
+	const TapeOp* ops=m_ops.empty()?0:&m_ops[0];
+	const double* c=m_consts.empty()?0:&m_consts[0];
+	const unsigned int n=size();
+	for(unsigned int i=0;i<n;++i)
+		if (ops[i].code!=TapeINPUT) v[i]=apply(ops[i],v,c);
+}
+
+template <class S, class W>
+void Tape::reverse(const S* v, W* w) const
+{
+	const TapeOp* ops=m_ops.empty()?0:&m_ops[0];
+	const double* c=m_consts.empty()?0:&m_consts[0];
+	for(unsigned int i=size();i-->0;)
+	{
+		const TapeOp& op=ops[i];
+		const W& wi=w[i];
+		switch(op.code)
+		{
+		case TapeINPUT: case TapeCONST: break;
+		case TapeADD: Op<W>::myCadd(w[op.a],wi); Op<W>::myCadd(w[op.b],wi); break;
+		case TapeSUB: Op<W>::myCadd(w[op.a],wi); Op<W>::myCsub(w[op.b],wi); break;
+		case TapeMUL: Op<W>::myCadd(w[op.a],wi*v[op.b]); Op<W>::myCadd(w[op.b],wi*v[op.a]); break;
+		case TapeDIV:
+		{
+			S t=wi/v[op.b];
+			Op<W>::myCadd(w[op.a],t);
+			Op<W>::myCsub(w[op.b],t*v[i]);
+			break;
+		}
+		case TapeNEG: Op<W>::myCsub(w[op.a],wi); break;
+		case TapeADDC: Op<W>::myCadd(w[op.a],wi); break;
+		case TapeCSUB: Op<W>::myCsub(w[op.a],wi); break;
+		case TapeMULC: Op<W>::myCadd(w[op.a],wi*c[op.b]); break;
+		case TapeDIVC: Op<W>::myCadd(w[op.a],wi/c[op.b]); break;
+		case TapeCDIV: Op<W>::myCsub(w[op.a],wi*v[i]/v[op.a]); break;
+		case TapeSQR: Op<W>::myCadd(w[op.a],wi*v[op.a]*Op<S>::myTwo()); break;
+		case TapePOWC: Op<W>::myCadd(w[op.a],wi*c[op.b]*Op<S>::myPow(v[op.a],c[op.b]-1)); break;
+		case TapePOW:
+			Op<W>::myCadd(w[op.a],wi*v[op.b]*Op<S>::myPow(v[op.a],v[op.b]-Op<S>::myOne()));
+			Op<W>::myCadd(w[op.b],wi*v[i]*Op<S>::myLog(v[op.a]));
+			break;
+		case TapeSQRT: Op<W>::myCadd(w[op.a],wi/(v[i]*Op<S>::myTwo())); break;
+		case TapeEXP: Op<W>::myCadd(w[op.a],wi*v[i]); break;
+		case TapeLOG: Op<W>::myCadd(w[op.a],wi/v[op.a]); break;
+		case TapeSIN: Op<W>::myCadd(w[op.a],wi*Op<S>::myCos(v[op.a])); break;
+		case TapeCOS: Op<W>::myCsub(w[op.a],wi*Op<S>::mySin(v[op.a])); break;
+		case TapeTAN: Op<W>::myCadd(w[op.a],wi*(Op<S>::mySqr(v[i])+Op<S>::myOne())); break;
+		case TapeASIN: Op<W>::myCadd(w[op.a],wi/Op<S>::mySqrt(Op<S>::myOne()-Op<S>::mySqr(v[op.a]))); break;
+		case TapeACOS: Op<W>::myCsub(w[op.a],wi/Op<S>::mySqrt(Op<S>::myOne()-Op<S>::mySqr(v[op.a]))); break;
+		case TapeATAN: Op<W>::myCadd(w[op.a],wi/(Op<S>::mySqr(v[op.a])+Op<S>::myOne())); break;
+		}
+	}
+}
+
+inline void Tape::partials(const double* v, double* d) const
+{
+	const double* c=m_consts.empty()?0:&m_consts[0];
+	for(unsigned int i=0;i<size();++i)
+	{
+		const TapeOp& op=m_ops[i];
+		double da=0, db=0;
+		switch(op.code)
+		{
+		case TapeINPUT: case TapeCONST: break;
+		case TapeADD: da=1; db=1; break;
+		case TapeSUB: da=1; db=-1; break;
+		case TapeMUL: da=v[op.b]; db=v[op.a]; break;
+		case TapeDIV: da=1/v[op.b]; db=-v[i]/v[op.b]; break;
+		case TapeNEG: da=-1; break;
+		case TapeADDC: da=1; break;
+		case TapeCSUB: da=-1; break;
+		case TapeMULC: da=c[op.b]; break;
+		case TapeDIVC: da=1/c[op.b]; break;
+		case TapeCDIV: da=-v[i]/v[op.a]; break;
+		case TapeSQR: da=2*v[op.a]; break;
+		case TapePOWC: da=c[op.b]*::pow(v[op.a],c[op.b]-1); break;
+		case TapePOW: da=v[op.b]*::pow(v[op.a],v[op.b]-1); db=v[i]*::log(v[op.a]); break;
+		case TapeSQRT: da=1/(2*v[i]); break;
+		case TapeEXP: da=v[i]; break;
+		case TapeLOG: da=1/v[op.a]; break;
+		case TapeSIN: da=::cos(v[op.a]); break;
+		case TapeCOS: da=-::sin(v[op.a]); break;
+		case TapeTAN: da=v[i]*v[i]+1; break;
+		case TapeASIN: da=1/::sqrt(1-v[op.a]*v[op.a]); break;
+		case TapeACOS: da=-1/::sqrt(1-v[op.a]*v[op.a]); break;
+		case TapeATAN: da=1/(v[op.a]*v[op.a]+1); break;
+		}
+		d[2*i]=da;
+		d[2*i+1]=db;
+	}
+}
+
+} // namespace fadbad
+
+#endif
@@ -0,0 +1,298 @@
+//
+//  tapeopt.h
+//  FADBADSwift
+//
+
+#ifndef _TAPEOPT_H
+#define _TAPEOPT_H
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+#include "tape.h"
+
+namespace fadbad
+{
+
+// Optimization passes over a recorded Tape, run once before replaying:
+//
+// - dead operations, those not reaching any output, are removed (the
+//   inputs are always kept, in order);
+// - operations on constants only are folded into constants, and binary
+//   operations with one constant operand become the constant forms
+//   (x*C to TapeMULC and so on);
+// - identities are removed: x+0, x*1, x/1, pow(x,1); x*(-1) becomes a
+//   negation (unary plus is never recorded);
+// - common subexpressions are shared, with the operands of + and *
+//   ordered;
+// - chains of scalings, x*c1*c2, -(x*c) and (x*c1)/c2, become a single
+//   scaling of x. This changes the rounding of the merged constants.
+//
+// The tape is rebuilt by one pass in recording order, with a second
+// dead operation pass for the intermediates that the merges leave
+// unused. Replays of the optimized tape compute the same function and
+// derivatives.
+
+struct TapeOptimizeStats
+{
+	unsigned int before, after; // tape lengths
+	unsigned int dead; // dead operations removed
+	unsigned int folded; // operations folded into constants
+	unsigned int identities; // identity operations removed
+	unsigned int common; // operations shared with an earlier one
+	unsigned int scalings; // scalings merged into a previous one
+	TapeOptimizeStats():before(0),after(0),dead(0),folded(0),identities(0),common(0),scalings(0){}
+};
+
+// Operations reaching an output:
+inline std::vector<bool> tapeLive(const Tape& tape)
+{
+	std::vector<bool> live(tape.size(),false);
+	for(unsigned int k=0;k<tape.outputs();++k) live[tape.output(k)]=true;
+	for(unsigned int i=tape.size();i-->0;)
+	{
+		const TapeOp& op=tape.op(i);
+		if (!live[i] || op.code==TapeINPUT || op.code==TapeCONST) continue;
+		live[op.a]=true;
+		if (tapeIsBinary(op.code)) live[op.b]=true;
+	}
+	return live;
+}
+
+class TapeOptimizer
+{
+	static constexpr unsigned int Empty=~0u;
+	Tape& m_out;
+	// Slots emitted so far, by open addressing on (code,a,b):
+	std::vector<unsigned int> m_known;
+	unsigned long long m_mask;
+	std::vector<unsigned int> m_base; // scaled slot, for scalings
+	std::vector<double> m_factor;
+	TapeOptimizeStats& m_stats;
+
+	static unsigned long long bits(const double c)
+	{
+		unsigned long long b;
+		std::memcpy(&b,&c,sizeof(b));
+		return b;
+	}
+	bool isConstant(const unsigned int slot) const { return m_out.op(slot).code==TapeCONST; }
+	double constant(const unsigned int slot) const { return m_out.constant(m_out.op(slot).b); }
+	unsigned int emit(const unsigned int code, const unsigned int a, const unsigned int b, const double c)
+	{
+		const unsigned long long kb=tapeHasConstant(code)?bits(c):b;
+		unsigned long long h=kb*0x9E3779B97F4A7C15ull+((unsigned long long)a<<8|code);
+		h=(h^(h>>33))*0xFF51AFD7ED558CCDull;
+		h=(h^(h>>33))*0xC4CEB9FE1A85EC53ull;
+		for(h^=h>>33;;++h)
+		{
+			const unsigned int k=m_known[h&m_mask];
+			if (k==Empty) break;
+			const TapeOp& op=m_out.op(k);
+			if (op.code==code && op.a==a && (tapeHasConstant(code)?bits(m_out.constant(op.b)):op.b)==kb) { ++m_stats.common; return k; }
+		}
+		const unsigned int slot=tapeHasConstant(code)?m_out.pushConstant(code,a,c):m_out.push(code,a,b);
+		m_known[h&m_mask]=slot;
+		m_base.push_back(slot);
+		m_factor.push_back(1.0);
+		if (code==TapeMULC) { m_base[slot]=a; m_factor[slot]=c; }
+		else if (code==TapeNEG) { m_base[slot]=a; m_factor[slot]=-1.0; }
+		return slot;
+	}
+	unsigned int fold(const TapeOp& op, const double va, const double vb, const double c)
+	{
+		const double v[2]={va,vb};
+		TapeOp local={op.code,0,tapeHasConstant(op.code)?0u:1u};
+		++m_stats.folded;
+		return emit(TapeCONST,0,0,Tape::apply(local,v,&c));
+	}
+	// x*f for a slot x that is not itself a scaling:
+	unsigned int scale(const unsigned int x, const double f)
+	{
+		if (f==1) return x;
+		if (f==-1) return emit(TapeNEG,x,0,0);
+		return emit(TapeMULC,x,0,f);
+	}
+public:
+	TapeOptimizer(Tape& out, TapeOptimizeStats& stats, const unsigned int size):m_out(out),m_stats(stats)
+	{
+		unsigned long long capacity=64;
+		while(capacity<2ull*size) capacity*=2;
+		m_known.assign(capacity,Empty);
+		m_mask=capacity-1;
+		m_base.reserve(size);
+		m_factor.reserve(size);
+	}
+
+	unsigned int input()
+	{
+		const unsigned int slot=m_out.addInput();
+		m_base.push_back(slot);
+		m_factor.push_back(1.0);
+		return slot;
+	}
+	// Slot computing op on the new operand slots a and b:
+	unsigned int operation(const TapeOp& op, const unsigned int a, const unsigned int b, const double c)
+	{
+		unsigned int code=op.code;
+		if (code==TapeCONST) return emit(TapeCONST,0,0,c);
+		if (tapeIsBinary(code))
+		{
+			const bool ca=isConstant(a), cb=isConstant(b);
+			if (ca && cb) return fold(op,constant(a),constant(b),0);
+			if (cb)
+			{
+				const double k=constant(b);
+				switch(code)
+				{
+				case TapeADD: return operation(TapeOp{TapeADDC,0,0},a,0,k);
+				case TapeSUB: return operation(TapeOp{TapeADDC,0,0},a,0,-k);
+				case TapeMUL: return operation(TapeOp{TapeMULC,0,0},a,0,k);
+				case TapeDIV: return operation(TapeOp{TapeDIVC,0,0},a,0,k);
+				case TapePOW: return operation(TapeOp{TapePOWC,0,0},a,0,k);
+				}
+			}
+			if (ca)
+			{
+				const double k=constant(a);
+				switch(code)
+				{
+				case TapeADD: return operation(TapeOp{TapeADDC,0,0},b,0,k);
+				case TapeSUB: return operation(TapeOp{TapeCSUB,0,0},b,0,k);
+				case TapeMUL: return operation(TapeOp{TapeMULC,0,0},b,0,k);
+				case TapeDIV: return operation(TapeOp{TapeCDIV,0,0},b,0,k);
+				}
+			}
+			if ((code==TapeADD || code==TapeMUL) && b<a) return emit(code,b,a,0);
+			return emit(code,a,b,0);
+		}
+		if (isConstant(a)) return fold(op,constant(a),0,c);
+		switch(code)
+		{
+		case TapeADDC: if (c==0) { ++m_stats.identities; return a; } break;
+		case TapeDIVC: if (c==1) { ++m_stats.identities; return a; } break;
+		case TapePOWC: if (c==1) { ++m_stats.identities; return a; } break;
+		case TapeMULC: if (c==1) { ++m_stats.identities; return a; } break;
+		}
+		if (code==TapeMULC || code==TapeNEG || code==TapeDIVC)
+		{
+			const double f=code==TapeMULC?c:code==TapeNEG?-1.0:1/c;
+			if (m_base[a]!=a)
+			{
+				++m_stats.scalings;
+				return scale(m_base[a],m_factor[a]*f);
+			}
+			if (code==TapeMULC)
+			{
+				if (c==-1) { ++m_stats.identities; return emit(TapeNEG,a,0,0); }
+				return emit(TapeMULC,a,0,c);
+			}
+		}
+		return emit(code,a,0,c);
+	}
+};
+
+// Copy of the operations of tape marked live, renumbered:
+inline void tapeCompact(const Tape& tape, const std::vector<bool>& live, Tape& out)
+{
+	std::vector<unsigned int> slot(tape.size(),0);
+	out.clear();
+	for(unsigned int i=0;i<tape.size();++i)
+	{
+		const TapeOp& op=tape.op(i);
+		if (op.code==TapeINPUT) slot[i]=out.addInput();
+		else if (!live[i]) continue;
+		else if (tapeHasConstant(op.code)) slot[i]=out.pushConstant(op.code,slot[op.a],tape.constant(op.b));
+		else slot[i]=out.push(op.code,slot[op.a],tapeIsBinary(op.code)?slot[op.b]:0);
+	}
+	for(unsigned int k=0;k<tape.outputs();++k) out.addOutput(slot[tape.output(k)]);
+	out.prepare();
+}
+
+// Operand reads reaching more than window slots back, a count of the
+// reads likely to miss the cache on replay (32768 doubles are 256 KB,
+// the size of a typical L2 cache).
+inline unsigned long long tapeFarReads(const Tape& tape, const unsigned int window=32768)
+{
+	unsigned long long far=0;
+	for(unsigned int i=0;i<tape.size();++i)
+	{
+		const TapeOp& op=tape.op(i);
+		if (op.code==TapeINPUT || op.code==TapeCONST) continue;
+		if (i-op.a>window) ++far;
+		if (tapeIsBinary(op.code) && i-op.b>window) ++far;
+	}
+	return far;
+}
+
+// Reorders the operations of tape for cache locality on replay. The
+// inputs stay first, in order; the other operations are scheduled in
+// depth-first post-order from the outputs (first operand, then second,
+// then the operation), so values are computed right before the
+// operations reading them. Constants go next to their first reader, and
+// operations not reaching an output are dropped. On wide graphs with
+// much sharing the depth-first order can spread the reads instead, so
+// the new order is only kept when it has fewer far reads
+// (tapeFarReads); returns whether it was. Values are unchanged; adjoints
+// may be summed in another order.
+inline bool tapeRenumber(Tape& tape, const unsigned int window=32768)
+{
+	const unsigned int size=tape.size(), None=~0u;
+	std::vector<unsigned int> slot(size,None), stack;
+	Tape out;
+	for(unsigned int j=0;j<tape.inputs();++j) slot[tape.input(j)]=out.addInput();
+	for(unsigned int k=0;k<tape.outputs();++k)
+	{
+		stack.push_back(tape.output(k));
+		while(!stack.empty())
+		{
+			const unsigned int i=stack.back();
+			if (slot[i]!=None) { stack.pop_back(); continue; }
+			const TapeOp& op=tape.op(i);
+			if (op.code==TapeCONST) { slot[i]=out.pushConstant(TapeCONST,0,tape.constant(op.b)); stack.pop_back(); continue; }
+			// operands pushed in reverse so that a is emitted first:
+			const bool binary=tapeIsBinary(op.code);
+			if (binary && slot[op.b]==None) stack.push_back(op.b);
+			if (slot[op.a]==None) { stack.push_back(op.a); continue; }
+			if (binary && slot[op.b]==None) continue;
+			stack.pop_back();
+			if (tapeHasConstant(op.code)) slot[i]=out.pushConstant(op.code,slot[op.a],tape.constant(op.b));
+			else slot[i]=out.push(op.code,slot[op.a],binary?slot[op.b]:0);
+		}
+	}
+	for(unsigned int k=0;k<tape.outputs();++k) out.addOutput(slot[tape.output(k)]);
+	if (tapeFarReads(out,window)>=tapeFarReads(tape,window)) return false;
+	out.prepare();
+	tape=out;
+	return true;
+}
+
+// Runs all passes on tape in place.
+inline TapeOptimizeStats optimize(Tape& tape)
+{
+	TapeOptimizeStats stats;
+	stats.before=tape.size();
+	std::vector<bool> live=tapeLive(tape);
+	Tape out;
+	TapeOptimizer opt(out,stats,(unsigned int)std::count(live.begin(),live.end(),true)+tape.inputs());
+	std::vector<unsigned int> slot(tape.size(),0);
+	for(unsigned int i=0;i<tape.size();++i)
+	{
+		const TapeOp& op=tape.op(i);
+		if (op.code==TapeINPUT) { slot[i]=opt.input(); continue; }
+		if (!live[i]) { ++stats.dead; continue; }
+		const double c=tapeHasConstant(op.code)?tape.constant(op.b):0;
+		slot[i]=opt.operation(op,op.code==TapeCONST?0:slot[op.a],tapeIsBinary(op.code)?slot[op.b]:0,c);
+	}
+	for(unsigned int k=0;k<tape.outputs();++k) out.addOutput(slot[tape.output(k)]);
+	live=tapeLive(out);
+	for(unsigned int i=0;i<out.size();++i) if (!live[i] && out.op(i).code!=TapeINPUT) ++stats.dead;
+	tapeCompact(out,live,tape);
+	stats.after=tape.size();
+	return stats;
+}
+
+} // namespace fadbad
+
+#endif
@@ -0,0 +1,118 @@
+//
+//  tayloradjoint.h
+//  FADBADSwift
+//
+
+#ifndef _TAYLORADJOINT_H
+#define _TAYLORADJOINT_H
+
+#include <vector>
+
+#include "badiff.h"
+#include "taylorode.h"
+
+namespace fadbad
+{
+
+// Adapts rhs(x,p,f) to the rhs(x,f) form recorded by TaylorODE. The
+// parameters enter the graph as constant series built from p, which may
+// hold plain values or B<double> variables.
+template <typename RHS, typename P>
+struct TaylorParamRHS
+{
+	RHS& m_rhs;
+	const std::vector<P>& m_p;
+	TaylorParamRHS(RHS& rhs, const std::vector<P>& p):m_rhs(rhs),m_p(p){}
+	template <typename TT>
+	void operator()(const std::vector<TT>& x, std::vector<TT>& f) const
+	{
+		std::vector<TT> p(m_p.size());
+		for(unsigned int j=0;j<m_p.size();++j) p[j]=m_p[j];
+		m_rhs(x,p,f);
+	}
+};
+
+// Discrete adjoint of a Taylor integration of x'=f(x,p).
+//
+// forward() integrates on T<double> and checkpoints the state and step
+// size of every step (dim+1 values per step). reverse() then walks the
+// steps backwards; each step map x -> sum_k x_k(x,p) h^k is re-expanded
+// on T< B<double> > from its checkpoint, so the reverse pass runs through
+// the Taylor recurrences of that single step and its graph is released
+// before the next. Memory is one step's graph plus the checkpoints, and
+// the cost is a constant multiple of the forward integration. The step
+// sizes are those of the forward pass and are treated as constants.
+//
+// rhs(x,p,f) must be a template over the series type.
+
+template <int N=MaxLength>
+class TaylorAdjoint
+{
+	typedef TTypeName<double,N> TD;
+	typedef BTypeName<double,1> BD; // one output per step: scalar adjoints
+	unsigned int m_dim;
+	unsigned int m_order;
+	std::vector<double> m_p;
+	std::vector<double> m_states; // state at the start of each step
+	std::vector<double> m_steps; // step sizes
+public:
+	TaylorAdjoint(const unsigned int dim, const unsigned int order=20):m_dim(dim),m_order(order){}
+	unsigned int steps() const { return (unsigned int)m_steps.size(); }
+
+	// Integrates from x0 at t0 to t1 with parameters p (np values),
+	// storing checkpoints. Returns the number of steps.
+	template <typename RHS>
+	unsigned int forward(RHS rhs, const double* x0, const double* p, const unsigned int np,
+		const double t0, const double t1, const double tol, double* x1, const unsigned int maxSteps=100000)
+	{
+		m_p.assign(p,p+np);
+		m_states.clear();
+		m_steps.clear();
+		TaylorODE<double,N> ode(m_dim,TaylorParamRHS<RHS,double>(rhs,m_p),m_order);
+		std::vector<double> x(x0,x0+m_dim);
+		double t=t0;
+		while(t<t1 && m_steps.size()<maxSteps)
+		{
+			ode.expand(&x[0]);
+			double h=std::min(ode.stepSize(tol),t1-t);
+			m_states.insert(m_states.end(),x.begin(),x.end());
+			m_steps.push_back(h);
+			ode.advance(h,&x[0]);
+			t=(t1-t<=h)?t1:t+h;
+		}
+		for(unsigned int i=0;i<m_dim;++i) x1[i]=x[i];
+		return (unsigned int)m_steps.size();
+	}
+
+	// Given xbar1=dL/dx(t1), computes xbar0=dL/dx(t0) and pbar=dL/dp
+	// for the last forward() integration.
+	template <typename RHS>
+	void reverse(RHS rhs, const double* xbar1, double* xbar0, double* pbar) const
+	{
+		const unsigned int np=(unsigned int)m_p.size();
+		std::vector<double> lambda(xbar1,xbar1+m_dim);
+		for(unsigned int j=0;j<np;++j) pbar[j]=0;
+		for(unsigned int n=(unsigned int)m_steps.size();n-->0;)
+		{
+			std::vector<BD> x(m_dim), p(np);
+			for(unsigned int i=0;i<m_dim;++i) x[i]=m_states[n*m_dim+i];
+			for(unsigned int j=0;j<np;++j) p[j]=m_p[j];
+			BD s=0;
+			{
+				TaylorODE<BD,N> ode(m_dim,TaylorParamRHS<RHS,BD>(rhs,p),m_order);
+				std::vector<BD> y(m_dim);
+				ode.expand(&x[0]);
+				ode.advance(BD(m_steps[n]),&y[0]);
+				for(unsigned int i=0;i<m_dim;++i) s+=lambda[i]*y[i];
+			} // the step graph must be gone before propagating
+			s.diff(0,1);
+			for(unsigned int i=0;i<m_dim;++i) lambda[i]=x[i].d(0);
+			for(unsigned int j=0;j<np;++j) pbar[j]+=p[j].d(0);
+		}
+		for(unsigned int i=0;i<m_dim;++i) xbar0[i]=lambda[i];
+	}
+};
+
+} // namespace fadbad
+
+#endif
@@ -0,0 +1,242 @@
+//
+//  taylorcost.h
+//  FADBADSwift
+//
+
+#ifndef _TAYLORCOST_H
+#define _TAYLORCOST_H
+
+#include <vector>
+#include <set>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <string>
+
+#include "tadiff.h"
+#include "taylorode.h"
+
+namespace fadbad
+{
+
+// Kernel classes with distinct cost per Taylor order: linear kernels
+// (ADD, SUB, scaling) are O(k), convolutions (MUL, SQR) O(k^2), the
+// recursive quotient-like kernels (DIV, SQRT, LOG, TAN, ASIN, ...) O(k^2)
+// with a division, and EXP and SIN/COS carry their own recurrences.
+enum TaylorKernel { TaylorKernelADD, TaylorKernelMUL, TaylorKernelDIV, TaylorKernelEXP, TaylorKernelSIN, TaylorKernels };
+
+struct TaylorOpMix
+{
+	unsigned int count[TaylorKernels];
+	TaylorOpMix(){ for(int i=0;i<TaylorKernels;++i) count[i]=0; }
+	TaylorOpMix& operator+=(const TaylorOpMix& m){ for(int i=0;i<TaylorKernels;++i) count[i]+=m.count[i]; return *this; }
+	unsigned int total() const { unsigned int n=0; for(int i=0;i<TaylorKernels;++i) n+=count[i]; return n; }
+};
+
+template <typename U, int N>
+TaylorKernel taylorKernelOf(TTypeNameHV<U,N>* pHV)
+{
+	if (dynamic_cast<TTypeNameMUL<U,N>*>(pHV) || dynamic_cast<TTypeNameSQR<U,N>*>(pHV)) return TaylorKernelMUL;
+	if (dynamic_cast<TTypeNameEXP<U,N>*>(pHV)) return TaylorKernelEXP;
+	if (dynamic_cast<TTypeNameSIN<U,N>*>(pHV) || dynamic_cast<TTypeNameCOS<U,N>*>(pHV)) return TaylorKernelSIN;
+	if (dynamic_cast<TTypeNameDIV<U,N>*>(pHV) || dynamic_cast<TTypeNameSQRT<U,N>*>(pHV) ||
+		dynamic_cast<TTypeNameLOG<U,N>*>(pHV) || dynamic_cast<TTypeNameTAN<U,N>*>(pHV) ||
+		dynamic_cast<TTypeNameASIN<U,N>*>(pHV) || dynamic_cast<TTypeNameACOS<U,N>*>(pHV) ||
+		dynamic_cast<TTypeNameATAN<U,N>*>(pHV) || dynamic_cast<TTypeNameDIV1<U,N,U>*>(pHV) ||
+		dynamic_cast<TTypeNameDIV1<U,N,typename Op<U>::Base>*>(pHV)) return TaylorKernelDIV;
+	return TaylorKernelADD; // sums, differences and scalings
+}
+
+// Counts the operation nodes of a recorded graph by kernel class.
+template <typename U, int N>
+void taylorOpMix(TTypeNameHV<U,N>* pHV, TaylorOpMix& mix, std::set<TTypeNameHV<U,N>*>& visited)
+{
+	if (!visited.insert(pHV).second) return;
+	if (TTypeNameLINCOMB<U,N>* pLC=dynamic_cast<TTypeNameLINCOMB<U,N>*>(pHV))
+	{
+		for(unsigned int j=0;j<pLC->terms();++j) taylorOpMix(pLC->op(j),mix,visited);
+		mix.count[TaylorKernelADD]+=pLC->terms(); // one scaled addition per term
+		return;
+	}
+	if (TTypeNameFMA<U,N>* pFMA=dynamic_cast<TTypeNameFMA<U,N>*>(pHV))
+	{
+		taylorOpMix(pFMA->opA(),mix,visited);
+		taylorOpMix(pFMA->opB(),mix,visited);
+		taylorOpMix(pFMA->opC(),mix,visited);
+		++mix.count[TaylorKernelMUL];
+		return;
+	}
+	if (BinTTypeNameHV<U,N>* pBin=dynamic_cast<BinTTypeNameHV<U,N>*>(pHV))
+	{
+		taylorOpMix(pBin->op1(),mix,visited);
+		taylorOpMix(pBin->op2(),mix,visited);
+	}
+	else if (UnTTypeNameHV<U,N>* pUn=dynamic_cast<UnTTypeNameHV<U,N>*>(pHV))
+	{
+		taylorOpMix(pUn->op(),mix,visited);
+	}
+	else return; // independent variables and constants cost nothing
+	++mix.count[taylorKernelOf(pHV)];
+}
+template <typename U, int N>
+TaylorOpMix taylorOpMix(const std::vector< TTypeName<U,N> >& outputs)
+{
+	TaylorOpMix mix;
+	std::set<TTypeNameHV<U,N>*> visited;
+	for(unsigned int i=0;i<outputs.size();++i) taylorOpMix(outputs[i].getTTypeNameHV(),mix,visited);
+	return mix;
+}
+
+// Host-calibrated cost table for the Taylor kernels.
+//
+// cost(kernel,k) is the measured time in seconds to evaluate one node of
+// that kernel from scratch to order k on this machine. calibrate() runs
+// the micro-benchmarks; load()/save() keep the table in a text file so
+// the calibration can be done once at install time, or lazily at startup
+// through startup(path).
+//
+// The order is chosen by modelling the step size for a series with radius
+// of convergence rho as h(K)=rho*tol^(1/K) and minimizing the wall time per
+// unit of simulated time, cost(mix,K)/h(K).
+
+template <int N=MaxLength>
+class TaylorCostModel
+{
+	double m_cost[TaylorKernels][N];
+
+	template <typename BUILD>
+	void bench(const TaylorKernel kernel, BUILD build, const double minSeconds)
+	{
+		typedef TTypeName<double,N> TD;
+		TD x(1.25);
+		for(int k=1;k<N;++k) x[k]=0.5/(k+1);
+		TD f=build(x);
+		m_cost[kernel][0]=0;
+		for(int k=1;k<N;++k)
+		{
+			// Best of a few trials, to keep preemption out of the table:
+			double best=HUGE_VAL;
+			for(int trial=0;trial<5;++trial)
+			{
+				unsigned long reps=0;
+				std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+				double seconds=0;
+				do
+				{
+					for(int r=0;r<16;++r) { f.reset(); f.eval(k); }
+					reps+=16;
+					seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+				} while(seconds<minSeconds/5);
+				best=std::min(best,seconds/reps);
+			}
+			m_cost[kernel][k]=std::max(best,m_cost[kernel][k-1]);
+		}
+	}
+	template <typename TT> struct BuildADD { TT operator()(const TT& x) const { return x+x; } };
+	template <typename TT> struct BuildMUL { TT operator()(const TT& x) const { return x*x; } };
+	template <typename TT> struct BuildDIV { TT operator()(const TT& x) const { return x/x; } };
+	template <typename TT> struct BuildEXP { TT operator()(const TT& x) const { return exp(x); } };
+	template <typename TT> struct BuildSIN { TT operator()(const TT& x) const { return sin(x); } };
+public:
+	TaylorCostModel(){ for(int i=0;i<TaylorKernels;++i) for(int k=0;k<N;++k) m_cost[i][k]=0; }
+
+	double cost(const TaylorKernel kernel, const unsigned int k) const { return m_cost[kernel][k]; }
+	double cost(const TaylorOpMix& mix, const unsigned int k) const
+	{
+		double c=0;
+		for(int i=0;i<TaylorKernels;++i) c+=mix.count[i]*m_cost[i][k];
+		return c;
+	}
+
+	void calibrate(const double minSeconds=5e-4)
+	{
+		typedef TTypeName<double,N> TD;
+		bench(TaylorKernelADD,BuildADD<TD>(),minSeconds);
+		bench(TaylorKernelMUL,BuildMUL<TD>(),minSeconds);
+		bench(TaylorKernelDIV,BuildDIV<TD>(),minSeconds);
+		bench(TaylorKernelEXP,BuildEXP<TD>(),minSeconds);
+		bench(TaylorKernelSIN,BuildSIN<TD>(),minSeconds);
+	}
+	bool save(const char* path) const
+	{
+		std::ofstream out(path);
+		if (!out) return false;
+		out.precision(17);
+		out<<"fadbad-taylor-cost "<<N<<"\n";
+		for(int i=0;i<TaylorKernels;++i)
+		{
+			for(int k=0;k<N;++k) out<<m_cost[i][k]<<(k+1<N?" ":"\n");
+		}
+		return bool(out);
+	}
+	bool load(const char* path)
+	{
+		std::ifstream in(path);
+		std::string magic;
+		int n=0;
+		if (!(in>>magic>>n) || magic!="fadbad-taylor-cost" || n!=N) return false;
+		for(int i=0;i<TaylorKernels;++i) for(int k=0;k<N;++k) if (!(in>>m_cost[i][k])) return false;
+		return true;
+	}
+	// Loads the table from path, or calibrates and stores it there.
+	static TaylorCostModel<N> startup(const char* path)
+	{
+		TaylorCostModel<N> model;
+		if (!model.load(path))
+		{
+			model.calibrate();
+			model.save(path);
+		}
+		return model;
+	}
+
+	// Order in [minOrder,maxOrder] minimizing cost per unit simulated time
+	// for a solution with convergence radius rho. step receives h(K).
+	unsigned int selectOrder(const TaylorOpMix& mix, const double tol, const double rho,
+		const unsigned int minOrder=4, const unsigned int maxOrder=N-1, double* step=0) const
+	{
+		unsigned int best=minOrder;
+		double bestRate=HUGE_VAL;
+		for(unsigned int k=minOrder;k<=maxOrder && k<(unsigned int)N;++k)
+		{
+			double h=rho*std::pow(tol,1.0/k);
+			double rate=cost(mix,k)/h;
+			if (rate<bestRate) { bestRate=rate; best=k; }
+		}
+		if (step) *step=rho*std::pow(tol,1.0/best);
+		return best;
+	}
+};
+
+// Estimates the radius of convergence of the current expansion of an
+// integrator from its last coefficients.
+template <typename U, int N>
+double taylorRadius(const TaylorODE<U,N>& ode)
+{
+	double rho=HUGE_VAL;
+	const unsigned int K=ode.order();
+	for(unsigned int k=K-1;k<=K;++k)
+	{
+		double c=0;
+		for(unsigned int i=0;i<ode.dim();++i) c=std::max(c,std::fabs(ode.coeff(i,k)));
+		if (c>0) rho=std::min(rho,std::pow(1.0/c,1.0/k));
+	}
+	return rho;
+}
+
+// Expands ode at x and switches it to the order the cost model predicts
+// to be fastest for the tolerance. Returns the chosen order.
+template <typename U, int N>
+unsigned int tuneOrder(TaylorODE<U,N>& ode, const TaylorCostModel<N>& model, const U* x, const double tol)
+{
+	TaylorOpMix mix=taylorOpMix(ode.field());
+	mix+=taylorOpMix(ode.guardFunctions());
+	ode.expand(x);
+	unsigned int order=model.selectOrder(mix,tol,taylorRadius(ode));
+	ode.setOrder(order);
+	return order;
+}
+
+} // namespace fadbad
+
+#endif
@@ -0,0 +1,158 @@
+//
+//  taylorensemble.h
+//  FADBADSwift
+//
+
+#ifndef _TAYLORENSEMBLE_H
+#define _TAYLORENSEMBLE_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include "taylorode.h"
+
+namespace fadbad
+{
+
+struct TaylorEnsembleStats
+{
+	unsigned long trajectories;
+	unsigned long steps; // trajectory-steps, counted per active lane
+	unsigned long batchSteps; // packed steps, counted per batch
+	double seconds;
+	TaylorEnsembleStats():trajectories(0),steps(0),batchSteps(0),seconds(0){}
+	double stepsPerSecond() const { return seconds>0?steps/seconds:0; }
+	double laneUtilization(const int width) const { return batchSteps>0?double(steps)/(double(batchSteps)*width):0; }
+};
+
+// Never terminates a trajectory before tEnd.
+struct TaylorEnsembleNoStop
+{
+	bool operator()(const double*, const double) const { return false; }
+};
+
+// Integrates one vector field from many initial conditions.
+//
+// Trajectories are packed W at a time into the lanes of a
+// T< Lanes<double,W> > graph, so every Taylor recurrence works on W
+// trajectories at once. Each lane picks its own step size; lanes that
+// reach tEnd, hit maxSteps, or for which stop(x,t) holds are frozen
+// (their state is no longer written) until the whole batch is done.
+// Batches are handed out to worker threads, each owning its own
+// recorded graph.
+
+template <int W, int N=MaxLength>
+class TaylorEnsemble
+{
+	typedef Lanes<double,W> P;
+	unsigned int m_dim;
+	unsigned int m_order;
+	double m_tol;
+	unsigned int m_maxSteps;
+public:
+	TaylorEnsemble(const unsigned int dim, const unsigned int order=20, const double tol=1e-14, const unsigned int maxSteps=100000):
+		m_dim(dim),m_order(order),m_tol(tol),m_maxSteps(maxSteps){}
+
+	// x0 and xEnd hold count trajectories of dim values each. tEnd
+	// receives the time at which each trajectory stopped (may be 0).
+	template <typename RHS, typename STOP>
+	TaylorEnsembleStats run(RHS rhs, STOP stop, const double* x0, double* xEnd, double* tEnd,
+		const unsigned long count, const double t0, const double t1, unsigned int threads=0) const
+	{
+		if (threads==0) threads=std::max(1u,std::thread::hardware_concurrency());
+		const unsigned long batches=(count+W-1)/W;
+		threads=(unsigned int)std::min<unsigned long>(threads,std::max(1ul,batches));
+		std::atomic<unsigned long> next(0);
+		std::vector<TaylorEnsembleStats> stats(threads);
+		std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+		std::vector<std::thread> workers;
+		for(unsigned int w=0;w<threads;++w)
+		{
+			workers.push_back(std::thread([&,w]()
+			{
+				TaylorODE<P,N> ode(m_dim,rhs,m_order);
+				unsigned long b;
+				while((b=next++)<batches) runBatch(ode,stop,x0,xEnd,tEnd,count,b*W,t0,t1,stats[w]);
+			}));
+		}
+		for(unsigned int w=0;w<threads;++w) workers[w].join();
+		TaylorEnsembleStats res;
+		for(unsigned int w=0;w<threads;++w)
+		{
+			res.steps+=stats[w].steps;
+			res.batchSteps+=stats[w].batchSteps;
+		}
+		res.trajectories=count;
+		res.seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+		return res;
+	}
+	template <typename RHS>
+	TaylorEnsembleStats run(RHS rhs, const double* x0, double* xEnd, double* tEnd,
+		const unsigned long count, const double t0, const double t1, unsigned int threads=0) const
+	{
+		return run(rhs,TaylorEnsembleNoStop(),x0,xEnd,tEnd,count,t0,t1,threads);
+	}
+
+private:
+	template <typename STOP>
+	void runBatch(TaylorODE<P,N>& ode, STOP& stop, const double* x0, double* xEnd, double* tEnd,
+		const unsigned long count, const unsigned long first, const double t0, const double t1,
+		TaylorEnsembleStats& stats) const
+	{
+		std::vector<P> x(m_dim), xn(m_dim);
+		std::vector<double> xl(m_dim);
+		P t(t0);
+		bool active[W];
+		unsigned int steps[W];
+		int nactive=0;
+		for(int l=0;l<W;++l)
+		{
+			// Unused tail lanes replay the first trajectory, masked from the start:
+			unsigned long j=first+l<count?first+l:first;
+			for(unsigned int i=0;i<m_dim;++i) x[i][l]=x0[j*m_dim+i];
+			active[l]=first+l<count && t0<t1;
+			steps[l]=0;
+			if (active[l]) ++nactive;
+		}
+		while(nactive>0)
+		{
+			ode.expand(&x[0]);
+			P h=ode.stepSize(m_tol);
+			for(int l=0;l<W;++l)
+			{
+				if (!active[l]) { h[l]=0; continue; }
+				if (h[l]>=t1-t[l]) h[l]=t1-t[l];
+			}
+			// Frozen lanes keep their state: summing them with h=0 would
+			// still turn an infinite coefficient into NaN (inf*0).
+			ode.advance(h,&xn[0]);
+			++stats.batchSteps;
+			for(int l=0;l<W;++l)
+			{
+				if (!active[l]) continue;
+				for(unsigned int i=0;i<m_dim;++i) x[i][l]=xn[i][l];
+				t[l]=(h[l]==t1-t[l])?t1:t[l]+h[l];
+				++steps[l];
+				++stats.steps;
+				for(unsigned int i=0;i<m_dim;++i) xl[i]=x[i][l];
+				if (t[l]>=t1 || steps[l]>=m_maxSteps || stop(&xl[0],t[l]))
+				{
+					active[l]=false;
+					--nactive;
+				}
+			}
+		}
+		for(int l=0;l<W && first+l<count;++l)
+		{
+			for(unsigned int i=0;i<m_dim;++i) xEnd[(first+l)*m_dim+i]=x[i][l];
+			if (tEnd) tEnd[first+l]=t[l];
+		}
+	}
+};
+
+} // namespace fadbad
+
+#endif
@@ -0,0 +1,225 @@
+//
+//  taylorode.h
+//  FADBADSwift
+//
+
+#ifndef _TAYLORODE_H
+#define _TAYLORODE_H
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#include "tadiff.h"
+#include "simdlanes.h"
+
+namespace fadbad
+{
+
+// Taylor series integrator for the autonomous system x'=f(x).
+//
+// The right-hand side is recorded once as a T<U,N> graph on state
+// variables created by odeVariable and bound to it, so every step only
+// re-seeds the state and evaluates the state variables once, letting the
+// nodes run the IVP recurrence internally.
+// The functor is called as rhs(x,f) with x,f being std::vector<T<U,N> >;
+// it should be a template (or generic lambda) so that it can also be
+// recorded on other coefficient types, e.g. T< Lanes<double,W> >.
+//
+// U may be a packed type (see simdlanes.h); step sizes are then chosen
+// per lane, and a zero step size leaves a lane untouched.
+//
+// Event (guard) functions are recorded as guards(x,g) next to the field
+// and expanded to the same order as the solution, so zero crossings are
+// located on the coefficient polynomials without further evaluations of
+// the right-hand side.
+
+template <typename U>
+U polyEval(const U* c, const unsigned int K, const U& s)
+{
+	U p=c[K];
+	for(unsigned int k=K;k-->0;) p=p*s+c[k];
+	return p;
+}
+
+// Finds the smallest root of sum_k c[k]*s^k in (smin,h]. The interval is
+// scanned for sign changes and the first bracket is refined with Newton
+// steps, falling back to bisection whenever Newton leaves the bracket.
+// Returns false if no sign change is found. A root at smin itself is
+// outside the interval: the scan starts from the sign just right of it.
+template <typename U>
+bool polyRoot(const U* c, const unsigned int K, const U& smin, const U& h, U& root, const unsigned int samples=16)
+{
+	U a=smin, pa=polyEval(c,K,a);
+	if (pa==0)
+		for(unsigned int k=K;k>0;--k) pa=pa*a+c[k]*U(k);
+	for(unsigned int m=1;m<=samples;++m)
+	{
+		U b=smin+(h-smin)*U(m)/U(samples), pb=polyEval(c,K,b);
+		if ((pa<0 && pb<0) || (pa>0 && pb>0) || pa==0) { a=b; pa=pb; continue; }
+		if (pb==0) { root=b; return true; }
+		U s=(a+b)/2;
+		for(unsigned int it=0;it<100;++it)
+		{
+			U p=c[K], dp=0;
+			for(unsigned int k=K;k-->0;) { dp=dp*s+p; p=p*s+c[k]; }
+			if (p==0) break;
+			if ((p<0)==(pa<0)) { a=s; pa=p; } else b=s;
+			if (b-a<=std::numeric_limits<U>::epsilon()*std::fabs(b)) { s=b; break; }
+			U sn=dp!=0?s-p/dp:a;
+			s=(sn>a && sn<b)?sn:(a+b)/2;
+		}
+		root=s;
+		return true;
+	}
+	return false;
+}
+
+template <typename U, int N=MaxLength>
+class TaylorODE
+{
+public:
+	typedef TTypeName<U,N> TType;
+	typedef LaneTraits<U> Lane;
+	typedef typename Lane::Scalar Scalar;
+private:
+	unsigned int m_dim;
+	unsigned int m_order;
+	std::vector<TType> m_x;
+	std::vector<TType> m_f;
+	std::vector<TType> m_g;
+	TaylorODE(const TaylorODE<U,N>&); // not allowed
+	void operator=(const TaylorODE<U,N>&); // not allowed
+public:
+	template <typename RHS>
+	TaylorODE(const unsigned int dim, RHS rhs, const unsigned int order=20):
+		m_dim(dim),m_order(std::min<unsigned int>(order,N-1)),m_x(dim),m_f(dim)
+	{
+		USER_ASSERT(order>1 && order<N,"Order "<<order<<" out of range [2,"<<N-1<<"]")
+		TTypeNameDeferred deferred; // every expand() starts from order 0
+		for(unsigned int i=0;i<m_dim;++i) m_x[i]=odeVariable<U,N>(Op<U>::myZero());
+		rhs(m_x,m_f);
+		for(unsigned int i=0;i<m_dim;++i) odeBind(m_x[i],m_f[i]);
+	}
+	template <typename RHS, typename GUARDS>
+	TaylorODE(const unsigned int dim, RHS rhs, const unsigned int nguards, GUARDS guards, const unsigned int order=20):
+		m_dim(dim),m_order(std::min<unsigned int>(order,N-1)),m_x(dim),m_f(dim),m_g(nguards)
+	{
+		USER_ASSERT(order>1 && order<N,"Order "<<order<<" out of range [2,"<<N-1<<"]")
+		TTypeNameDeferred deferred; // every expand() starts from order 0
+		for(unsigned int i=0;i<m_dim;++i) m_x[i]=odeVariable<U,N>(Op<U>::myZero());
+		rhs(m_x,m_f);
+		for(unsigned int i=0;i<m_dim;++i) odeBind(m_x[i],m_f[i]);
+		guards(m_x,m_g);
+	}
+	unsigned int dim() const { return m_dim; }
+	unsigned int order() const { return m_order; }
+	unsigned int guards() const { return (unsigned int)m_g.size(); }
+	void setOrder(const unsigned int order)
+	{
+		USER_ASSERT(order>1 && order<N,"Order "<<order<<" out of range [2,"<<N-1<<"]")
+		m_order=order;
+	}
+	std::vector<TType>& state() { return m_x; }
+	std::vector<TType>& field() { return m_f; }
+	std::vector<TType>& guardFunctions() { return m_g; }
+
+	// Computes the Taylor coefficients of the solution through x0.
+	void expand(const U* x0)
+	{
+		for(unsigned int i=0;i<m_dim;++i) m_x[i].reset();
+		for(unsigned int j=0;j<m_g.size();++j) m_g[j].reset();
+		for(unsigned int i=0;i<m_dim;++i) m_x[i][0]=x0[i];
+		for(unsigned int i=0;i<m_dim;++i) m_x[i].eval(m_order);
+		for(unsigned int j=0;j<m_g.size();++j) m_g[j].eval(m_order);
+	}
+	const U& coeff(const unsigned int i, const unsigned int k) const { return m_x[i][k]; }
+	const U& guardCoeff(const unsigned int j, const unsigned int k) const { return m_g[j][k]; }
+
+	// Locates the first zero crossing of a guard in (0,h] on the current
+	// expansion. Roots closer to 0 than a tiny fraction of h are ignored,
+	// so that integration can be resumed from an event. Returns the guard
+	// index, or -1 if no guard changes sign; s receives the crossing.
+	int locateEvent(const U& h, U& s) const
+	{
+		int event=-1;
+		U best=h, smin=h*U(16)*std::numeric_limits<U>::epsilon(), c[N], root;
+		for(unsigned int j=0;j<m_g.size();++j)
+		{
+			for(unsigned int k=0;k<=m_order;++k) c[k]=m_g[j][k];
+			if (polyRoot(c,m_order,smin,best,root) && (event<0 || root<best))
+			{
+				best=root;
+				event=(int)j;
+			}
+		}
+		if (event>=0) s=best;
+		return event;
+	}
+
+	// Step size from the last two coefficients (Jorba & Zou), such that
+	// the first neglected terms are below tol relative to max(1,|x|).
+	U stepSize(const Scalar& tol) const
+	{
+		U h;
+		for(int l=0;l<Lane::width;++l)
+		{
+			Scalar xnorm=1, c1=0, c2=0;
+			for(unsigned int i=0;i<m_dim;++i)
+			{
+				xnorm=std::max(xnorm,std::fabs(Lane::lane(m_x[i][0],l)));
+				c1=std::max(c1,std::fabs(Lane::lane(m_x[i][m_order-1],l)));
+				c2=std::max(c2,std::fabs(Lane::lane(m_x[i][m_order],l)));
+			}
+			Scalar eps=tol*xnorm;
+			Scalar r1=c1>0?std::pow(eps/c1,Scalar(1)/Scalar(m_order-1)):Scalar(HUGE_VAL);
+			Scalar r2=c2>0?std::pow(eps/c2,Scalar(1)/Scalar(m_order)):Scalar(HUGE_VAL);
+			Lane::lane(h,l)=Scalar(0.9)*std::min(r1,r2);
+		}
+		return h;
+	}
+
+	// Sums the expansion at h: x=sum_k coeff(.,k)*h^k.
+	void advance(const U& h, U* x) const
+	{
+		for(unsigned int i=0;i<m_dim;++i)
+		{
+			U s=m_x[i][m_order];
+			for(unsigned int k=m_order;k-->0;) s=s*h+m_x[i][k];
+			x[i]=s;
+		}
+	}
+
+	// Integrates x from t to tEnd. Returns the number of steps taken.
+	unsigned int integrate(Scalar& t, Scalar* x, const Scalar& tEnd, const Scalar& tol, const unsigned int maxSteps=100000)
+	{
+		int event;
+		return integrate(t,x,tEnd,tol,event,maxSteps);
+	}
+
+	// As above, but stops at the first zero crossing of a guard, leaving
+	// t and x at the crossing and its index in event (-1 if none).
+	unsigned int integrate(Scalar& t, Scalar* x, const Scalar& tEnd, const Scalar& tol, int& event, const unsigned int maxSteps=100000)
+	{
+		unsigned int n=0;
+		event=-1;
+		while(t<tEnd && n<maxSteps)
+		{
+			expand(x);
+			Scalar h=std::min(stepSize(tol),tEnd-t);
+			bool last=tEnd-t<=h;
+			Scalar s;
+			if (!m_g.empty() && (event=locateEvent(h,s))>=0) { h=s; last=false; }
+			advance(h,x);
+			t=last?tEnd:t+h;
+			++n;
+			if (event>=0) break;
+		}
+		return n;
+	}
+};
+
+} // namespace fadbad
+
+#endif
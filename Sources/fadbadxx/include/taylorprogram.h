@@ -0,0 +1,396 @@
+//
+//  taylorprogram.h
+//  FADBADSwift
+//
+
+#ifndef _TAYLORPROGRAM_H
+#define _TAYLORPROGRAM_H
+
+#include <vector>
+#include <algorithm>
+
+#include "tape.h"
+
+namespace fadbad
+{
+
+// Compiled Taylor programs.
+//
+// A function recorded on a Tape is compiled into a list of series
+// instructions, each computing all K+1 coefficients of one operation
+// before the next runs. Evaluated that way a T<U> graph keeps every
+// node's coefficient array until the graph dies; here the compiler
+// computes the live range of every value, from its operation to its
+// last use, and assigns coefficient buffers from a pool like a register
+// allocator: a buffer is returned to the pool after the last read of
+// its value and reused by the next operation that needs one. Peak
+// memory is the largest number of values live at once times K+1
+// instead of the number of operations times K+1, and the working set
+// stays in cache. Auxiliary series (cos for sin, 1+t^2 for tan and so
+// on) live in scratch buffers shared by all instructions.
+//
+// Dead operations are not compiled. The inputs are all loaded before
+// the first instruction runs, so their buffers are allocated up front
+// and enter the pool only after their last use. An output is copied out
+// as soon as it is computed, so its buffer is released like any other.
+// The number of buffers depends on the order of the tape: compiling a
+// tape reordered by tapeRenumber (tapeopt.h), where every value is
+// computed next to its readers, shortens the live ranges.
+//
+// Programs are compiled from Tape recordings only, so the function has
+// to be written as a template over the scalar type and recorded on
+// TapeVar. T<U> graphs are not compiled: graphs with nodes that have no
+// Tape operation, such as the ODE state of TaylorODE or Param constants,
+// keep evaluating on T.
+
+enum TaylorProgramCode
+{
+	TaylorProgramOUTPUT=TapeCodes // copy buffer a to output dst
+};
+
+struct TaylorInstr
+{
+	unsigned int code;
+	unsigned int dst, a, b; // buffers (outputs index for OUTPUT)
+	double c;
+};
+
+template <typename U>
+class TaylorProgram
+{
+	std::vector<TaylorInstr> m_code;
+	std::vector<unsigned int> m_inputs; // buffer of every input
+	unsigned int m_outputs, m_buffers, m_operations;
+	unsigned int m_n; // coefficients per buffer, K+1
+	std::vector<U> m_pool, m_s1, m_s2;
+
+	U* buf(const unsigned int i) { return &m_pool[i*m_n]; }
+
+	// The kernels compute coefficients k0..n-1, reading the ones below k0
+	// of their result and auxiliary series as already computed; k0 is 0
+	// except in MixedTaylorProgram, which starts the high orders at split.
+	// c=a*b (convolution):
+	static void mul(const U* a, const U* b, U* c, const unsigned int k0, const unsigned int n)
+	{
+		for(unsigned int k=k0;k<n;++k)
+		{
+			U s=a[0]*b[k];
+			for(unsigned int i=1;i<=k;++i) Op<U>::myCadd(s,a[i]*b[k-i]);
+			c[k]=s;
+		}
+	}
+	// c with b*c=a:
+	static void div(const U* a, const U* b, U* c, const unsigned int k0, const unsigned int n)
+	{
+		for(unsigned int k=k0;k<n;++k)
+		{
+			U s=a[k];
+			for(unsigned int i=0;i<k;++i) Op<U>::myCsub(s,c[i]*b[k-i]);
+			c[k]=s/b[0];
+		}
+	}
+	// y with w*y'=a' and y[0] given:
+	static void integrateQuotient(const U* a, const U* w, U* y, const unsigned int k0, const unsigned int n)
+	{
+		for(unsigned int k=std::max(k0,1u);k<n;++k)
+		{
+			U s=a[k]*Op<U>::myInteger(k);
+			for(unsigned int i=1;i<k;++i) Op<U>::myCsub(s,y[i]*w[k-i]*Op<U>::myInteger(i));
+			y[k]=s/(w[0]*Op<U>::myInteger(k));
+		}
+	}
+	// y with y'=a'*u and y[0] given:
+	static void integrateProduct(const U* a, const U* u, U* y, const unsigned int k0, const unsigned int n)
+	{
+		for(unsigned int k=std::max(k0,1u);k<n;++k)
+		{
+			U s=a[1]*u[k-1];
+			for(unsigned int i=2;i<=k;++i) Op<U>::myCadd(s,a[i]*u[k-i]*Op<U>::myInteger(i));
+			y[k]=s/Op<U>::myInteger(k);
+		}
+	}
+	static void sqrtSeries(const U* a, U* c, const unsigned int k0, const unsigned int n)
+	{
+		if (k0==0) c[0]=Op<U>::mySqrt(a[0]);
+		for(unsigned int k=std::max(k0,1u);k<n;++k)
+		{
+			U s=a[k];
+			for(unsigned int i=1;i<k;++i) Op<U>::myCsub(s,c[i]*c[k-i]);
+			c[k]=s/(c[0]*Op<U>::myTwo());
+		}
+	}
+	static void expSeries(const U* a, U* c, const unsigned int k0, const unsigned int n)
+	{
+		if (k0==0) c[0]=Op<U>::myExp(a[0]);
+		integrateProduct(a,c,c,k0,n);
+	}
+	static void logSeries(const U* a, U* c, const unsigned int k0, const unsigned int n)
+	{
+		if (k0==0) c[0]=Op<U>::myLog(a[0]);
+		integrateQuotient(a,a,c,k0,n);
+	}
+	// s=sin(a), co=cos(a):
+	static void sinCos(const U* a, U* s, U* co, const unsigned int k0, const unsigned int n)
+	{
+		if (k0==0)
+		{
+			s[0]=Op<U>::mySin(a[0]);
+			co[0]=Op<U>::myCos(a[0]);
+		}
+		for(unsigned int k=std::max(k0,1u);k<n;++k)
+		{
+			U ss=a[1]*co[k-1], sc=a[1]*s[k-1];
+			for(unsigned int i=2;i<=k;++i)
+			{
+				Op<U>::myCadd(ss,a[i]*co[k-i]*Op<U>::myInteger(i));
+				Op<U>::myCadd(sc,a[i]*s[k-i]*Op<U>::myInteger(i));
+			}
+			s[k]=ss/Op<U>::myInteger(k);
+			co[k]=Op<U>::myNeg(sc)/Op<U>::myInteger(k);
+		}
+	}
+	void run(const TaylorInstr& in, U* y, const unsigned int k0=0)
+	{
+		const unsigned int n=m_n, k1=std::max(k0,1u);
+		U* c=buf(in.dst);
+		const U* a=buf(in.a);
+		const U* b=buf(in.b);
+		U* s1=&m_s1[0];
+		U* s2=&m_s2[0];
+		const U k=U(in.c);
+		switch(in.code)
+		{
+		case TapeCONST: if (k0==0) c[0]=k; for(unsigned int i=k1;i<n;++i) c[i]=Op<U>::myZero(); break;
+		case TapeADD: for(unsigned int i=k0;i<n;++i) c[i]=a[i]+b[i]; break;
+		case TapeSUB: for(unsigned int i=k0;i<n;++i) c[i]=a[i]-b[i]; break;
+		case TapeMUL: mul(a,b,c,k0,n); break;
+		case TapeDIV: div(a,b,c,k0,n); break;
+		case TapeNEG: for(unsigned int i=k0;i<n;++i) c[i]=Op<U>::myNeg(a[i]); break;
+		case TapeADDC: if (k0==0) c[0]=a[0]+k; for(unsigned int i=k1;i<n;++i) c[i]=a[i]; break;
+		case TapeCSUB: if (k0==0) c[0]=k-a[0]; for(unsigned int i=k1;i<n;++i) c[i]=Op<U>::myNeg(a[i]); break;
+		case TapeMULC: for(unsigned int i=k0;i<n;++i) c[i]=a[i]*k; break;
+		case TapeDIVC: for(unsigned int i=k0;i<n;++i) c[i]=a[i]/k; break;
+		case TapeCDIV:
+			s1[0]=k;
+			for(unsigned int i=1;i<n;++i) s1[i]=Op<U>::myZero();
+			div(s1,a,c,k0,n);
+			break;
+		case TapeSQR: mul(a,a,c,k0,n); break;
+		case TapePOWC:
+			// a*y'=k*y*a':
+			if (k0==0) c[0]=Op<U>::myPow(a[0],k);
+			for(unsigned int j=k1;j<n;++j)
+			{
+				U s=Op<U>::myZero();
+				for(unsigned int i=1;i<=j;++i) Op<U>::myCadd(s,a[i]*c[j-i]*(k*Op<U>::myInteger(i)-Op<U>::myInteger(j-i)));
+				c[j]=s/(a[0]*Op<U>::myInteger(j));
+			}
+			break;
+		case TapePOW: // exp(b*log(a))
+			logSeries(a,s1,k0,n);
+			mul(b,s1,s2,k0,n);
+			expSeries(s2,c,k0,n);
+			break;
+		case TapeSQRT: sqrtSeries(a,c,k0,n); break;
+		case TapeEXP: expSeries(a,c,k0,n); break;
+		case TapeLOG: logSeries(a,c,k0,n); break;
+		case TapeSIN: sinCos(a,c,s1,k0,n); break;
+		case TapeCOS: sinCos(a,s1,c,k0,n); break;
+		case TapeTAN: // c'=(1+c^2)*a'
+			if (k0==0)
+			{
+				c[0]=Op<U>::myTan(a[0]);
+				s1[0]=Op<U>::myOne()+c[0]*c[0];
+			}
+			for(unsigned int j=k1;j<n;++j)
+			{
+				U s=a[1]*s1[j-1];
+				for(unsigned int i=2;i<=j;++i) Op<U>::myCadd(s,a[i]*s1[j-i]*Op<U>::myInteger(i));
+				c[j]=s/Op<U>::myInteger(j);
+				U q=c[0]*c[j];
+				for(unsigned int i=1;i<=j;++i) Op<U>::myCadd(q,c[i]*c[j-i]);
+				s1[j]=q;
+			}
+			break;
+		case TapeASIN: case TapeACOS: // sqrt(1-a^2)*c'=+-a'
+			mul(a,a,s2,k0,n);
+			for(unsigned int i=k0;i<n;++i) s2[i]=Op<U>::myNeg(s2[i]);
+			if (k0==0) Op<U>::myCadd(s2[0],Op<U>::myOne());
+			sqrtSeries(s2,s1,k0,n);
+			if (in.code==TapeASIN)
+			{
+				if (k0==0) c[0]=Op<U>::myAsin(a[0]);
+				integrateQuotient(a,s1,c,k0,n);
+			}
+			else
+			{
+				for(unsigned int i=k0;i<n;++i) s2[i]=Op<U>::myNeg(a[i]);
+				if (k0==0) c[0]=Op<U>::myAcos(a[0]);
+				integrateQuotient(s2,s1,c,k0,n);
+			}
+			break;
+		case TapeATAN: // (1+a^2)*c'=a'
+			mul(a,a,s1,k0,n);
+			if (k0==0)
+			{
+				Op<U>::myCadd(s1[0],Op<U>::myOne());
+				c[0]=Op<U>::myAtan(a[0]);
+			}
+			integrateQuotient(a,s1,c,k0,n);
+			break;
+		case TaylorProgramOUTPUT: std::copy(a+k0,a+n,y+in.dst*n+k0); break;
+		}
+	}
+	template <typename, typename> friend class MixedTaylorProgram;
+public:
+	// Compiles tape for Taylor expansions to the given order.
+	TaylorProgram(const Tape& tape, const unsigned int order):m_outputs(tape.outputs()),m_buffers(0),m_operations(0),m_n(order+1)
+	{
+		const unsigned int size=tape.size();
+		const unsigned int None=~0u;
+		// last reader of every slot; outputs read at their definition:
+		std::vector<unsigned int> last(size,None);
+		std::vector< std::vector<unsigned int> > outputsOf(size);
+		for(unsigned int k=0;k<tape.outputs();++k)
+		{
+			const unsigned int o=tape.output(k);
+			outputsOf[o].push_back(k);
+			last[o]=o;
+		}
+		for(unsigned int i=size;i-->0;)
+		{
+			const TapeOp& op=tape.op(i);
+			if (last[i]==None || op.code==TapeINPUT || op.code==TapeCONST) continue;
+			if (last[op.a]==None || last[op.a]<i) last[op.a]=i;
+			if (tapeIsBinary(op.code) && (last[op.b]==None || last[op.b]<i)) last[op.b]=i;
+		}
+		std::vector<unsigned int> buffer(size,None), pool;
+		for(unsigned int j=0;j<tape.inputs();++j)
+		{
+			buffer[tape.input(j)]=m_buffers++;
+			m_inputs.push_back(buffer[tape.input(j)]);
+		}
+		for(unsigned int i=0;i<size;++i)
+		{
+			const TapeOp& op=tape.op(i);
+			if (op.code!=TapeINPUT && last[i]==None) continue;
+			if (op.code!=TapeINPUT)
+			{
+				if (pool.empty()) pool.push_back(m_buffers++);
+				buffer[i]=pool.back();
+				pool.pop_back();
+				TaylorInstr in={op.code,buffer[i],
+					op.code==TapeCONST?buffer[i]:buffer[op.a],
+					tapeIsBinary(op.code)?buffer[op.b]:buffer[i],
+					tapeHasConstant(op.code)?tape.constant(op.b):0.0};
+				m_code.push_back(in);
+				++m_operations;
+			}
+			for(unsigned int k=0;k<outputsOf[i].size();++k)
+			{
+				TaylorInstr out={TaylorProgramOUTPUT,outputsOf[i][k],buffer[i],buffer[i],0.0};
+				m_code.push_back(out);
+			}
+			// release the operands read for the last time, and the
+			// value itself if nothing reads it:
+			if (op.code!=TapeINPUT && op.code!=TapeCONST)
+			{
+				if (last[op.a]==i) pool.push_back(buffer[op.a]);
+				if (tapeIsBinary(op.code) && op.b!=op.a && last[op.b]==i) pool.push_back(buffer[op.b]);
+			}
+			if (last[i]==i || last[i]==None) pool.push_back(buffer[i]);
+		}
+		m_pool.assign(m_buffers*m_n,Op<U>::myZero());
+		m_s1.assign(m_n,Op<U>::myZero());
+		m_s2.assign(m_n,Op<U>::myZero());
+	}
+	unsigned int order() const { return m_n-1; }
+	unsigned int inputs() const { return (unsigned int)m_inputs.size(); }
+	unsigned int outputs() const { return m_outputs; }
+	unsigned int operations() const { return m_operations; }
+	// Coefficient buffers after allocation: the peak number of live values.
+	unsigned int buffers() const { return m_buffers; }
+
+	// Expands the outputs y (outputs() x (K+1), output-major) from the
+	// coefficients x of the inputs (inputs() x (K+1), input-major).
+	void evaluate(const U* x, U* y)
+	{
+		for(unsigned int j=0;j<m_inputs.size();++j) std::copy(x+j*m_n,x+(j+1)*m_n,buf(m_inputs[j]));
+		const unsigned int n=(unsigned int)m_code.size();
+		for(unsigned int i=0;i<n;++i) run(m_code[i],y);
+	}
+};
+
+// Mixed precision program: the coefficients below order split are
+// computed in L and the others in H, for instance L=double and H=float.
+// The tape is compiled twice with the same buffer assignment, once to
+// order split-1 in L and once to the full order in H, and the two run
+// instruction by instruction: the L instruction computes the low orders
+// of its value and auxiliary series, they are converted into the H
+// buffers, and the H instruction computes only the orders from split on,
+// which read the lower ones through the recurrences. Every coefficient is
+// computed once. The low orders, which carry the value of the series at
+// small steps, keep the precision of L; the high orders, where most of
+// the O(K^2) work is, run on H and are accurate to about the precision of
+// H relative to their size. Scalar float arithmetic costs what double
+// does, so the time saved is on packs: MixedTaylorProgram<Lanes<double,W>,
+// Lanes<float,W> > runs twice the lanes per vector instruction on the
+// high orders (with subnormals flushed, see precision.h).
+template <typename L, typename H>
+class MixedTaylorProgram
+{
+	TaylorProgram<L> m_low;
+	TaylorProgram<H> m_high;
+	unsigned int m_split;
+	std::vector<L> m_yl;
+	std::vector<H> m_yh;
+
+	void convert(const L* l, H* h) const
+	{
+		for(unsigned int k=0;k<m_split;++k) h[k]=H(l[k]);
+	}
+public:
+	MixedTaylorProgram(const Tape& tape, const unsigned int order, const unsigned int split):
+		m_low(tape,std::min(std::max(split,1u),order+1)-1),m_high(tape,order),
+		m_split(std::min(std::max(split,1u),order+1)),
+		m_yl(m_low.outputs()*m_split),m_yh(m_high.outputs()*(order+1)){}
+	unsigned int order() const { return m_high.order(); }
+	unsigned int split() const { return m_split; }
+	unsigned int inputs() const { return m_high.inputs(); }
+	unsigned int outputs() const { return m_high.outputs(); }
+
+	// As TaylorProgram::evaluate, with x and y in L.
+	void evaluate(const L* x, L* y)
+	{
+		const unsigned int n=order()+1, ns=m_split;
+		for(unsigned int j=0;j<inputs();++j)
+		{
+			L* xl=m_low.buf(m_low.m_inputs[j]);
+			H* xh=m_high.buf(m_high.m_inputs[j]);
+			for(unsigned int k=0;k<ns;++k) xl[k]=x[j*n+k];
+			for(unsigned int k=0;k<n;++k) xh[k]=H(x[j*n+k]);
+		}
+		const unsigned int size=(unsigned int)m_low.m_code.size();
+		for(unsigned int i=0;i<size;++i)
+		{
+			const TaylorInstr& in=m_low.m_code[i];
+			m_low.run(in,&m_yl[0]);
+			if (in.code!=TaylorProgramOUTPUT)
+			{
+				convert(m_low.buf(in.dst),m_high.buf(in.dst));
+				convert(&m_low.m_s1[0],&m_high.m_s1[0]);
+				convert(&m_low.m_s2[0],&m_high.m_s2[0]);
+			}
+			m_high.run(in,&m_yh[0],ns);
+		}
+		for(unsigned int i=0;i<outputs();++i)
+		{
+			for(unsigned int k=0;k<ns;++k) y[i*n+k]=m_yl[i*ns+k];
+			for(unsigned int k=ns;k<n;++k) y[i*n+k]=L(m_yh[i*n+k]);
+		}
+	}
+};
+
+} // namespace fadbad
+
+#endif
@@ -0,0 +1,351 @@
+//
+//  tiered.h
+//  FADBADSwift
+//
+
+#ifndef _TIERED_H
+#define _TIERED_H
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+
+#ifdef FADBAD_NATIVE_TIER
+#include <dlfcn.h>
+#include <unistd.h>
+#endif
+
+#include "tape.h"
+#include "tapeopt.h"
+
+namespace fadbad
+{
+
+// Tiered execution of a recorded function.
+//
+// A TieredTape counts its evaluations and runs them on the cheapest tier
+// that has paid off so far:
+//
+// - TierINTERPRETED replays the tape as recorded;
+// - TierOPTIMIZED replays a copy run through optimize and tapeRenumber
+//   (tapeopt.h): folded, shared and reordered for locality;
+// - TierNATIVE, when compiled with FADBAD_NATIVE_TIER, runs the
+//   optimized tape generated as C (tapeSource), compiled by the system
+//   compiler into a shared library and loaded with dlopen. The compiler
+//   is $FADBAD_CC, or cc.
+//
+// When the count reaches hot[tier] the next tier is built, by default on
+// a background thread while callers keep running on the current one,
+// and then published with one atomic store; callers pick up the new tier
+// on their next call. Tiers are never freed before the TieredTape, so a
+// call still running on an older tier is never interrupted. A tier that
+// cannot be built (native code disabled, too large, or the compiler
+// failing) ends the promotions. evaluate and gradient may be called from
+// any number of threads; each thread replays on its own buffers.
+
+enum TieredTier
+{
+	TierINTERPRETED, TierOPTIMIZED, TierNATIVE, Tiers
+};
+
+struct TieredStats
+{
+	unsigned int tier; // tier running new calls
+	unsigned long long hits[Tiers]; // calls run on each tier
+	double promotionSeconds[Tiers]; // from reaching hot[tier] to the tier running
+	TieredStats():tier(TierINTERPRETED)
+	{
+		for(unsigned int t=0;t<Tiers;++t) { hits[t]=0; promotionSeconds[t]=0; }
+	}
+};
+
+// C literal of c, exact:
+inline std::string tapeLiteral(const double c)
+{
+	if (c!=c) return "(0.0/0.0)";
+	if (c==HUGE_VAL) return "(1.0/0.0)";
+	if (c==-HUGE_VAL) return "(-1.0/0.0)";
+	std::ostringstream s;
+	s<<std::hexfloat<<c;
+	return "("+s.str()+")";
+}
+
+// C source of tape as the function
+//	void name(const double* x, double* y, double* g, double* v, double* w)
+// with the outputs y, the gradient g of the first output unless g is 0,
+// and slot arrays v and w of size tape.size().
+inline std::string tapeSource(const Tape& tape, const std::string& name)
+{
+	std::ostringstream s;
+	s<<"#include <math.h>\n#include <string.h>\n";
+	s<<"void "<<name<<"(const double* x, double* y, double* g, double* v, double* w)\n{\n";
+	for(unsigned int j=0;j<tape.inputs();++j) s<<"v["<<tape.input(j)<<"]=x["<<j<<"];\n";
+	for(unsigned int i=0;i<tape.size();++i)
+	{
+		const TapeOp& op=tape.op(i);
+		if (op.code==TapeINPUT) continue;
+		const std::string c=tapeHasConstant(op.code)?tapeLiteral(tape.constant(op.b)):"";
+		s<<"v["<<i<<"]=";
+		switch(op.code)
+		{
+		case TapeCONST: s<<c; break;
+		case TapeADD: s<<"v["<<op.a<<"]+v["<<op.b<<"]"; break;
+		case TapeSUB: s<<"v["<<op.a<<"]-v["<<op.b<<"]"; break;
+		case TapeMUL: s<<"v["<<op.a<<"]*v["<<op.b<<"]"; break;
+		case TapeDIV: s<<"v["<<op.a<<"]/v["<<op.b<<"]"; break;
+		case TapeNEG: s<<"-v["<<op.a<<"]"; break;
+		case TapeADDC: s<<"v["<<op.a<<"]+"<<c; break;
+		case TapeCSUB: s<<c<<"-v["<<op.a<<"]"; break;
+		case TapeMULC: s<<"v["<<op.a<<"]*"<<c; break;
+		case TapeDIVC: s<<"v["<<op.a<<"]/"<<c; break;
+		case TapeCDIV: s<<c<<"/v["<<op.a<<"]"; break;
+		case TapeSQR: s<<"v["<<op.a<<"]*v["<<op.a<<"]"; break;
+		case TapePOWC: s<<"pow(v["<<op.a<<"],"<<c<<")"; break;
+		case TapePOW: s<<"pow(v["<<op.a<<"],v["<<op.b<<"])"; break;
+		case TapeSQRT: s<<"sqrt(v["<<op.a<<"])"; break;
+		case TapeEXP: s<<"exp(v["<<op.a<<"])"; break;
+		case TapeLOG: s<<"log(v["<<op.a<<"])"; break;
+		case TapeSIN: s<<"sin(v["<<op.a<<"])"; break;
+		case TapeCOS: s<<"cos(v["<<op.a<<"])"; break;
+		case TapeTAN: s<<"tan(v["<<op.a<<"])"; break;
+		case TapeASIN: s<<"asin(v["<<op.a<<"])"; break;
+		case TapeACOS: s<<"acos(v["<<op.a<<"])"; break;
+		case TapeATAN: s<<"atan(v["<<op.a<<"])"; break;
+		}
+		s<<";\n";
+	}
+	for(unsigned int k=0;k<tape.outputs();++k) s<<"y["<<k<<"]=v["<<tape.output(k)<<"];\n";
+	if (tape.outputs()>0)
+	{
+		s<<"if (!g) return;\nmemset(w,0,"<<tape.size()<<"*sizeof(double));\n";
+		s<<"w["<<tape.output(0)<<"]=1;\n";
+		for(unsigned int i=tape.size();i-->0;)
+		{
+			const TapeOp& op=tape.op(i);
+			if (op.code==TapeINPUT || op.code==TapeCONST) continue;
+			const std::string c=tapeHasConstant(op.code)?tapeLiteral(tape.constant(op.b)):"";
+			const std::string a="w["+std::to_string(op.a)+"]", b="w["+std::to_string(op.b)+"]";
+			const std::string wi="w["+std::to_string(i)+"]", vi="v["+std::to_string(i)+"]";
+			const std::string va="v["+std::to_string(op.a)+"]", vb="v["+std::to_string(op.b)+"]";
+			switch(op.code)
+			{
+			case TapeADD: s<<a<<"+="<<wi<<"; "<<b<<"+="<<wi; break;
+			case TapeSUB: s<<a<<"+="<<wi<<"; "<<b<<"-="<<wi; break;
+			case TapeMUL: s<<a<<"+="<<wi<<"*"<<vb<<"; "<<b<<"+="<<wi<<"*"<<va; break;
+			case TapeDIV: s<<"{ double t="<<wi<<"/"<<vb<<"; "<<a<<"+=t; "<<b<<"-=t*"<<vi<<"; }"; break;
+			case TapeNEG: s<<a<<"-="<<wi; break;
+			case TapeADDC: s<<a<<"+="<<wi; break;
+			case TapeCSUB: s<<a<<"-="<<wi; break;
+			case TapeMULC: s<<a<<"+="<<wi<<"*"<<c; break;
+			case TapeDIVC: s<<a<<"+="<<wi<<"/"<<c; break;
+			case TapeCDIV: s<<a<<"-="<<wi<<"*"<<vi<<"/"<<va; break;
+			case TapeSQR: s<<a<<"+="<<wi<<"*"<<va<<"*2.0"; break;
+			case TapePOWC: s<<a<<"+="<<wi<<"*"<<c<<"*pow("<<va<<","<<c<<"-1)"; break;
+			case TapePOW:
+				s<<a<<"+="<<wi<<"*"<<vb<<"*pow("<<va<<","<<vb<<"-1.0); ";
+				s<<b<<"+="<<wi<<"*"<<vi<<"*log("<<va<<")";
+				break;
+			case TapeSQRT: s<<a<<"+="<<wi<<"/("<<vi<<"*2.0)"; break;
+			case TapeEXP: s<<a<<"+="<<wi<<"*"<<vi; break;
+			case TapeLOG: s<<a<<"+="<<wi<<"/"<<va; break;
+			case TapeSIN: s<<a<<"+="<<wi<<"*cos("<<va<<")"; break;
+			case TapeCOS: s<<a<<"-="<<wi<<"*sin("<<va<<")"; break;
+			case TapeTAN: s<<a<<"+="<<wi<<"*("<<vi<<"*"<<vi<<"+1.0)"; break;
+			case TapeASIN: s<<a<<"+="<<wi<<"/sqrt(1.0-"<<va<<"*"<<va<<")"; break;
+			case TapeACOS: s<<a<<"-="<<wi<<"/sqrt(1.0-"<<va<<"*"<<va<<")"; break;
+			case TapeATAN: s<<a<<"+="<<wi<<"/("<<va<<"*"<<va<<"+1.0)"; break;
+			}
+			s<<";\n";
+		}
+		for(unsigned int j=0;j<tape.inputs();++j) s<<"g["<<j<<"]=w["<<tape.input(j)<<"];\n";
+	}
+	s<<"}\n";
+	return s.str();
+}
+
+class TieredTape
+{
+	// One tier: a replay of outputs y and, unless g is 0, the gradient
+	// g of the first output, on slot buffers v and w of size().
+	class Program
+	{
+	public:
+		virtual ~Program(){}
+		virtual unsigned int size() const=0;
+		virtual void run(const double* x, double* y, double* g, double* v, double* w) const=0;
+	};
+	class Interpreted : public Program
+	{
+		Tape m_tape;
+	public:
+		Interpreted(const Tape& tape, const bool optimized):m_tape(tape)
+		{
+			if (optimized) { optimize(m_tape); tapeRenumber(m_tape); }
+		}
+		const Tape& tape() const { return m_tape; }
+		unsigned int size() const { return m_tape.size(); }
+		void run(const double* x, double* y, double* g, double* v, double* w) const
+		{
+			for(unsigned int j=0;j<m_tape.inputs();++j) v[m_tape.input(j)]=x[j];
+			m_tape.forward(v);
+			for(unsigned int k=0;k<m_tape.outputs();++k) y[k]=v[m_tape.output(k)];
+			if (!g) return;
+			std::fill(w,w+m_tape.size(),0.0);
+			w[m_tape.output(0)]=1.0;
+			m_tape.reverse(v,w);
+			for(unsigned int j=0;j<m_tape.inputs();++j) g[j]=w[m_tape.input(j)];
+		}
+	};
+#ifdef FADBAD_NATIVE_TIER
+	class Native : public Program
+	{
+		typedef void (*Function)(const double*, double*, double*, double*, double*);
+		void* m_library;
+		Function m_function;
+		unsigned int m_size;
+	public:
+		explicit Native(const Tape& tape):m_library(0),m_function(0),m_size(tape.size())
+		{
+			char dir[]="/tmp/fadbadXXXXXX";
+			if (!mkdtemp(dir)) return;
+			const std::string source=std::string(dir)+"/tier.c", library=std::string(dir)+"/tier.so";
+			if (FILE* f=std::fopen(source.c_str(),"w"))
+			{
+				const std::string text=tapeSource(tape,"fadbad_tier");
+				const bool written=std::fwrite(text.data(),1,text.size(),f)==text.size();
+				if (std::fclose(f)==0 && written)
+				{
+					const char* cc=std::getenv("FADBAD_CC");
+					const std::string command=std::string(cc?cc:"cc")+" -O2 -ffp-contract=off -shared -fPIC -o "+library+" "+source+" -lm";
+					if (std::system(command.c_str())==0) m_library=dlopen(library.c_str(),RTLD_NOW|RTLD_LOCAL);
+				}
+			}
+			if (m_library) m_function=(Function)dlsym(m_library,"fadbad_tier");
+			unlink(library.c_str());
+			unlink(source.c_str());
+			rmdir(dir);
+		}
+		~Native() { if (m_library) dlclose(m_library); }
+		bool loaded() const { return m_function!=0; }
+		unsigned int size() const { return m_size; }
+		void run(const double* x, double* y, double* g, double* v, double* w) const { m_function(x,y,g,v,w); }
+	};
+#endif
+
+	std::unique_ptr<Program> m_programs[Tiers];
+	std::atomic<unsigned int> m_tier;
+	std::atomic<unsigned long long> m_calls;
+	std::atomic<unsigned long long> m_hits[Tiers];
+	std::atomic<bool> m_promoting; // set while a promotion runs, and for good once none is left
+	double m_promotion[Tiers];
+	std::thread m_promoter;
+	std::mutex m_promoterLock; // the promoter may finish before it is stored
+	TieredTape(const TieredTape&); // not allowed
+	void operator=(const TieredTape&); // not allowed
+
+	const Tape& tape(const unsigned int t) const { return static_cast<const Interpreted&>(*m_programs[t]).tape(); }
+	// Builds tier t (the one after the current tier) and publishes it.
+	void promote(const unsigned int t, const std::chrono::steady_clock::time_point hot)
+	{
+		std::unique_ptr<Program> program;
+		if (t==TierOPTIMIZED) program.reset(new Interpreted(tape(TierINTERPRETED),true));
+#ifdef FADBAD_NATIVE_TIER
+		else if (t==TierNATIVE && m_programs[TierOPTIMIZED]->size()<=maxNativeOps)
+		{
+			Native* native=new Native(tape(TierOPTIMIZED));
+			program.reset(native);
+			if (!native->loaded()) program.reset();
+		}
+#endif
+		if (!program) return; // m_promoting stays set: no more promotions
+		m_programs[t]=std::move(program);
+		m_promotion[t]=std::chrono::duration<double>(std::chrono::steady_clock::now()-hot).count();
+		m_tier.store(t,std::memory_order_release);
+		m_promoting.store(false,std::memory_order_release);
+	}
+	double run(const double* x, double* y, double* g)
+	{
+		const unsigned int t=m_tier.load(std::memory_order_acquire);
+		m_hits[t].fetch_add(1,std::memory_order_relaxed);
+		const unsigned long long calls=m_calls.fetch_add(1,std::memory_order_relaxed)+1;
+		if (t+1<Tiers && calls>=hot[t+1] && !m_promoting.load(std::memory_order_relaxed) &&
+			!m_promoting.exchange(true,std::memory_order_acquire))
+		{
+			// t may be stale: the promotion that just ended published its
+			// tier before clearing m_promoting.
+			const unsigned int next=m_tier.load(std::memory_order_acquire)+1;
+			if (next<Tiers && calls>=hot[next])
+			{
+				const std::chrono::steady_clock::time_point now=std::chrono::steady_clock::now();
+				std::lock_guard<std::mutex> lock(m_promoterLock);
+				if (m_promoter.joinable()) m_promoter.join();
+				if (background) m_promoter=std::thread(&TieredTape::promote,this,next,now);
+				else promote(next,now);
+			}
+			else m_promoting.store(false,std::memory_order_release);
+		}
+		// slot buffers of the calling thread, shared by all TieredTapes:
+		static thread_local std::vector<double> v, w, yt;
+		const Program& program=*m_programs[t];
+		if (v.size()<program.size()) { v.resize(program.size()); w.resize(program.size()); }
+		if (!y)
+		{
+			if (yt.size()<outputs()) yt.resize(outputs());
+			y=&yt[0];
+		}
+		program.run(x,y,g,&v[0],&w[0]);
+		return y[0];
+	}
+public:
+	// Calls after which each tier is built; hot[TierINTERPRETED] is unused.
+	unsigned long long hot[Tiers];
+	bool background; // build tiers on a background thread
+	unsigned int maxNativeOps; // larger tapes stay interpreted
+
+	explicit TieredTape(const Tape& tape):m_tier(TierINTERPRETED),m_calls(0),m_promoting(false),background(true),maxNativeOps(20000)
+	{
+		m_programs[TierINTERPRETED].reset(new Interpreted(tape,false));
+		for(unsigned int t=0;t<Tiers;++t) { m_hits[t]=0; m_promotion[t]=0; }
+		hot[TierINTERPRETED]=0;
+		hot[TierOPTIMIZED]=1000;
+		hot[TierNATIVE]=100000;
+	}
+	~TieredTape() { wait(); }
+
+	unsigned int inputs() const { return tape(TierINTERPRETED).inputs(); }
+	unsigned int outputs() const { return tape(TierINTERPRETED).outputs(); }
+	// Outputs at x.
+	void evaluate(const double* x, double* y) { run(x,y,0); }
+	// Value of the first output at x and its gradient g.
+	double gradient(const double* x, double* g) { return run(x,0,g); }
+	// Waits for a promotion in progress; not to be called concurrently
+	// with evaluate or gradient.
+	void wait()
+	{
+		std::lock_guard<std::mutex> lock(m_promoterLock);
+		if (m_promoter.joinable()) m_promoter.join();
+	}
+	TieredStats stats() const
+	{
+		TieredStats stats;
+		stats.tier=m_tier.load(std::memory_order_acquire);
+		for(unsigned int t=0;t<Tiers;++t)
+		{
+			stats.hits[t]=m_hits[t].load(std::memory_order_relaxed);
+			stats.promotionSeconds[t]=t<=stats.tier?m_promotion[t]:0;
+		}
+		return stats;
+	}
+};
+
+} // namespace fadbad
+
+#endif
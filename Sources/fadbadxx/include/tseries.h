@@ -0,0 +1,254 @@
+//
+//  tseries.h
+//  FADBADSwift
+//
+
+#ifndef _TSERIES_H
+#define _TSERIES_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "fadbad.h"
+
+// Below this length truncated products use the schoolbook convolution:
+#ifndef SeriesKaratsubaThreshold
+#define SeriesKaratsubaThreshold 32
+#endif
+
+namespace fadbad
+{
+
+// Primitives on truncated power series held in plain coefficient arrays,
+// c[k] being the coefficient of t^k. They work directly on evaluated
+// buffers (e.g. copied out of a T<U,N> after eval) instead of building
+// T graphs. All results are truncated to n coefficients and may not
+// alias the inputs.
+
+// Full product of two length-n arrays into out[0..2n-2].
+template <typename U>
+void seriesConvolve(const U* a, const U* b, const unsigned int n, U* out)
+{
+	for(unsigned int i=0;i+1<2*n;++i) out[i]=Op<U>::myZero();
+	for(unsigned int i=0;i<n;++i)
+		for(unsigned int j=0;j<n;++j) Op<U>::myCadd(out[i+j],a[i]*b[j]);
+}
+
+// Karatsuba product of two length-n arrays into out[0..2n-2]; scratch
+// must hold 8n values.
+template <typename U>
+void seriesKaratsuba(const U* a, const U* b, const unsigned int n, U* out, U* scratch)
+{
+	if (n<=SeriesKaratsubaThreshold) { seriesConvolve(a,b,n,out); return; }
+	const unsigned int m=n/2, h=n-m; // low part has m, high part h>=m coefficients
+	U* as=scratch; // a_lo+a_hi (h)
+	U* bs=scratch+h; // b_lo+b_hi (h)
+	U* mid=scratch+2*h; // (2h-1)
+	U* rest=scratch+4*h;
+	for(unsigned int i=0;i<h;++i)
+	{
+		as[i]=a[m+i];
+		bs[i]=b[m+i];
+		if (i<m) { Op<U>::myCadd(as[i],a[i]); Op<U>::myCadd(bs[i],b[i]); }
+	}
+	seriesKaratsuba(as,bs,h,mid,rest);
+	U* lo=out; // a_lo*b_lo (2m-1)
+	U* hi=out+2*m; // a_hi*b_hi (2h-1)
+	seriesKaratsuba(a,b,m,lo,rest);
+	out[2*m-1]=Op<U>::myZero();
+	seriesKaratsuba(a+m,b+m,h,hi,rest);
+	for(unsigned int i=0;i+1<2*m;++i) Op<U>::myCsub(mid[i],lo[i]);
+	for(unsigned int i=0;i+1<2*h;++i) Op<U>::myCsub(mid[i],hi[i]);
+	for(unsigned int i=0;i+1<2*h;++i) Op<U>::myCadd(out[m+i],mid[i]);
+}
+
+// Scratch values seriesMul needs for length n.
+inline unsigned int seriesMulScratch(const unsigned int n) { return n<=SeriesKaratsubaThreshold?0:10*n; }
+
+// Truncated product c=a*b mod t^n; scratch must hold seriesMulScratch(n)
+// values. At high order only the low half of the product is formed: with
+// n=m+h, the Karatsuba product of the first m coefficients of a and b
+// plus the two truncated cross products of length h at t^m.
+template <typename U>
+void seriesMul(const U* a, const U* b, U* c, const unsigned int n, U* scratch)
+{
+	if (n<=SeriesKaratsubaThreshold)
+	{
+		for(unsigned int i=0;i<n;++i)
+		{
+			c[i]=Op<U>::myZero();
+			for(unsigned int j=0;j<=i;++j) Op<U>::myCadd(c[i],a[j]*b[i-j]);
+		}
+		return;
+	}
+	const unsigned int m=(n+1)/2, h=n-m;
+	seriesKaratsuba(a,b,m,scratch,scratch+2*m);
+	for(unsigned int i=0;i<n;++i) c[i]=i+1<2*m?scratch[i]:Op<U>::myZero();
+	U* cross=scratch;
+	seriesMul(a,b+m,cross,h,scratch+h);
+	for(unsigned int i=0;i<h;++i) Op<U>::myCadd(c[m+i],cross[i]);
+	seriesMul(a+m,b,cross,h,scratch+h);
+	for(unsigned int i=0;i<h;++i) Op<U>::myCadd(c[m+i],cross[i]);
+}
+template <typename U>
+void seriesMul(const U* a, const U* b, U* c, const unsigned int n)
+{
+	std::vector<U> scratch(seriesMulScratch(n));
+	seriesMul(a,b,c,n,scratch.empty()?0:&scratch[0]);
+}
+
+// Scratch values seriesInv needs for length n.
+inline unsigned int seriesInvScratch(const unsigned int n) { return 2*n+seriesMulScratch(n); }
+
+// Reciprocal r=1/a mod t^n by Newton iteration r=r*(2-a*r), doubling the
+// number of correct coefficients each step. Requires a[0]!=0; scratch
+// must hold seriesInvScratch(n) values.
+template <typename U>
+void seriesInv(const U* a, U* r, const unsigned int n, U* scratch)
+{
+	if (n==0) return;
+	U* e=scratch;
+	U* f=scratch+n;
+	U* mul=scratch+2*n;
+	r[0]=Op<U>::myInv(a[0]);
+	for(unsigned int m=1;m<n;)
+	{
+		unsigned int m2=std::min(2*m,n);
+		for(unsigned int i=m;i<m2;++i) r[i]=Op<U>::myZero();
+		seriesMul(a,r,e,m2,mul); // e=a*r=1+O(t^m)
+		for(unsigned int i=0;i<m2;++i) e[i]=Op<U>::myNeg(e[i]);
+		Op<U>::myCadd(e[0],Op<U>::myTwo());
+		seriesMul(r,e,f,m2,mul);
+		std::copy(f,f+m2,r);
+		m=m2;
+	}
+}
+template <typename U>
+void seriesInv(const U* a, U* r, const unsigned int n)
+{
+	std::vector<U> scratch(seriesInvScratch(n));
+	seriesInv(a,r,n,scratch.empty()?0:&scratch[0]);
+}
+
+// Scratch values seriesDiv needs for length n.
+inline unsigned int seriesDivScratch(const unsigned int n) { return n+seriesInvScratch(n); }
+
+// Quotient q=a/b mod t^n. Requires b[0]!=0; scratch must hold
+// seriesDivScratch(n) values.
+template <typename U>
+void seriesDiv(const U* a, const U* b, U* q, const unsigned int n, U* scratch)
+{
+	U* r=scratch;
+	seriesInv(b,r,n,scratch+n);
+	seriesMul(a,r,q,n,scratch+n);
+}
+template <typename U>
+void seriesDiv(const U* a, const U* b, U* q, const unsigned int n)
+{
+	std::vector<U> scratch(seriesDivScratch(n));
+	seriesDiv(a,b,q,n,scratch.empty()?0:&scratch[0]);
+}
+
+// Formal derivative: d[k]=(k+1)*a[k+1], truncated to n coefficients.
+template <typename U>
+void seriesDiff(const U* a, U* d, const unsigned int n)
+{
+	for(unsigned int k=0;k+1<n;++k) d[k]=a[k+1]*Op<U>::myInteger(k+1);
+	if (n>0) d[n-1]=Op<U>::myZero();
+}
+
+// Block length m~sqrt(n) of seriesCompose, and its scratch values.
+inline unsigned int seriesComposeBlock(const unsigned int n)
+{
+	unsigned int m=1;
+	while(m*m<n) ++m;
+	return m;
+}
+inline unsigned int seriesComposeScratch(const unsigned int n)
+{
+	return (seriesComposeBlock(n)+4)*n+seriesMulScratch(n);
+}
+
+// Composition c=a(b(t)) mod t^n. Requires b[0]==0, so that only the
+// first n coefficients of a contribute.
+//
+// Uses the baby-step giant-step scheme of Paterson & Stockmeyer: the
+// powers b^0..b^m-1 with m~sqrt(n) are formed once, every block of m
+// coefficients of a becomes a linear combination of them, and the blocks
+// are combined by Horner's rule in b^m. That is about 2*sqrt(n) truncated
+// products instead of n. scratch must hold seriesComposeScratch(n)
+// values.
+template <typename U>
+void seriesCompose(const U* a, const U* b, U* c, const unsigned int n, U* scratch)
+{
+	USER_ASSERT(n==0 || b[0]==Op<U>::myZero(),"Inner series must vanish at 0")
+	if (n==0) return;
+	const unsigned int m=seriesComposeBlock(n);
+	U* pw=scratch; // (m+1)*n
+	U* block=pw+(m+1)*n;
+	U* acc=block+n;
+	U* tmp=acc+n;
+	U* mul=tmp+n;
+	// pw[j] = b^j, j=0..m:
+	for(unsigned int i=0;i<n;++i) pw[i]=Op<U>::myZero();
+	pw[0]=Op<U>::myOne();
+	for(unsigned int j=1;j<=m;++j) seriesMul(&pw[(j-1)*n],b,&pw[j*n],n,mul);
+	const U* giant=&pw[m*n];
+	const unsigned int blocks=(n+m-1)/m;
+	for(unsigned int i=0;i<n;++i) acc[i]=Op<U>::myZero();
+	for(unsigned int blk=blocks;blk-->0;)
+	{
+		// block = sum_{j<m} a[blk*m+j]*b^j
+		for(unsigned int i=0;i<n;++i) block[i]=Op<U>::myZero();
+		for(unsigned int j=0;j<m && blk*m+j<n;++j)
+		{
+			const U& aj=a[blk*m+j];
+			// b^j vanishes below t^j:
+			for(unsigned int i=j;i<n;++i) Op<U>::myCadd(block[i],aj*pw[j*n+i]);
+		}
+		// acc = acc*b^m + block
+		seriesMul(acc,giant,tmp,n,mul);
+		for(unsigned int i=0;i<n;++i) acc[i]=tmp[i]+block[i];
+	}
+	std::copy(acc,acc+n,c);
+}
+template <typename U>
+void seriesCompose(const U* a, const U* b, U* c, const unsigned int n)
+{
+	std::vector<U> scratch(seriesComposeScratch(n));
+	seriesCompose(a,b,c,n,scratch.empty()?0:&scratch[0]);
+}
+
+// Reversion: r with a(r(t))=t mod t^n. Requires a[0]==0 and a[1]!=0.
+//
+// Newton iteration on series, r=r-(a(r)-t)/a'(r), doubling the number of
+// correct coefficients per step, so the cost is dominated by the last
+// two compositions at full length.
+template <typename U>
+void seriesRevert(const U* a, U* r, const unsigned int n)
+{
+	USER_ASSERT(n<2 || a[0]==Op<U>::myZero(),"Series must vanish at 0")
+	if (n==0) return;
+	r[0]=Op<U>::myZero();
+	if (n==1) return;
+	// one workspace for all the compositions and divisions:
+	std::vector<U> da(n), ar(n), dar(n), q(n), scratch(std::max(seriesComposeScratch(n),seriesDivScratch(n)));
+	seriesDiff(a,&da[0],n);
+	r[1]=Op<U>::myInv(a[1]);
+	for(unsigned int m=2;m<n;)
+	{
+		unsigned int m2=std::min(2*m,n);
+		for(unsigned int i=m;i<m2;++i) r[i]=Op<U>::myZero();
+		seriesCompose(a,r,&ar[0],m2,&scratch[0]);
+		Op<U>::myCsub(ar[1],Op<U>::myOne());
+		seriesCompose(&da[0],r,&dar[0],m2,&scratch[0]);
+		seriesDiv(&ar[0],&dar[0],&q[0],m2,&scratch[0]);
+		for(unsigned int i=0;i<m2;++i) Op<U>::myCsub(r[i],q[i]);
+		m=m2;
+	}
+}
+
+} // namespace fadbad
+
+#endif
@@ -20,3 +20,36 @@ func equation1(x: T, y: T) -> T {
         print("(1/k!)*(d^\(i)f/dx^\(i))=\(f[i])")
     }
 }
+
+@Test func testODEVariable() async throws {
+    // x' = y, y' = -x, x(0) = 0, y(0) = 1, so x(t) = sin(t)
+    let x = T(odeInitialValue: 0.0)
+    let y = T(odeInitialValue: 1.0)
+    x.bind(to: y)
+    y.bind(to: -x)
+    
+    x.evaluate(to: 9)
+    
+    var factorial = 1.0
+    for i in 0...9 {
+        let expected = i % 2 == 0 ? 0.0 : (i % 4 == 1 ? 1.0 : -1.0) / factorial
+        #expect(abs(x[i] - expected) < 1e-15)
+        factorial *= Double(i + 1)
+    }
+}
+
+@Test func testEvaluateToTolerance() async throws {
+    // exp(t) at t=0: the terms 0.1^k/k! drop below 1e-12 from k=8 on
+    let x = T(0.0)
+    x[1] = 1
+    let f = exp(x)
+    
+    let order = f.evaluate(step: 0.1, tolerance: 1e-12)
+    
+    #expect(order == 9)
+    var factorial = 1.0
+    for i in 0...9 {
+        #expect(abs(f[i] - 1.0 / factorial) < 1e-15)
+        factorial *= Double(i + 1)
+    }
+}
@@ -0,0 +1,77 @@
+//
+//  atomicrc.cpp
+//  fadbadxxTests
+//
+
+// Checks the FADBAD_ATOMIC_RC configuration; meant to be run under
+// ThreadSanitizer too.
+#define FADBAD_ATOMIC_RC
+
+#include <thread>
+#include "tadiff.h"
+#include "badiff.h"
+#include "check.h"
+
+using namespace fadbad;
+
+const unsigned int P=16, Models=64, Terms=40;
+
+// Models built by several threads on a shared preamble, with the sums
+// fused and extended in place, and Params copied into the graphs:
+template <class V>
+void buildOnSharedPreamble(std::vector<double>& value)
+{
+	std::vector<V> pre(P);
+	for(unsigned int i=0;i<P;++i) pre[i]=V(0.01*i+0.5);
+	for(unsigned int i=1;i<P;++i) pre[i]=pre[i]*pre[i-1]+pre[i];
+	const Param<double> scale(2.0);
+	value.assign(Models,0.0);
+	std::vector<std::thread> workers;
+	for(unsigned int w=0;w<4;++w) workers.emplace_back([&,w]()
+	{
+		for(unsigned int m=w;m<Models;m+=4)
+		{
+			const Param<double> s=scale;
+			V f=pre[m%P]*s;
+			for(unsigned int k=0;k<Terms;++k) f+=pre[(m+k)%P]*pre[(m*7+k)%P];
+			f=f+2.0*pre[m%P]+3.0*pre[(m+1)%P];
+			value[m]=f.val();
+		}
+	});
+	for(unsigned int w=0;w<4;++w) workers[w].join();
+}
+
+double expected(const unsigned int m)
+{
+	std::vector<double> pre(P);
+	for(unsigned int i=0;i<P;++i) pre[i]=0.01*i+0.5;
+	for(unsigned int i=1;i<P;++i) pre[i]=pre[i]*pre[i-1]+pre[i];
+	double f=pre[m%P]*2.0;
+	for(unsigned int k=0;k<Terms;++k) f+=pre[(m+k)%P]*pre[(m*7+k)%P];
+	return f+2.0*pre[m%P]+3.0*pre[(m+1)%P];
+}
+
+TEST(testThreadsBuildOnSharedT)
+{
+	std::vector<double> value;
+	buildOnSharedPreamble< T<double> >(value);
+	for(unsigned int m=0;m<Models;++m) EXPECT_NEAR(value[m],expected(m),1e-14)
+}
+
+TEST(testThreadsBuildOnSharedB)
+{
+	std::vector<double> value;
+	buildOnSharedPreamble< B<double> >(value);
+	for(unsigned int m=0;m<Models;++m) EXPECT_NEAR(value[m],expected(m),1e-14)
+}
+
+TEST(testInPlaceSumDerivatives)
+{
+	B<double> x(0.5), y(2.0);
+	B<double> s=x*y;
+	for(int k=0;k<10;++k) s+=x*y;
+	s=s+3.0*x;
+	s.diff(0,1);
+	EXPECT(s.val()==11*1.0+1.5)
+	EXPECT(x.d(0)==11*2.0+3.0 && y.d(0)==11*0.5)
+}
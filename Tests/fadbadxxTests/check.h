@@ -0,0 +1,72 @@
+//
+//  check.h
+//  fadbadxxTests
+//
+
+#ifndef _CHECK_H
+#define _CHECK_H
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Every test source is its own program: TEST registers a function, the
+// main() below runs them all and returns nonzero if an EXPECT failed.
+
+struct TestCase
+{
+	const char* name;
+	void (*fn)();
+};
+
+inline std::vector<TestCase>& testCases()
+{
+	static std::vector<TestCase> cases;
+	return cases;
+}
+inline int& testFailures()
+{
+	static int failures=0;
+	return failures;
+}
+
+struct TestRegistrar
+{
+	TestRegistrar(const char* name, void (*fn)()) { testCases().push_back(TestCase{name,fn}); }
+};
+
+#define TEST(name)\
+	static void name();\
+	static TestRegistrar name##Registrar(#name,name);\
+	static void name()
+
+#define EXPECT(check)\
+	if (!(check))\
+	{\
+		std::printf("%s:%d: expectation failed: %s\n",__FILE__,__LINE__,#check);\
+		++testFailures();\
+	}
+
+// |a-b| <= tol*max(1,|b|):
+#define EXPECT_NEAR(a,b,tol)\
+	{\
+		const double a_=(a), b_=(b);\
+		if (!(std::fabs(a_-b_)<=(tol)*std::fmax(1.0,std::fabs(b_))))\
+		{\
+			std::printf("%s:%d: expectation failed: %s=%.17g, %s=%.17g\n",__FILE__,__LINE__,#a,a_,#b,b_);\
+			++testFailures();\
+		}\
+	}
+
+int main()
+{
+	for(const TestCase& t: testCases())
+	{
+		const int before=testFailures();
+		t.fn();
+		std::printf("%s %s\n",testFailures()==before?"passed":"FAILED",t.name);
+	}
+	return testFailures()==0?0:1;
+}
+
+#endif
@@ -0,0 +1,111 @@
+//
+//  ddouble.cpp
+//  fadbadxxTests
+//
+
+#include "ddouble.h"
+#include "tadiff.h"
+#include "check.h"
+#include <cfloat>
+#include <random>
+
+using namespace fadbad;
+
+// DDouble against long double: where long double has a wider significand
+// than double (x87, 64 bits) the results agree to a few of its ulps, and
+// the identities below check the digits past it. Where long double is
+// double the comparison only holds to double precision.
+const double LongTol=LDBL_MANT_DIG>DBL_MANT_DIG?16*LDBL_EPSILON:16*DBL_EPSILON;
+
+long double ld(const DDouble& a) { return (long double)a.hi+(long double)a.lo; }
+
+// |a-b|/max(1,|b|):
+double err(const DDouble& a, const long double b)
+{
+	return (double)(std::fabs(ld(a)-b)/std::fmax(1.0L,std::fabs(b)));
+}
+double err(const DDouble& a, const DDouble& b)
+{
+	const DDouble d=a-b;
+	return std::fabs(d.hi)/std::fmax(1.0,std::fabs(b.hi));
+}
+
+TEST(testArithmeticMatchesLongDouble)
+{
+	std::mt19937_64 gen(1);
+	std::uniform_real_distribution<double> u(-3,3);
+	double e=0;
+	for(int i=0;i<10000;++i)
+	{
+		const DDouble a=DDouble(u(gen))/3.0, b=DDouble(u(gen))/7.0;
+		const long double la=ld(a), lb=ld(b);
+		e=std::max(e,err(a+b,la+lb));
+		e=std::max(e,err(a-b,la-lb));
+		e=std::max(e,err(a*b,la*lb));
+		e=std::max(e,err(a/b,la/lb)*std::fmin(1.0,std::fabs(b.hi)));
+		e=std::max(e,err(a*2.5,la*2.5L));
+		e=std::max(e,err(a/2.5,la/2.5L));
+	}
+	EXPECT(e<=LongTol)
+}
+
+TEST(testFunctionsMatchLongDouble)
+{
+	std::mt19937_64 gen(2);
+	std::uniform_real_distribution<double> u(-1,1);
+	double e=0;
+	for(int i=0;i<10000;++i)
+	{
+		const DDouble a=DDouble(u(gen))/3.0;
+		const DDouble p=fabs(a)*10.0+1e-3, w=a*30.0;
+		e=std::max(e,err(sqrt(p),std::sqrt(ld(p))));
+		e=std::max(e,err(exp(w),std::exp(ld(w)))/std::fmax(1.0,std::exp(w.hi)));
+		e=std::max(e,err(log(p),std::log(ld(p))));
+		e=std::max(e,err(log(1.0+a/100.0),std::log(ld(1.0+a/100.0))));
+		e=std::max(e,err(sin(w),std::sin(ld(w))));
+		e=std::max(e,err(cos(w),std::cos(ld(w))));
+		e=std::max(e,err(atan(w),std::atan(ld(w))));
+		e=std::max(e,err(asin(a),std::asin(ld(a))));
+		e=std::max(e,err(acos(a),std::acos(ld(a))));
+		e=std::max(e,err(pow(p,a),std::pow(ld(p),ld(a))));
+	}
+	EXPECT(e<=LongTol)
+	// tan away from its poles:
+	EXPECT(err(tan(DDouble(0.7)/3.0),std::tan(ld(DDouble(0.7)/3.0)))<=LongTol)
+	EXPECT(err(pow(DDouble(1.5),DDouble(7)),std::pow(1.5L,7))<=LongTol)
+}
+
+TEST(testIdentitiesHold106Bits)
+{
+	std::mt19937_64 gen(3);
+	std::uniform_real_distribution<double> u(0.1,3);
+	double e=0;
+	for(int i=0;i<1000;++i)
+	{
+		const DDouble a=DDouble(u(gen))/3.0, b=DDouble(u(gen))/7.0;
+		e=std::max(e,err((a/b)*b,a));
+		e=std::max(e,err(sqr(sqrt(a)),a));
+		e=std::max(e,err(exp(log(a)),a));
+		e=std::max(e,err(log(exp(a)),a));
+		e=std::max(e,err(sqr(sin(a))+sqr(cos(a)),DDouble(1.0)));
+		e=std::max(e,err(tan(atan(a)),a));
+		e=std::max(e,err(sin(asin(a/4.0)),a/4.0));
+	}
+	EXPECT(e<=1e-30)
+	EXPECT(err(sin(ddPI()),DDouble(0.0))<=1e-31)
+	EXPECT(err(cos(ddPI2()),DDouble(0.0))<=1e-31)
+}
+
+TEST(testTaylorMatchesLongDouble)
+{
+	const int K=20;
+	T<DDouble> x;
+	T<long double> y;
+	x=DDouble(0.3); x[1]=DDouble(1.0);
+	y=(long double)0.3; y[1]=1.0L; // the same double as x
+	T<DDouble> f=exp(sin(x))*atan(x)/(sqr(x)+1.0)+sqrt(sqr(x)+1.0)*log(x+2.0);
+	T<long double> g=exp(sin(y))*atan(y)/(sqr(y)+1.0L)+sqrt(sqr(y)+1.0L)*log(y+2.0L);
+	f.eval(K);
+	g.eval(K);
+	for(int k=0;k<=K;++k) EXPECT(err(f[k],g[k])<=K*LongTol)
+}
@@ -0,0 +1,78 @@
+//
+//  deferred.cpp
+//  fadbadxxTests
+//
+
+#include "tadiff.h"
+#include "check.h"
+#include <thread>
+
+using namespace fadbad;
+
+// sin(x)*exp(x)+x/2 at x=0.5+t:
+T<double> build(T<double>& x)
+{
+	return sin(x)*exp(x)+x/2.0;
+}
+
+TEST(testEagerComputesOrderZero)
+{
+	T<double> x; x=0.5; x[1]=1;
+	T<double> y=build(x);
+	EXPECT(y.length()==1)
+	EXPECT_NEAR(y[0],std::sin(0.5)*std::exp(0.5)+0.25,1e-15)
+}
+
+TEST(testDeferredSkipsOrderZeroUntilEval)
+{
+	T<double> x; x=0.5; x[1]=1;
+	T<double> e=build(x);
+	e.eval(4);
+	T<double> y;
+	{
+		TTypeNameDeferred deferred;
+		y=build(x);
+		EXPECT(y.length()==0)
+	}
+	EXPECT(y.length()==0)
+	y.eval(4);
+	for(unsigned int k=0;k<=4;++k) EXPECT_NEAR(y[k],e[k],1e-15)
+	// re-seeded and evaluated again from order 0:
+	y.reset();
+	e.reset();
+	x[0]=0.8;
+	y.eval(4);
+	e.eval(4);
+	EXPECT_NEAR(y[0],std::sin(0.8)*std::exp(0.8)+0.4,1e-15)
+	for(unsigned int k=0;k<=4;++k) EXPECT_NEAR(y[k],e[k],1e-15)
+}
+
+TEST(testNestedScopesRestoreEagerMode)
+{
+	EXPECT(!tDeferred())
+	{
+		TTypeNameDeferred outer;
+		{
+			TTypeNameDeferred inner;
+			EXPECT(tDeferred())
+		}
+		// the inner scope restores the outer, still deferred, mode:
+		EXPECT(tDeferred())
+		T<double> x; x=0.5;
+		T<double> y=exp(x);
+		EXPECT(y.length()==0)
+	}
+	EXPECT(!tDeferred())
+	T<double> x; x=0.5;
+	T<double> y=exp(x);
+	EXPECT(y.length()==1)
+}
+
+TEST(testScopeIsPerThread)
+{
+	TTypeNameDeferred deferred;
+	bool other=true;
+	std::thread t([&]() { other=tDeferred(); });
+	t.join();
+	EXPECT(!other && tDeferred())
+}
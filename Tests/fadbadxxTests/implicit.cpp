@@ -0,0 +1,139 @@
+//
+//  implicit.cpp
+//  fadbadxxTests
+//
+
+#include "fadiff.h"
+#include "badiff.h"
+#include "implicit.h"
+#include "check.h"
+
+using namespace fadbad;
+
+// x^3+p0*x-p1=0. At p=(2,3) the root is x=1 with Jx=3x^2+p0=5, so
+// dx/dp=(-x/Jx,1/Jx)=(-0.2,0.2).
+struct Cubic
+{
+	template <class V> void operator()(const V* x, const V* p, V* r) const
+	{
+		r[0]=x[0]*x[0]*x[0]+p[0]*x[0]-p[1];
+	}
+};
+
+const double p0[2]={2,3}, dxdp[2]={-0.2,0.2};
+
+TEST(testForwardDynamic)
+{
+	F<double> p[2], x[1];
+	for(int j=0;j<2;++j) { p[j]=p0[j]; p[j].diff(j,2); }
+	x[0]=0.5; // initial guess
+	EXPECT(implicitSolve(Cubic(),p,2,x,1))
+	EXPECT_NEAR(x[0].x(),1.0,1e-14)
+	EXPECT(x[0].size()==2)
+	for(int j=0;j<2;++j) EXPECT_NEAR(x[0].d(j),dxdp[j],1e-14)
+
+	// constant parameters give a constant solution:
+	F<double> q[2]={2.0,3.0}, y[1]={0.5};
+	EXPECT(implicitSolve(Cubic(),q,2,y,1))
+	EXPECT_NEAR(y[0].x(),1.0,1e-14)
+	EXPECT(!y[0].depend())
+}
+
+TEST(testForwardStatic)
+{
+	F<double,2> p[2], x[1];
+	for(int j=0;j<2;++j) { p[j]=p0[j]; p[j].diff(j); }
+	x[0]=0.5;
+	Cubic res;
+	EXPECT(implicitSolve(res,ImplicitNewton<Cubic>(res,1,2),p,2,x,1))
+	EXPECT_NEAR(x[0].x(),1.0,1e-14)
+	for(int j=0;j<2;++j) EXPECT_NEAR(x[0].d(j),dxdp[j],1e-14)
+}
+
+TEST(testReverseThroughDownstreamOp)
+{
+	B<double> p[2];
+	for(int j=0;j<2;++j) p[j]=p0[j];
+	{
+		B<double> x[1];
+		x[0]=0.5;
+		EXPECT(implicitSolve(Cubic(),p,2,x,1))
+		EXPECT_NEAR(x[0].val(),1.0,1e-14)
+		// y=x^2*p1 depends on p1 directly and through x:
+		B<double> y=x[0]*x[0]*p[1];
+		y.diff(0,1);
+	} // the implicit node applies its adjoint when its output is released
+	// dy/dp=2*x*p1*dx/dp+(0,x^2):
+	EXPECT_NEAR(p[0].d(0),2*3*dxdp[0],1e-14)
+	EXPECT_NEAR(p[1].d(0),2*3*dxdp[1]+1,1e-14)
+}
+
+// Bisection on [0,2], counting its calls:
+struct Bisection
+{
+	int& m_calls;
+	bool operator()(double* x, const double* p) const
+	{
+		++m_calls;
+		double a=0, b=2;
+		Cubic res;
+		for(int it=0;it<200 && b-a>1e-15;++it)
+		{
+			double m=(a+b)/2, r;
+			res(&m,p,&r);
+			if (r<0) a=m; else b=m;
+		}
+		x[0]=(a+b)/2;
+		return true;
+	}
+};
+
+TEST(testCallerSuppliedSolver)
+{
+	int calls=0;
+	Bisection solver={calls};
+	F<double> p[2], x[1];
+	for(int j=0;j<2;++j) { p[j]=p0[j]; p[j].diff(j,2); }
+	x[0]=0;
+	EXPECT(implicitSolve(Cubic(),solver,p,2,x,1))
+	EXPECT(calls==1)
+	EXPECT_NEAR(x[0].x(),1.0,1e-14)
+	for(int j=0;j<2;++j) EXPECT_NEAR(x[0].d(j),dxdp[j],1e-13)
+
+	B<double> q[2];
+	for(int j=0;j<2;++j) q[j]=p0[j];
+	{
+		B<double> y[1];
+		EXPECT(implicitSolve(Cubic(),solver,q,2,y,1))
+		EXPECT(calls==2)
+		y[0].diff(0,1);
+	}
+	for(int j=0;j<2;++j) EXPECT_NEAR(q[j].d(0),dxdp[j],1e-13)
+}
+
+// x^2-p0=0 at p0=0 has the root x=0 with Jx=0:
+struct Square
+{
+	template <class V> void operator()(const V* x, const V* p, V* r) const
+	{
+		r[0]=x[0]*x[0]-p[0];
+	}
+};
+struct AtZero
+{
+	bool operator()(double* x, const double*) const { x[0]=0; return true; }
+};
+
+TEST(testSingularJacobian)
+{
+	F<double> p[1], x[1];
+	p[0]=0.0;
+	p[0].diff(0,1);
+	x[0]=0.0;
+	EXPECT(!implicitSolve(Square(),AtZero(),p,1,x,1))
+	B<double> q[1], y[1];
+	q[0]=0.0;
+	EXPECT(!implicitSolve(Square(),AtZero(),q,1,y,1))
+	// Newton stops on the singular Jacobian at the initial guess 0:
+	EXPECT(!implicitSolve(Square(),p,1,x,1))
+}
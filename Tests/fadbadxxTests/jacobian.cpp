@@ -0,0 +1,85 @@
+//
+//  jacobian.cpp
+//  fadbadxxTests
+//
+
+#include "jacobian.h"
+#include "check.h"
+
+using namespace fadbad;
+
+// n inputs through two latent sums to m outputs, with L layers each side:
+struct Bottleneck
+{
+	unsigned int n, m, L;
+	template <class V> void operator()(const V* x, V* y) const
+	{
+		V s=0, t=0;
+		for(unsigned int j=0;j<n;++j)
+		{
+			V u=x[j];
+			for(unsigned int l=0;l<L;++l) u=sin(u)*1.1+0.1*u*u;
+			s+=u;
+			t+=u*x[j];
+		}
+		for(unsigned int k=0;k<m;++k)
+		{
+			V u=s*(1.0+k*0.01)+t;
+			for(unsigned int l=0;l<L;++l) u=exp(-u*u*0.01)+0.5*u;
+			y[k]=u;
+		}
+	}
+};
+
+// Outputs reading a few inputs each and the previous output:
+struct Mixed
+{
+	unsigned int n, m;
+	template <class V> void operator()(const V* x, V* y) const
+	{
+		for(unsigned int k=0;k<m;++k)
+		{
+			V u=x[k%n]*x[(k*7+1)%n]+x[k%n]*x[k%n]-x[(k+1)%n]/x[(k+2)%n];
+			if (k>0) u+=y[k-1]/(1.0+sqr(y[k-1]));
+			y[k]=sqrt(1.0+sqr(u))+pow(x[(k+3)%n],2)-log(2.0+cos(u));
+		}
+	}
+};
+
+template <class FUN>
+void checkModes(const FUN& f, const unsigned int n, const unsigned int m)
+{
+	std::vector<double> x(n),y(m),J(m*n);
+	for(unsigned int j=0;j<n;++j) x[j]=0.1+0.01*j;
+	JacobianEngine engine(f,&x[0],n,m);
+	std::vector< F<double> > fx(x.begin(),x.end()), fy(m);
+	for(unsigned int j=0;j<n;++j) fx[j].diff(j,n);
+	f(&fx[0],&fy[0]);
+	// The engine picks the cheapest scheme:
+	for(int mode=0;mode<3;++mode) EXPECT(engine.cost(engine.mode())<=engine.cost(JacobianMode(mode)))
+	for(int mode=0;mode<3;++mode)
+	{
+		engine.setMode(JacobianMode(mode));
+		engine.jacobian(&x[0],&y[0],&J[0]);
+		for(unsigned int k=0;k<m;++k)
+		{
+			EXPECT_NEAR(y[k],fy[k].val(),1e-14)
+			for(unsigned int j=0;j<n;++j) EXPECT_NEAR(J[k*n+j],fy[k].deriv(j),1e-12)
+		}
+	}
+}
+
+TEST(testModesAgreeOnBottleneck)
+{
+	checkModes(Bottleneck{40,30,4},40,30);
+	// Through the bottleneck elimination beats both pure modes:
+	std::vector<double> x(40,0.1);
+	JacobianEngine engine(Bottleneck{40,30,4},&x[0],40,30);
+	EXPECT(engine.mode()==JacobianELIMINATION)
+}
+
+TEST(testModesAgreeOnMixed)
+{
+	checkModes(Mixed{10,60},10,60);
+	checkModes(Mixed{60,8},60,8);
+}
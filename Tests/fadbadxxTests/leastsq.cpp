@@ -0,0 +1,96 @@
+//
+//  leastsq.cpp
+//  fadbadxxTests
+//
+
+#include "leastsq.h"
+#include "check.h"
+
+using namespace fadbad;
+
+// Residual i fits a_k*exp(-b_k*t_i)+c_k with k=i%groups, so every row
+// depends on three of the 3*groups parameters:
+struct Groups
+{
+	unsigned int m, groups;
+	const double* t;
+	const double* y;
+	template <class V> void operator()(const V* p, V* r) const
+	{
+		for(unsigned int i=0;i<m;++i)
+		{
+			const unsigned int k=i%groups;
+			r[i]=p[3*k]*exp(-p[3*k+1]*t[i])+p[3*k+2]-y[i];
+		}
+	}
+};
+
+// Every residual depends on every parameter:
+struct Dense
+{
+	unsigned int m, n;
+	const double* t;
+	const double* y;
+	template <class V> void operator()(const V* p, V* r) const
+	{
+		for(unsigned int i=0;i<m;++i)
+		{
+			V s=0;
+			double tp=1;
+			for(unsigned int j=0;j<n;++j) { s+=p[j]*tp*exp(-p[j]*p[j]*0.01*t[i]); tp*=t[i]; }
+			r[i]=s-y[i];
+		}
+	}
+};
+
+TEST(testSparseFitRecoversParameters)
+{
+	const unsigned int groups=40, m=40*groups, np=3*groups;
+	std::vector<double> t(m),y(m),truth(np),p(np);
+	for(unsigned int k=0;k<groups;++k)
+	{
+		truth[3*k]=1+0.01*k; truth[3*k+1]=0.5+0.01*k; truth[3*k+2]=0.1;
+		p[3*k]=2; p[3*k+1]=1; p[3*k+2]=0;
+	}
+	for(unsigned int i=0;i<m;++i)
+	{
+		const unsigned int k=i%groups;
+		t[i]=(i/groups)*0.1;
+		y[i]=truth[3*k]*exp(-truth[3*k+1]*t[i])+truth[3*k+2];
+	}
+	const Groups res={m,groups,&t[0],&y[0]};
+	std::vector<size_t> rowPtr;
+	std::vector<unsigned int> cols;
+	jacobianPattern(res,&p[0],np,m,rowPtr,cols);
+	EXPECT(rowPtr.size()==m+1 && cols.size()==3*(size_t)m)
+	LevenbergMarquardt<Groups,4> lm(res,m,np,&rowPtr[0],&cols[0]);
+	// The groups share no rows, so three colors cover all the columns:
+	EXPECT(lm.colors()==3)
+	const LeastSquaresStats s=lm.fit(&p[0],1e-12);
+	EXPECT(s.converged && s.passes==1)
+	for(unsigned int j=0;j<np;++j) EXPECT_NEAR(p[j],truth[j],1e-8)
+}
+
+TEST(testDenseFitRecoversParameters)
+{
+	const unsigned int m=400, n=4;
+	const double truth[n]={1,-0.5,0.3,0.2};
+	std::vector<double> t(m),y(m);
+	for(unsigned int i=0;i<m;++i)
+	{
+		t[i]=i*2.0/m;
+		double s=0, tp=1;
+		for(unsigned int j=0;j<n;++j) { s+=truth[j]*tp*exp(-truth[j]*truth[j]*0.01*t[i]); tp*=t[i]; }
+		y[i]=s;
+	}
+	const Dense res={m,n,&t[0],&y[0]};
+	for(int qr=0;qr<2;++qr)
+	{
+		std::vector<double> p(n,0.5);
+		LevenbergMarquardt<Dense,4> lm(res,m,n);
+		lm.useQR=qr;
+		const LeastSquaresStats s=lm.fit(&p[0],1e-12);
+		EXPECT(s.converged && s.cost<1e-20)
+		for(unsigned int j=0;j<n;++j) EXPECT_NEAR(p[j],truth[j],1e-8)
+	}
+}
@@ -0,0 +1,130 @@
+//
+//  lincomb.cpp
+//  fadbadxxTests
+//
+
+#include "tadiff.h"
+#include "taylorcost.h"
+#include "check.h"
+
+using namespace fadbad;
+
+TEST(testNamedProductIsEvaluated)
+{
+	T<double> x,y,u;
+	x=1; x[1]=1;
+	y=2; y[1]=2;
+	u=3;
+	T<double> p=x*y;
+	T<double> f=p+u;
+	f.eval(5);
+	// p=(1+t)*(2+2t)=2+4t+2t^2 is part of the graph of f:
+	EXPECT(p.length()==6)
+	EXPECT(p[1]==4.0)
+	EXPECT(p[2]==2.0)
+	EXPECT(f[0]==5.0)
+	EXPECT(f[1]==4.0)
+}
+
+TEST(testSharedProductInSumAndDifference)
+{
+	T<double> x,y,u;
+	x=1; x[1]=1;
+	y=2; y[1]=2;
+	u=3; u[1]=1;
+	T<double> p=x*y;
+	T<double> s=p+u, d=p-u;
+	s.eval(3);
+	d.eval(3);
+	EXPECT(s[1]==5.0 && d[1]==3.0)
+	EXPECT(s[2]==2.0 && d[2]==2.0)
+}
+
+TEST(testTemporariesFuse)
+{
+	const int n=20;
+	std::vector<T<double> > x(n);
+	for(int i=0;i<n;++i) { x[i]=0.1*i; x[i][1]=1; }
+	T<double> s;
+	s=0;
+	for(int i=0;i<n;++i) s+=(i+1.0)*sin(x[i]);
+	T<double> g=2.0*x[0]+3.0*x[1]-4.0*x[2]+x[3]*x[4];
+	s.eval(4);
+	g.eval(4);
+	for(unsigned int k=0;k<=4;++k)
+	{
+		double r=0;
+		for(int i=0;i<n;++i)
+		{
+			T<double> v; v=0.1*i; v[1]=1;
+			T<double> w=sin(v);
+			w.eval(k);
+			r+=(i+1.0)*w[k];
+		}
+		EXPECT_NEAR(s[k],r,1e-14)
+	}
+	EXPECT_NEAR(g[0],2*0.0+3*0.1-4*0.2+0.3*0.4,1e-15)
+	EXPECT_NEAR(g[1],2.0+3.0-4.0+0.3+0.4,1e-15)
+	EXPECT_NEAR(g[2],1.0,1e-15)
+}
+
+typedef TTypeNameLINCOMB<double,MaxLength> LINCOMB;
+typedef TTypeNameFMA<double,MaxLength> FMA;
+
+TaylorOpMix opMix(const T<double>& f)
+{
+	return taylorOpMix(std::vector< T<double> >(1,f));
+}
+
+TEST(testChainsCollapse)
+{
+	const int n=20;
+	std::vector<T<double> > x(n);
+	for(int i=0;i<n;++i) { x[i]=0.1*i; x[i][1]=1; }
+	// an accumulation loop is one LINCOMB node over the constant and n terms:
+	T<double> s;
+	s=0;
+	for(int i=0;i<n;++i) s+=(i+1.0)*sin(x[i]);
+	LINCOMB* pS=dynamic_cast<LINCOMB*>(s.getTTypeNameHV());
+	EXPECT(pS!=0 && pS->terms()==n+1)
+	TaylorOpMix mix=opMix(s);
+	EXPECT(mix.count[TaylorKernelADD]==n+1 && mix.count[TaylorKernelSIN]==n && mix.total()==2*n+1)
+	// a sum of scaled temporaries likewise, the product being a term:
+	T<double> g=2.0*x[0]+3.0*x[1]-4.0*x[2]+x[3]*x[4];
+	LINCOMB* pG=dynamic_cast<LINCOMB*>(g.getTTypeNameHV());
+	EXPECT(pG!=0 && pG->terms()==4)
+	mix=opMix(g);
+	EXPECT(mix.count[TaylorKernelADD]==4 && mix.count[TaylorKernelMUL]==1 && mix.total()==5)
+	// a temporary product plus a value is one FMA node:
+	T<double> h=x[1]*x[2]+x[3];
+	EXPECT(dynamic_cast<FMA*>(h.getTTypeNameHV())!=0)
+	mix=opMix(h);
+	EXPECT(mix.count[TaylorKernelMUL]==1 && mix.total()==1)
+	// a named product is not fused:
+	T<double> p=x[1]*x[2];
+	T<double> w=p+x[3];
+	EXPECT(dynamic_cast<FMA*>(w.getTTypeNameHV())==0)
+	EXPECT(opMix(w).total()==2)
+}
+
+TEST(testMovedFromVariablesAreIndependent)
+{
+	T<double> x,y;
+	x=0.5; x[1]=1;
+	y=1.5;
+	T<double> a1=2.0*x+3.0*y, a2=4.0*x-y;
+	T<double> r1=std::move(a1)+y, r2=std::move(a2)+x;
+	EXPECT(dynamic_cast<LINCOMB*>(r1.getTTypeNameHV())!=0)
+	EXPECT(dynamic_cast<LINCOMB*>(r2.getTTypeNameHV())!=0)
+	// the moved-from variables hold nodes of their own:
+	EXPECT(a1.getTTypeNameHV()!=a2.getTTypeNameHV())
+	a1=7.0;
+	a1[1]=1;
+	a2=8.0;
+	EXPECT(a1[0]==7.0 && a2[0]==8.0 && a1[1]==1.0)
+	r1.eval(2);
+	r2.eval(2);
+	EXPECT_NEAR(r1[0],2*0.5+3*1.5+1.5,1e-15)
+	EXPECT_NEAR(r2[0],4*0.5-1.5+0.5,1e-15)
+	EXPECT_NEAR(r2[1],5.0,1e-15)
+}
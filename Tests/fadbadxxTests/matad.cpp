@@ -0,0 +1,189 @@
+//
+//  matad.cpp
+//  fadbadxxTests
+//
+
+#include "fadiff.h"
+#include "badiff.h"
+#include "matad.h"
+#include "check.h"
+#include <random>
+#include <vector>
+
+using namespace fadbad;
+
+TEST(testLogdetForwardMatchesReverse)
+{
+	const double a[9]={4,1,2, 0.5,3,1, 1,2,5};
+	F<double> Af[9];
+	B<double> Ab[9];
+	for(int i=0;i<9;++i) { Af[i]=a[i]; Af[i].diff(i,9); Ab[i]=a[i]; }
+	F<double> yf=logdet(Af,3);
+	B<double> yb=logdet(Ab,3);
+	yb.diff(0,1);
+	const double det=4*(3*5-1*2)-1*(0.5*5-1*1)+2*(0.5*2-3*1);
+	EXPECT_NEAR(yf.x(),std::log(det),1e-15)
+	EXPECT_NEAR(yb.val(),std::log(det),1e-15)
+	for(int i=0;i<9;++i) EXPECT_NEAR(yf.d(i),Ab[i].d(0),1e-14)
+	// d log det / dA_00 = (A^-1)_00 = cofactor/det:
+	EXPECT_NEAR(yf.d(0),(3*5-1*2)/det,1e-14)
+}
+
+TEST(testLogdetSingular)
+{
+	const double a[4]={1,2, 2,4};
+	F<double> Af[4];
+	B<double> Ab[4];
+	for(int i=0;i<4;++i) { Af[i]=a[i]; Af[i].diff(i,4); Ab[i]=a[i]; }
+	F<double> yf=logdet(Af,2);
+	B<double> yb=logdet(Ab,2);
+	yb.diff(0,1);
+	EXPECT(std::isinf(yf.x()) && yf.x()<0)
+	EXPECT(std::isinf(yb.val()) && yb.val()<0)
+	for(int i=0;i<4;++i) EXPECT(!std::isnan(Ab[i].d(0)))
+	EXPECT(!yf.depend())
+}
+
+// Above MatBlockSize the products run over several tiles and panels and
+// the Cholesky factorization updates a trailing matrix.
+const unsigned int Big=MatBlockSize+6;
+
+// y=sum_i w_i*X_i with X=op(A,B):
+template <class V, class OP>
+V objective(OP op, const std::vector<V>& A, const std::vector<V>& Bm, const unsigned int nx, const std::vector<double>& w)
+{
+	std::vector<V> X(nx);
+	op(&A[0],&Bm[0],&X[0]);
+	V y=0.0;
+	for(unsigned int i=0;i<nx;++i) y=y+w[i]*X[i];
+	return y;
+}
+
+// The derivative of y along (vA,vB) at (a,b) in forward mode, from the
+// reverse mode gradient and by central differences:
+template <class OP>
+void directional(OP op, const std::vector<double>& a, const std::vector<double>& b, const unsigned int nx,
+	const std::vector<double>& vA, const std::vector<double>& vB, double& df, double& db, double& dd)
+{
+	std::mt19937_64 gen(nx);
+	std::uniform_real_distribution<double> u(-1,1);
+	std::vector<double> w(nx);
+	for(unsigned int i=0;i<nx;++i) w[i]=u(gen);
+
+	F<double> t=0.0;
+	t.diff(0,1);
+	std::vector< F<double> > Af(a.size()), Bf(b.size());
+	for(unsigned int i=0;i<a.size();++i) Af[i]=a[i]+vA[i]*t;
+	for(unsigned int i=0;i<b.size();++i) Bf[i]=b[i]+vB[i]*t;
+	df=objective(op,Af,Bf,nx,w).d(0);
+
+	std::vector< B<double> > Ab(a.begin(),a.end()), Bb(b.begin(),b.end());
+	{
+		B<double> y=objective(op,Ab,Bb,nx,w);
+		y.diff(0,1);
+	}
+	db=0;
+	for(unsigned int i=0;i<a.size();++i) db+=Ab[i].d(0)*vA[i];
+	for(unsigned int i=0;i<b.size();++i) db+=Bb[i].d(0)*vB[i];
+
+	const double e=1e-6;
+	std::vector< F<double> > Ap(a.size()), Am(a.size()), Bp(b.size()), Bmn(b.size());
+	for(unsigned int i=0;i<a.size();++i) { Ap[i]=a[i]+e*vA[i]; Am[i]=a[i]-e*vA[i]; }
+	for(unsigned int i=0;i<b.size();++i) { Bp[i]=b[i]+e*vB[i]; Bmn[i]=b[i]-e*vB[i]; }
+	dd=(objective(op,Ap,Bp,nx,w).x()-objective(op,Am,Bmn,nx,w).x())/(2*e);
+}
+
+std::vector<double> randomVector(const unsigned int n, const unsigned int seed)
+{
+	std::mt19937_64 gen(seed);
+	std::uniform_real_distribution<double> u(-1,1);
+	std::vector<double> v(n);
+	for(unsigned int i=0;i<n;++i) v[i]=u(gen);
+	return v;
+}
+
+// A well conditioned n x n matrix: the diagonal dominates.
+std::vector<double> dominant(const unsigned int n, const unsigned int seed)
+{
+	std::vector<double> a=randomVector(n*n,seed);
+	for(unsigned int i=0;i<n;++i) a[i*n+i]+=n;
+	return a;
+}
+
+TEST(testMatmulAboveBlockSize)
+{
+	const unsigned int m=Big, k=2*MatBlockSize+3, n=Big+1;
+	double df, db, dd;
+	directional([&](const auto* A, const auto* Bm, auto* C) { matmul(A,Bm,C,m,k,n); },
+		randomVector(m*k,1),randomVector(k*n,2),m*n,randomVector(m*k,3),randomVector(k*n,4),df,db,dd);
+	EXPECT_NEAR(db,df,1e-12)
+	EXPECT_NEAR(dd,df,1e-7)
+}
+
+TEST(testTriSolveAboveBlockSize)
+{
+	const unsigned int n=Big, nrhs=3;
+	for(bool lower: {true,false})
+	{
+		double df, db, dd;
+		bool ok=true;
+		directional([&](const auto* A, const auto* Bm, auto* X) { ok=triSolve(A,lower,Bm,X,n,nrhs) && ok; },
+			dominant(n,5),randomVector(n*nrhs,6),n*nrhs,randomVector(n*n,7),randomVector(n*nrhs,8),df,db,dd);
+		EXPECT(ok)
+		EXPECT_NEAR(db,df,1e-12)
+		EXPECT_NEAR(dd,df,1e-7)
+	}
+}
+
+TEST(testLUSolveAboveBlockSize)
+{
+	const unsigned int n=Big, nrhs=2;
+	double df, db, dd;
+	bool ok=true;
+	directional([&](const auto* A, const auto* Bm, auto* X) { ok=luSolve(A,Bm,X,n,nrhs) && ok; },
+		dominant(n,9),randomVector(n*nrhs,10),n*nrhs,randomVector(n*n,11),randomVector(n*nrhs,12),df,db,dd);
+	EXPECT(ok)
+	EXPECT_NEAR(db,df,1e-12)
+	EXPECT_NEAR(dd,df,1e-7)
+}
+
+TEST(testCholSolveAboveBlockSize)
+{
+	const unsigned int n=Big, nrhs=2;
+	std::vector<double> a=dominant(n,13);
+	for(unsigned int i=0;i<n;++i)
+		for(unsigned int j=0;j<i;++j) a[j*n+i]=a[i*n+j];
+	// An unsymmetric direction: only its lower triangle moves the solution,
+	// as the upper triangle of A is taken from the lower. The reverse mode
+	// gradient of a lower entry collects both mirrored adjoints.
+	double df, db, dd;
+	bool ok=true;
+	directional([&](const auto* A, const auto* Bm, auto* X) { ok=cholSolve(A,Bm,X,n,nrhs) && ok; },
+		a,randomVector(n*nrhs,14),n*nrhs,randomVector(n*n,15),randomVector(n*nrhs,16),df,db,dd);
+	EXPECT(ok)
+	EXPECT_NEAR(db,df,1e-12)
+	EXPECT_NEAR(dd,df,1e-7)
+}
+
+TEST(testCholSolveSymmetricAdjoint)
+{
+	// For a symmetric perturbation of the lower triangle alone the
+	// gradient is that of the full symmetric matrix: dA_ij for i>j counts
+	// twice.
+	const unsigned int n=4, nrhs=1;
+	std::vector<double> a=dominant(n,17);
+	for(unsigned int i=0;i<n;++i)
+		for(unsigned int j=0;j<i;++j) a[j*n+i]=a[i*n+j];
+	std::vector<double> b=randomVector(n,18), vA(n*n,0.0), vB(n,0.0);
+	vA[2*n+1]=1; // A_21, mirrored into A_12
+	double df, db, dd;
+	directional([&](const auto* A, const auto* Bm, auto* X) { cholSolve(A,Bm,X,n,nrhs); },a,b,n,vA,vB,df,db,dd);
+	EXPECT_NEAR(db,df,1e-13)
+	EXPECT_NEAR(dd,df,1e-8)
+	// the same perturbation on both triangles through luSolve:
+	vA[1*n+2]=1;
+	double lf, lb, ld;
+	directional([&](const auto* A, const auto* Bm, auto* X) { luSolve(A,Bm,X,n,nrhs); },a,b,n,vA,vB,lf,lb,ld);
+	EXPECT_NEAR(db,lf,1e-13)
+	EXPECT_NEAR(lb,lf,1e-13)
+}
@@ -0,0 +1,75 @@
+//
+//  newtonkrylov.cpp
+//  fadbadxxTests
+//
+
+#include <cstdlib>
+#include <new>
+
+// Counts allocations, to check that a solve does not allocate:
+static long allocations=0;
+void* operator new(size_t n) { ++allocations; if (void* p=std::malloc(n)) return p; throw std::bad_alloc(); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+#include "newtonkrylov.h"
+#include "check.h"
+
+using namespace fadbad;
+
+// Bratu problem -laplace(u)=lambda*exp(u) on an N x N grid:
+struct Bratu
+{
+	unsigned int N;
+	double lambda;
+	template <class V> void operator()(const V* u, V* r) const
+	{
+		const double h=1.0/(N+1);
+		for(unsigned int i=0;i<N;++i) for(unsigned int j=0;j<N;++j)
+		{
+			const V& c=u[i*N+j];
+			V s=4.0*c;
+			if (i>0) s-=u[(i-1)*N+j];
+			if (i+1<N) s-=u[(i+1)*N+j];
+			if (j>0) s-=u[i*N+j-1];
+			if (j+1<N) s-=u[i*N+j+1];
+			r[i*N+j]=s/(h*h)-lambda*exp(c);
+		}
+	}
+};
+
+TEST(testJvpMatchesDifferenceQuotient)
+{
+	const unsigned int N=8, n=N*N;
+	const Bratu f={N,5.0};
+	std::vector<double> x(n),d(n),y(n),jv(n),xp(n),yp(n),xm(n),ym(n);
+	for(unsigned int i=0;i<n;++i) { x[i]=0.01*i; d[i]=std::sin(1.0*i); }
+	Tape tape;
+	tape.record(f,&x[0],n,n);
+	tape.jvp(&x[0],&d[0],&y[0],&jv[0]);
+	const double h=1e-5;
+	for(unsigned int i=0;i<n;++i) { xp[i]=x[i]+h*d[i]; xm[i]=x[i]-h*d[i]; }
+	tape.evaluate(&xp[0],&yp[0]);
+	tape.evaluate(&xm[0],&ym[0]);
+	for(unsigned int i=0;i<n;++i) EXPECT_NEAR(jv[i],(yp[i]-ym[i])/(2*h),1e-6*std::fabs(jv[i])+1e-6)
+}
+
+TEST(testSolveReachesResidualWithoutAllocating)
+{
+	const unsigned int N=20, n=N*N;
+	const Bratu f={N,5.0};
+	std::vector<double> x(n,0.0),r(n);
+	Tape tape;
+	tape.record(f,&x[0],n,n);
+	NewtonGMRES nk(tape,30);
+	nk.maxRestarts=50;
+	const long before=allocations;
+	const NewtonKrylovStats s=nk.solve(&x[0],1e-8);
+	EXPECT(allocations==before)
+	EXPECT(s.converged && s.jvps>0)
+	tape.evaluate(&x[0],&r[0]);
+	double norm=0;
+	for(unsigned int i=0;i<n;++i) norm+=r[i]*r[i];
+	EXPECT(std::sqrt(norm)<=1e-8)
+	EXPECT_NEAR(std::sqrt(norm),s.residualNorm,1e-6)
+}
@@ -0,0 +1,73 @@
+//
+//  odenode.cpp
+//  fadbadxxTests
+//
+
+#include "tadiff.h"
+#include "param.h"
+#include "check.h"
+
+using namespace fadbad;
+
+TEST(testExpSeriesFromOneEval)
+{
+	// x'=x, x(0)=1:
+	T<double> x=odeVariable<double>(1.0);
+	T<double> f=x*1.0;
+	odeBind(x,f);
+	const unsigned int K=20;
+	EXPECT(x.eval(K)==K+1)
+	double c=1;
+	for(unsigned int k=0;k<=K;++k)
+	{
+		EXPECT_NEAR(x[k],c,1e-16)
+		c/=k+1;
+	}
+	// the field was evaluated along:
+	EXPECT(f.length()>=K)
+	EXPECT_NEAR(f[K-1],x[K]*K,1e-16)
+}
+
+TEST(testSinSeriesFromOneEval)
+{
+	// x0'=x1, x1'=-x0 from (0,1): x0=sin t, x1=cos t
+	T<double> x0=odeVariable<double>(0.0), x1=odeVariable<double>(1.0);
+	T<double> f0=x1*1.0, f1=-x0;
+	odeBind(x0,f0);
+	odeBind(x1,f1);
+	const unsigned int K=25;
+	x0.eval(K);
+	double c=1;
+	for(unsigned int k=0;k<=K;++k)
+	{
+		const double s=k%2==0?0:(k%4==1?c:-c), co=k%2==1?0:(k%4==0?c:-c);
+		EXPECT_NEAR(x0[k],s,1e-16)
+		if (k<K) { EXPECT_NEAR(x1[k],co,1e-16) }
+		c/=k+1;
+	}
+	// reset() keeps the initial values; a new one restarts the expansion:
+	x0.reset();
+	x1.reset();
+	x0[0]=1;
+	x1[0]=0;
+	x0.eval(K); // cos t
+	EXPECT_NEAR(x0[1],0,1e-16)
+	EXPECT_NEAR(x0[2],-0.5,1e-16)
+	EXPECT_NEAR(x0[4],1.0/24,1e-16)
+}
+
+TEST(testParamChangeRestartsExpansion)
+{
+	// x'=p*x, x(0)=1: x[k]=p^k/k!
+	Param<double> p(2.0);
+	T<double> x=odeVariable<double>(1.0);
+	T<double> f=x*p;
+	odeBind(x,f);
+	x.eval(6);
+	EXPECT_NEAR(x[3],8.0/6,1e-15)
+	p.set(3.0);
+	x.update();
+	x.eval(6);
+	EXPECT_NEAR(x[3],27.0/6,1e-15)
+	EXPECT_NEAR(x[6],729.0/720,1e-15)
+}
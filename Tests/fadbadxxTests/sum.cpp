@@ -0,0 +1,137 @@
+//
+//  sum.cpp
+//  fadbadxxTests
+//
+
+#include "badiff.h"
+#include "check.h"
+#include <cmath>
+
+using namespace fadbad;
+
+typedef BTypeNameSUM<double,0> SUM;
+
+const int n=5;
+const double x0[n]={0.3,-1.2,0.7,2.0,-0.4};
+
+// Gradient of f on fresh variables at x0:
+template <class FN> void gradient(FN f, double* g, double& value)
+{
+	B<double> x[n];
+	for(int i=0;i<n;++i) x[i]=x0[i];
+	B<double> y=f(x);
+	value=y.val();
+	y.diff(0,1);
+	for(int i=0;i<n;++i) g[i]=x[i].d(0);
+}
+
+TEST(testSumAndDotGradients)
+{
+	const double w[n]={1.5,-2.0,0.5,3.0,-1.0};
+	double g[n], r[n], v, u;
+	// a shared operand enters the sum twice:
+	gradient([](B<double>* x) { B<double> y[3]={x[0],x[1],x[0]}; return sin(sum(y,3)); },g,v);
+	for(int i=0;i<n;++i) r[i]=0;
+	u=sin(2*x0[0]+x0[1]);
+	r[0]=2*std::cos(2*x0[0]+x0[1]);
+	r[1]=std::cos(2*x0[0]+x0[1]);
+	EXPECT_NEAR(v,u,1e-15)
+	for(int i=0;i<n;++i) EXPECT_NEAR(g[i],r[i],1e-15)
+
+	gradient([&](B<double>* x) { return dot(w,x,n); },g,v);
+	u=0;
+	for(int i=0;i<n;++i) u+=w[i]*x0[i];
+	EXPECT_NEAR(v,u,1e-15)
+	for(int i=0;i<n;++i) EXPECT_NEAR(g[i],w[i],1e-15)
+
+	// x.x differentiates to 2x through both slots of every term:
+	gradient([](B<double>* x) { return dot(x,x,n); },g,v);
+	u=0;
+	for(int i=0;i<n;++i) u+=x0[i]*x0[i];
+	EXPECT_NEAR(v,u,1e-15)
+	for(int i=0;i<n;++i) EXPECT_NEAR(g[i],2*x0[i],1e-15)
+
+	gradient([](B<double>* x) { return dot(x,x+1,n-1); },g,v);
+	for(int i=0;i<n;++i) r[i]=(i>0?x0[i-1]:0)+(i+1<n?x0[i+1]:0);
+	for(int i=0;i<n;++i) EXPECT_NEAR(g[i],r[i],1e-15)
+}
+
+// x0*x1+p-3*x4+x0 with p=x2*x3, accumulated with += and -=:
+B<double> accumulate(B<double>* x)
+{
+	B<double> p=x[2]*x[3];
+	B<double> s=x[0]*x[1];
+	s+=p;
+	s-=3.0*x[4];
+	s+=x[0];
+	return s*p+sin(s);
+}
+// The same with plain binary nodes:
+B<double> chain(B<double>* x)
+{
+	B<double> p=x[2]*x[3];
+	B<double> s=x[0]*x[1]+p-3.0*x[4]+x[0];
+	return s*p+sin(s);
+}
+
+TEST(testCompoundAssignmentMatchesChain)
+{
+	double g[n], r[n], v, u;
+	gradient(accumulate,g,v);
+	gradient(chain,r,u);
+	EXPECT_NEAR(v,u,1e-15)
+	for(int i=0;i<n;++i) EXPECT_NEAR(g[i],r[i],1e-14)
+}
+
+TEST(testUnsharedTermsAreSplit)
+{
+	B<double> x[n];
+	for(int i=0;i<n;++i) x[i]=x0[i];
+	B<double> p=x[2]*x[3];
+	B<double> s=x[0]*x[1];
+	s+=p; // both products are held by one name only: x0,x1,x2,x3
+	s-=3.0*x[4]; // the scaled temporary: x4
+	s+=x[0]; // a variable is shared, so it stays a term
+	SUM* pSum=dynamic_cast<SUM*>(s.getBTypeNameHV());
+	EXPECT(pSum!=0)
+	EXPECT(pSum->terms()==6)
+	EXPECT(pSum->op(0)==x[0].getBTypeNameHV() && pSum->weight(0)==x0[1])
+	EXPECT(pSum->op(1)==x[1].getBTypeNameHV() && pSum->weight(1)==x0[0])
+	EXPECT(pSum->op(2)==x[2].getBTypeNameHV() && pSum->weight(2)==x0[3])
+	EXPECT(pSum->op(3)==x[3].getBTypeNameHV() && pSum->weight(3)==x0[2])
+	EXPECT(pSum->op(4)==x[4].getBTypeNameHV() && pSum->weight(4)==-3.0)
+	EXPECT(pSum->op(5)==x[0].getBTypeNameHV() && pSum->weight(5)==1.0)
+	// the named product is still intact:
+	EXPECT_NEAR(p.val(),x0[2]*x0[3],1e-15)
+	s.diff(0,1);
+	EXPECT_NEAR(x[0].d(0),x0[1]+1,1e-15)
+	EXPECT_NEAR(x[2].d(0),x0[3],1e-15)
+	EXPECT_NEAR(x[4].d(0),-3.0,1e-15)
+
+	// a product that is also used elsewhere is kept as one term:
+	B<double> y[n];
+	for(int i=0;i<n;++i) y[i]=x0[i];
+	B<double> q=y[2]*y[3], t=q*2.0;
+	B<double> a=y[0]*y[1];
+	a+=q;
+	pSum=dynamic_cast<SUM*>(a.getBTypeNameHV());
+	EXPECT(pSum!=0 && pSum->terms()==3)
+	EXPECT(pSum->op(2)==q.getBTypeNameHV())
+	a+=t;
+	EXPECT(a.getBTypeNameHV()==pSum && pSum->terms()==4)
+}
+
+TEST(testSumIntoItself)
+{
+	B<double> x[n];
+	for(int i=0;i<n;++i) x[i]=x0[i];
+	B<double> s=x[0]*x[1];
+	s+=x[2];
+	s+=s;
+	s-=x[3];
+	EXPECT_NEAR(s.val(),2*(x0[0]*x0[1]+x0[2])-x0[3],1e-15)
+	s.diff(0,1);
+	EXPECT_NEAR(x[0].d(0),2*x0[1],1e-15)
+	EXPECT_NEAR(x[2].d(0),2.0,1e-15)
+	EXPECT_NEAR(x[3].d(0),-1.0,1e-15)
+}
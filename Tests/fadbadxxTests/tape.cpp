@@ -0,0 +1,118 @@
+//
+//  tape.cpp
+//  fadbadxxTests
+//
+
+#include "tape.h"
+#include "minimize.h"
+#include "fadiff.h"
+#include "check.h"
+
+using namespace fadbad;
+
+// Uses every recorded operation:
+struct Mixed
+{
+	template <class V> V operator()(const V* x) const
+	{
+		return sin(x[0])*exp(x[1]/3.0)+x[0]/x[1]-sqrt(x[2]*x[2]+1.0)+atan(x[0]*x[2])+
+			pow(x[1],x[2])+log(x[1])+tan(x[2]/4.0)+asin(x[0]/5.0)-acos(x[2]/7.0)+
+			(2.0-x[0])+3.0/x[1]+cos(x[0]-1.0)+sqr(x[2])-pow(x[0],3);
+	}
+};
+
+struct Rosenbrock
+{
+	unsigned int n;
+	template <class V> V operator()(const V* x) const
+	{
+		V s=0;
+		for(unsigned int i=0;i+1<n;i+=2) s+=100.0*sqr(x[i+1]-sqr(x[i]))+sqr(1.0-x[i]);
+		return s;
+	}
+};
+
+TEST(testGradientMatchesForward)
+{
+	const Mixed f;
+	double x[3]={0.7,1.3,0.4}, g[3];
+	Tape tape;
+	tape.record(f,x,3);
+	// The replay at another point follows the same operations:
+	x[0]=0.6; x[2]=0.5;
+	const double v=tape.gradient(x,g);
+	F<double> xf[3]={x[0],x[1],x[2]};
+	for(int i=0;i<3;++i) xf[i].diff(i,3);
+	F<double> y=f(xf);
+	EXPECT_NEAR(v,y.x(),1e-15)
+	for(int i=0;i<3;++i) EXPECT_NEAR(g[i],y.d(i),1e-14)
+}
+
+TEST(testFloatAdjointsMatchDouble)
+{
+	// Double values with float adjoints: the value is the double one, the
+	// gradient agrees to about float precision.
+	const Mixed f;
+	double x[3]={0.7,1.3,0.4}, g[3];
+	float gf[3];
+	Tape tape;
+	tape.record(f,x,3);
+	const double v=tape.gradient(x,g);
+	EXPECT(tape.gradient(x,gf)==v)
+	for(int i=0;i<3;++i) EXPECT_NEAR(gf[i],g[i],1e-6)
+
+	// adjoints summed over many uses of every input:
+	const unsigned int n=200;
+	const Rosenbrock r={n};
+	std::vector<double> y(n), h(n);
+	std::vector<float> hf(n);
+	for(unsigned int i=0;i<n;++i) y[i]=0.5+0.01*i;
+	Tape big;
+	big.record(r,&y[0],n);
+	EXPECT(big.gradient(&y[0],&hf[0])==big.gradient(&y[0],&h[0]))
+	for(unsigned int i=0;i<n;++i) EXPECT_NEAR(hf[i],h[i],1e-6)
+}
+
+TEST(testHessVecMatchesForwardOverForward)
+{
+	const Mixed f;
+	double x[3]={0.7,1.3,0.4}, d[3]={0.3,-0.2,0.5}, g[3], hv[3];
+	Tape tape;
+	tape.record(f,x,3);
+	tape.hessVec(x,d,g,hv);
+	// H*d as the directional derivative of the gradient:
+	F<F<double> > xf[3];
+	for(int i=0;i<3;++i)
+	{
+		xf[i]=x[i];
+		xf[i].x().diff(0,1);
+		xf[i].x().d(0)=d[i];
+		xf[i].diff(i,3);
+	}
+	F<F<double> > y=f(xf);
+	for(int i=0;i<3;++i)
+	{
+		EXPECT_NEAR(g[i],y.d(i).x(),1e-14)
+		EXPECT_NEAR(hv[i],y.d(i).d(0),1e-13)
+	}
+}
+
+TEST(testMinimizersFindRosenbrockMinimum)
+{
+	const unsigned int n=100;
+	const Rosenbrock f={n};
+	std::vector<double> x0(n),x(n);
+	for(unsigned int i=0;i<n;i+=2) { x0[i]=-1.2; x0[i+1]=1; }
+	Tape tape;
+	tape.record(f,&x0[0],n);
+	x=x0;
+	LBFGS lbfgs(tape);
+	MinimizeStats s=lbfgs.minimize(&x[0],1e-8,5000);
+	EXPECT(s.converged)
+	for(unsigned int i=0;i<n;++i) EXPECT_NEAR(x[i],1.0,1e-6)
+	x=x0;
+	TrustRegionNewtonCG tr(tape);
+	s=tr.minimize(&x[0],1e-8,5000);
+	EXPECT(s.converged && s.hessVecs>0)
+	for(unsigned int i=0;i<n;++i) EXPECT_NEAR(x[i],1.0,1e-6)
+}
@@ -0,0 +1,116 @@
+//
+//  tapeopt.cpp
+//  fadbadxxTests
+//
+
+#include "tapeopt.h"
+#include "taylorprogram.h"
+#include "check.h"
+
+using namespace fadbad;
+
+// Model code with neutral parameters (gain 1, offset 0, unit 1),
+// repeated subexpressions, constant-only terms and an unused diagnostic,
+// so that every pass has something to do:
+struct Model
+{
+	unsigned int n;
+	double gain, offset, unit;
+	template <class V> V operator()(const V* x) const
+	{
+		V f=0, diag=0;
+		for(unsigned int i=0;i+1<n;++i)
+		{
+			V a=x[i]*gain+offset;
+			V b=x[i+1]*unit*1000.0/1000.0;
+			V d=(a-b)*(a-b);
+			V e=exp(-x[i]*x[i])*exp(-x[i]*x[i]);
+			diag+=sqrt(d+1.0)*log(1.0+e);
+			V c=V(2.0)*V(0.5);
+			f+=c*d*2.0*0.5+pow(e,1)*V(3.0)-(-x[i])*0.1*10.0;
+		}
+		return f;
+	}
+};
+
+TEST(testOptimizePreservesDerivatives)
+{
+	const unsigned int n=50;
+	std::vector<double> x(n),d(n),g1(n),g2(n),h1(n),h2(n);
+	for(unsigned int i=0;i<n;++i) { x[i]=0.3+0.01*i; d[i]=std::cos(1.0*i); }
+	Tape tape;
+	tape.record(Model{n,1.0,0.0,1.0},&x[0],n);
+	Tape opt=tape;
+	const TapeOptimizeStats s=optimize(opt);
+	EXPECT(s.before==tape.size() && s.after==opt.size() && s.after<s.before/2)
+	EXPECT(s.dead>0 && s.folded>0 && s.identities>0 && s.common>0 && s.scalings>0)
+	EXPECT(opt.inputs()==n && opt.outputs()==1)
+	// Replay away from the recording point:
+	for(unsigned int i=0;i<n;++i) x[i]=0.5-0.02*i;
+	const double f1=tape.gradient(&x[0],&g1[0]), f2=opt.gradient(&x[0],&g2[0]);
+	EXPECT_NEAR(f2,f1,1e-14)
+	for(unsigned int i=0;i<n;++i) EXPECT_NEAR(g2[i],g1[i],1e-14)
+	tape.hessVec(&x[0],&d[0],&g1[0],&h1[0]);
+	opt.hessVec(&x[0],&d[0],&g2[0],&h2[0]);
+	for(unsigned int i=0;i<n;++i) EXPECT_NEAR(h2[i],h1[i],1e-13)
+}
+
+struct Rosenbrock
+{
+	template <class V> V operator()(const V* x) const { return 100.0*sqr(x[1]-sqr(x[0]))+sqr(1.0-x[0]); }
+};
+
+TEST(testOptimizeKeepsCleanTape)
+{
+	double x[2]={-1.2,1}, g1[2], g2[2];
+	Tape tape;
+	tape.record(Rosenbrock(),x,2);
+	Tape opt=tape;
+	const TapeOptimizeStats s=optimize(opt);
+	EXPECT(s.after<=s.before && s.dead==0)
+	EXPECT(tape.gradient(x,g1)==opt.gradient(x,g2))
+	EXPECT(g1[0]==g2[0] && g1[1]==g2[1])
+}
+
+// Assembly-style graph: products of random inputs scattered into rows,
+// then a sum of squares over the rows.
+struct Assembly
+{
+	unsigned int terms, rows, nx;
+	template <class V> void operator()(const V* x, V* y) const
+	{
+		unsigned int seed=7;
+		auto next=[&seed](const unsigned int n) { seed=seed*1103515245u+12345u; return (seed>>8)%n; };
+		std::vector<V> r(rows,V(0.0));
+		for(unsigned int k=0;k<terms;++k)
+		{
+			V t=sin(x[next(nx)]*x[next(nx)])*0.5+x[next(nx)];
+			const unsigned int i=next(rows);
+			r[i]=r[i]+t;
+		}
+		V s=r[0]*r[0];
+		for(unsigned int i=1;i<rows;++i) s=s+r[i]*r[i];
+		y[0]=s;
+	}
+};
+
+TEST(testRenumberPreservesGradient)
+{
+	const Assembly f={2000,300,500};
+	const unsigned int window=64;
+	std::vector<double> x(f.nx),g1(f.nx),g2(f.nx);
+	for(unsigned int i=0;i<f.nx;++i) x[i]=0.1+1e-3*i;
+	Tape tape;
+	tape.record(f,&x[0],f.nx,1);
+	Tape ren=tape;
+	const unsigned long long far=tapeFarReads(tape,window);
+	EXPECT(tapeRenumber(ren,window))
+	EXPECT(tapeFarReads(ren,window)<far)
+	EXPECT(ren.inputs()==f.nx && ren.outputs()==1)
+	for(unsigned int i=0;i<f.nx;++i) x[i]=0.2-1e-4*i;
+	// The same operations in another order: values are bitwise equal.
+	EXPECT(tape.gradient(&x[0],&g1[0])==ren.gradient(&x[0],&g2[0]))
+	for(unsigned int i=0;i<f.nx;++i) EXPECT_NEAR(g2[i],g1[i],1e-13)
+	// Shorter live ranges need fewer Taylor program buffers:
+	EXPECT(TaylorProgram<double>(ren,4).buffers()<TaylorProgram<double>(tape,4).buffers())
+}
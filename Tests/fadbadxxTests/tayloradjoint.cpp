@@ -0,0 +1,72 @@
+//
+//  tayloradjoint.cpp
+//  fadbadxxTests
+//
+
+#include "tayloradjoint.h"
+#include "check.h"
+
+using namespace fadbad;
+
+// x'=-p*x:
+struct Decay
+{
+	template <class TT> void operator()(const std::vector<TT>& x, const std::vector<TT>& p, std::vector<TT>& f) const
+	{
+		f[0]=-p[0]*x[0];
+	}
+};
+
+// Damped pendulum x0'=x1, x1'=-p0*sin(x0)-p1*x1:
+struct Pendulum
+{
+	template <class TT> void operator()(const std::vector<TT>& x, const std::vector<TT>& p, std::vector<TT>& f) const
+	{
+		f[0]=x[1];
+		f[1]=-p[0]*sin(x[0])-p[1]*x[1];
+	}
+};
+
+TEST(testDecayMatchesClosedForm)
+{
+	TaylorAdjoint<> adjoint(1);
+	const double x0=1, p=0.7;
+	double x1;
+	adjoint.forward(Decay(),&x0,&p,1,0.0,2.0,1e-14,&x1);
+	EXPECT_NEAR(x1,std::exp(-2*p),1e-13)
+	const double xbar1=1;
+	double xbar0, pbar;
+	adjoint.reverse(Decay(),&xbar1,&xbar0,&pbar);
+	EXPECT_NEAR(xbar0,std::exp(-2*p),1e-13)
+	EXPECT_NEAR(pbar,-2*std::exp(-2*p),1e-13)
+}
+
+// L=x1(t1)[0]+2*x1(t1)[1]:
+double pendulumLoss(const double* x0, const double* p)
+{
+	TaylorAdjoint<> adjoint(2);
+	double x1[2];
+	adjoint.forward(Pendulum(),x0,p,2,0.0,3.0,1e-14,x1);
+	return x1[0]+2*x1[1];
+}
+
+TEST(testPendulumMatchesDifferenceQuotients)
+{
+	double x0[2]={0.8,0.1}, p[2]={1.5,0.2}, x1[2];
+	TaylorAdjoint<> adjoint(2);
+	adjoint.forward(Pendulum(),x0,p,2,0.0,3.0,1e-14,x1);
+	EXPECT(adjoint.steps()>1)
+	const double xbar1[2]={1,2};
+	double xbar0[2], pbar[2];
+	adjoint.reverse(Pendulum(),xbar1,xbar0,pbar);
+	const double e=1e-6;
+	for(unsigned int i=0;i<2;++i)
+	{
+		double xp[2]={x0[0],x0[1]}, xm[2]={x0[0],x0[1]};
+		xp[i]+=e; xm[i]-=e;
+		EXPECT_NEAR(xbar0[i],(pendulumLoss(xp,p)-pendulumLoss(xm,p))/(2*e),1e-7)
+		double pp[2]={p[0],p[1]}, pm[2]={p[0],p[1]};
+		pp[i]+=e; pm[i]-=e;
+		EXPECT_NEAR(pbar[i],(pendulumLoss(x0,pp)-pendulumLoss(x0,pm))/(2*e),1e-7)
+	}
+}
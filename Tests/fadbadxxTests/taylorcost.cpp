@@ -0,0 +1,86 @@
+//
+//  taylorcost.cpp
+//  fadbadxxTests
+//
+
+#include "taylorcost.h"
+#include "check.h"
+#include <cstdio>
+
+using namespace fadbad;
+
+const char* TablePath="build/taylorcost.table";
+
+// A table where only MUL costs, k^2 seconds at order k:
+void writeQuadraticTable(const char* path)
+{
+	std::ofstream out(path);
+	out<<"fadbad-taylor-cost "<<MaxLength<<"\n";
+	for(int i=0;i<TaylorKernels;++i)
+		for(int k=0;k<MaxLength;++k) out<<(i==TaylorKernelMUL?double(k)*k:0.0)<<(k+1<MaxLength?" ":"\n");
+}
+
+struct Oscillator
+{
+	template <class V> void operator()(std::vector<V>& x, std::vector<V>& f) const
+	{
+		f[0]=x[1];
+		f[1]=-sin(x[0]);
+	}
+};
+
+TEST(testSaveLoadRoundTrip)
+{
+	TaylorCostModel<> model;
+	model.calibrate(1e-5);
+	for(unsigned int k=1;k<MaxLength;++k) EXPECT(model.cost(TaylorKernelMUL,k)>=model.cost(TaylorKernelMUL,k-1))
+	EXPECT(model.cost(TaylorKernelMUL,MaxLength-1)>0)
+	EXPECT(model.save(TablePath))
+	TaylorCostModel<> loaded;
+	EXPECT(loaded.load(TablePath))
+	for(int i=0;i<TaylorKernels;++i)
+		for(unsigned int k=0;k<MaxLength;++k) EXPECT(loaded.cost(TaylorKernel(i),k)==model.cost(TaylorKernel(i),k))
+	// a table for another N is rejected:
+	TaylorCostModel<20> other;
+	EXPECT(!other.load(TablePath))
+	EXPECT(!loaded.load("build/no-such.table"))
+	// startup() loads an existing table instead of calibrating:
+	writeQuadraticTable(TablePath);
+	TaylorCostModel<> started=TaylorCostModel<>::startup(TablePath);
+	EXPECT(started.cost(TaylorKernelMUL,7)==49 && started.cost(TaylorKernelADD,7)==0)
+	std::remove(TablePath);
+}
+
+TEST(testSelectOrderIsOptimal)
+{
+	writeQuadraticTable(TablePath);
+	TaylorCostModel<> model;
+	EXPECT(model.load(TablePath))
+	std::remove(TablePath);
+	TaylorOpMix mix;
+	mix.count[TaylorKernelMUL]=3;
+	// k^2/(rho*tol^(1/k)) is smallest at k=-ln(tol)/2:
+	double h=0;
+	EXPECT(model.selectOrder(mix,std::exp(-20.0),0.5,4,MaxLength-1,&h)==10)
+	EXPECT_NEAR(h,0.5*std::exp(-2.0),1e-15)
+	EXPECT(model.selectOrder(mix,std::exp(-30.0),0.5)==15)
+	// clamped to the range:
+	EXPECT(model.selectOrder(mix,std::exp(-30.0),0.5,4,12)==12)
+	EXPECT(model.selectOrder(mix,std::exp(-4.0),0.5,6)==6)
+}
+
+TEST(testTuneOrderStaysInRange)
+{
+	writeQuadraticTable(TablePath);
+	TaylorCostModel<> model;
+	EXPECT(model.load(TablePath))
+	std::remove(TablePath);
+	TaylorODE<double> ode(2,Oscillator(),20);
+	const double x[2]={1,0};
+	for(double tol: {1e-2,1e-8,1e-16,1e-300})
+	{
+		const unsigned int order=tuneOrder(ode,model,x,tol);
+		EXPECT(order>=4 && order<=MaxLength-1)
+		EXPECT(ode.order()==order)
+	}
+}
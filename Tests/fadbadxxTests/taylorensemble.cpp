@@ -0,0 +1,62 @@
+//
+//  taylorensemble.cpp
+//  fadbadxxTests
+//
+
+#include "taylorensemble.h"
+#include "check.h"
+
+using namespace fadbad;
+
+struct Pendulum
+{
+	template <class V> void operator()(const std::vector<V>& x, std::vector<V>& f) const
+	{
+		f[0]=x[1];
+		f[1]=-sin(x[0]);
+	}
+};
+
+TEST(testEnsembleMatchesScalar)
+{
+	const unsigned long count=10;
+	std::vector<double> x0(2*count),xEnd(2*count),tEnd(count);
+	for(unsigned long i=0;i<count;++i) { x0[2*i]=0.1+0.1*i; x0[2*i+1]=0; }
+	TaylorEnsemble<4> ensemble(2,20,1e-14);
+	ensemble.run(Pendulum(),&x0[0],&xEnd[0],&tEnd[0],count,0.0,5.0,2);
+	for(unsigned long i=0;i<count;++i)
+	{
+		TaylorODE<double> ode(2,Pendulum(),20);
+		double t=0, x[2]={x0[2*i],0};
+		ode.integrate(t,x,5.0,1e-14);
+		EXPECT_NEAR(xEnd[2*i],x[0],1e-12)
+		EXPECT_NEAR(xEnd[2*i+1],x[1],1e-12)
+		EXPECT(tEnd[i]==5.0)
+	}
+}
+
+// x'=-1 with a sqrt term that has NaN coefficients for x<0:
+struct Drain
+{
+	template <class V> void operator()(const std::vector<V>& x, std::vector<V>& f) const
+	{
+		f[0]=-1.0+1e-30*sqrt(x[0])+0.01*sin(x[0]);
+	}
+};
+struct BelowZero
+{
+	bool operator()(const double* x, const double) const { return x[0]<0; }
+};
+
+TEST(testStoppedLaneIsFrozen)
+{
+	// The first lane stops below 0, where its expansion is NaN, while the
+	// second one keeps stepping.
+	double x0[2]={0.05,10}, xEnd[2], tEnd[2];
+	TaylorEnsemble<2> ensemble(1,20,1e-14);
+	ensemble.run(Drain(),BelowZero(),x0,xEnd,tEnd,2,0.0,5.0,1);
+	EXPECT(xEnd[0]<0 && xEnd[0]>-1)
+	EXPECT(tEnd[0]<1)
+	EXPECT_NEAR(xEnd[1],5.0115,1e-3)
+	EXPECT(tEnd[1]==5.0)
+}
@@ -0,0 +1,82 @@
+//
+//  taylorode.cpp
+//  fadbadxxTests
+//
+
+#include "taylorode.h"
+#include "check.h"
+
+using namespace fadbad;
+
+// x0'=x1, x1'=-x0: x0=cos t from (1,0).
+struct Oscillator
+{
+	template <class V> void operator()(std::vector<V>& x, std::vector<V>& f) const
+	{
+		f[0]=x[1];
+		f[1]=-x[0];
+	}
+};
+
+struct GuardX0
+{
+	template <class V> void operator()(std::vector<V>& x, std::vector<V>& g) const
+	{
+		g[0]=x[0]*1.0;
+	}
+};
+
+TEST(testEventLocatedAndResumed)
+{
+	TaylorODE<double> ode(2,Oscillator(),1,GuardX0(),20);
+	double t=0, x[2]={1,0};
+	int event;
+	ode.integrate(t,x,10.0,1e-14,event);
+	EXPECT(event==0)
+	EXPECT_NEAR(t,M_PI/2,1e-12)
+	EXPECT_NEAR(x[0],0,1e-12)
+	EXPECT_NEAR(x[1],-1,1e-12)
+	// resuming from the event finds the next crossing, not the same one:
+	ode.integrate(t,x,10.0,1e-14,event);
+	EXPECT(event==0)
+	EXPECT_NEAR(t,3*M_PI/2,1e-12)
+	EXPECT_NEAR(x[1],1,1e-12)
+	// without a crossing before tEnd the integration runs to the end:
+	ode.integrate(t,x,6.0,1e-14,event);
+	EXPECT(event==-1 && t==6.0)
+	EXPECT_NEAR(x[0],std::cos(6.0),1e-12)
+}
+
+TEST(testPolyRootDoubleRoot)
+{
+	// (s-0.3)^2 touches zero without changing sign:
+	const double c[3]={0.09,-0.6,1};
+	double root=-1;
+	EXPECT(!polyRoot(c,2,0.0,1.0,root))
+	// (s-0.3)^2*(s-0.8): the first sign change is the simple root
+	const double d[4]={-0.072,0.57,-1.4,1};
+	EXPECT(polyRoot(d,3,0.0,1.0,root))
+	EXPECT_NEAR(root,0.8,1e-14)
+}
+
+TEST(testPolyRootAtLowerBound)
+{
+	// s-0.25 on (0.25,1] has no root; (s-0.25)*(s-0.75) has one at 0.75:
+	const double c[2]={-0.25,1};
+	double root=-1;
+	EXPECT(!polyRoot(c,1,0.25,1.0,root))
+	const double d[3]={0.1875,-1,1};
+	EXPECT(polyRoot(d,2,0.25,1.0,root))
+	EXPECT_NEAR(root,0.75,1e-14)
+	// the interval is closed at h:
+	EXPECT(polyRoot(c,1,0.0,0.25,root))
+	EXPECT(root==0.25)
+}
+
+TEST(testPolyRootNoSignChange)
+{
+	const double c[3]={1,0,1}; // s^2+1
+	double root=-1;
+	EXPECT(!polyRoot(c,2,0.0,10.0,root))
+	EXPECT(root==-1)
+}
@@ -0,0 +1,158 @@
+//
+//  taylorprogram.cpp
+//  fadbadxxTests
+//
+
+#include "taylorprogram.h"
+#include "tadiff.h"
+#include "simdlanes.h"
+#include "check.h"
+
+using namespace fadbad;
+
+// An input that is only an output, next to one that is read:
+struct PassThrough
+{
+	template <class V> void operator()(const V* x, V* y) const
+	{
+		y[0]=x[0];
+		y[1]=sin(x[1]);
+	}
+};
+
+// Runs every kernel of a program. a is read again by the outputs, so
+// its buffer stays live across the whole chain while the others are
+// recycled; the optional dead value is recorded but never read.
+struct Kernels
+{
+	bool dead;
+	template <class V> void operator()(const V* x, V* y) const
+	{
+		V a=x[0]/x[1];
+		if (dead) (void)(exp(x[2])*a);
+		V s=sin(a)+cos(x[2]);
+		V t=sqrt(sqr(s)+2.0)-log(x[1]+1.0);
+		V u=tan(x[2]/4.0)*atan(t)-asin(x[0]/5.0)+acos(x[2]/7.0);
+		V v=pow(x[1],x[2])+pow(t,3)-3.0/x[1]+(1.5-u)*exp(-s/3.0);
+		y[0]=v*a;
+		y[1]=(2.0-u/v)*x[1]+a;
+	}
+};
+
+TEST(testInputUsedOnlyAsOutput)
+{
+	const unsigned int K=3;
+	double x0[2]={0.5,0.2};
+	Tape tape;
+	tape.record(PassThrough(),x0,2,2);
+	TaylorProgram<double> program(tape,K);
+	// x0=0.5+t, x1=2+t:
+	const double x[2*(K+1)]={0.5,1,0,0, 2,1,0,0};
+	double y[2*(K+1)];
+	program.evaluate(x,y);
+	EXPECT(y[0]==0.5 && y[1]==1 && y[2]==0 && y[3]==0)
+	EXPECT_NEAR(y[K+1],std::sin(2.0),1e-15)
+	EXPECT_NEAR(y[K+2],std::cos(2.0),1e-15)
+}
+
+TEST(testProgramMatchesT)
+{
+	const unsigned int K=10;
+	double x0[3]={0.7,1.3,0.4};
+	Tape tape;
+	tape.record(Kernels{false},x0,3,2);
+	TaylorProgram<double> program(tape,K);
+	EXPECT(program.inputs()==3 && program.outputs()==2)
+	std::vector<double> x(3*(K+1),0.0), y(2*(K+1));
+	T<double> tx[3], ty[2];
+	for(unsigned int j=0;j<3;++j)
+	{
+		x[j*(K+1)]=x0[j];
+		x[j*(K+1)+1]=0.1*(j+1);
+		tx[j]=x0[j];
+		tx[j][1]=0.1*(j+1);
+	}
+	program.evaluate(&x[0],&y[0]);
+	Kernels{false}(tx,ty);
+	for(unsigned int k=0;k<2;++k)
+	{
+		ty[k].eval(K);
+		for(unsigned int i=0;i<=K;++i) EXPECT_NEAR(y[k*(K+1)+i],ty[k][i],1e-13)
+	}
+}
+
+TEST(testDeadOperationsAreNotCompiled)
+{
+	const unsigned int K=6;
+	double x0[3]={0.7,1.3,0.4};
+	Tape live, dead;
+	live.record(Kernels{false},x0,3,2);
+	dead.record(Kernels{true},x0,3,2);
+	EXPECT(dead.size()==live.size()+2)
+	TaylorProgram<double> a(live,K), b(dead,K);
+	EXPECT(b.operations()==a.operations() && b.buffers()==a.buffers())
+	std::vector<double> x(3*(K+1),0.0), ya(2*(K+1)), yb(2*(K+1));
+	for(unsigned int j=0;j<3;++j) { x[j*(K+1)]=x0[j]; x[j*(K+1)+1]=1; }
+	a.evaluate(&x[0],&ya[0]);
+	b.evaluate(&x[0],&yb[0]);
+	EXPECT(ya==yb)
+}
+
+TEST(testMixedMatchesProgram)
+{
+	const unsigned int K=10;
+	double x0[3]={0.7,1.3,0.4};
+	Tape tape;
+	tape.record(Kernels{false},x0,3,2);
+	TaylorProgram<double> program(tape,K);
+	// With H=L the two halves run the same recurrences as one program:
+	MixedTaylorProgram<double,double> same(tape,K,4);
+	MixedTaylorProgram<double,float> mixed(tape,K,4);
+	EXPECT(mixed.split()==4 && mixed.inputs()==3 && mixed.outputs()==2)
+	std::vector<double> x(3*(K+1),0.0), y(2*(K+1)), ys(2*(K+1)), ym(2*(K+1));
+	for(unsigned int j=0;j<3;++j)
+	{
+		x[j*(K+1)]=x0[j];
+		x[j*(K+1)+1]=0.1*(j+1);
+	}
+	program.evaluate(&x[0],&y[0]);
+	same.evaluate(&x[0],&ys[0]);
+	mixed.evaluate(&x[0],&ym[0]);
+	for(unsigned int k=0;k<2;++k)
+	{
+		for(unsigned int i=0;i<=K;++i)
+		{
+			const double yi=y[k*(K+1)+i];
+			EXPECT(ys[k*(K+1)+i]==yi)
+			if (i<4) { EXPECT(ym[k*(K+1)+i]==yi) }
+			else { EXPECT(std::fabs(ym[k*(K+1)+i]-yi)<=1e-5*std::max(1.0,std::fabs(yi))) }
+		}
+	}
+}
+
+TEST(testMixedLanesMatchScalar)
+{
+	const unsigned int K=8;
+	double x0[3]={0.7,1.3,0.4};
+	Tape tape;
+	tape.record(Kernels{false},x0,3,2);
+	typedef Lanes<double,4> LD;
+	MixedTaylorProgram<double,float> scalar(tape,K,3);
+	MixedTaylorProgram<LD,Lanes<float,4> > lanes(tape,K,3);
+	std::vector<double> x(3*(K+1),0.0), y(2*(K+1));
+	std::vector<LD> xl(3*(K+1)), yl(2*(K+1));
+	for(unsigned int j=0;j<3;++j)
+	{
+		x[j*(K+1)]=x0[j];
+		x[j*(K+1)+1]=0.1*(j+1);
+		for(int w=0;w<4;++w)
+		{
+			xl[j*(K+1)][w]=x0[j];
+			xl[j*(K+1)+1][w]=0.1*(j+1);
+		}
+	}
+	scalar.evaluate(&x[0],&y[0]);
+	lanes.evaluate(&xl[0],&yl[0]);
+	for(unsigned int i=0;i<2*(K+1);++i)
+		for(int w=0;w<4;++w) EXPECT_NEAR(yl[i][w],y[i],1e-6)
+}
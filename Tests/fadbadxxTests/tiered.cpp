@@ -0,0 +1,117 @@
+//
+//  tiered.cpp
+//  fadbadxxTests
+//
+
+#include "tiered.h"
+#include "check.h"
+
+using namespace fadbad;
+
+// Neutral scalings and repeated subexpressions, so the optimized tier
+// really runs a different tape:
+struct Sum
+{
+	unsigned int n;
+	template <class V> V operator()(const V* x) const
+	{
+		V s=0.0;
+		for(unsigned int i=0;i<n;++i)
+		{
+			V a=x[i]*1.0+0.0;
+			s=s+sin(a)*exp(x[(i+1)%n]*0.1)/(1.0+sqr(x[(i+7)%n]))+pow(a*a+1.0,1.5)+atan(a)*2.0*0.5;
+		}
+		return s;
+	}
+};
+
+TEST(testTiersMatchInterpreted)
+{
+	const unsigned int n=32;
+	std::vector<double> x(n),g0(n),g(n);
+	for(unsigned int i=0;i<n;++i) x[i]=0.1*i-2;
+	Tape tape;
+	tape.record(Sum{n},&x[0],n);
+	const double y0=tape.gradient(&x[0],&g0[0]);
+	TieredTape tiered(tape);
+	tiered.background=false;
+	tiered.hot[TierOPTIMIZED]=2;
+	tiered.hot[TierNATIVE]=4;
+	for(unsigned int k=0;k<8;++k)
+	{
+		const double y=tiered.gradient(&x[0],&g[0]);
+		EXPECT_NEAR(y,y0,1e-14)
+		for(unsigned int i=0;i<n;++i) EXPECT_NEAR(g[i],g0[i],1e-13)
+		double v;
+		tiered.evaluate(&x[0],&v);
+		EXPECT_NEAR(v,y0,1e-14)
+	}
+	const TieredStats s=tiered.stats();
+#ifdef FADBAD_NATIVE_TIER
+	EXPECT(s.tier>=TierOPTIMIZED)
+#else
+	EXPECT(s.tier==TierOPTIMIZED)
+#endif
+	EXPECT(s.hits[TierINTERPRETED]>0 && s.hits[TierOPTIMIZED]>0)
+}
+
+TEST(testConcurrentCallsDuringPromotion)
+{
+	const unsigned int n=32, threads=4, calls=3000;
+	std::vector<double> x(n),g0(n);
+	for(unsigned int i=0;i<n;++i) x[i]=0.05*i-1;
+	Tape tape;
+	tape.record(Sum{n},&x[0],n);
+	const double y0=tape.gradient(&x[0],&g0[0]);
+	TieredTape tiered(tape);
+	tiered.hot[TierOPTIMIZED]=100;
+	std::atomic<int> wrong(0);
+	std::vector<std::thread> workers;
+	for(unsigned int w=0;w<threads;++w) workers.emplace_back([&]()
+	{
+		std::vector<double> g(n);
+		for(unsigned int k=0;k<calls;++k)
+		{
+			double e=std::fabs(tiered.gradient(&x[0],&g[0])-y0);
+			for(unsigned int i=0;i<n;++i) e=std::max(e,std::fabs(g[i]-g0[i]));
+			if (e>1e-12*(1+std::fabs(y0))) ++wrong;
+		}
+	});
+	for(unsigned int w=0;w<threads;++w) workers[w].join();
+	tiered.wait();
+	const TieredStats s=tiered.stats();
+	EXPECT(wrong==0)
+	EXPECT(s.tier>=TierOPTIMIZED)
+	EXPECT(s.hits[TierINTERPRETED]+s.hits[TierOPTIMIZED]+s.hits[TierNATIVE]==threads*calls)
+}
+
+TEST(testBackToBackPromotions)
+{
+	// The second promotion becomes due while the first one is still being
+	// handed over, so its caller must not touch the promoter thread of the
+	// first before that caller has stored it.
+	const unsigned int n=8, threads=4, calls=200;
+	std::vector<double> x(n),g0(n);
+	for(unsigned int i=0;i<n;++i) x[i]=0.2*i-1;
+	Tape tape;
+	tape.record(Sum{n},&x[0],n);
+	const double y0=tape.gradient(&x[0],&g0[0]);
+	for(unsigned int rep=0;rep<20;++rep)
+	{
+		TieredTape tiered(tape);
+		tiered.hot[TierOPTIMIZED]=1;
+		tiered.hot[TierNATIVE]=2;
+		std::atomic<int> wrong(0);
+		std::vector<std::thread> workers;
+		for(unsigned int w=0;w<threads;++w) workers.emplace_back([&]()
+		{
+			std::vector<double> g(n);
+			for(unsigned int k=0;k<calls;++k)
+				if (std::fabs(tiered.gradient(&x[0],&g[0])-y0)>1e-12*(1+std::fabs(y0))) ++wrong;
+		});
+		for(unsigned int w=0;w<threads;++w) workers[w].join();
+		tiered.wait();
+		EXPECT(wrong==0)
+		EXPECT(tiered.stats().tier>=TierOPTIMIZED)
+	}
+}
@@ -0,0 +1,82 @@
+//
+//  tseries.cpp
+//  fadbadxxTests
+//
+
+#include "tseries.h"
+#include "check.h"
+
+using namespace fadbad;
+
+// Lengths above SeriesKaratsubaThreshold, odd and even:
+const unsigned int Lengths[]={33,64,77,130};
+
+TEST(testMulMatchesSchoolbook)
+{
+	for(unsigned int n: Lengths)
+	{
+		std::vector<double> a(n), b(n), c(n), scratch(seriesMulScratch(n));
+		for(unsigned int i=0;i<n;++i) { a[i]=std::sin(i+1.0); b[i]=std::cos(2.0*i); }
+		seriesMul(&a[0],&b[0],&c[0],n,&scratch[0]);
+		for(unsigned int k=0;k<n;++k)
+		{
+			double s=0;
+			for(unsigned int i=0;i<=k;++i) s+=a[i]*b[k-i];
+			EXPECT_NEAR(c[k],s,1e-13)
+		}
+	}
+}
+
+TEST(testComposeExpLog1p)
+{
+	for(unsigned int n: Lengths)
+	{
+		std::vector<double> e(n), l(n,0.0), c(n);
+		e[0]=1;
+		for(unsigned int k=1;k<n;++k)
+		{
+			e[k]=e[k-1]/k;
+			l[k]=(k%2?1.0:-1.0)/k;
+		}
+		seriesCompose(&e[0],&l[0],&c[0],n);
+		EXPECT_NEAR(c[0],1,1e-14)
+		EXPECT_NEAR(c[1],1,1e-14)
+		for(unsigned int k=2;k<n;++k) EXPECT_NEAR(c[k],0,1e-14)
+	}
+}
+
+TEST(testRevertSinIsAsin)
+{
+	for(unsigned int n: Lengths)
+	{
+		std::vector<double> s(n,0.0), r(n), asin(n,0.0);
+		double f=1;
+		for(unsigned int k=1;k<n;k+=2)
+		{
+			s[k]=(k%4==1?1.0:-1.0)/f;
+			f*=(k+1.0)*(k+2.0);
+		}
+		// asin t = sum c_k t^k, c_{k+2}=c_k*k^2/((k+1)(k+2)):
+		asin[1]=1;
+		for(unsigned int k=1;k+2<n;k+=2) asin[k+2]=asin[k]*k*k/((k+1.0)*(k+2.0));
+		seriesRevert(&s[0],&r[0],n);
+		for(unsigned int k=0;k<n;++k) EXPECT_NEAR(r[k],asin[k],1e-14)
+	}
+}
+
+TEST(testInvTimesSeriesIsOne)
+{
+	for(unsigned int n: Lengths)
+	{
+		std::vector<double> a(n), r(n), p(n), q(n), scratch(seriesDivScratch(n));
+		for(unsigned int k=0;k<n;++k) a[k]=1.0/(k+1);
+		seriesInv(&a[0],&r[0],n);
+		seriesMul(&a[0],&r[0],&p[0],n);
+		EXPECT_NEAR(p[0],1,1e-14)
+		for(unsigned int k=1;k<n;++k) EXPECT_NEAR(p[k],0,1e-14)
+		// a/a through a caller-owned workspace:
+		seriesDiv(&a[0],&a[0],&q[0],n,&scratch[0]);
+		EXPECT_NEAR(q[0],1,1e-14)
+		for(unsigned int k=1;k<n;++k) EXPECT_NEAR(q[k],0,1e-14)
+	}
+}